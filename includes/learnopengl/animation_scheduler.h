@@ -0,0 +1,196 @@
+#pragma once
+
+/* Updates many animated instances at a rate that depends on their size on screen */
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/animation.h>
+#include <learnopengl/animator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+// one update-rate tier: instances at least 'minScreenHeight' pixels tall are evaluated every 'updateInterval' seconds
+struct AnimationLODLevel
+{
+	float minScreenHeight;
+	float updateInterval;
+};
+
+struct AnimationSchedulerStats
+{
+	unsigned int instanceCount = 0;
+	unsigned int posesRequested = 0;	// instances whose pose had to be refreshed this frame
+	unsigned int skeletonsEvaluated = 0;	// full hierarchy evaluations actually performed
+	unsigned int posesShared = 0;	// requests served from a palette another instance already evaluated
+};
+
+class AnimationScheduler
+{
+public:
+	// instances playing the same clip whose target times, wrapped into the clip, round to the same 'timeQuantum' (seconds)
+	// share one evaluated palette
+	AnimationScheduler(float timeQuantum = 1.0f / 60.0f)
+		: m_TimeQuantum(timeQuantum)
+	{
+		// ordered from closest to farthest, the last entry catches everything else
+		m_Levels = {
+			{ 200.0f, 0.0f },
+			{ 80.0f, 1.0f / 30.0f },
+			{ 20.0f, 1.0f / 15.0f },
+			{ 0.0f, 1.0f / 8.0f }
+		};
+	}
+
+	void SetLODLevels(const std::vector<AnimationLODLevel>& levels) { m_Levels = levels; }
+
+	// returns the handle of the new instance
+	unsigned int AddInstance(Animation* clip, float startTime = 0.0f, float playbackRate = 1.0f, float boundingRadius = 1.0f)
+	{
+		Instance instance;
+		instance.clip = clip;
+		instance.time = startTime;
+		instance.playbackRate = playbackRate;
+		instance.boundingRadius = boundingRadius;
+		m_Instances.push_back(instance);
+		if (m_Animators.find(clip) == m_Animators.end())
+			m_Animators.emplace(clip, Animator(clip));
+		return static_cast<unsigned int>(m_Instances.size() - 1);
+	}
+
+	void SetPosition(unsigned int instance, const glm::vec3& position)
+	{
+		m_Instances[instance].position = position;
+	}
+
+	// advances all instances and refreshes the poses that are due, 'viewportHeight' is in pixels
+	void Update(float dt, const glm::mat4& projection, const glm::mat4& view, float viewportHeight)
+	{
+		m_Stats = AnimationSchedulerStats();
+		m_Stats.instanceCount = static_cast<unsigned int>(m_Instances.size());
+		m_SharedPoses.clear();
+
+		for (Instance& instance : m_Instances)
+		{
+			instance.time += dt * instance.playbackRate;
+
+			float interval = updateInterval(instance, projection, view, viewportHeight);
+			if (!instance.initialized || instance.time >= instance.nextTime || interval < instance.interval)
+			{
+				// evaluate ahead of time and blend towards it, so a low-rate pose never lags behind the clip
+				float target = quantize(instance.time + interval);
+				instance.interval = interval;
+				if (!instance.initialized)
+				{
+					instance.previousTime = instance.time;
+					instance.previous = pose(instance.clip, quantize(instance.time));
+					instance.initialized = true;
+				}
+				else
+				{
+					instance.previousTime = instance.time;
+					instance.previous = instance.current;
+				}
+				instance.nextTime = target;
+				instance.next = pose(instance.clip, target);
+				m_Stats.posesRequested++;
+			}
+			blend(instance);
+		}
+	}
+
+	const std::vector<glm::mat4>& GetFinalBoneMatrices(unsigned int instance) const
+	{
+		return m_Instances[instance].current;
+	}
+
+	const AnimationSchedulerStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Instance
+	{
+		Animation* clip = nullptr;
+		float time = 0.0f;	// seconds, unwrapped
+		float playbackRate = 1.0f;
+		float boundingRadius = 1.0f;
+		glm::vec3 position = glm::vec3(0.0f);
+		bool initialized = false;
+		float interval = 0.0f;
+		float previousTime = 0.0f, nextTime = 0.0f;
+		std::vector<glm::mat4> previous, next, current;
+	};
+
+	std::vector<AnimationLODLevel> m_Levels;
+	std::vector<Instance> m_Instances;
+	std::map<Animation*, Animator> m_Animators;	// one evaluator per clip
+	std::map<std::pair<Animation*, long long>, std::vector<glm::mat4>> m_SharedPoses;	// palettes evaluated this frame
+	float m_TimeQuantum;
+	AnimationSchedulerStats m_Stats;
+
+	float quantize(float time) const
+	{
+		return m_TimeQuantum > 0.0f ? std::round(time / m_TimeQuantum) * m_TimeQuantum : time;
+	}
+
+	float updateInterval(const Instance& instance, const glm::mat4& projection, const glm::mat4& view, float viewportHeight) const
+	{
+		// projected height of the bounding sphere in pixels
+		float distance = std::max(-(view * glm::vec4(instance.position, 1.0f)).z, 0.001f);
+		float screenHeight = instance.boundingRadius * projection[1][1] * viewportHeight / distance;
+		for (const AnimationLODLevel& level : m_Levels)
+			if (screenHeight >= level.minScreenHeight)
+				return level.updateInterval;
+		return m_Levels.empty() ? 0.0f : m_Levels.back().updateInterval;
+	}
+
+	const std::vector<glm::mat4>& pose(Animation* clip, float time)
+	{
+		// the clip loops, so the key is the position within the clip; instance times are unwrapped and would
+		// otherwise never match once the instances are a whole loop apart
+		float duration = clip->GetDuration() / clip->GetTicksPerSecond();
+		if (duration > 0.0f)
+		{
+			time = std::fmod(time, duration);
+			if (time < 0.0f)
+				time += duration;
+		}
+		long long key = static_cast<long long>(time * 1000000.0f);
+		if (m_TimeQuantum > 0.0f)
+		{
+			key = std::llround(time / m_TimeQuantum);
+			// rounding up to the end of the clip is its start again
+			if (duration > 0.0f && key * m_TimeQuantum >= duration)
+				key = 0;
+			// every sharer gets the pose at the quantized time, not the one of whichever instance asked first
+			time = key * m_TimeQuantum;
+		}
+		auto shared = m_SharedPoses.find(std::make_pair(clip, key));
+		if (shared != m_SharedPoses.end())
+		{
+			m_Stats.posesShared++;
+			return shared->second;
+		}
+		Animator& animator = m_Animators.find(clip)->second;
+		animator.SetAnimationTime(time * clip->GetTicksPerSecond());
+		m_Stats.skeletonsEvaluated++;
+		return m_SharedPoses[std::make_pair(clip, key)] = animator.GetFinalBoneMatricesRef();
+	}
+
+	void blend(Instance& instance)
+	{
+		float span = instance.nextTime - instance.previousTime;
+		float factor = span > 0.0f ? glm::clamp((instance.time - instance.previousTime) / span, 0.0f, 1.0f) : 1.0f;
+		if (factor >= 1.0f)
+		{
+			instance.current = instance.next;
+			return;
+		}
+		// component-wise blend of the skinning matrices; good enough over the few frames a LOD interval spans
+		instance.current.resize(instance.next.size());
+		for (size_t i = 0; i < instance.next.size(); i++)
+			instance.current[i] = instance.previous[i] + (instance.next[i] - instance.previous[i]) * factor;
+	}
+};
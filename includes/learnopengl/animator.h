@@ -39,6 +39,18 @@ public:
 		m_CurrentTime = 0.0f;
 	}
 
+	// evaluates the pose at an absolute time (in ticks) instead of advancing by a delta
+	void SetAnimationTime(float ticks)
+	{
+		if (m_CurrentAnimation)
+		{
+			m_CurrentTime = fmod(ticks, m_CurrentAnimation->GetDuration());
+			if (m_CurrentTime < 0.0f)
+				m_CurrentTime += m_CurrentAnimation->GetDuration();
+			CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+		}
+	}
+
 	void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
 	{
 		std::string nodeName = node->name;
@@ -54,11 +66,12 @@ public:
 
 		glm::mat4 globalTransformation = parentTransform * nodeTransform;
 
-		auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-		if (boneInfoMap.find(nodeName) != boneInfoMap.end())
+		const auto& boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
+		auto boneInfo = boneInfoMap.find(nodeName);
+		if (boneInfo != boneInfoMap.end())
 		{
-			int index = boneInfoMap[nodeName].id;
-			glm::mat4 offset = boneInfoMap[nodeName].offset;
+			int index = boneInfo->second.id;
+			glm::mat4 offset = boneInfo->second.offset;
 			m_FinalBoneMatrices[index] = globalTransformation * offset;
 		}
 
@@ -71,6 +84,11 @@ public:
 		return m_FinalBoneMatrices;
 	}
 
+	const std::vector<glm::mat4>& GetFinalBoneMatricesRef() const
+	{
+		return m_FinalBoneMatrices;
+	}
+
 private:
 	std::vector<glm::mat4> m_FinalBoneMatrices;
 	Animation* m_CurrentAnimation;
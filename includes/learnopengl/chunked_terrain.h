@@ -0,0 +1,340 @@
+#pragma once
+
+/* CDLOD-style terrain: a quadtree of equally sized chunks over a heightmap, selected per frame by camera distance and frustum, geomorphed between levels */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_access.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Every node of the quadtree is drawn with the same grid of chunkQuads x chunkQuads quads, so a
+// node of level L spans chunkQuads << L heightmap pixels, with a vertex every 1 << L pixels.
+// Level 0 is the full resolution. A node is split while the camera is closer than the range of
+// the next finer level; the ranges double per level, so neighbouring nodes differ by at most one
+// level. Towards the end of its range every vertex morphs onto the grid of the next coarser level,
+// which hides the switch and keeps the seams between levels closed.
+//
+// The terrain lies in the xz plane centred on the origin, heightmap rows along x and columns
+// along z, with y = pixel * yScale - yShift. Only the heights are uploaded, two bytes per vertex:
+// the vertex's own height and the height it morphs to. The vertex shader rebuilds x and z from
+// gl_VertexID and the node uniforms (see 8.3.cpuheight_lod.vs).
+class ChunkedTerrain
+{
+public:
+	// per frame statistics of the last Draw
+	unsigned int DrawCalls = 0;
+	unsigned int Triangles = 0;
+	unsigned int CulledNodes = 0;
+
+	// data: rows x columns pixels with 'channels' bytes each, only the first channel is used
+	ChunkedTerrain(const unsigned char* data, int rows, int columns, int channels, float yScale, float yShift,
+		int chunkQuads = 32, int levels = 7, float leafRange = 192.0f)
+		: m_Rows(rows), m_Columns(columns), m_ChunkQuads(chunkQuads), m_Levels(levels), m_YScale(yScale), m_YShift(yShift)
+	{
+		for (int level = 0; level < m_Levels; level++)
+			m_Ranges.push_back(leafRange * float(1 << level));
+
+		// quadtree: the roots tile the heightmap at the coarsest level, their children are only created
+		// where they overlap it
+		int rootSpan = m_ChunkQuads << (m_Levels - 1);
+		for (int row = 0; row < m_Rows - 1; row += rootSpan)
+			for (int column = 0; column < m_Columns - 1; column += rootSpan)
+				m_Roots.push_back(createNode(row, column, m_Levels - 1));
+
+		std::vector<uint8_t> heights;
+		heights.reserve(m_Nodes.size() * (VertexCount() * 2 + 2));
+		for (Node& node : m_Nodes)
+			fillHeights(node, data, channels, heights);
+		m_HeightBytes = heights.size();
+		// a node's bounds must hold the full resolution heights under it, or the distance to a finer
+		// neighbour's seam vertices could be less than the node's selection assumed; children come
+		// after their parent, so walking backwards sees them first
+		for (int index = (int)m_Nodes.size() - 1; index >= 0; index--)
+		{
+			for (int child : m_Nodes[index].children)
+			{
+				if (child < 0)
+					continue;
+				m_Nodes[index].minY = std::min(m_Nodes[index].minY, m_Nodes[child].minY);
+				m_Nodes[index].maxY = std::max(m_Nodes[index].maxY, m_Nodes[child].maxY);
+			}
+		}
+
+		glGenVertexArrays(1, &m_VAO);
+		glBindVertexArray(m_VAO);
+		glGenBuffers(1, &m_HeightBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_HeightBuffer);
+		glBufferData(GL_ARRAY_BUFFER, heights.size(), heights.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+
+		// one strip per grid row, joined by primitive restart; the whole grid first, then its four quadrants
+		std::vector<uint16_t> indices;
+		appendGrid(indices, 0, 0, m_ChunkQuads);
+		for (int quadrant = 0; quadrant < 4; quadrant++)
+			appendGrid(indices, (quadrant / 2) * m_ChunkQuads / 2, (quadrant % 2) * m_ChunkQuads / 2, m_ChunkQuads / 2);
+		glGenBuffers(1, &m_IndexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+		glBindVertexArray(0);
+	}
+
+	~ChunkedTerrain()
+	{
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteBuffers(1, &m_HeightBuffer);
+		glDeleteBuffers(1, &m_IndexBuffer);
+	}
+
+	ChunkedTerrain(const ChunkedTerrain&) = delete;
+	ChunkedTerrain& operator=(const ChunkedTerrain&) = delete;
+
+	int VertexCount() const { return (m_ChunkQuads + 1) * (m_ChunkQuads + 1); }
+	size_t NodeCount() const { return m_Nodes.size(); }
+	size_t GpuBytes() const { return m_HeightBytes + (m_IndexCount + 4 * m_QuadrantIndexCount) * sizeof(uint16_t); }
+
+	// picks the nodes to draw for a camera at 'cameraPos' looking through 'viewProjection' (model is identity)
+	void Select(const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+	{
+		extractPlanes(viewProjection);
+		m_Selection.clear();
+		CulledNodes = 0;
+		for (int root : m_Roots)
+		{
+			// the coarsest level has no range, it covers everything further away
+			if (!selectNode(root, cameraPos) && inFrustum(m_Nodes[root]))
+				m_Selection.push_back({ root, -1 });
+		}
+	}
+
+	// draws the selected nodes with 'shader' (8.3.cpuheight_lod.vs), which must be in use
+	void Draw(Shader& shader, const glm::vec3& cameraPos)
+	{
+		shader.setInt("gridSize", m_ChunkQuads);
+		shader.setVec2("mapSize", glm::vec2(m_Rows, m_Columns));
+		shader.setFloat("yScale", m_YScale);
+		shader.setFloat("yShift", m_YShift);
+		shader.setVec3("cameraPos", cameraPos);
+
+		// the attribute is repointed per node, at the heights buffer (array buffer binding isn't VAO state)
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_HeightBuffer);
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(RESTART_INDEX);
+		DrawCalls = 0;
+		Triangles = 0;
+		for (const Selected& selected : m_Selection)
+		{
+			const Node& node = m_Nodes[selected.node];
+			float step = float(1 << node.level);
+			shader.setVec2("nodeOrigin", glm::vec2(node.row, node.column));
+			shader.setFloat("nodeStep", step);
+			shader.setVec2("morphRange", morphRange(node.level));
+			glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, GL_FALSE, 2, (void*)(node.heightOffset));
+			if (selected.quadrant < 0)
+			{
+				glDrawElements(GL_TRIANGLE_STRIP, m_IndexCount, GL_UNSIGNED_SHORT, (void*)0);
+				Triangles += 2 * m_ChunkQuads * m_ChunkQuads;
+			}
+			else
+			{
+				size_t first = m_IndexCount + selected.quadrant * m_QuadrantIndexCount;
+				glDrawElements(GL_TRIANGLE_STRIP, m_QuadrantIndexCount, GL_UNSIGNED_SHORT, (void*)(first * sizeof(uint16_t)));
+				Triangles += m_ChunkQuads * m_ChunkQuads / 2;
+			}
+			DrawCalls++;
+		}
+		glDisable(GL_PRIMITIVE_RESTART);
+		glBindVertexArray(0);
+	}
+
+private:
+	static constexpr uint16_t RESTART_INDEX = 0xFFFF;
+	// fraction of a level's range over which its vertices morph to the next level
+	static constexpr float MORPH_FRACTION = 0.3f;
+
+	struct Node
+	{
+		int row, column;	// first heightmap pixel
+		int level;
+		float minY, maxY;
+		int children[4];	// by quadrant (row half * 2 + column half), -1 outside the heightmap
+		size_t heightOffset;	// byte offset of the node's heights
+	};
+
+	struct Selected
+	{
+		int node;
+		int quadrant;	// -1 for the whole node, else only this quadrant at the node's resolution
+	};
+
+	int m_Rows, m_Columns;
+	int m_ChunkQuads;
+	int m_Levels;
+	float m_YScale, m_YShift;
+	std::vector<float> m_Ranges;	// per level, the distance up to which it is used
+	std::vector<Node> m_Nodes;
+	std::vector<int> m_Roots;
+	std::vector<Selected> m_Selection;
+	glm::vec4 m_Planes[6];
+
+	unsigned int m_VAO = 0, m_HeightBuffer = 0, m_IndexBuffer = 0;
+	int m_IndexCount = 0, m_QuadrantIndexCount = 0;
+	size_t m_HeightBytes = 0;
+
+	int createNode(int row, int column, int level)
+	{
+		int index = (int)m_Nodes.size();
+		m_Nodes.push_back({ row, column, level, 0.0f, 0.0f, { -1, -1, -1, -1 }, 0 });
+		if (level > 0)
+		{
+			int half = (m_ChunkQuads << level) / 2;
+			for (int quadrant = 0; quadrant < 4; quadrant++)
+			{
+				int childRow = row + (quadrant / 2) * half, childColumn = column + (quadrant % 2) * half;
+				if (childRow < m_Rows - 1 && childColumn < m_Columns - 1)
+				{
+					int child = createNode(childRow, childColumn, level - 1);
+					m_Nodes[index].children[quadrant] = child;
+				}
+			}
+		}
+		return index;
+	}
+
+	// heights of a node's grid, clamped to the heightmap; vertices in an odd row move one row back and
+	// vertices in an odd column one column on when morphing, so they land on the next level's grid
+	// along the diagonal the strips use
+	void fillHeights(Node& node, const unsigned char* data, int channels, std::vector<uint8_t>& heights)
+	{
+		int step = 1 << node.level;
+		auto sample = [&](int a, int b)
+		{
+			int row = std::min(node.row + a * step, m_Rows - 1), column = std::min(node.column + b * step, m_Columns - 1);
+			return data[((size_t)row * m_Columns + column) * channels];
+		};
+		node.heightOffset = heights.size();
+		uint8_t low = 255, high = 0;
+		for (int a = 0; a <= m_ChunkQuads; a++)
+		{
+			for (int b = 0; b <= m_ChunkQuads; b++)
+			{
+				uint8_t height = sample(a, b);
+				heights.push_back(height);
+				heights.push_back(sample(a - a % 2, b + b % 2));
+				low = std::min(low, height);
+				high = std::max(high, height);
+			}
+		}
+		// every node starts 4 byte aligned
+		while (heights.size() % 4 != 0)
+			heights.push_back(0);
+		node.minY = low * m_YScale - m_YShift;
+		node.maxY = high * m_YScale - m_YShift;
+	}
+
+	void appendGrid(std::vector<uint16_t>& indices, int firstRow, int firstColumn, int quads)
+	{
+		size_t start = indices.size();
+		for (int a = firstRow; a < firstRow + quads; a++)
+		{
+			if (a > firstRow)
+				indices.push_back(RESTART_INDEX);
+			for (int b = firstColumn; b <= firstColumn + quads; b++)
+			{
+				indices.push_back(uint16_t(a * (m_ChunkQuads + 1) + b));
+				indices.push_back(uint16_t((a + 1) * (m_ChunkQuads + 1) + b));
+			}
+		}
+		int count = int(indices.size() - start);
+		if (quads == m_ChunkQuads)
+			m_IndexCount = count;
+		else
+			m_QuadrantIndexCount = count;
+	}
+
+	glm::vec2 morphRange(int level) const
+	{
+		if (level == m_Levels - 1)
+			return glm::vec2(1e30f, 2e30f);	// nothing coarser to morph to
+		float end = m_Ranges[level];
+		float start = end - (end - (level > 0 ? m_Ranges[level - 1] : 0.0f)) * MORPH_FRACTION;
+		return glm::vec2(start, end);
+	}
+
+	void bounds(const Node& node, glm::vec3& low, glm::vec3& high) const
+	{
+		int span = m_ChunkQuads << node.level;
+		low = glm::vec3(-m_Rows / 2.0f + node.row, node.minY, -m_Columns / 2.0f + node.column);
+		high = glm::vec3(-m_Rows / 2.0f + std::min(node.row + span, m_Rows - 1), node.maxY,
+			-m_Columns / 2.0f + std::min(node.column + span, m_Columns - 1));
+	}
+
+	bool inRange(const Node& node, const glm::vec3& cameraPos, float range) const
+	{
+		glm::vec3 low, high;
+		bounds(node, low, high);
+		glm::vec3 closest = glm::clamp(cameraPos, low, high);
+		glm::vec3 offset = closest - cameraPos;
+		return glm::dot(offset, offset) <= range * range;
+	}
+
+	// true if the node is handled (drawn, split or culled), false if it is out of its level's range
+	// and must be drawn by its parent
+	bool selectNode(int index, const glm::vec3& cameraPos)
+	{
+		const Node& node = m_Nodes[index];
+		if (node.level < m_Levels - 1 && !inRange(node, cameraPos, m_Ranges[node.level]))
+			return false;
+		if (!inFrustum(node))
+		{
+			CulledNodes++;
+			return true;
+		}
+		if (node.level == 0 || !inRange(node, cameraPos, m_Ranges[node.level - 1]))
+		{
+			m_Selection.push_back({ index, -1 });
+			return true;
+		}
+		for (int quadrant = 0; quadrant < 4; quadrant++)
+		{
+			int child = node.children[quadrant];
+			if (child >= 0 && !selectNode(child, cameraPos))
+				m_Selection.push_back({ index, quadrant });
+		}
+		return true;
+	}
+
+	// frustum planes from the view-projection matrix, pointing inwards
+	void extractPlanes(const glm::mat4& viewProjection)
+	{
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::row(viewProjection, i);
+		for (int i = 0; i < 3; i++)
+		{
+			m_Planes[i * 2] = rows[3] + rows[i];
+			m_Planes[i * 2 + 1] = rows[3] - rows[i];
+		}
+	}
+
+	bool inFrustum(const Node& node) const
+	{
+		glm::vec3 low, high;
+		bounds(node, low, high);
+		for (const glm::vec4& plane : m_Planes)
+		{
+			// the box corner furthest along the plane normal
+			glm::vec3 corner(plane.x > 0.0f ? high.x : low.x, plane.y > 0.0f ? high.y : low.y, plane.z > 0.0f ? high.z : low.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+/* Compute min/max reduction of a depth buffer to view distances, read back through pixel buffers without stalling */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_c.h>
+
+#include <cstring>
+
+// Reduce() runs the compute shader (10.depth_reduce.cs) over a depth texture: every work group
+// reduces a 16 x 16 tile to the nearest and farthest view distance, skipping cleared pixels, and
+// merges it into a 2 x 1 GL_R32UI texture with image atomics. Positive floats order like their
+// bit patterns, so the atomics work on floatBitsToUint(). The result is copied into one of two pixel
+// pack buffers and fenced; Latest() maps a buffer only once its fence has signalled, so the range
+// arrives a frame (or more, if the GPU falls behind) after the depth it came from.
+class DepthRangeReducer
+{
+public:
+	DepthRangeReducer(const char* computePath = "10.depth_reduce.cs")
+		: m_Shader(computePath)
+	{
+		glGenTextures(1, &m_RangeTexture);
+		glBindTexture(GL_TEXTURE_2D, m_RangeTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, 2, 1, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenBuffers(2, m_ReadBuffers);
+		for (unsigned int buffer : m_ReadBuffers)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, 2 * sizeof(unsigned int), nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	~DepthRangeReducer()
+	{
+		for (GLsync& fence : m_Fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+		glDeleteBuffers(2, m_ReadBuffers);
+		glDeleteTextures(1, &m_RangeTexture);
+		glDeleteProgram(m_Shader.ID);
+	}
+
+	DepthRangeReducer(const DepthRangeReducer&) = delete;
+	DepthRangeReducer& operator=(const DepthRangeReducer&) = delete;
+
+	// depthTexture was written with a perspective projection from nearPlane to farPlane; it must not
+	// use depth comparison
+	void Reduce(unsigned int depthTexture, int width, int height, float nearPlane, float farPlane)
+	{
+		const unsigned int reset[2] = { 0xFFFFFFFFu, 0u };
+		glBindTexture(GL_TEXTURE_2D, m_RangeTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 2, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, reset);
+
+		m_Shader.use();
+		m_Shader.setInt("depthMap", 0);
+		m_Shader.setFloat("nearPlane", nearPlane);
+		m_Shader.setFloat("farPlane", farPlane);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		glBindImageTexture(0, m_RangeTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+		glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+		glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+		// a buffer whose result was never picked up is simply overwritten
+		if (m_Fences[m_Next])
+			glDeleteSync(m_Fences[m_Next]);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadBuffers[m_Next]);
+		glBindTexture(GL_TEXTURE_2D, m_RangeTexture);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		m_Fences[m_Next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_Next = 1 - m_Next;
+	}
+
+	// picks up every finished readback without waiting; range is the nearest and farthest view
+	// distance of the newest one. Returns false while no reduction has finished or when the last
+	// depth buffer held no geometry.
+	bool Latest(glm::vec2& range)
+	{
+		// the older of the two buffers first
+		for (int i = 0; i < 2; i++)
+		{
+			int slot = (m_Next + i) % 2;
+			if (!m_Fences[slot] || glClientWaitSync(m_Fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED)
+				continue;
+			glDeleteSync(m_Fences[slot]);
+			m_Fences[slot] = 0;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadBuffers[slot]);
+			const unsigned int* bits = (const unsigned int*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 2 * sizeof(unsigned int), GL_MAP_READ_BIT);
+			if (bits)
+			{
+				m_Valid = bits[0] <= bits[1];
+				std::memcpy(&m_Range.x, &bits[0], sizeof(float));
+				std::memcpy(&m_Range.y, &bits[1], sizeof(float));
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		range = m_Range;
+		return m_Valid;
+	}
+
+private:
+	ComputeShader m_Shader;
+	unsigned int m_RangeTexture = 0;
+	unsigned int m_ReadBuffers[2] = { 0, 0 };
+	GLsync m_Fences[2] = { 0, 0 };
+	int m_Next = 0;
+	glm::vec2 m_Range = glm::vec2(0.0f);
+	bool m_Valid = false;
+};
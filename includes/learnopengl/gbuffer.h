@@ -0,0 +1,148 @@
+#pragma once
+
+/* Deferred shading G-buffer: the wide layout with a position target, or a packed one that reconstructs position from depth */
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// Both layouts render into a GL_DEPTH24_STENCIL8 texture and use the same attachment points, so
+// the geometry shaders keep their output locations:
+//
+//   location 0  position       GL_RGBA16F, 8 bytes    packed: not stored
+//   location 1  normal         GL_RGBA16F, 8 bytes    packed: octahedral, GL_RG16, 4 bytes
+//   location 2  albedo + spec  GL_RGBA8, 4 bytes      packed: the same
+//   depth                      4 bytes                packed: the same
+//
+// In the packed layout draw buffer 0 is GL_NONE, so whatever the shader writes to location 0 is
+// dropped; the lighting shaders rebuild the position from the depth texture and the inverse
+// projection instead, and decode the two normal components (see the geometry and lighting shaders
+// of the deferred shading and SSAO demos). That halves the bytes written per pixel by the geometry
+// pass and read per pixel by every full-screen pass after it.
+//
+// BindTextures() binds position, normal, albedo and depth to four consecutive texture units; the
+// position texture is 0 in the packed layout.
+class GBuffer
+{
+public:
+	enum Layout
+	{
+		GBUFFER_WIDE,
+		GBUFFER_PACKED
+	};
+
+	GBuffer(int width, int height, Layout layout)
+		: m_Width(width), m_Height(height), m_Layout(layout)
+	{
+		create();
+	}
+
+	~GBuffer()
+	{
+		release();
+	}
+
+	GBuffer(const GBuffer&) = delete;
+	GBuffer& operator=(const GBuffer&) = delete;
+
+	static const char* LayoutName(Layout layout)
+	{
+		return layout == GBUFFER_PACKED ? "packed G-buffer" : "wide G-buffer";
+	}
+
+	// recreates the targets; their contents are lost
+	void SetLayout(Layout layout)
+	{
+		if (layout == m_Layout)
+			return;
+		release();
+		m_Layout = layout;
+		create();
+	}
+
+	Layout GetLayout() const { return m_Layout; }
+	bool Packed() const { return m_Layout == GBUFFER_PACKED; }
+	unsigned int FBO() const { return m_FBO; }
+	unsigned int Position() const { return m_Position; }
+	unsigned int Normal() const { return m_Normal; }
+	unsigned int AlbedoSpec() const { return m_AlbedoSpec; }
+	unsigned int Depth() const { return m_Depth; }
+
+	// storage per pixel over all targets, depth included
+	int BytesPerPixel() const
+	{
+		return m_Layout == GBUFFER_PACKED ? 4 + 4 + 4 : 8 + 8 + 4 + 4;
+	}
+
+	void BindTextures(unsigned int firstUnit = 0) const
+	{
+		const unsigned int textures[4] = { m_Position, m_Normal, m_AlbedoSpec, m_Depth };
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+private:
+	int m_Width, m_Height;
+	Layout m_Layout;
+	unsigned int m_FBO = 0;
+	unsigned int m_Position = 0, m_Normal = 0, m_AlbedoSpec = 0, m_Depth = 0;
+
+	void create()
+	{
+		glGenFramebuffers(1, &m_FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+		if (m_Layout == GBUFFER_WIDE)
+		{
+			m_Position = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Position, 0);
+			m_Normal = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+		}
+		else
+			m_Normal = createTarget(GL_RG16, GL_RG, GL_UNSIGNED_SHORT);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_Normal, 0);
+		m_AlbedoSpec = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_AlbedoSpec, 0);
+		// the stencil bits come for free with 24 bit depth, and match the usual default framebuffer
+		// format so the depth can be blitted there
+		m_Depth = createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_Depth, 0);
+
+		unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		if (m_Layout == GBUFFER_PACKED)
+			attachments[0] = GL_NONE;
+		glDrawBuffers(3, attachments);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::GBUFFER: Framebuffer is not complete!" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void release()
+	{
+		glDeleteFramebuffers(1, &m_FBO);
+		const unsigned int textures[4] = { m_Position, m_Normal, m_AlbedoSpec, m_Depth };
+		for (unsigned int texture : textures)
+		{
+			if (texture)
+				glDeleteTextures(1, &texture);
+		}
+		m_FBO = m_Position = m_Normal = m_AlbedoSpec = m_Depth = 0;
+	}
+
+	unsigned int createTarget(GLenum internalFormat, GLenum format, GLenum type)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_Width, m_Height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+};
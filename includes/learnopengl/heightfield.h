@@ -0,0 +1,138 @@
+#pragma once
+
+/* Full resolution heightfield drawn by vertex pulling: only heights and normals are stored, in textures */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Heights go into a GL_R8 texture and normals into a GL_RG8_SNORM texture (x and z, y follows from
+// them), 3 bytes per heightmap pixel against 12 bytes of position plus 8 bytes of strip indices for
+// a vertex buffer mesh. There is no vertex or index buffer: Draw() issues one instanced triangle
+// strip per row pair and the vertex shader (8.3.cpuheight.vs) rebuilds the vertex from gl_VertexID
+// and gl_InstanceID. Same layout as ChunkedTerrain: rows along x, columns along z, centred on the
+// origin, y = pixel * yScale - yShift.
+class Heightfield
+{
+public:
+	double BuildMilliseconds = 0.0;	// CPU time of the normals and the uploads
+
+	// data: rows x columns pixels with 'channels' bytes each, only the first channel is used
+	Heightfield(const unsigned char* data, int rows, int columns, int channels, float yScale, float yShift)
+		: m_Rows(rows), m_Columns(columns), m_YScale(yScale), m_YShift(yShift)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		std::vector<uint8_t> heights((size_t)rows * columns);
+		std::vector<int8_t> normals((size_t)rows * columns * 2);
+
+		// every thread takes a band of rows
+		unsigned int threads = std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)rows));
+		std::vector<std::thread> workers;
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			int first = (int)((size_t)rows * i / threads), last = (int)((size_t)rows * (i + 1) / threads);
+			workers.push_back(std::thread([&, first, last]() { fillRows(data, channels, first, last, heights, normals); }));
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+
+		glGenVertexArrays(1, &m_VAO);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glGenTextures(1, &m_HeightTexture);
+		glBindTexture(GL_TEXTURE_2D, m_HeightTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, columns, rows, 0, GL_RED, GL_UNSIGNED_BYTE, heights.data());
+		setFiltering();
+		glGenTextures(1, &m_NormalTexture);
+		glBindTexture(GL_TEXTURE_2D, m_NormalTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8_SNORM, columns, rows, 0, GL_RG, GL_BYTE, normals.data());
+		setFiltering();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		BuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	~Heightfield()
+	{
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteTextures(1, &m_HeightTexture);
+		glDeleteTextures(1, &m_NormalTexture);
+	}
+
+	Heightfield(const Heightfield&) = delete;
+	Heightfield& operator=(const Heightfield&) = delete;
+
+	size_t GpuBytes() const { return (size_t)m_Rows * m_Columns * 3; }
+	// what the same mesh took as float positions and unsigned int strip indices
+	size_t MeshBytes() const { return (size_t)m_Rows * m_Columns * 3 * sizeof(float) + (size_t)(m_Rows - 1) * m_Columns * 2 * sizeof(unsigned int); }
+	unsigned int Triangles() const { return (unsigned int)((m_Rows - 1) * (m_Columns * 2 - 2)); }
+
+	// binds the height and normal textures to 'firstUnit' and the unit after it; ChunkedTerrain's
+	// shader can take the normals from here too
+	void Bind(Shader& shader, int firstUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit);
+		glBindTexture(GL_TEXTURE_2D, m_HeightTexture);
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+		glBindTexture(GL_TEXTURE_2D, m_NormalTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("heights", firstUnit);
+		shader.setInt("normals", firstUnit + 1);
+	}
+
+	// draws the whole heightfield with 'shader' (8.3.cpuheight.vs), which must be in use
+	void Draw(Shader& shader)
+	{
+		Bind(shader, 0);
+		shader.setFloat("yScale", m_YScale);
+		shader.setFloat("yShift", m_YShift);
+		shader.setVec2("mapSize", glm::vec2(m_Rows, m_Columns));
+		glBindVertexArray(m_VAO);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, m_Columns * 2, m_Rows - 1);
+		glBindVertexArray(0);
+	}
+
+private:
+	int m_Rows, m_Columns;
+	float m_YScale, m_YShift;
+	unsigned int m_VAO = 0, m_HeightTexture = 0, m_NormalTexture = 0;
+
+	static void setFiltering()
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// heights and central difference normals of rows [first, last), the edges repeat the border pixels
+	void fillRows(const unsigned char* data, int channels, int first, int last, std::vector<uint8_t>& heights, std::vector<int8_t>& normals) const
+	{
+		size_t stride = (size_t)m_Columns * channels;
+		for (int row = first; row < last; row++)
+		{
+			const unsigned char* center = data + row * stride;
+			const unsigned char* above = data + std::max(row - 1, 0) * stride;
+			const unsigned char* below = data + std::min(row + 1, m_Rows - 1) * stride;
+			for (int column = 0; column < m_Columns; column++)
+			{
+				size_t index = (size_t)row * m_Columns + column;
+				int left = std::max(column - 1, 0) * channels, right = std::min(column + 1, m_Columns - 1) * channels;
+				heights[index] = center[column * channels];
+				// normalize((dx, 2, dz)) with dx and dz the height differences over two pixels
+				float dx = (above[column * channels] - below[column * channels]) * m_YScale;
+				float dz = (center[left] - center[right]) * m_YScale;
+				float scale = 127.0f / std::sqrt(dx * dx + 4.0f + dz * dz);
+				normals[index * 2] = (int8_t)std::floor(dx * scale + 0.5f);
+				normals[index * 2 + 1] = (int8_t)std::floor(dz * scale + 0.5f);
+			}
+		}
+	}
+};
@@ -0,0 +1,384 @@
+#pragma once
+
+/* Streams the tiles of a TiledHeightmap around the camera: background loading, LRU caches, GPU page table */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/tiled_heightmap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Every frame Update() decides which tiles should be resident: those within ResidentRadius tiles of
+// the camera and of a point PrefetchDistance tiles ahead of it, nearest first. Missing tiles are
+// read from the mapped file by a loader thread into a CPU cache; cached tiles are uploaded into
+// free slots of a texture array, at most UploadsPerFrame per frame, evicting the slot used least
+// recently. A page table texture holds slot + 1 for every resident tile and 0 for the others,
+// where the shader falls back to the overview that is always resident.
+//
+// The shader finds the tile of raster pixel p = uv * mapSize - 0.5 with texelFetch(pageTable, ...),
+// then samples the array at (p - tile * tileSize + 0.5) / (tileSize + 1) in layer slot - 1; see
+// sampleHeight() in 8.3.gpuheight.tes of terrain_gpu_dist.
+class HeightmapStreamer
+{
+public:
+	// counts of the last Update
+	struct FrameStats
+	{
+		unsigned int Wanted = 0;
+		unsigned int Missing = 0;	// wanted near the camera but not resident, drawn from the overview
+		unsigned int Requested = 0;	// queued for the loader
+		unsigned int Loaded = 0;	// arrived from the loader
+		unsigned int Uploaded = 0;
+		unsigned int Evicted = 0;
+		double UpdateMilliseconds = 0.0;
+	};
+
+	int ResidentRadius;	// tiles around the camera that should be resident
+	float PrefetchDistance;	// tiles ahead of the camera around which tiles are prefetched
+	int UploadsPerFrame;
+	FrameStats LastFrame;
+
+	HeightmapStreamer(const TiledHeightmap& map, int gpuSlots = 128, int cpuTiles = 256, int residentRadius = 4,
+		float prefetchDistance = 4.0f, int uploadsPerFrame = 4)
+		: ResidentRadius(residentRadius), PrefetchDistance(prefetchDistance), UploadsPerFrame(uploadsPerFrame),
+		m_Map(map), m_GpuSlots(gpuSlots), m_CpuTiles(std::max(cpuTiles, gpuSlots))
+	{
+		int tiles = m_Map.TilesX() * m_Map.TilesY();
+		m_Tiles.resize(tiles);
+		m_PageTable.assign(tiles, 0);
+		m_SlotTile.assign(m_GpuSlots, -1);
+		m_SlotUsed.assign(m_GpuSlots, 0);
+		for (int slot = m_GpuSlots - 1; slot >= 0; slot--)
+			m_FreeSlots.push_back(slot);
+
+		int side = m_Map.TileSize() + 1;
+		glGenTextures(1, &m_TileArray);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_TileArray);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, side, side, m_GpuSlots, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+		setFiltering(GL_TEXTURE_2D_ARRAY, GL_LINEAR, GL_LINEAR);
+
+		glGenTextures(1, &m_PageTableTexture);
+		glBindTexture(GL_TEXTURE_2D, m_PageTableTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, m_Map.TilesX(), m_Map.TilesY(), 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, m_PageTable.data());
+		setFiltering(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+
+		glGenTextures(1, &m_OverviewTexture);
+		glBindTexture(GL_TEXTURE_2D, m_OverviewTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, m_Map.OverviewWidth(), m_Map.OverviewHeight(), 0, GL_RED, GL_UNSIGNED_SHORT, m_Map.Overview());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		setFiltering(GL_TEXTURE_2D, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		m_Loader = std::thread(&HeightmapStreamer::loaderLoop, this);
+	}
+
+	~HeightmapStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Wake.notify_one();
+		m_Loader.join();
+		glDeleteTextures(1, &m_TileArray);
+		glDeleteTextures(1, &m_PageTableTexture);
+		glDeleteTextures(1, &m_OverviewTexture);
+	}
+
+	HeightmapStreamer(const HeightmapStreamer&) = delete;
+	HeightmapStreamer& operator=(const HeightmapStreamer&) = delete;
+
+	// camera position and viewing direction in raster pixels (x along the width, y along the height)
+	void Update(const glm::vec2& cameraPixel, const glm::vec2& cameraDirection)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_Frame++;
+		LastFrame = FrameStats();
+
+		// tiles the loader finished go to the CPU cache
+		std::vector<LoadedTile> loaded;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			loaded.swap(m_Completed);
+		}
+		for (LoadedTile& tile : loaded)
+		{
+			if (m_Tiles[tile.index].state != TILE_QUEUED)
+				continue;
+			m_Cache[tile.index].swap(tile.samples);
+			m_Tiles[tile.index].state = TILE_CACHED;
+			LastFrame.Loaded++;
+		}
+
+		// wanted tiles, nearest to the camera first
+		float tileSize = (float)m_Map.TileSize();
+		glm::vec2 cameraTile = cameraPixel / tileSize;
+		glm::vec2 ahead = cameraTile;
+		if (glm::dot(cameraDirection, cameraDirection) > 0.0f)
+			ahead += glm::normalize(cameraDirection) * PrefetchDistance;
+		m_Wanted.clear();
+		gatherWanted(cameraTile, cameraTile);
+		gatherWanted(ahead, cameraTile);
+		std::sort(m_Wanted.begin(), m_Wanted.end(), [](const Wanted& a, const Wanted& b) { return a.distance < b.distance; });
+		LastFrame.Wanted = (unsigned int)m_Wanted.size();
+
+		// mark every wanted tile first, so an upload below never evicts a resident tile that is
+		// wanted this frame but farther from the camera than the one being uploaded
+		for (const Wanted& wanted : m_Wanted)
+		{
+			Tile& tile = m_Tiles[wanted.index];
+			tile.used = m_Frame;
+			if (tile.slot >= 0)
+				m_SlotUsed[tile.slot] = m_Frame;
+		}
+
+		std::vector<int> requests;
+		for (const Wanted& wanted : m_Wanted)
+		{
+			Tile& tile = m_Tiles[wanted.index];
+			if (tile.slot >= 0)
+				continue;
+			if (wanted.distance <= ResidentRadius)
+				LastFrame.Missing++;
+			if (tile.state == TILE_CACHED)
+			{
+				if ((int)LastFrame.Uploaded < UploadsPerFrame)
+					upload(wanted.index);
+			}
+			else
+			{
+				if (tile.state == TILE_NONE)
+					LastFrame.Requested++;
+				tile.state = TILE_QUEUED;
+				requests.push_back(wanted.index);
+			}
+		}
+
+		// the request list is replaced as a whole: tiles the camera moved away from are dropped
+		// unless they are already being loaded
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (int index : m_Requests)
+				if (m_Tiles[index].used != m_Frame)
+					m_Tiles[index].state = TILE_NONE;
+			requests.erase(std::remove(requests.begin(), requests.end(), m_Loading), requests.end());
+			m_Requests.swap(requests);
+		}
+		m_Wake.notify_one();
+		trimCache();
+
+		if (m_PageTableDirty)
+		{
+			glBindTexture(GL_TEXTURE_2D, m_PageTableTexture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_Map.TilesX(), m_Map.TilesY(), GL_RED_INTEGER, GL_UNSIGNED_SHORT, m_PageTable.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			m_PageTableDirty = false;
+		}
+		LastFrame.UpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// binds the page table, tile array and overview to 'firstUnit' and the two units after it
+	void Bind(Shader& shader, int firstUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit);
+		glBindTexture(GL_TEXTURE_2D, m_PageTableTexture);
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_TileArray);
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+		glBindTexture(GL_TEXTURE_2D, m_OverviewTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("pageTable", firstUnit);
+		shader.setInt("heightTiles", firstUnit + 1);
+		shader.setInt("overview", firstUnit + 2);
+		shader.setVec2("mapSize", glm::vec2(m_Map.Width(), m_Map.Height()));
+		shader.setFloat("tileSize", (float)m_Map.TileSize());
+		shader.setFloat("overviewStep", (float)m_Map.OverviewStep());
+	}
+
+	unsigned int ResidentTiles() const { return m_GpuSlots - (unsigned int)m_FreeSlots.size(); }
+	size_t CachedTiles() const { return m_Cache.size(); }
+	size_t TileBytes() const { return (size_t)m_Map.TileSamples() * sizeof(uint16_t); }
+	size_t CpuBytes() const { return m_Cache.size() * TileBytes() + m_Tiles.size() * (sizeof(Tile) + sizeof(uint16_t)); }
+	size_t GpuBytes() const
+	{
+		size_t overview = (size_t)m_Map.OverviewWidth() * m_Map.OverviewHeight() * sizeof(uint16_t) * 4 / 3;
+		return m_GpuSlots * TileBytes() + m_PageTable.size() * sizeof(uint16_t) + overview;
+	}
+
+private:
+	enum TileState : uint8_t
+	{
+		TILE_NONE,
+		TILE_QUEUED,	// requested from (or being read by) the loader
+		TILE_CACHED
+	};
+
+	struct Tile
+	{
+		TileState state = TILE_NONE;
+		int slot = -1;	// GPU slot, -1 if not resident
+		unsigned int used = 0;	// last frame the tile was wanted
+	};
+
+	struct Wanted
+	{
+		int index;
+		float distance;	// in tiles, from the camera
+	};
+
+	struct LoadedTile
+	{
+		int index;
+		std::vector<uint16_t> samples;
+	};
+
+	const TiledHeightmap& m_Map;
+	int m_GpuSlots;
+	size_t m_CpuTiles;
+	unsigned int m_Frame = 0;
+
+	// main thread state
+	std::vector<Tile> m_Tiles;
+	std::unordered_map<int, std::vector<uint16_t>> m_Cache;
+	std::vector<uint16_t> m_PageTable;
+	bool m_PageTableDirty = false;
+	std::vector<int> m_SlotTile;
+	std::vector<unsigned int> m_SlotUsed;
+	std::vector<int> m_FreeSlots;
+	std::vector<Wanted> m_Wanted;
+	unsigned int m_TileArray = 0, m_PageTableTexture = 0, m_OverviewTexture = 0;
+
+	// shared with the loader thread
+	std::thread m_Loader;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::vector<int> m_Requests;	// nearest first
+	std::vector<LoadedTile> m_Completed;
+	int m_Loading = -1;	// tile the loader is reading
+	bool m_Stop = false;
+
+	static void setFiltering(GLenum target, GLint minFilter, GLint magFilter)
+	{
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, magFilter);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// adds the tiles within ResidentRadius of 'center', skipping those added already this frame
+	void gatherWanted(const glm::vec2& center, const glm::vec2& cameraTile)
+	{
+		int x0 = std::max(0, (int)std::floor(center.x) - ResidentRadius), x1 = std::min(m_Map.TilesX() - 1, (int)std::floor(center.x) + ResidentRadius);
+		int y0 = std::max(0, (int)std::floor(center.y) - ResidentRadius), y1 = std::min(m_Map.TilesY() - 1, (int)std::floor(center.y) + ResidentRadius);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				glm::vec2 middle(x + 0.5f, y + 0.5f);
+				int index = y * m_Map.TilesX() + x;
+				if (glm::length(middle - center) > ResidentRadius + 0.5f || m_Tiles[index].used == m_Frame)
+					continue;
+				m_Tiles[index].used = m_Frame;
+				m_Wanted.push_back({ index, glm::length(middle - cameraTile) });
+			}
+		}
+	}
+
+	void upload(int index)
+	{
+		int slot = acquireSlot();
+		if (slot < 0)
+			return;
+		Tile& tile = m_Tiles[index];
+		tile.slot = slot;
+		m_SlotTile[slot] = index;
+		m_SlotUsed[slot] = m_Frame;
+		int side = m_Map.TileSize() + 1;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_TileArray);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, side, side, 1, GL_RED, GL_UNSIGNED_SHORT, m_Cache[index].data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		m_PageTable[index] = uint16_t(slot + 1);
+		m_PageTableDirty = true;
+		LastFrame.Uploaded++;
+	}
+
+	// a free slot, or the one least recently used if it isn't wanted this frame
+	int acquireSlot()
+	{
+		if (!m_FreeSlots.empty())
+		{
+			int slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			return slot;
+		}
+		int oldest = 0;
+		for (int slot = 1; slot < m_GpuSlots; slot++)
+			if (m_SlotUsed[slot] < m_SlotUsed[oldest])
+				oldest = slot;
+		if (m_SlotUsed[oldest] == m_Frame)
+			return -1;
+		int evicted = m_SlotTile[oldest];
+		m_Tiles[evicted].slot = -1;
+		m_PageTable[evicted] = 0;
+		LastFrame.Evicted++;
+		return oldest;
+	}
+
+	// drops the least recently wanted CPU tiles over capacity, but none wanted this frame. Whether a
+	// tile is also resident on the GPU doesn't matter: a dropped tile that is evicted from the GPU
+	// later is read from disk again
+	void trimCache()
+	{
+		if (m_Cache.size() <= m_CpuTiles)
+			return;
+		std::vector<std::pair<unsigned int, int>> byUse;
+		byUse.reserve(m_Cache.size());
+		for (const auto& entry : m_Cache)
+			byUse.push_back({ m_Tiles[entry.first].used, entry.first });
+		std::sort(byUse.begin(), byUse.end());
+		for (size_t i = 0; i < byUse.size() - m_CpuTiles && byUse[i].first != m_Frame; i++)
+		{
+			m_Cache.erase(byUse[i].second);
+			m_Tiles[byUse[i].second].state = TILE_NONE;
+		}
+	}
+
+	void loaderLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			m_Wake.wait(lock, [this]() { return m_Stop || !m_Requests.empty(); });
+			if (m_Stop)
+				return;
+			int index = m_Requests.front();
+			m_Requests.erase(m_Requests.begin());
+			m_Loading = index;
+			lock.unlock();
+
+			// copying out of the mapping is where the tile is read from disk
+			LoadedTile tile;
+			tile.index = index;
+			const uint16_t* samples = m_Map.Tile(index % m_Map.TilesX(), index / m_Map.TilesX());
+			tile.samples.assign(samples, samples + m_Map.TileSamples());
+
+			lock.lock();
+			m_Completed.push_back(std::move(tile));
+			m_Loading = -1;
+		}
+	}
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+/* Records GLFW key, cursor and scroll input to a file and replays it at a fixed time step, for repeatable runs */
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Set LOGL_RECORD_INPUT=<file> to record a session, LOGL_REPLAY_INPUT=<file> to replay one.
+// While replaying, real input is ignored, every frame advances by LOGL_REPLAY_DT seconds
+// (default 1/60) and the window closes after the last recorded frame, printing frame times.
+//
+// Usage: call Attach() after installing the program's own GLFW callbacks, take the frame's
+// delta time from Update() right after measuring it, and read keys with GetKey() instead of
+// glfwGetKey(). Callbacks installed before Attach() receive the replayed events.
+class InputRecorder
+{
+public:
+	enum Mode
+	{
+		INPUT_LIVE,
+		INPUT_RECORD,
+		INPUT_REPLAY
+	};
+
+	InputRecorder()
+	{
+		const char* record = std::getenv("LOGL_RECORD_INPUT");
+		const char* replay = std::getenv("LOGL_REPLAY_INPUT");
+		const char* replayDt = std::getenv("LOGL_REPLAY_DT");
+		if (replay != nullptr && load(replay))
+		{
+			m_Mode = INPUT_REPLAY;
+			if (replayDt != nullptr && std::atof(replayDt) > 0.0)
+				m_ReplayDeltaTime = static_cast<float>(std::atof(replayDt));
+		}
+		else if (record != nullptr)
+		{
+			m_Mode = INPUT_RECORD;
+			m_File = record;
+		}
+		s_Instance = this;
+	}
+
+	~InputRecorder()
+	{
+		if (m_Mode == INPUT_RECORD)
+			save();
+		if (s_Instance == this)
+			s_Instance = nullptr;
+	}
+
+	Mode GetMode() const { return m_Mode; }
+	bool IsReplaying() const { return m_Mode == INPUT_REPLAY; }
+
+	// puts the recorder in front of the window's key, cursor and scroll callbacks
+	void Attach(GLFWwindow* window)
+	{
+		m_Window = window;
+		if (m_Mode == INPUT_LIVE)
+			return;
+		m_KeyCallback = glfwSetKeyCallback(window, keyCallback);
+		m_CursorCallback = glfwSetCursorPosCallback(window, cursorCallback);
+		m_ScrollCallback = glfwSetScrollCallback(window, scrollCallback);
+	}
+
+	// advances the input clock by one frame and returns the delta time the frame should use;
+	// when replaying, this delivers the events recorded up to the current time
+	float Update(float deltaTime)
+	{
+		if (m_Mode == INPUT_RECORD)
+		{
+			// the first frame is measured from glfwInit and would stretch the recording by the startup
+			// time; it takes no time, like the first replayed frame
+			if (m_Frames++ == 0)
+				deltaTime = 0.0f;
+			m_Time += deltaTime;
+		}
+		if (m_Mode != INPUT_REPLAY)
+			return deltaTime;
+
+		// frame time statistics, measured between Update calls
+		double now = glfwGetTime();
+		if (m_Frames > 0)
+		{
+			double frameTime = now - m_LastFrameStart;
+			m_FrameTimeTotal += frameTime;
+			m_FrameTimeMax = m_Frames == 1 ? frameTime : std::max(m_FrameTimeMax, frameTime);
+			m_FrameTimeMin = m_Frames == 1 ? frameTime : std::min(m_FrameTimeMin, frameTime);
+		}
+		m_LastFrameStart = now;
+		m_Frames++;
+
+		for (; m_Next < m_Events.size() && m_Events[m_Next].time <= m_Time; ++m_Next)
+			deliver(m_Events[m_Next]);
+		if (m_Next == m_Events.size() && m_Time >= m_EndTime && !m_Finished)
+		{
+			m_Finished = true;
+			glfwSetWindowShouldClose(m_Window, true);
+			if (m_Frames > 1)
+				std::cout << "input replay: " << m_Frames - 1 << " frames, " << m_FrameTimeTotal / (m_Frames - 1) * 1000.0 << " ms average, "
+					<< m_FrameTimeMin * 1000.0 << " ms min, " << m_FrameTimeMax * 1000.0 << " ms max" << std::endl;
+		}
+		m_Time += m_ReplayDeltaTime;
+		return m_ReplayDeltaTime;
+	}
+
+	// glfwGetKey that returns the replayed key state while replaying
+	int GetKey(GLFWwindow* window, int key) const
+	{
+		if (m_Mode != INPUT_REPLAY)
+			return glfwGetKey(window, key);
+		if (key < 0 || key > GLFW_KEY_LAST)
+			return GLFW_RELEASE;
+		return m_Keys[key] ? GLFW_PRESS : GLFW_RELEASE;
+	}
+
+private:
+	enum EventType : uint8_t
+	{
+		EVENT_KEY,
+		EVENT_CURSOR,
+		EVENT_SCROLL,
+		EVENT_END
+	};
+
+	struct KeyData
+	{
+		int32_t key, scancode;
+	};
+
+	struct PositionData
+	{
+		float x, y;
+	};
+
+	// 16 bytes per event in the file
+	struct Event
+	{
+		float time;	// seconds since recording started, at the frame the event was polled in
+		uint8_t type;
+		uint8_t action;
+		uint8_t mods;
+		uint8_t padding;
+		union
+		{
+			KeyData keyData;
+			PositionData position;
+		};
+	};
+	static_assert(sizeof(Event) == 16, "input events are stored as 16 bytes");
+
+	static constexpr char FILE_MAGIC[4] = { 'L', 'G', 'I', 'R' };
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	static InputRecorder* s_Instance;
+
+	Mode m_Mode = INPUT_LIVE;
+	GLFWwindow* m_Window = nullptr;
+	std::string m_File;
+	std::vector<Event> m_Events;
+	size_t m_Next = 0;
+	float m_Time = 0.0f;
+	float m_EndTime = 0.0f;
+	float m_ReplayDeltaTime = 1.0f / 60.0f;
+	bool m_Finished = false;
+	bool m_Keys[GLFW_KEY_LAST + 1] = {};
+
+	GLFWkeyfun m_KeyCallback = nullptr;
+	GLFWcursorposfun m_CursorCallback = nullptr;
+	GLFWscrollfun m_ScrollCallback = nullptr;
+
+	unsigned int m_Frames = 0;	// frames updated so far, recording or replaying
+	double m_LastFrameStart = 0.0;
+	double m_FrameTimeTotal = 0.0, m_FrameTimeMin = 0.0, m_FrameTimeMax = 0.0;
+
+	void record(const Event& event)
+	{
+		m_Events.push_back(event);
+	}
+
+	void deliver(const Event& event)
+	{
+		if (event.type == EVENT_KEY)
+		{
+			if (event.keyData.key >= 0 && event.keyData.key <= GLFW_KEY_LAST)
+				m_Keys[event.keyData.key] = event.action != GLFW_RELEASE;
+			if (m_KeyCallback)
+				m_KeyCallback(m_Window, event.keyData.key, event.keyData.scancode, event.action, event.mods);
+		}
+		else if (event.type == EVENT_CURSOR && m_CursorCallback)
+			m_CursorCallback(m_Window, event.position.x, event.position.y);
+		else if (event.type == EVENT_SCROLL && m_ScrollCallback)
+			m_ScrollCallback(m_Window, event.position.x, event.position.y);
+	}
+
+	// GLFW callbacks: record and forward live input, swallow it while replaying
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+	{
+		InputRecorder* self = s_Instance;
+		if (self == nullptr || self->m_Mode == INPUT_REPLAY)
+			return;
+		Event event = makeEvent(self->m_Time, EVENT_KEY);
+		event.action = static_cast<uint8_t>(action);
+		event.mods = static_cast<uint8_t>(mods);
+		event.keyData.key = key;
+		event.keyData.scancode = scancode;
+		self->record(event);
+		if (self->m_KeyCallback)
+			self->m_KeyCallback(window, key, scancode, action, mods);
+	}
+
+	static void cursorCallback(GLFWwindow* window, double x, double y)
+	{
+		InputRecorder* self = s_Instance;
+		if (self == nullptr || self->m_Mode == INPUT_REPLAY)
+			return;
+		Event event = makeEvent(self->m_Time, EVENT_CURSOR);
+		event.position.x = static_cast<float>(x);
+		event.position.y = static_cast<float>(y);
+		self->record(event);
+		// forward what was recorded, so the live run sees exactly what a replay will
+		if (self->m_CursorCallback)
+			self->m_CursorCallback(window, event.position.x, event.position.y);
+	}
+
+	static void scrollCallback(GLFWwindow* window, double x, double y)
+	{
+		InputRecorder* self = s_Instance;
+		if (self == nullptr || self->m_Mode == INPUT_REPLAY)
+			return;
+		Event event = makeEvent(self->m_Time, EVENT_SCROLL);
+		event.position.x = static_cast<float>(x);
+		event.position.y = static_cast<float>(y);
+		self->record(event);
+		if (self->m_ScrollCallback)
+			self->m_ScrollCallback(window, event.position.x, event.position.y);
+	}
+
+	static Event makeEvent(float time, EventType type)
+	{
+		Event event = {};
+		event.time = time;
+		event.type = type;
+		return event;
+	}
+
+	// file: magic, version and event count, then the events; the last one is EVENT_END at the final frame time
+	void save()
+	{
+		std::vector<Event> events = m_Events;
+		events.push_back(makeEvent(m_Time, EVENT_END));
+		std::ofstream file(m_File, std::ios::binary);
+		uint32_t header[2] = { FILE_VERSION, static_cast<uint32_t>(events.size()) };
+		file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(Event));
+		if (!file)
+			std::cout << "ERROR::INPUT_RECORDER: failed to write " << m_File << std::endl;
+		else
+			std::cout << "input recorder: " << m_Events.size() << " events over " << m_Time << " s written to " << m_File << std::endl;
+	}
+
+	bool load(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		char magic[4];
+		uint32_t header[2];
+		if (!file.read(magic, sizeof(magic)) || !file.read(reinterpret_cast<char*>(header), sizeof(header))
+			|| std::string(magic, 4) != std::string(FILE_MAGIC, 4) || header[0] != FILE_VERSION || header[1] == 0)
+		{
+			std::cout << "ERROR::INPUT_RECORDER: " << path << " is not an input recording" << std::endl;
+			return false;
+		}
+		m_Events.resize(header[1]);
+		if (!file.read(reinterpret_cast<char*>(m_Events.data()), m_Events.size() * sizeof(Event)) || m_Events.back().type != EVENT_END)
+		{
+			std::cout << "ERROR::INPUT_RECORDER: " << path << " is truncated" << std::endl;
+			m_Events.clear();
+			return false;
+		}
+		m_EndTime = m_Events.back().time;
+		m_Events.pop_back();
+		return true;
+	}
+};
+
+inline InputRecorder* InputRecorder::s_Instance = nullptr;
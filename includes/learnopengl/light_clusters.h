@@ -0,0 +1,389 @@
+#pragma once
+
+/* Clustered light culling: point lights assigned to a grid of view frustum cells, on the CPU or in a compute shader */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LIGHT_CLUSTERS_USE_SSE 1
+#endif
+
+// std430 layouts shared with the shaders
+struct ClusterLight
+{
+	glm::vec4 PositionRadius;	// world space position, w = radius of influence
+	glm::vec4 Color;	// w unused
+};
+
+struct ClusterBounds
+{
+	glm::vec4 Min;	// view space, w unused
+	glm::vec4 Max;
+};
+
+// The view frustum is cut into GridX x GridY screen tiles and GridZ depth slices whose far
+// distances grow geometrically from the near to the far plane, so every cluster is about as deep
+// as it is wide. A light belongs to every cluster whose view space bounding box its sphere touches.
+// The result is one list of light indices, grouped by cluster, and per cluster its offset and
+// count in that list (the layout the lighting shader reads).
+//
+// Build() takes every light only to the slices and tiles its sphere can reach and tests four
+// clusters of a row at a time with SSE; BuildReference() tests every light against every cluster
+// one at a time and gives exactly the same lists, in the same order.
+class LightClusterBuilder
+{
+public:
+	static constexpr int GridX = 16;
+	static constexpr int GridY = 9;
+	static constexpr int GridZ = 24;
+	static constexpr int ClusterCount = GridX * GridY * GridZ;
+	static_assert(GridX % 4 == 0, "rows are tested four clusters at a time");
+
+	static int ClusterIndex(int x, int y, int z) { return x + GridX * (y + GridY * z); }
+
+	// projection is a symmetric perspective projection from nearPlane to farPlane
+	void SetProjection(const glm::mat4& projection, float nearPlane, float farPlane)
+	{
+		m_Near = nearPlane;
+		m_Far = farPlane;
+		m_ScaleX = projection[0][0];
+		m_ScaleY = projection[1][1];
+		m_SliceScale = GridZ / std::log(farPlane / nearPlane);
+		m_SliceBias = -GridZ * std::log(nearPlane) / std::log(farPlane / nearPlane);
+		for (int z = 0; z <= GridZ; z++)
+			m_SliceDepth[z] = nearPlane * std::pow(farPlane / nearPlane, (float)z / GridZ);
+
+		m_Bounds.resize(ClusterCount);
+		for (int z = 0; z < GridZ; z++)
+		{
+			float nearDepth = m_SliceDepth[z], farDepth = m_SliceDepth[z + 1];
+			for (int y = 0; y < GridY; y++)
+			{
+				for (int x = 0; x < GridX; x++)
+				{
+					// the tile's edges in NDC, at both depths of the slice
+					float left = -1.0f + 2.0f * x / GridX, right = -1.0f + 2.0f * (x + 1) / GridX;
+					float bottom = -1.0f + 2.0f * y / GridY, top = -1.0f + 2.0f * (y + 1) / GridY;
+					int index = ClusterIndex(x, y, z);
+					m_MinX[index] = std::min(left * nearDepth, left * farDepth) / m_ScaleX;
+					m_MaxX[index] = std::max(right * nearDepth, right * farDepth) / m_ScaleX;
+					m_MinY[index] = std::min(bottom * nearDepth, bottom * farDepth) / m_ScaleY;
+					m_MaxY[index] = std::max(top * nearDepth, top * farDepth) / m_ScaleY;
+					m_MinZ[index] = -farDepth;
+					m_MaxZ[index] = -nearDepth;
+					m_Bounds[index].Min = glm::vec4(m_MinX[index], m_MinY[index], m_MinZ[index], 0.0f);
+					m_Bounds[index].Max = glm::vec4(m_MaxX[index], m_MaxY[index], m_MaxZ[index], 0.0f);
+				}
+			}
+		}
+	}
+
+	void Build(const std::vector<ClusterLight>& lights, const glm::mat4& view)
+	{
+		m_Pairs.clear();
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].PositionRadius), 1.0f));
+			float radius = lights[i].PositionRadius.w;
+			float nearest = -center.z - radius, farthest = -center.z + radius;
+			if (farthest < m_Near || nearest > m_Far)
+				continue;
+			// slice() rounds log(depth), the bounds come from pow(); one slice more on either side keeps a
+			// sphere that just touches a slice boundary from missing that slice, the box test stays exact
+			int firstSlice = std::max(slice(std::max(nearest, m_Near)) - 1, 0);
+			int lastSlice = std::min(slice(std::min(farthest, m_Far)) + 1, GridZ - 1);
+			float radius2 = radius * radius;
+#ifdef LIGHT_CLUSTERS_USE_SSE
+			const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+			const __m128 r2 = _mm_set1_ps(radius2), zero = _mm_setzero_ps();
+#endif
+			for (int z = firstSlice; z <= lastSlice; z++)
+			{
+				// the tiles the sphere's box can reach between the slice's two depths
+				int x0, x1, y0, y1;
+				if (!tileRange(center.x, radius, m_ScaleX, z, GridX, x0, x1) || !tileRange(center.y, radius, m_ScaleY, z, GridY, y0, y1))
+					continue;
+				for (int y = y0; y <= y1; y++)
+				{
+#ifdef LIGHT_CLUSTERS_USE_SSE
+					for (int x = x0 & ~3; x <= x1; x += 4)
+					{
+						int index = ClusterIndex(x, y, z);
+						__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(m_MinX + index), cx), _mm_sub_ps(cx, _mm_loadu_ps(m_MaxX + index))), zero);
+						__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(m_MinY + index), cy), _mm_sub_ps(cy, _mm_loadu_ps(m_MaxY + index))), zero);
+						__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(m_MinZ + index), cz), _mm_sub_ps(cz, _mm_loadu_ps(m_MaxZ + index))), zero);
+						__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+						int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, r2));
+						for (int lane = 0; mask != 0; lane++, mask >>= 1)
+						{
+							if (mask & 1)
+								m_Pairs.push_back({ (unsigned int)(index + lane), i });
+						}
+					}
+#else
+					for (int x = x0; x <= x1; x++)
+					{
+						int index = ClusterIndex(x, y, z);
+						if (intersects(index, center, radius2))
+							m_Pairs.push_back({ (unsigned int)index, i });
+					}
+#endif
+				}
+			}
+		}
+		sortPairs();
+	}
+
+	void BuildReference(const std::vector<ClusterLight>& lights, const glm::mat4& view)
+	{
+		m_Pairs.clear();
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].PositionRadius), 1.0f));
+			float radius = lights[i].PositionRadius.w;
+			for (int index = 0; index < ClusterCount; index++)
+			{
+				if (intersects(index, center, radius * radius))
+					m_Pairs.push_back({ (unsigned int)index, i });
+			}
+		}
+		sortPairs();
+	}
+
+	// per cluster the offset and count of its lights in Indices()
+	const std::vector<glm::uvec2>& Clusters() const { return m_Clusters; }
+	const std::vector<unsigned int>& Indices() const { return m_Indices; }
+	const std::vector<ClusterBounds>& Bounds() const { return m_Bounds; }
+
+	// slice = floor(log(view depth) * SliceScale() + SliceBias())
+	float SliceScale() const { return m_SliceScale; }
+	float SliceBias() const { return m_SliceBias; }
+
+private:
+	struct Pair
+	{
+		unsigned int Cluster, Light;
+	};
+
+	float m_Near = 0.1f, m_Far = 100.0f;
+	float m_ScaleX = 1.0f, m_ScaleY = 1.0f;
+	float m_SliceScale = 0.0f, m_SliceBias = 0.0f;
+	float m_SliceDepth[GridZ + 1] = {};
+	// bounds as separate arrays, so four clusters of a row load as one vector
+	float m_MinX[ClusterCount], m_MinY[ClusterCount], m_MinZ[ClusterCount];
+	float m_MaxX[ClusterCount], m_MaxY[ClusterCount], m_MaxZ[ClusterCount];
+	std::vector<ClusterBounds> m_Bounds;
+	std::vector<Pair> m_Pairs;
+	std::vector<glm::uvec2> m_Clusters;
+	std::vector<unsigned int> m_Indices;
+
+	int slice(float depth) const
+	{
+		return glm::clamp((int)std::floor(std::log(depth) * m_SliceScale + m_SliceBias), 0, GridZ - 1);
+	}
+
+	// tiles along one axis that a box [center - radius, center + radius] can overlap anywhere
+	// between the depths of slice z, false if none; a little wide, the box test decides
+	bool tileRange(float center, float radius, float scale, int z, int tiles, int& first, int& last) const
+	{
+		float nearDepth = m_SliceDepth[z], farDepth = m_SliceDepth[z + 1];
+		float a = (center - radius) / nearDepth, b = (center - radius) / farDepth;
+		float c = (center + radius) / nearDepth, d = (center + radius) / farDepth;
+		float low = std::min(std::min(a, b), std::min(c, d)) * scale;
+		float high = std::max(std::max(a, b), std::max(c, d)) * scale;
+		first = (int)std::floor((low * 0.5f + 0.5f) * tiles - 0.01f);
+		last = (int)std::floor((high * 0.5f + 0.5f) * tiles + 0.01f);
+		if (last < 0 || first >= tiles)
+			return false;
+		first = std::max(first, 0);
+		last = std::min(last, tiles - 1);
+		return true;
+	}
+
+	// the same operations, in the same order, as the SSE path and the compute shader
+	bool intersects(int index, const glm::vec3& center, float radius2) const
+	{
+		float dx = std::max(std::max(m_MinX[index] - center.x, center.x - m_MaxX[index]), 0.0f);
+		float dy = std::max(std::max(m_MinY[index] - center.y, center.y - m_MaxY[index]), 0.0f);
+		float dz = std::max(std::max(m_MinZ[index] - center.z, center.z - m_MaxZ[index]), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= radius2;
+	}
+
+	// counting sort by cluster; lights stay in index order within a cluster
+	void sortPairs()
+	{
+		m_Clusters.assign(ClusterCount, glm::uvec2(0u));
+		for (const Pair& pair : m_Pairs)
+			m_Clusters[pair.Cluster].y++;
+		unsigned int offset = 0;
+		for (glm::uvec2& cluster : m_Clusters)
+		{
+			cluster.x = offset;
+			offset += cluster.y;
+			cluster.y = 0;
+		}
+		m_Indices.resize(m_Pairs.size());
+		for (const Pair& pair : m_Pairs)
+		{
+			glm::uvec2& cluster = m_Clusters[pair.Cluster];
+			m_Indices[cluster.x + cluster.y++] = pair.Light;
+		}
+	}
+};
+
+// The GL side: the lights, the cluster offsets and counts and the light index list in shader
+// storage buffers (bindings 0, 1 and 2, see Bind()). The lists come either from the CPU builder,
+// uploaded every frame, or from the compute shader (8.1.light_clusters.cs), in which one
+// invocation per cluster tests every light. The compute shader has no per cluster limit: every
+// cluster counts its lights, then takes exactly that many entries of the index list with an atomic
+// on a counter (binding 4). BuildOnGpu() reads the counter back, and when the clusters asked for
+// more entries than the list holds it grows the list and dispatches again, so a cluster never
+// loses a light and all modes shade the same.
+class LightClusters
+{
+public:
+	LightClusters(const char* computePath)
+		: m_Shader(computePath)
+	{
+		glGenBuffers(1, &m_LightBuffer);
+		glGenBuffers(1, &m_ClusterBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ClusterBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, LightClusterBuilder::ClusterCount * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+		glGenBuffers(1, &m_IndexBuffer);
+		reserveIndices((size_t)LightClusterBuilder::ClusterCount * INITIAL_LIGHTS_PER_CLUSTER);
+		glGenBuffers(1, &m_CountBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CountBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), nullptr, GL_DYNAMIC_READ);
+		glGenBuffers(1, &m_BoundsBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BoundsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, LightClusterBuilder::ClusterCount * sizeof(ClusterBounds), nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	~LightClusters()
+	{
+		glDeleteBuffers(1, &m_LightBuffer);
+		glDeleteBuffers(1, &m_ClusterBuffer);
+		glDeleteBuffers(1, &m_IndexBuffer);
+		glDeleteBuffers(1, &m_CountBuffer);
+		glDeleteBuffers(1, &m_BoundsBuffer);
+		glDeleteProgram(m_Shader.ID);
+	}
+
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	const LightClusterBuilder& Builder() const { return m_Builder; }
+
+	// call whenever the projection changes
+	void SetProjection(const glm::mat4& projection, float nearPlane, float farPlane)
+	{
+		m_Builder.SetProjection(projection, nearPlane, farPlane);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BoundsBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, LightClusterBuilder::ClusterCount * sizeof(ClusterBounds), m_Builder.Bounds().data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// call whenever the lights change
+	void SetLights(const std::vector<ClusterLight>& lights)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_LightBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(lights.size(), 1) * sizeof(ClusterLight), lights.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_LightCount = (int)lights.size();
+	}
+
+	// assigns the lights on the CPU and uploads the lists; 'lights' as given to SetLights()
+	void BuildOnCpu(const std::vector<ClusterLight>& lights, const glm::mat4& view)
+	{
+		m_Builder.Build(lights, view);
+		const std::vector<unsigned int>& indices = m_Builder.Indices();
+		reserveIndices(indices.size());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ClusterBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, LightClusterBuilder::ClusterCount * sizeof(glm::uvec2), m_Builder.Clusters().data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_IndexBuffer);
+		if (!indices.empty())
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// assigns the lights in the compute shader. Reading the index count back waits for the dispatch;
+	// it is a single integer and the lighting pass needs the lists right after anyway
+	void BuildOnGpu(const glm::mat4& view)
+	{
+		Bind();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_BoundsBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_CountBuffer);
+		m_Shader.use();
+		m_Shader.setMat4("view", view);
+		m_Shader.setInt("lightCount", m_LightCount);
+		m_Shader.setInt("clusterCount", LightClusterBuilder::ClusterCount);
+
+		unsigned int indexCount = dispatch();
+		if (indexCount > m_IndexCapacity)
+		{
+			// some clusters were cut short; a quarter more than needed keeps the list from growing
+			// again for small changes of the view
+			reserveIndices(indexCount + indexCount / 4);
+			Bind();
+			indexCount = dispatch();
+		}
+		m_IndexCount = indexCount;
+	}
+
+	// light indices written by the last build, over all clusters
+	size_t IndexCount() const { return m_IndexCount; }
+
+	// binds lights, clusters and indices to shader storage bindings 0, 1 and 2
+	void Bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_LightBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ClusterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_IndexBuffer);
+	}
+
+private:
+	static const unsigned int WORK_GROUP_SIZE = 128; // local_size_x in the compute shader
+	static const int INITIAL_LIGHTS_PER_CLUSTER = 32; // only sizes the first index list, it grows as needed
+
+	ComputeShader m_Shader;
+	LightClusterBuilder m_Builder;
+	unsigned int m_LightBuffer = 0, m_ClusterBuffer = 0, m_IndexBuffer = 0, m_CountBuffer = 0, m_BoundsBuffer = 0;
+	size_t m_IndexCapacity = 0;
+	size_t m_IndexCount = 0;
+	int m_LightCount = 0;
+
+	// clears the counter, runs the compute shader and returns the entries the clusters asked for
+	unsigned int dispatch()
+	{
+		const unsigned int zero = 0;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CountBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &zero);
+		m_Shader.setInt("indexCapacity", (int)m_IndexCapacity);
+		glDispatchCompute((LightClusterBuilder::ClusterCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		unsigned int indexCount = 0;
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &indexCount);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return indexCount;
+	}
+
+	void reserveIndices(size_t count)
+	{
+		if (count <= m_IndexCapacity)
+			return;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_IndexBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_IndexCapacity = count;
+	}
+};
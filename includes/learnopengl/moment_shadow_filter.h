@@ -0,0 +1,162 @@
+#pragma once
+
+/* Exponential variance shadow maps: separable compute blur of the moments, then a mip chain for single-fetch filtered lookups */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_c.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// glad is generated without the anisotropic filtering extension; the enums are the same for the
+// EXT and the ARB version and for the GL 4.6 core names
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+// The shadow pass writes four moments per texel into a GL_RGBA32F texture instead of a depth value:
+// the depth d in [0,1] warped to exp(c+ d) and -exp(-c- d), each with its square (see Moments()).
+// Unlike depths, moments may be averaged, so the shadow map can be blurred once per light at its
+// own resolution and then read through trilinear, anisotropic filtering: one fetch per pixel gives
+// the mean and variance over the filter footprint, and Chebyshev's inequality turns that into the
+// lit fraction. Filter() blurs every face of the texture with a separable Gaussian in a compute
+// shader, horizontally into a scratch texture and vertically back, and rebuilds the mipmaps.
+//
+// The exponents are the largest that keep exp(2 c+) finite in 32 bit floats.
+class MomentShadowFilter
+{
+public:
+	static constexpr float PositiveExponent = 40.0f;
+	static constexpr float NegativeExponent = 5.0f;
+	static constexpr int MaxRadius = 16;	// must match MAX_RADIUS in the compute shader
+
+	MomentShadowFilter(const char* computePath)
+		: m_Shader(computePath)
+	{
+	}
+
+	~MomentShadowFilter()
+	{
+		if (m_Scratch)
+			glDeleteTextures(1, &m_Scratch);
+		glDeleteProgram(m_Shader.ID);
+	}
+
+	MomentShadowFilter(const MomentShadowFilter&) = delete;
+	MomentShadowFilter& operator=(const MomentShadowFilter&) = delete;
+
+	// the moments of one depth; also what a cleared (unoccluded) texel holds
+	static glm::vec4 Moments(float depth)
+	{
+		float positive = std::exp(PositiveExponent * depth);
+		float negative = -std::exp(-NegativeExponent * depth);
+		return glm::vec4(positive, positive * positive, negative, negative * negative);
+	}
+
+	// trilinear sampling for the bound texture, anisotropic where the driver supports it
+	static void SetSampling(GLenum target)
+	{
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (anisotropySupported())
+		{
+			float maxAnisotropy = 1.0f;
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+			glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::fmin(maxAnisotropy, 8.0f));
+		}
+	}
+
+	// blurs level 0 of 'moments' (GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP, GL_RGBA32F, size x size) with a
+	// Gaussian of the given radius in texels and regenerates its mipmaps; cube faces are blurred
+	// independently, so the seams are not filtered across
+	void Filter(GLenum target, unsigned int moments, int size, int radius)
+	{
+		radius = glm::clamp(radius, 0, MaxRadius);
+		if (m_ScratchSize != size)
+			createScratch(size);
+
+		m_Shader.use();
+		if (radius != m_Radius)
+		{
+			// sigma of half the radius puts the cut at two standard deviations
+			float weights[MaxRadius + 1] = {};
+			float sigma = std::fmax(radius * 0.5f, 0.5f), total = 0.0f;
+			for (int i = 0; i <= radius; i++)
+			{
+				weights[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+				total += i == 0 ? weights[i] : 2.0f * weights[i];
+			}
+			for (int i = 0; i <= radius; i++)
+				weights[i] /= total;
+			glUniform1fv(glGetUniformLocation(m_Shader.ID, "weights"), MaxRadius + 1, weights);
+			m_Shader.setInt("radius", radius);
+			m_Radius = radius;
+		}
+
+		const unsigned int groups = (size + 127) / 128;
+		const int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+		for (int face = 0; face < faces; face++)
+		{
+			// a single cube face bound without layering is an ordinary 2D image
+			glBindImageTexture(0, moments, 0, GL_FALSE, face, GL_READ_ONLY, GL_RGBA32F);
+			glBindImageTexture(1, m_Scratch, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			m_Shader.setVec2("direction", glm::vec2(1.0f, 0.0f));
+			glDispatchCompute(groups, size, 1);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			glBindImageTexture(0, m_Scratch, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+			glBindImageTexture(1, moments, 0, GL_FALSE, face, GL_WRITE_ONLY, GL_RGBA32F);
+			m_Shader.setVec2("direction", glm::vec2(0.0f, 1.0f));
+			glDispatchCompute(groups, size, 1);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+		glBindTexture(target, moments);
+		glGenerateMipmap(target);
+		glBindTexture(target, 0);
+	}
+
+private:
+	ComputeShader m_Shader;
+	unsigned int m_Scratch = 0;
+	int m_ScratchSize = 0;
+	int m_Radius = -1;
+
+	void createScratch(int size)
+	{
+		if (m_Scratch)
+			glDeleteTextures(1, &m_Scratch);
+		glGenTextures(1, &m_Scratch);
+		glBindTexture(GL_TEXTURE_2D, m_Scratch);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, size, size);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		m_ScratchSize = size;
+	}
+
+	static bool anisotropySupported()
+	{
+		static int supported = -1;
+		if (supported < 0)
+		{
+			supported = 0;
+			int count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (int i = 0; i < count; i++)
+			{
+				const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+				if (std::strcmp(name, "GL_EXT_texture_filter_anisotropic") == 0 ||
+					std::strcmp(name, "GL_ARB_texture_filter_anisotropic") == 0)
+					supported = 1;
+			}
+		}
+		return supported == 1;
+	}
+};
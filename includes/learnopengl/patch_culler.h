@@ -0,0 +1,205 @@
+#pragma once
+
+/* Compute pre-pass for tessellated terrain: frustum culls the patch grid against a height-range pyramid and feeds an indirect draw */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_c.h>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/tiled_heightmap.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// The terrain is a grid of patchesPerSide^2 flat quad patches over the heightmap, centred on the
+// origin with x along the raster width and z along its height (see terrain_gpu_dist). Every frame
+// Cull() runs the compute shader (8.3.gpuheight_cull.cs) over all patches. A patch whose bounding
+// box, its extent in xz and its height range in y, is outside the frustum is dropped; the others
+// are appended to the visible list together with their tessellation levels, and the vertex count
+// of the indirect draw command is advanced by four. Draw() then only sends the visible patches
+// through tessellation, the vertex shader pulls their corners from the list and the control
+// shader their levels.
+//
+// Height ranges come from the min/max of every tile stored in the heightmap file, reduced into a
+// mip pyramid: a patch looks up the level where the tiles under it fall into at most 2 x 2 texels.
+class PatchCuller
+{
+public:
+	PatchCuller(const TiledHeightmap& map, unsigned int patchesPerSide, float yScale = 64.0f, float yShift = 16.0f,
+		const char* computePath = "8.3.gpuheight_cull.cs")
+		: m_Shader(computePath), m_PatchesPerSide(patchesPerSide), m_MapSize(map.Width(), map.Height()),
+		m_TileSize(map.TileSize()), m_OverviewStep(map.OverviewStep()), m_YScale(yScale), m_YShift(yShift)
+	{
+		createRangePyramid(map);
+
+		glGenVertexArrays(1, &m_VAO);
+		const unsigned int command[4] = { 0, 1, 0, 0 };
+		glGenBuffers(1, &m_IndirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		// visible patch indices, and 4 outer + 2 inner tessellation levels per visible patch
+		glGenBuffers(1, &m_PatchBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_PatchBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, PatchCount() * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
+		glGenBuffers(1, &m_LevelBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_LevelBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, PatchCount() * 6 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	~PatchCuller()
+	{
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteBuffers(1, &m_IndirectBuffer);
+		glDeleteBuffers(1, &m_PatchBuffer);
+		glDeleteBuffers(1, &m_LevelBuffer);
+		glDeleteTextures(1, &m_RangeTexture);
+		glDeleteProgram(m_Shader.ID);
+	}
+
+	PatchCuller(const PatchCuller&) = delete;
+	PatchCuller& operator=(const PatchCuller&) = delete;
+
+	unsigned int PatchCount() const { return m_PatchesPerSide * m_PatchesPerSide; }
+
+	// patches drawn by the last Draw(); reads the indirect command back, so it waits for the GPU
+	unsigned int VisiblePatches() const
+	{
+		unsigned int vertices = 0;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+		glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(vertices), &vertices);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		return vertices / 4;
+	}
+
+	// fills the visible list; with frustumCull off every patch is kept, still with precomputed levels
+	void Cull(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model, bool frustumCull = true)
+	{
+		const unsigned int reset = 0;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(reset), &reset);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		m_Shader.use();
+		m_Shader.setMat4("viewModel", view * model);
+		m_Shader.setMat4("viewProjection", projection * view * model);
+		m_Shader.setBool("frustumCull", frustumCull);
+		setGridUniforms(m_Shader);
+		m_Shader.setFloat("tileSize", (float)m_TileSize);
+		m_Shader.setFloat("margin", (float)(m_OverviewStep + 1));
+		m_Shader.setInt("rangeLevels", m_RangeLevels);
+		m_Shader.setFloat("yScale", m_YScale);
+		m_Shader.setFloat("yShift", m_YShift);
+		m_Shader.setInt("heightRanges", 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_RangeTexture);
+		bindBuffers();
+		glDispatchCompute((PatchCount() + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// draws the visible patches with 'shader' (8.3.gpuheight.vs/.tcs/.tes), which must be in use
+	void Draw(Shader& shader)
+	{
+		setGridUniforms(shader);
+		bindBuffers();
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+		glPatchParameteri(GL_PATCH_VERTICES, 4);
+		glDrawArraysIndirect(GL_PATCHES, (void*)0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+private:
+	ComputeShader m_Shader;
+	unsigned int m_PatchesPerSide;
+	glm::vec2 m_MapSize;
+	int m_TileSize, m_OverviewStep;
+	float m_YScale, m_YShift;
+	int m_RangeLevels = 0;
+	unsigned int m_VAO = 0, m_IndirectBuffer = 0, m_PatchBuffer = 0, m_LevelBuffer = 0, m_RangeTexture = 0;
+
+	template <typename ShaderType>
+	void setGridUniforms(ShaderType& shader)
+	{
+		shader.setInt("patchesPerSide", (int)m_PatchesPerSide);
+		shader.setVec2("mapSize", m_MapSize);
+	}
+
+	void bindBuffers()
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_IndirectBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_PatchBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_LevelBuffer);
+	}
+
+	// RG16 texture of tile minimum and maximum, padded to power of two sides so every mip level halves
+	// exactly; padding texels hold an empty range
+	void createRangePyramid(const TiledHeightmap& map)
+	{
+		int width = 1, height = 1;
+		while (width < map.TilesX())
+			width *= 2;
+		while (height < map.TilesY())
+			height *= 2;
+		std::vector<uint16_t> level((size_t)width * height * 2);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				uint16_t* range = &level[((size_t)y * width + x) * 2];
+				if (x < map.TilesX() && y < map.TilesY())
+				{
+					const uint16_t* tile = map.TileRanges() + 2 * (y * map.TilesX() + x);
+					range[0] = tile[0];
+					range[1] = tile[1];
+				}
+				else
+				{
+					range[0] = 0xFFFF;
+					range[1] = 0;
+				}
+			}
+		}
+
+		glGenTextures(1, &m_RangeTexture);
+		glBindTexture(GL_TEXTURE_2D, m_RangeTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		for (m_RangeLevels = 0; ; m_RangeLevels++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, m_RangeLevels, GL_RG16, width, height, 0, GL_RG, GL_UNSIGNED_SHORT, level.data());
+			if (width == 1 && height == 1)
+				break;
+			int parentWidth = std::max(1, width / 2), parentHeight = std::max(1, height / 2);
+			std::vector<uint16_t> parent((size_t)parentWidth * parentHeight * 2);
+			for (int y = 0; y < parentHeight; y++)
+			{
+				for (int x = 0; x < parentWidth; x++)
+				{
+					uint16_t low = 0xFFFF, high = 0;
+					for (int child = 0; child < 4; child++)
+					{
+						int childX = std::min(x * 2 + child % 2, width - 1), childY = std::min(y * 2 + child / 2, height - 1);
+						low = std::min(low, level[((size_t)childY * width + childX) * 2]);
+						high = std::max(high, level[((size_t)childY * width + childX) * 2 + 1]);
+					}
+					parent[((size_t)y * parentWidth + x) * 2] = low;
+					parent[((size_t)y * parentWidth + x) * 2 + 1] = high;
+				}
+			}
+			level.swap(parent);
+			width = parentWidth;
+			height = parentHeight;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_RangeLevels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		m_RangeLevels++;
+	}
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+/* One depth texture shared by the shadow maps of many lights: power of two tiles packed every frame, static tiles kept */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Every frame the program asks for one tile per light face it wants shadowed (a point light has
+// up to six faces, a spot light one), with a power of two size. Pack() sorts the requests from
+// large to small and lays them out along a Morton curve in units of the smallest tile: in that
+// order every tile lands on a multiple of its own size, so the tiles never overlap and there is
+// no free list to maintain. If the requests do not fit, the largest ones are halved until they do.
+//
+// A request marked static (light and casters did not move) whose tile comes out exactly where it
+// was last frame is reported Cached: its depth is still in the atlas and it need not be rendered.
+// Static requests are laid out before the others, by size and then key, so their layout stays the
+// same as long as no static size changes.
+class ShadowAtlas
+{
+public:
+	struct Request
+	{
+		unsigned int Key;	// identifies the face across frames, e.g. light * 6 + face
+		int Size;
+		bool Static;
+	};
+
+	struct Tile
+	{
+		int X = 0, Y = 0, Size = 0;	// Size 0: the request was dropped
+		bool Cached = false;
+	};
+
+	ShadowAtlas(int size = 4096, int minTile = 64, int maxTile = 1024)
+		: m_Size(size), m_MinTile(minTile), m_MaxTile(maxTile)
+	{
+		glGenTextures(1, &m_Texture);
+		glBindTexture(GL_TEXTURE_2D, m_Texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenFramebuffers(1, &m_FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_Texture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::SHADOW_ATLAS: Framebuffer is not complete!" << std::endl;
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	~ShadowAtlas()
+	{
+		glDeleteFramebuffers(1, &m_FBO);
+		glDeleteTextures(1, &m_Texture);
+	}
+
+	ShadowAtlas(const ShadowAtlas&) = delete;
+	ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+	int Size() const { return m_Size; }
+	unsigned int Texture() const { return m_Texture; }
+
+	// nearest allowed tile size for a wanted edge length in texels
+	int TileSize(float texels) const
+	{
+		int size = m_MinTile;
+		while (size < m_MaxTile && size * 1.5f < texels)
+			size *= 2;
+		return size;
+	}
+
+	// tiles in request order
+	std::vector<Tile> Pack(std::vector<Request> requests)
+	{
+		std::vector<Tile> tiles(requests.size());
+		std::vector<size_t> order(requests.size());
+		std::iota(order.begin(), order.end(), 0);
+		for (Request& request : requests)
+			request.Size = std::max(m_MinTile, std::min(m_MaxTile, request.Size));
+
+		// static requests go first and the others start at the next multiple of their largest tile, so
+		// moving lights gaining or losing faces never shift a cacheable tile
+		std::sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+			if (requests[a].Static != requests[b].Static)
+				return requests[a].Static;
+			return requests[a].Size != requests[b].Size ? requests[a].Size > requests[b].Size : requests[a].Key < requests[b].Key;
+		});
+
+		// halve the largest requests until they fit; at the smallest size the rest is dropped
+		const size_t capacity = (size_t)(m_Size / m_MinTile) * (m_Size / m_MinTile);
+		auto units = [this](int size) { return (size_t)(size / m_MinTile) * (size / m_MinTile); };
+		auto place = [&](size_t cursor, const Request& request, bool first) {
+			return first && !request.Static ? (cursor + units(request.Size) - 1) / units(request.Size) * units(request.Size) : cursor;
+		};
+		auto used = [&]() {
+			size_t cursor = 0;
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				const Request& request = requests[order[i]];
+				cursor = place(cursor, request, i == 0 || requests[order[i - 1]].Static) + units(request.Size);
+			}
+			return cursor;
+		};
+		while (used() > capacity)
+		{
+			int largest = 0;
+			for (const Request& request : requests)
+				largest = std::max(largest, request.Size);
+			if (largest == m_MinTile)
+				break;
+			for (Request& request : requests)
+			{
+				if (request.Size == largest)
+					request.Size = largest / 2;
+			}
+		}
+
+		std::unordered_map<unsigned int, Tile> placed;
+		size_t cursor = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			size_t index = order[i];
+			const Request& request = requests[index];
+			cursor = place(cursor, request, i == 0 || requests[order[i - 1]].Static);
+			if (cursor + units(request.Size) > capacity)
+				continue;
+			Tile& tile = tiles[index];
+			glm::ivec2 position = mortonDecode(cursor);
+			tile.X = position.x * m_MinTile;
+			tile.Y = position.y * m_MinTile;
+			tile.Size = request.Size;
+			cursor += units(request.Size);
+
+			auto previous = m_Tiles.find(request.Key);
+			tile.Cached = request.Static && previous != m_Tiles.end() &&
+				previous->second.X == tile.X && previous->second.Y == tile.Y && previous->second.Size == tile.Size;
+			placed[request.Key] = tile;
+		}
+		m_Tiles.swap(placed);
+		return tiles;
+	}
+
+	// tile corner and edge length in texture coordinates, for the lighting shader
+	glm::vec4 TileRect(const Tile& tile) const
+	{
+		return glm::vec4((float)tile.X / m_Size, (float)tile.Y / m_Size, (float)tile.Size / m_Size, 0.0f);
+	}
+
+	// binds the atlas and clears the tile; draws then land in it until the next BeginTile() or End()
+	void BeginTile(const Tile& tile)
+	{
+		if (!m_Rendering)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+			glEnable(GL_SCISSOR_TEST);
+			m_Rendering = true;
+		}
+		glViewport(tile.X, tile.Y, tile.Size, tile.Size);
+		glScissor(tile.X, tile.Y, tile.Size, tile.Size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	void End()
+	{
+		if (!m_Rendering)
+			return;
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_Rendering = false;
+	}
+
+	// forgets a tile, so the face is rendered again even if its light stays static
+	void Invalidate(unsigned int key)
+	{
+		m_Tiles.erase(key);
+	}
+
+private:
+	int m_Size, m_MinTile, m_MaxTile;
+	unsigned int m_Texture = 0, m_FBO = 0;
+	bool m_Rendering = false;
+	std::unordered_map<unsigned int, Tile> m_Tiles;	// last frame's layout
+
+	static glm::ivec2 mortonDecode(size_t index)
+	{
+		glm::ivec2 position(0);
+		for (int bit = 0; bit < 16; bit++)
+		{
+			position.x |= (int)((index >> (2 * bit)) & 1) << bit;
+			position.y |= (int)((index >> (2 * bit + 1)) & 1) << bit;
+		}
+		return position;
+	}
+};
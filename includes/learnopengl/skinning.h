@@ -0,0 +1,269 @@
+#pragma once
+
+/* Skins a Model once per frame (compute pre-pass) so every later pass can draw it as a static mesh */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SKINNING_USE_SSE 1
+#endif
+
+// std430 layouts shared with skinning.cs
+struct SkinningInputVertex
+{
+	glm::vec4 position;	// w unused
+	glm::vec4 normal;	// w unused
+	glm::ivec4 boneIds;
+	glm::vec4 weights;
+};
+
+struct SkinnedVertex
+{
+	glm::vec4 position;	// w = 1
+	glm::vec4 normal;	// w = 0
+};
+
+// CPU reference skinner with exactly the math of skinning.cs: blend the bone matrices, then transform once.
+// Unweighted vertices keep their bind pose, bone ids past 'boneCount' make the vertex use its bind pose (as anim_model.vs does).
+class CpuSkinner
+{
+public:
+	static SkinningInputVertex MakeInput(const Vertex& vertex)
+	{
+		SkinningInputVertex input;
+		input.position = glm::vec4(vertex.Position, 1.0f);
+		input.normal = glm::vec4(vertex.Normal, 0.0f);
+		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+		{
+			input.boneIds[i] = vertex.m_BoneIDs[i];
+			input.weights[i] = vertex.m_Weights[i];
+		}
+		return input;
+	}
+
+	// scalar path, used for single vertices (e.g. by the vertex animation baker). Like anim_model.vs
+	// the weights are used as they are, not renormalized; a vertex without weights keeps its bind pose
+	static void SkinVertex(const SkinningInputVertex& vertex, const glm::mat4* bones, int boneCount, glm::vec3& position, glm::vec3& normal)
+	{
+		glm::mat4 skin(0.0f);
+		float total = 0.0f;
+		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+		{
+			int boneId = vertex.boneIds[i];
+			if (boneId < 0)
+				continue;
+			if (boneId >= boneCount)
+			{
+				skin = glm::mat4(1.0f);
+				total = 1.0f;
+				break;
+			}
+			skin += bones[boneId] * vertex.weights[i];
+			total += vertex.weights[i];
+		}
+		if (total <= 0.0f)
+			skin = glm::mat4(1.0f);
+		position = glm::vec3(skin * glm::vec4(glm::vec3(vertex.position), 1.0f));
+		glm::vec3 n = glm::mat3(skin) * glm::vec3(vertex.normal);
+		float length = glm::length(n);
+		normal = length > 0.0f ? n / length : glm::vec3(vertex.normal);
+	}
+
+	// batch path, SSE when available
+	static void Skin(const std::vector<SkinningInputVertex>& input, const std::vector<glm::mat4>& bones, std::vector<SkinnedVertex>& output)
+	{
+		output.resize(input.size());
+		int boneCount = static_cast<int>(bones.size());
+#ifdef SKINNING_USE_SSE
+		const float* boneData = &bones[0][0][0];
+		for (size_t v = 0; v < input.size(); v++)
+		{
+			const SkinningInputVertex& vertex = input[v];
+			__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+			float total = 0.0f;
+			bool bindPose = false;
+			for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+			{
+				int boneId = vertex.boneIds[i];
+				if (boneId < 0)
+					continue;
+				if (boneId >= boneCount)
+				{
+					bindPose = true;
+					break;
+				}
+				const float* m = boneData + boneId * 16;
+				__m128 w = _mm_set1_ps(vertex.weights[i]);
+				c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(m + 0), w));
+				c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+				c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+				c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+				total += vertex.weights[i];
+			}
+			if (bindPose || total <= 0.0f)
+			{
+				c0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+				c1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+				c2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+				c3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+			__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.position.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.position.y))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.position.z)), c3));
+			__m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.normal.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.normal.y))),
+				_mm_mul_ps(c2, _mm_set1_ps(vertex.normal.z)));
+			float pf[4], nf[4];
+			_mm_storeu_ps(pf, p);
+			_mm_storeu_ps(nf, n);
+			output[v].position = glm::vec4(pf[0], pf[1], pf[2], 1.0f);
+			glm::vec3 normal(nf[0], nf[1], nf[2]);
+			float length = glm::length(normal);
+			output[v].normal = glm::vec4(length > 0.0f ? normal / length : glm::vec3(vertex.normal), 0.0f);
+		}
+#else
+		for (size_t v = 0; v < input.size(); v++)
+		{
+			glm::vec3 position, normal;
+			SkinVertex(input[v], bones.data(), boneCount, position, normal);
+			output[v].position = glm::vec4(position, 1.0f);
+			output[v].normal = glm::vec4(normal, 0.0f);
+		}
+#endif
+	}
+};
+
+// GPU skinning pre-pass: skinning.cs writes every vertex of the model once into an output buffer,
+// which Draw() then renders with a plain static-mesh shader (locations 0 = position, 1 = normal, 2 = texcoords).
+class SkinningPrePass
+{
+public:
+	SkinningPrePass(Model& model, ComputeShader& shader)
+		: m_Model(model), m_Shader(shader), m_VertexCount(0)
+	{
+		std::vector<SkinningInputVertex> input;
+		std::vector<glm::vec2> texCoords;
+		for (unsigned int i = 0; i < model.meshes.size(); i++)
+		{
+			m_BaseVertex.push_back(static_cast<unsigned int>(input.size()));
+			for (const Vertex& vertex : model.meshes[i].vertices)
+			{
+				input.push_back(CpuSkinner::MakeInput(vertex));
+				texCoords.push_back(vertex.TexCoords);
+			}
+		}
+		m_Input = input;
+		m_VertexCount = static_cast<unsigned int>(input.size());
+
+		glGenBuffers(1, &m_InputBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_InputBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, input.size() * sizeof(SkinningInputVertex), input.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &m_BoneBuffer);
+		glGenBuffers(1, &m_OutputBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_OutputBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, input.size() * sizeof(SkinnedVertex), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glGenBuffers(1, &m_TexCoordBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_TexCoordBuffer);
+		glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
+
+		// one VAO per mesh reading the skinned output as if it were a static vertex buffer
+		for (unsigned int i = 0; i < model.meshes.size(); i++)
+		{
+			unsigned int VAO, EBO;
+			glGenVertexArrays(1, &VAO);
+			glGenBuffers(1, &EBO);
+			glBindVertexArray(VAO);
+			GLintptr base = m_BaseVertex[i];
+			glBindBuffer(GL_ARRAY_BUFFER, m_OutputBuffer);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)(base * sizeof(SkinnedVertex) + offsetof(SkinnedVertex, position)));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)(base * sizeof(SkinnedVertex) + offsetof(SkinnedVertex, normal)));
+			glBindBuffer(GL_ARRAY_BUFFER, m_TexCoordBuffer);
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(base * sizeof(glm::vec2)));
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.meshes[i].indices.size() * sizeof(unsigned int), &model.meshes[i].indices[0], GL_STATIC_DRAW);
+			glBindVertexArray(0);
+			m_VAOs.push_back(VAO);
+			m_EBOs.push_back(EBO);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	~SkinningPrePass()
+	{
+		glDeleteVertexArrays(static_cast<GLsizei>(m_VAOs.size()), m_VAOs.data());
+		glDeleteBuffers(static_cast<GLsizei>(m_EBOs.size()), m_EBOs.data());
+		glDeleteBuffers(1, &m_InputBuffer);
+		glDeleteBuffers(1, &m_BoneBuffer);
+		glDeleteBuffers(1, &m_OutputBuffer);
+		glDeleteBuffers(1, &m_TexCoordBuffer);
+	}
+
+	// skins all vertices with the given palette, call once per frame before any pass draws the model
+	void Dispatch(const std::vector<glm::mat4>& bones)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BoneBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bones.size() * sizeof(glm::mat4), bones.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_InputBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_BoneBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_OutputBuffer);
+		m_Shader.use();
+		m_Shader.setInt("vertexCount", static_cast<int>(m_VertexCount));
+		m_Shader.setInt("boneCount", static_cast<int>(bones.size()));
+		glDispatchCompute((m_VertexCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+		// the output is consumed as vertex attributes by the following passes
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// draws the skinned result, 'shader' only needs the static mesh inputs
+	void Draw(Shader& shader)
+	{
+		for (unsigned int i = 0; i < m_Model.meshes.size(); i++)
+		{
+			m_Model.meshes[i].BindTextures(shader);
+			glBindVertexArray(m_VAOs[i]);
+			glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_Model.meshes[i].indices.size()), GL_UNSIGNED_INT, 0);
+		}
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// largest position difference between the GPU output and the CPU reference for the same palette
+	float Validate(const std::vector<glm::mat4>& bones)
+	{
+		std::vector<SkinnedVertex> gpu(m_VertexCount), cpu;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_OutputBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpu.size() * sizeof(SkinnedVertex), gpu.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		CpuSkinner::Skin(m_Input, bones, cpu);
+		float maxError = 0.0f;
+		for (unsigned int v = 0; v < m_VertexCount; v++)
+			maxError = std::max(maxError, glm::length(glm::vec3(gpu[v].position - cpu[v].position)));
+		return maxError;
+	}
+
+private:
+	static const unsigned int WORK_GROUP_SIZE = 64; // local_size_x in skinning.cs
+
+	Model& m_Model;
+	ComputeShader& m_Shader;
+	unsigned int m_VertexCount;
+	std::vector<SkinningInputVertex> m_Input;
+	std::vector<unsigned int> m_BaseVertex;
+	unsigned int m_InputBuffer, m_BoneBuffer, m_OutputBuffer, m_TexCoordBuffer;
+	std::vector<unsigned int> m_VAOs, m_EBOs;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+/* Tiled 16-bit heightmap file: written once by a converter, then memory mapped and read tile by tile */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout, all values little-endian:
+//   header     "LTHM", then version, width, height, tileSize, overviewWidth, overviewHeight, overviewStep as u32
+//   overview   overviewWidth x overviewHeight u16, every overviewStep-th sample of the raster
+//   tiles      tilesY rows of tilesX tiles, each (tileSize + 1)^2 u16 in row order
+//   ranges     minimum and maximum u16 of every tile, in the same order
+// A tile repeats the first row and column of its right and lower neighbours, so it can be
+// filtered up to its far edge on its own; samples past the raster edge repeat the last one.
+class TiledHeightmap
+{
+public:
+	// height at pixel (x, y) of the source raster, x along the width
+	typedef std::function<uint16_t(int x, int y)> Sampler;
+
+	TiledHeightmap() = default;
+	~TiledHeightmap() { Close(); }
+	TiledHeightmap(const TiledHeightmap&) = delete;
+	TiledHeightmap& operator=(const TiledHeightmap&) = delete;
+
+	bool Open(const std::string& path)
+	{
+		Close();
+		if (!map(path))
+		{
+			std::cout << "ERROR::TILED_HEIGHTMAP: failed to map " << path << std::endl;
+			return false;
+		}
+		uint32_t header[HEADER_WORDS];
+		if (m_Size < sizeof(header) + 4 || std::memcmp(m_Data, FILE_MAGIC, 4) != 0)
+		{
+			std::cout << "ERROR::TILED_HEIGHTMAP: " << path << " is not a tiled heightmap" << std::endl;
+			Close();
+			return false;
+		}
+		std::memcpy(header, m_Data + 4, sizeof(header));
+		m_Width = header[1];
+		m_Height = header[2];
+		m_TileSize = header[3];
+		m_OverviewWidth = header[4];
+		m_OverviewHeight = header[5];
+		m_OverviewStep = header[6];
+		if (header[0] != FILE_VERSION || m_TileSize == 0 || m_Size < tileOffset(TilesX() * TilesY()) + TilesX() * TilesY() * 2 * sizeof(uint16_t))
+		{
+			std::cout << "ERROR::TILED_HEIGHTMAP: " << path << " has an unknown version or is truncated" << std::endl;
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		if (m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = INVALID_HANDLE_VALUE;
+#else
+		if (m_Data)
+			munmap(const_cast<unsigned char*>(m_Data), m_Size);
+		if (m_Descriptor >= 0)
+			close(m_Descriptor);
+		m_Descriptor = -1;
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	int Width() const { return m_Width; }
+	int Height() const { return m_Height; }
+	int TileSize() const { return m_TileSize; }
+	int TilesX() const { return (m_Width + m_TileSize - 1) / m_TileSize; }
+	int TilesY() const { return (m_Height + m_TileSize - 1) / m_TileSize; }
+	int TileSamples() const { return (m_TileSize + 1) * (m_TileSize + 1); }
+	size_t FileBytes() const { return m_Size; }
+
+	int OverviewWidth() const { return m_OverviewWidth; }
+	int OverviewHeight() const { return m_OverviewHeight; }
+	int OverviewStep() const { return m_OverviewStep; }
+	const uint16_t* Overview() const { return reinterpret_cast<const uint16_t*>(m_Data + HEADER_BYTES); }
+
+	// samples of tile (x, y) inside the mapping; reading them pages the tile in from disk
+	const uint16_t* Tile(int x, int y) const
+	{
+		return reinterpret_cast<const uint16_t*>(m_Data + tileOffset(y * TilesX() + x));
+	}
+
+	// minimum and maximum sample of every tile, overlap included, tile (x, y) at 2 * (y * TilesX() + x)
+	const uint16_t* TileRanges() const
+	{
+		return reinterpret_cast<const uint16_t*>(m_Data + tileOffset(TilesX() * TilesY()));
+	}
+
+	// converts a width x height raster to a tiled file; the overview keeps at most overviewSize
+	// samples along the longer side
+	static bool Write(const std::string& path, int width, int height, const Sampler& sample, int tileSize = 256, int overviewSize = 1024)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file || width <= 0 || height <= 0 || tileSize <= 0)
+		{
+			std::cout << "ERROR::TILED_HEIGHTMAP: cannot write " << path << std::endl;
+			return false;
+		}
+		int step = std::max(1, (std::max(width, height) + overviewSize - 1) / overviewSize);
+		int overviewWidth = (width + step - 1) / step, overviewHeight = (height + step - 1) / step;
+		uint32_t header[HEADER_WORDS] = { FILE_VERSION, (uint32_t)width, (uint32_t)height, (uint32_t)tileSize,
+			(uint32_t)overviewWidth, (uint32_t)overviewHeight, (uint32_t)step };
+		file.write(FILE_MAGIC, 4);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		std::vector<uint16_t> samples((size_t)overviewWidth * overviewHeight);
+		for (int y = 0; y < overviewHeight; y++)
+			for (int x = 0; x < overviewWidth; x++)
+				samples[(size_t)y * overviewWidth + x] = sample(x * step, y * step);
+		file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(uint16_t));
+
+		// the overview is followed by padding, so every tile starts 4 byte aligned
+		if (samples.size() % 2 != 0)
+			file.write("\0\0", 2);
+
+		int tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+		samples.resize((size_t)(tileSize + 1) * (tileSize + 1));
+		std::vector<uint16_t> ranges;
+		ranges.reserve((size_t)tilesX * tilesY * 2);
+		for (int tileY = 0; tileY < tilesY; tileY++)
+		{
+			for (int tileX = 0; tileX < tilesX; tileX++)
+			{
+				for (int y = 0; y <= tileSize; y++)
+				{
+					int sourceY = std::min(tileY * tileSize + y, height - 1);
+					for (int x = 0; x <= tileSize; x++)
+						samples[(size_t)y * (tileSize + 1) + x] = sample(std::min(tileX * tileSize + x, width - 1), sourceY);
+				}
+				file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(uint16_t));
+				auto range = std::minmax_element(samples.begin(), samples.end());
+				ranges.push_back(*range.first);
+				ranges.push_back(*range.second);
+			}
+		}
+		file.write(reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(uint16_t));
+		return (bool)file;
+	}
+
+	// converts a headerless raw raster of 16-bit little-endian samples, mapped rather than read whole
+	static bool ConvertRaw(const std::string& rawPath, int width, int height, const std::string& path, int tileSize = 256)
+	{
+		TiledHeightmap raw;
+		if (!raw.map(rawPath) || raw.m_Size < (size_t)width * height * 2)
+		{
+			std::cout << "ERROR::TILED_HEIGHTMAP: " << rawPath << " is smaller than " << width << " x " << height << " 16-bit samples" << std::endl;
+			return false;
+		}
+		const unsigned char* data = raw.m_Data;
+		return Write(path, width, height, [&](int x, int y)
+		{
+			const unsigned char* sample = data + ((size_t)y * width + x) * 2;
+			return uint16_t(sample[0] | (sample[1] << 8));
+		}, tileSize);
+	}
+
+	// writes a size x size synthetic raster (fractal value noise with ridges) for testing large terrain
+	static bool WriteSynthetic(const std::string& path, int size, int tileSize = 256, uint32_t seed = 1)
+	{
+		return Write(path, size, size, [seed](int x, int y)
+		{
+			float height = 0.0f, amplitude = 0.5f, frequency = 1.0f / 2048.0f;
+			for (int octave = 0; octave < 8; octave++)
+			{
+				float value = valueNoise(x * frequency, y * frequency, seed + octave);
+				height += amplitude * (octave < 3 ? value : 1.0f - std::fabs(value * 2.0f - 1.0f));
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+			return uint16_t(std::min(std::max(height, 0.0f), 1.0f) * 65535.0f);
+		}, tileSize);
+	}
+
+private:
+	static constexpr char FILE_MAGIC[4] = { 'L', 'T', 'H', 'M' };
+	static constexpr uint32_t FILE_VERSION = 2;
+	static constexpr int HEADER_WORDS = 7;
+	static constexpr size_t HEADER_BYTES = 4 + HEADER_WORDS * sizeof(uint32_t);
+
+	const unsigned char* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	HANDLE m_File = INVALID_HANDLE_VALUE, m_Mapping = nullptr;
+#else
+	int m_Descriptor = -1;
+#endif
+	int m_Width = 0, m_Height = 0, m_TileSize = 0;
+	int m_OverviewWidth = 0, m_OverviewHeight = 0, m_OverviewStep = 1;
+
+	size_t tileOffset(int tile) const
+	{
+		size_t overview = (size_t)m_OverviewWidth * m_OverviewHeight;
+		return HEADER_BYTES + (overview + overview % 2) * sizeof(uint16_t) + (size_t)tile * TileSamples() * sizeof(uint16_t);
+	}
+
+	bool map(const std::string& path)
+	{
+#ifdef _WIN32
+		m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size;
+		if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+			return false;
+		m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping)
+			m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_Data)
+			m_Size = (size_t)size.QuadPart;
+#else
+		m_Descriptor = open(path.c_str(), O_RDONLY);
+		struct stat info;
+		if (m_Descriptor < 0 || fstat(m_Descriptor, &info) != 0 || info.st_size == 0)
+			return false;
+		void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, m_Descriptor, 0);
+		if (data == MAP_FAILED)
+			return false;
+		m_Data = static_cast<const unsigned char*>(data);
+		m_Size = info.st_size;
+#endif
+		return m_Data != nullptr;
+	}
+
+	// smoothly interpolated random values on the integer lattice, in [0, 1]
+	static float valueNoise(float x, float y, uint32_t seed)
+	{
+		int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+		float fx = x - x0, fy = y - y0;
+		fx = fx * fx * (3.0f - 2.0f * fx);
+		fy = fy * fy * (3.0f - 2.0f * fy);
+		float top = lattice(x0, y0, seed) + (lattice(x0 + 1, y0, seed) - lattice(x0, y0, seed)) * fx;
+		float bottom = lattice(x0, y0 + 1, seed) + (lattice(x0 + 1, y0 + 1, seed) - lattice(x0, y0 + 1, seed)) * fx;
+		return top + (bottom - top) * fy;
+	}
+
+	static float lattice(int x, int y, uint32_t seed)
+	{
+		uint32_t hash = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u + seed * 2246822519u;
+		hash = (hash ^ (hash >> 13)) * 1274126177u;
+		return (hash ^ (hash >> 16)) / 4294967295.0f;
+	}
+};
@@ -0,0 +1,284 @@
+#pragma once
+
+/* Bakes a skinned Model + Animation into vertex animation textures (VAT) */
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/animator.h>
+#include <learnopengl/skinning.h>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// must match MAX_BONES in anim_model.vs, bone ids at or above it fall back to the bind pose
+#define VAT_MAX_BONES 100
+// widest row used for the baked textures, one frame can span several rows
+#define VAT_MAX_TEXTURE_WIDTH 4096
+
+struct BakedVertexAnimation
+{
+	int vertexCount = 0;	// vertices of all meshes, concatenated in Model::meshes order
+	int frameCount = 0;
+	int textureWidth = 0;	// texels per row
+	int rowsPerFrame = 0;	// rows a single frame occupies
+	float sampleRate = 0.0f;	// frames per second of animation time
+	float clipDuration = 0.0f;	// seconds of the baked clip, Duration() rounds it up to whole frames
+	std::vector<unsigned int> meshBaseVertex;	// first baked vertex of every mesh
+
+	// RGBA16F texel data, xyz = value, w = 1 (positions) or 0 (normals)
+	std::vector<std::uint16_t> positions;
+	std::vector<std::uint16_t> normals;
+
+	// GL textures, only valid after VertexAnimationBaker::Upload
+	unsigned int positionTexture = 0;
+	unsigned int normalTexture = 0;
+
+	int TextureHeight() const { return frameCount * rowsPerFrame; }
+	float Duration() const { return sampleRate > 0.0f ? frameCount / sampleRate : 0.0f; }
+};
+
+class VertexAnimationBaker
+{
+public:
+	// fills 'matrices' with the final bone matrices of the given frame
+	typedef std::function<void(int frame, std::vector<glm::mat4>& matrices)> PoseSampler;
+
+	// bakes every mesh of 'model' playing 'animation', sampled 'sampleRate' times per second
+	static BakedVertexAnimation Bake(Model& model, Animation& animation, float sampleRate)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> meshBaseVertex;
+		for (unsigned int i = 0; i < model.meshes.size(); i++)
+		{
+			meshBaseVertex.push_back(static_cast<unsigned int>(vertices.size()));
+			vertices.insert(vertices.end(), model.meshes[i].vertices.begin(), model.meshes[i].vertices.end());
+		}
+
+		float durationSeconds = clipSeconds(animation);
+		int frameCount = frameCountFor(durationSeconds, sampleRate);
+
+		// step a private animator through the clip, frame 0 is evaluated at time 0
+		Animator animator(&animation);
+		int evaluatedFrame = -1;
+		PoseSampler sampler = [&](int frame, std::vector<glm::mat4>& matrices)
+		{
+			if (evaluatedFrame < 0)
+				animator.UpdateAnimation(0.0f);
+			animator.UpdateAnimation((frame - std::max(evaluatedFrame, 0)) / sampleRate);
+			evaluatedFrame = frame;
+			matrices = animator.GetFinalBoneMatrices();
+		};
+		BakedVertexAnimation baked = Bake(vertices, meshBaseVertex, frameCount, sampleRate, sampler);
+		baked.clipDuration = durationSeconds;
+		return baked;
+	}
+
+	// CPU-only core of the baker, does not touch OpenGL so it can run headless
+	static BakedVertexAnimation Bake(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& meshBaseVertex,
+		int frameCount, float sampleRate, const PoseSampler& sampler)
+	{
+		BakedVertexAnimation baked;
+		baked.vertexCount = static_cast<int>(vertices.size());
+		baked.frameCount = frameCount;
+		baked.sampleRate = sampleRate;
+		baked.clipDuration = frameCount / sampleRate;
+		baked.meshBaseVertex = meshBaseVertex;
+		setLayout(baked);
+
+		size_t texelCount = static_cast<size_t>(baked.textureWidth) * baked.TextureHeight();
+		baked.positions.assign(texelCount * 4, 0);
+		baked.normals.assign(texelCount * 4, 0);
+
+		std::vector<glm::mat4> matrices;
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			sampler(frame, matrices);
+			size_t frameTexel = static_cast<size_t>(frame) * baked.rowsPerFrame * baked.textureWidth;
+			for (int v = 0; v < baked.vertexCount; v++)
+			{
+				glm::vec3 position, normal;
+				SkinVertex(vertices[v], matrices, position, normal);
+				size_t texel = (frameTexel + v) * 4;
+				WriteHalf4(&baked.positions[texel], glm::vec4(position, 1.0f));
+				WriteHalf4(&baked.normals[texel], glm::vec4(normal, 0.0f));
+			}
+		}
+		return baked;
+	}
+
+	// same math as the compute skinning pre-pass, see CpuSkinner in skinning.h
+	static void SkinVertex(const Vertex& vertex, const std::vector<glm::mat4>& matrices, glm::vec3& position, glm::vec3& normal)
+	{
+		int boneCount = std::min(static_cast<int>(matrices.size()), VAT_MAX_BONES);
+		CpuSkinner::SkinVertex(CpuSkinner::MakeInput(vertex), matrices.data(), boneCount, position, normal);
+	}
+
+	// creates the RGBA16F position and normal textures (requires a current GL context)
+	static void Upload(BakedVertexAnimation& baked)
+	{
+		baked.positionTexture = createTexture(baked, baked.positions);
+		baked.normalTexture = createTexture(baked, baked.normals);
+	}
+
+	// binds the baked textures and sets the playback uniforms expected by vat_model.vs
+	static void Bind(const BakedVertexAnimation& baked, Shader& shader, unsigned int positionUnit, unsigned int normalUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + positionUnit);
+		glBindTexture(GL_TEXTURE_2D, baked.positionTexture);
+		glActiveTexture(GL_TEXTURE0 + normalUnit);
+		glBindTexture(GL_TEXTURE_2D, baked.normalTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("vatPositions", positionUnit);
+		shader.setInt("vatNormals", normalUnit);
+		shader.setInt("vatTextureWidth", baked.textureWidth);
+		shader.setInt("vatRowsPerFrame", baked.rowsPerFrame);
+		shader.setInt("vatFrameCount", baked.frameCount);
+		shader.setFloat("vatSampleRate", baked.sampleRate);
+	}
+
+	// the baked data is a cache: save it next to the model and skip baking on the next run
+	static bool Save(const BakedVertexAnimation& baked, const std::string& path)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::uint32_t header[6] = { FILE_MAGIC, static_cast<std::uint32_t>(baked.vertexCount), static_cast<std::uint32_t>(baked.frameCount),
+			static_cast<std::uint32_t>(baked.textureWidth), static_cast<std::uint32_t>(baked.rowsPerFrame),
+			static_cast<std::uint32_t>(baked.meshBaseVertex.size()) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(&baked.sampleRate), sizeof(float));
+		file.write(reinterpret_cast<const char*>(&baked.clipDuration), sizeof(float));
+		file.write(reinterpret_cast<const char*>(baked.meshBaseVertex.data()), baked.meshBaseVertex.size() * sizeof(unsigned int));
+		file.write(reinterpret_cast<const char*>(baked.positions.data()), baked.positions.size() * sizeof(std::uint16_t));
+		file.write(reinterpret_cast<const char*>(baked.normals.data()), baked.normals.size() * sizeof(std::uint16_t));
+		return static_cast<bool>(file);
+	}
+
+	// loads a cache written by Save(), if it was baked from the same meshes, clip and sample rate
+	// as Bake(model, animation, sampleRate) would use now; returns false when it has to be rebaked.
+	// Only the vertex and mesh counts identify the model, edits that keep them are not detected
+	static bool Load(BakedVertexAnimation& baked, const std::string& path, Model& model, Animation& animation, float sampleRate)
+	{
+		std::vector<unsigned int> meshBaseVertex;
+		int vertexCount = 0;
+		for (unsigned int i = 0; i < model.meshes.size(); i++)
+		{
+			meshBaseVertex.push_back(static_cast<unsigned int>(vertexCount));
+			vertexCount += static_cast<int>(model.meshes[i].vertices.size());
+		}
+		return Load(baked, path, meshBaseVertex, vertexCount, clipSeconds(animation), sampleRate);
+	}
+
+	// core of the above, does not touch OpenGL so it can run headless
+	static bool Load(BakedVertexAnimation& baked, const std::string& path, const std::vector<unsigned int>& meshBaseVertex,
+		int vertexCount, float clipDuration, float sampleRate)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		std::streamoff fileSize = file.tellg();
+		file.seekg(0);
+
+		// what the cache has to hold to be usable
+		BakedVertexAnimation expected;
+		expected.vertexCount = vertexCount;
+		expected.meshBaseVertex = meshBaseVertex;
+		expected.sampleRate = sampleRate;
+		expected.clipDuration = clipDuration;
+		expected.frameCount = frameCountFor(clipDuration, sampleRate);
+		setLayout(expected);
+
+		std::uint32_t header[6];
+		float rates[2]; // sample rate, clip duration
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		file.read(reinterpret_cast<char*>(rates), sizeof(rates));
+		if (!file || header[0] != FILE_MAGIC)
+		{
+			std::cout << "ERROR::VAT:: " << path << " is not a baked vertex animation of this version" << std::endl;
+			return false;
+		}
+		if (header[1] != static_cast<std::uint32_t>(expected.vertexCount) || header[2] != static_cast<std::uint32_t>(expected.frameCount)
+			|| header[3] != static_cast<std::uint32_t>(expected.textureWidth) || header[4] != static_cast<std::uint32_t>(expected.rowsPerFrame)
+			|| header[5] != expected.meshBaseVertex.size() || rates[0] != expected.sampleRate || rates[1] != expected.clipDuration)
+		{
+			std::cout << "VAT:: " << path << " was baked from another model, clip or sample rate" << std::endl;
+			return false;
+		}
+		// the header now describes the expected sizes, the file has to hold exactly that much
+		size_t texelCount = static_cast<size_t>(expected.textureWidth) * expected.TextureHeight();
+		std::streamoff dataSize = sizeof(header) + sizeof(rates) + expected.meshBaseVertex.size() * sizeof(unsigned int)
+			+ 2 * texelCount * 4 * sizeof(std::uint16_t);
+		if (fileSize != dataSize)
+		{
+			std::cout << "ERROR::VAT:: " << path << " is truncated or has trailing data" << std::endl;
+			return false;
+		}
+
+		std::vector<unsigned int> savedBaseVertex(expected.meshBaseVertex.size());
+		file.read(reinterpret_cast<char*>(savedBaseVertex.data()), savedBaseVertex.size() * sizeof(unsigned int));
+		if (!file || savedBaseVertex != expected.meshBaseVertex)
+		{
+			std::cout << "VAT:: " << path << " was baked from another model" << std::endl;
+			return false;
+		}
+		expected.positions.resize(texelCount * 4);
+		expected.normals.resize(texelCount * 4);
+		file.read(reinterpret_cast<char*>(expected.positions.data()), expected.positions.size() * sizeof(std::uint16_t));
+		file.read(reinterpret_cast<char*>(expected.normals.data()), expected.normals.size() * sizeof(std::uint16_t));
+		if (!file)
+			return false;
+		baked = std::move(expected);
+		return true;
+	}
+
+private:
+	static const std::uint32_t FILE_MAGIC = 0x33544156; // "VAT3": clip duration stored, weights not renormalized
+
+	static float clipSeconds(Animation& animation)
+	{
+		return animation.GetDuration() / animation.GetTicksPerSecond();
+	}
+
+	static int frameCountFor(float durationSeconds, float sampleRate)
+	{
+		return std::max(1, static_cast<int>(std::ceil(durationSeconds * sampleRate)));
+	}
+
+	// texture width and rows per frame from vertexCount
+	static void setLayout(BakedVertexAnimation& baked)
+	{
+		baked.textureWidth = std::max(1, std::min(baked.vertexCount, VAT_MAX_TEXTURE_WIDTH));
+		baked.rowsPerFrame = std::max(1, (baked.vertexCount + baked.textureWidth - 1) / baked.textureWidth);
+	}
+
+	static void WriteHalf4(std::uint16_t* dest, const glm::vec4& value)
+	{
+		for (int i = 0; i < 4; i++)
+			dest[i] = glm::packHalf1x16(value[i]);
+	}
+
+	static unsigned int createTexture(const BakedVertexAnimation& baked, const std::vector<std::uint16_t>& data)
+	{
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, baked.textureWidth, baked.TextureHeight(), 0, GL_RGBA, GL_HALF_FLOAT, data.data());
+		// fetched with texelFetch only, interpolation between frames happens in the shader
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return textureID;
+	}
+};
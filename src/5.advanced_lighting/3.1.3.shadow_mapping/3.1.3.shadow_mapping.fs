@@ -10,10 +10,15 @@ in VS_OUT {
 
 uniform sampler2D diffuseTexture;
 uniform sampler2D shadowMap;
+uniform sampler2D momentMap; // blurred, mipmapped EVSM moments (see 3.1.3.shadow_mapping_moments.fs)
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
+uniform bool filtered;          // EVSM lookup instead of PCF
+uniform vec2 exponents;         // positive and negative EVSM warp
+uniform float lightBleedReduction;
+
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
     // perform perspective divide
@@ -52,6 +57,40 @@ float ShadowCalculation(vec4 fragPosLightSpace)
     return shadow;
 }
 
+// upper bound on the lit fraction from the mean and variance of one warp (Chebyshev's inequality)
+float ChebyshevUpperBound(vec2 moments, float mean, float minVariance)
+{
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    // light bleeding reduction: the bound is loose where several occluders overlap, cut off its tail
+    pMax = clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+    return mean <= moments.x ? 1.0 : pMax;
+}
+
+float FilteredShadowCalculation(vec4 fragPosLightSpace)
+{
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if (projCoords.z > 1.0)
+        return 0.0;
+    // same bias as the PCF path
+    vec3 normal = normalize(fs_in.Normal);
+    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
+    float depth = projCoords.z - max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    // one trilinear, anisotropic fetch replaces the PCF loop
+    vec4 moments = texture(momentMap, projCoords.xy);
+    float positive = exp(exponents.x * depth);
+    float negative = -exp(-exponents.y * depth);
+    // a minimum variance of 1e-4 in depth units, scaled by the slope of each warp
+    vec2 minVariance = vec2(exponents.x * positive, exponents.y * negative) * 0.0001;
+    minVariance *= minVariance;
+    float lit = min(ChebyshevUpperBound(moments.xy, positive, minVariance.x),
+                    ChebyshevUpperBound(moments.zw, negative, minVariance.y));
+    return 1.0 - lit;
+}
+
 void main()
 {
     vec3 color = texture(diffuseTexture, fs_in.TexCoords).rgb;
@@ -71,7 +110,7 @@ void main()
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;
     // calculate shadow
-    float shadow = ShadowCalculation(fs_in.FragPosLightSpace);
+    float shadow = filtered ? FilteredShadowCalculation(fs_in.FragPosLightSpace) : ShadowCalculation(fs_in.FragPosLightSpace);
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;
 
     FragColor = vec4(lighting, 1.0);
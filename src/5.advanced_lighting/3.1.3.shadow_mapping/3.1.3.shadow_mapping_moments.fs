@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform vec2 exponents; // positive and negative EVSM warp
+
+void main()
+{
+    // the orthographic light projection keeps depth linear, so it can be warped directly
+    float depth = gl_FragCoord.z;
+    float positive = exp(exponents.x * depth);
+    float negative = -exp(-exponents.y * depth);
+    FragColor = vec4(positive, positive * positive, negative, negative * negative);
+}
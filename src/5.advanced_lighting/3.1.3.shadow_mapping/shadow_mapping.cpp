@@ -11,6 +11,7 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/moment_shadow_filter.h>
 
 #include <iostream>
 #include <learnopengl/IMGUIContext.h>
@@ -53,7 +54,7 @@ int main()
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -95,6 +96,8 @@ int main()
     Shader shader("3.1.3.shadow_mapping.vs", "3.1.3.shadow_mapping.fs");
     Shader simpleDepthShader("3.1.3.shadow_mapping_depth.vs", "3.1.3.shadow_mapping_depth.fs");
     Shader debugDepthQuad("3.1.3.debug_quad.vs", "3.1.3.debug_quad_depth.fs");
+    Shader momentsShader("3.1.3.shadow_mapping_depth.vs", "3.1.3.shadow_mapping_moments.fs");
+    MomentShadowFilter *momentFilter = new MomentShadowFilter("3.1.3.shadow_mapping_blur.cs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -151,18 +154,59 @@ int main()
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // configure the filterable (EVSM) shadow map: moments in a mipmapped float texture, blurred once
+    // per frame instead of taking 9 depth samples per pixel
+    // -----------------------
+    unsigned int momentMap;
+    glGenTextures(1, &momentMap);
+    glBindTexture(GL_TEXTURE_2D, momentMap);
+    glTexStorage2D(GL_TEXTURE_2D, (int)std::log2(SHADOW_WIDTH) + 1, GL_RGBA32F, SHADOW_WIDTH, SHADOW_HEIGHT);
+    MomentShadowFilter::SetSampling(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    // like the depth map's border of 1.0: outside the light's frustum nothing is in shadow
+    const glm::vec4 clearMoments = MomentShadowFilter::Moments(1.0f);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, &clearMoments[0]);
+    unsigned int momentDepth;
+    glGenRenderbuffers(1, &momentDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, momentDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT);
+    unsigned int momentFBO;
+    glGenFramebuffers(1, &momentFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, momentFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, momentMap, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, momentDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Moment framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // GPU time of the shadow map (including the blur) and of the lighting pass, averaged over a second
+    unsigned int timeQueries[2];
+    glGenQueries(2, timeQueries);
+    GLuint64 shadowTime = 0, lightingTime = 0;
+    unsigned int timedFrames = 0;
+    float timedSeconds = 0.0f;
+    float shadowMs = 0.0f, lightingMs = 0.0f;
+
 
     // shader configuration
     // --------------------
     shader.use();
     shader.setInt("diffuseTexture", 0);
     shader.setInt("shadowMap", 1);
+    shader.setInt("momentMap", 2);
+    shader.setVec2("exponents", glm::vec2(MomentShadowFilter::PositiveExponent, MomentShadowFilter::NegativeExponent));
+    momentsShader.use();
+    momentsShader.setVec2("exponents", glm::vec2(MomentShadowFilter::PositiveExponent, MomentShadowFilter::NegativeExponent));
     debugDepthQuad.use();
     debugDepthQuad.setInt("depthMap", 0);
 
     // lighting info
     // -------------
     glm::vec3 lightPos(-2.0f, 4.0f, -1.0f);
+    int shadowFilter = 1; // 0: PCF, 1: EVSM
+    int blurRadius = 3;
+    float lightBleedReduction = 0.3f;
 
     IMGUIContext imgui_context(window);
 
@@ -185,6 +229,13 @@ int main()
         ImGui::Begin("Lighting");
         // 光的位置
         ImGui::SliderFloat3("Light Position", (float*)&lightPos, -10.0f, 10.0f);
+        ImGui::Combo("Shadow Filter", &shadowFilter, "PCF (9 taps)\0EVSM (blurred, 1 tap)\0");
+        if (shadowFilter == 1)
+        {
+            ImGui::SliderInt("Blur Radius", &blurRadius, 0, MomentShadowFilter::MaxRadius);
+            ImGui::SliderFloat("Light Bleed Reduction", &lightBleedReduction, 0.0f, 0.9f);
+        }
+        ImGui::Text("Shadow map: %.3f ms, lighting: %.3f ms", shadowMs, lightingMs);
         ImGui::End();
 
         // change light position over time
@@ -207,16 +258,32 @@ int main()
         lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
         lightSpaceMatrix = lightProjection * lightView;
         // render scene from light's point of view
-        simpleDepthShader.use();
-        simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[0]);
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
-        renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (shadowFilter == 0)
+        {
+            simpleDepthShader.use();
+            simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            renderScene(simpleDepthShader);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        else
+        {
+            // moments instead of depth, then one separable blur and the mip chain
+            momentsShader.use();
+            momentsShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glBindFramebuffer(GL_FRAMEBUFFER, momentFBO);
+            glClearBufferfv(GL_COLOR, 0, &clearMoments[0]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            renderScene(momentsShader);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            momentFilter->Filter(GL_TEXTURE_2D, momentMap, SHADOW_WIDTH, blurRadius);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
 
         // reset viewport
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
@@ -234,11 +301,34 @@ int main()
         shader.setVec3("viewPos", camera.Position);
         shader.setVec3("lightPos", lightPos);
         shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        shader.setBool("filtered", shadowFilter == 1);
+        shader.setFloat("lightBleedReduction", lightBleedReduction);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, depthMap);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, momentMap);
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[1]);
         renderScene(shader);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        // the results are waited for, which is fine for comparing the two filters
+        GLuint64 elapsed;
+        glGetQueryObjectui64v(timeQueries[0], GL_QUERY_RESULT, &elapsed);
+        shadowTime += elapsed;
+        glGetQueryObjectui64v(timeQueries[1], GL_QUERY_RESULT, &elapsed);
+        lightingTime += elapsed;
+        timedFrames++;
+        timedSeconds += deltaTime;
+        if (timedSeconds >= 1.0f)
+        {
+            shadowMs = (float)(shadowTime * 1.0e-6 / timedFrames);
+            lightingMs = (float)(lightingTime * 1.0e-6 / timedFrames);
+            shadowTime = lightingTime = 0;
+            timedFrames = 0;
+            timedSeconds = 0.0f;
+        }
 
         // render Depth map to quad for visual debugging
         // ---------------------------------------------
@@ -261,6 +351,7 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
+    delete momentFilter;
 
     glfwTerminate();
     return 0;
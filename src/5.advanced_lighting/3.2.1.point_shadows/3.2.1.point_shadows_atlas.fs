@@ -0,0 +1,109 @@
+#version 330 core
+out vec4 FragColor;
+
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+} fs_in;
+
+#define MAX_LIGHTS 32
+
+struct Light {
+    vec4 Position;  // xyz: position, w: range (the shadow far plane)
+    vec4 Color;     // rgb: color, w: 1.0 for a spot light
+    vec4 Direction; // spot light: xyz direction, w: cosine of the cutoff
+    ivec4 Faces;    // x: bit per face that has a tile in the atlas
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[MAX_LIGHTS];
+    int lightCount;
+};
+
+// per face: the light's view projection, and the tile's corner and size in the atlas
+layout (std140) uniform ShadowFaces
+{
+    mat4 faceMatrices[MAX_LIGHTS * 6];
+    vec4 faceTiles[MAX_LIGHTS * 6];
+};
+
+uniform sampler2D diffuseTexture;
+uniform sampler2D shadowAtlas;
+
+uniform vec3 viewPos;
+uniform bool shadows;
+
+float ShadowCalculation(int light, vec3 fragPos)
+{
+    vec3 fragToLight = fragPos - lights[light].Position.xyz;
+    // a point light's face is the major axis of the direction, in cubemap order +X -X +Y -Y +Z -Z
+    int face = 0;
+    if (lights[light].Color.w == 0.0)
+    {
+        vec3 a = abs(fragToLight);
+        if (a.x >= a.y && a.x >= a.z)
+            face = fragToLight.x > 0.0 ? 0 : 1;
+        else if (a.y >= a.z)
+            face = fragToLight.y > 0.0 ? 2 : 3;
+        else
+            face = fragToLight.z > 0.0 ? 4 : 5;
+    }
+    // faces without a tile saw no casters
+    if ((lights[light].Faces.x & (1 << face)) == 0)
+        return 0.0;
+
+    int index = light * 6 + face;
+    vec4 clipPos = faceMatrices[index] * vec4(fragPos, 1.0);
+    if (clipPos.w <= 0.0)
+        return 0.0;
+    // stay half a texel inside the tile so nothing is read from the neighbours
+    vec4 tile = faceTiles[index];
+    float halfTexel = 0.5 / (tile.z * textureSize(shadowAtlas, 0).x);
+    vec2 uv = clamp(clipPos.xy / clipPos.w * 0.5 + 0.5, halfTexel, 1.0 - halfTexel);
+    float closestDepth = texture(shadowAtlas, tile.xy + uv * tile.z).r;
+    // stored linear in [0,1] over the light's range, like the cubemap version
+    closestDepth *= lights[light].Position.w;
+    float currentDepth = length(fragToLight);
+    float bias = 0.05;
+    return currentDepth - bias > closestDepth ? 1.0 : 0.0;
+}
+
+void main()
+{           
+    vec3 color = texture(diffuseTexture, fs_in.TexCoords).rgb;
+    vec3 normal = normalize(fs_in.Normal);
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    // ambient
+    vec3 lighting = 0.3 * vec3(0.3) * color;
+    for (int i = 0; i < lightCount; ++i)
+    {
+        vec3 toLight = lights[i].Position.xyz - fs_in.FragPos;
+        float distance = length(toLight);
+        float range = lights[i].Position.w;
+        if (distance > range)
+            continue;
+        vec3 lightDir = toLight / distance;
+        // falls off to zero at the range
+        float attenuation = 1.0 - distance / range;
+        attenuation *= attenuation;
+        if (lights[i].Color.w != 0.0)
+        {
+            float cosAngle = dot(-lightDir, lights[i].Direction.xyz);
+            attenuation *= smoothstep(lights[i].Direction.w, mix(lights[i].Direction.w, 1.0, 0.2), cosAngle);
+        }
+        if (attenuation <= 0.0)
+            continue;
+        // diffuse
+        float diff = max(dot(lightDir, normal), 0.0);
+        // specular
+        vec3 halfwayDir = normalize(lightDir + viewDir);  
+        float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+        // calculate shadow
+        float shadow = shadows ? ShadowCalculation(i, fs_in.FragPos) : 0.0;
+        lighting += (1.0 - shadow) * (diff + spec) * attenuation * lights[i].Color.rgb * color;
+    }
+    
+    FragColor = vec4(lighting, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 shadowMatrix;
+uniform mat4 model;
+
+out vec4 FragPos; // world position for the linear depth in the fragment shader
+
+void main()
+{
+    FragPos = model * vec4(aPos, 1.0);
+    gl_Position = shadowMatrix * FragPos;
+}
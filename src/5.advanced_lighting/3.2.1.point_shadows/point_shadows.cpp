@@ -10,8 +10,11 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/shadow_atlas.h>
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 // 窗口大小变化回调函数
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -27,12 +30,42 @@ unsigned int loadTexture(const char* path);
 void renderScene(const Shader& shader);
 // 渲染一个立方体
 void renderCube();
+// 投射阴影的立方体的模型矩阵
+const std::vector<glm::mat4>& getCasterModels();
+// 创建阴影图集模式下的光源
+void createLights();
+// 移动会动的光源
+void updateLights(float time);
 
 // 设置
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 bool shadows = true;
 bool shadowsKeyPressed = false;
+bool atlasMode = true;
+bool atlasKeyPressed = false;
+
+// 阴影图集模式：几十个点光源和聚光灯共用一张深度纹理（按 M 切换回单个光源的深度立方体贴图）。
+// 每帧先按光源影响球在屏幕上的大小为它选择分辨率，再对它的每个面（点光源 6 个，聚光灯 1 个）
+// 剔除投射物：看不到任何投射物的面不分配图块，着色器里直接当作没有阴影。
+// 光源没有移动、图块位置也没变的面沿用上一帧的深度，不再渲染。
+// 房间只接收阴影：它包住了整个场景，墙后面什么都没有，所以不画进阴影贴图。
+const unsigned int MAX_LIGHTS = 32; // 与 3.2.1.point_shadows_atlas.fs 一致
+struct ShadowLight
+{
+    glm::vec3 Position;
+    glm::vec3 Color;
+    float Range;          // 光照范围，同时也是阴影的远平面
+    bool Spot;
+    glm::vec3 Direction;  // 聚光灯方向
+    float CutOff;         // 聚光灯的半角（弧度）
+    bool Moving;
+};
+std::vector<ShadowLight> lights;
+// 光源某个面（点光源 0-5，顺序同立方体贴图；聚光灯只有 0）的视图矩阵
+glm::mat4 getFaceView(const ShadowLight& light, int face);
+// 包围球是否与某个视图投影矩阵的视锥体相交
+bool sphereInFrustum(const glm::mat4& viewProjection, const glm::vec3& center, float radius);
 
 // 摄像机
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -92,6 +125,8 @@ int main()
     Shader shader("3.2.1.point_shadows.vs", "3.2.1.point_shadows.fs");
     Shader simpleDepthShader("3.2.1.point_shadows_depth.vs", "3.2.1.point_shadows_depth.fs",
                              "3.2.1.point_shadows_depth.gs");
+    Shader atlasShader("3.2.1.point_shadows.vs", "3.2.1.point_shadows_atlas.fs");
+    Shader atlasDepthShader("3.2.1.point_shadows_atlas_depth.vs", "3.2.1.point_shadows_depth.fs");
 
     // 加载纹理
     // -------------
@@ -137,6 +172,41 @@ int main()
     shader.use();
     shader.setInt("diffuseTexture", 0);
     shader.setInt("depthMap", 1);
+    atlasShader.use();
+    atlasShader.setInt("diffuseTexture", 0);
+    atlasShader.setInt("shadowAtlas", 1);
+
+    // 阴影图集，以及光源和光源面的 uniform 缓冲（std140 布局）
+    // -----------------------
+    ShadowAtlas *atlas = new ShadowAtlas(4096, 64, 1024);
+    struct GpuLight
+    {
+        glm::vec4 Position;   // w: 范围
+        glm::vec4 Color;      // w: 是否为聚光灯
+        glm::vec4 Direction;  // w: 半角的余弦
+        glm::ivec4 Faces;     // x: 在图集中有图块的面
+    };
+    unsigned int lightsUBO, facesUBO;
+    glGenBuffers(1, &lightsUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_LIGHTS * sizeof(GpuLight) + sizeof(glm::ivec4), NULL, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &facesUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, facesUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_LIGHTS * 6 * (sizeof(glm::mat4) + sizeof(glm::vec4)), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glUniformBlockBinding(atlasShader.ID, glGetUniformBlockIndex(atlasShader.ID, "Lights"), 0);
+    glUniformBlockBinding(atlasShader.ID, glGetUniformBlockIndex(atlasShader.ID, "ShadowFaces"), 1);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, lightsUBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1, facesUBO);
+    createLights();
+
+    // 阴影渲染的 GPU 计时，每秒输出一次
+    unsigned int timeQuery;
+    glGenQueries(1, &timeQuery);
+    float statTime = 0.0f;
+    unsigned int statFrames = 0;
+    GLuint64 statShadowNs = 0;
+    unsigned int statShadowed = 0, statUpdated = 0, statRendered = 0, statCached = 0, statSkipped = 0;
 
     // 灯光信息
     // -------------
@@ -163,60 +233,205 @@ int main()
         // ------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // 0. 创建深度立方体变换矩阵
-        // -----------------------------------------------
-        float near_plane = 1.0f;
-        float far_plane = 25.0f;
-        glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT,
-                                                near_plane, far_plane);
-        std::vector<glm::mat4> shadowTransforms;
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(1.0f, 0.0f, 0.0f),
-                                                            glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0f, 0.0f, 0.0f),
-                                                            glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, -1.0f, 0.0f),
-                                                            glm::vec3(0.0f, 0.0f, -1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, 1.0f),
-                                                            glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, -1.0f),
-                                                            glm::vec3(0.0f, -1.0f, 0.0f)));
-
-        // 1. 将场景渲染到深度立方体贴图
-        // --------------------------------
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        simpleDepthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-        simpleDepthShader.setFloat("far_plane", far_plane);
-        simpleDepthShader.setVec3("lightPos", lightPos);
-        renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // 2. 正常渲染场景 
-        // -------------------------
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shader.use();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
-                                                100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-        // 设置光照相关的uniform变量
-        shader.setVec3("lightPos", lightPos);
-        shader.setVec3("viewPos", camera.Position);
-        shader.setInt("shadows", shadows); // 通过按“空格”键启用/禁用阴影
-        shader.setFloat("far_plane", far_plane);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-        renderScene(shader);
+        if (atlasMode)
+        {
+            updateLights(currentFrame);
+
+            // 0. 为每个能看到投射物的光源面申请图块
+            // -----------------------------------------------
+            const std::vector<glm::mat4>& casters = getCasterModels();
+            std::vector<ShadowAtlas::Request> requests;
+            std::vector<glm::mat4> requestMatrices;
+            std::vector<std::vector<unsigned int>> requestCasters;
+            std::vector<GpuLight> gpuLights(lights.size());
+            for (unsigned int i = 0; i < lights.size(); ++i)
+            {
+                const ShadowLight& light = lights[i];
+                gpuLights[i].Position = glm::vec4(light.Position, light.Range);
+                gpuLights[i].Color = glm::vec4(light.Color, light.Spot ? 1.0f : 0.0f);
+                gpuLights[i].Direction = glm::vec4(light.Direction, std::cos(light.CutOff));
+                gpuLights[i].Faces = glm::ivec4(0);
+
+                // 分辨率取光源影响球在屏幕上的半径（像素）；摄像机在球内时用最大的图块
+                float distance = glm::length(light.Position - camera.Position);
+                float texels = distance <= light.Range ? 1.0e9f
+                    : light.Range / (distance * std::tan(glm::radians(camera.Zoom) * 0.5f)) * SCR_HEIGHT * 0.5f;
+                int size = atlas->TileSize(texels);
+
+                glm::mat4 faceProj = glm::perspective(light.Spot ? 2.0f * light.CutOff : glm::radians(90.0f), 1.0f,
+                                                      0.1f, light.Range);
+                for (int face = 0; face < (light.Spot ? 1 : 6); ++face)
+                {
+                    glm::mat4 faceMatrix = faceProj * getFaceView(light, face);
+                    // 这个面能看到的投射物（立方体的包围球对面的视锥体）
+                    std::vector<unsigned int> visible;
+                    for (unsigned int c = 0; c < casters.size(); ++c)
+                    {
+                        float radius = glm::length(glm::vec3(casters[c][0])) * std::sqrt(3.0f);
+                        if (sphereInFrustum(faceMatrix, glm::vec3(casters[c][3]), radius))
+                            visible.push_back(c);
+                    }
+                    if (visible.empty())
+                    {
+                        statSkipped++;
+                        continue;
+                    }
+                    requests.push_back({ i * 6 + face, size, !light.Moving });
+                    requestMatrices.push_back(faceMatrix);
+                    requestCasters.push_back(visible);
+                }
+            }
+            std::vector<ShadowAtlas::Tile> tiles = atlas->Pack(requests);
+
+            // 1. 只渲染没有缓存的图块，每个图块只画这个面能看到的投射物
+            // --------------------------------
+            std::vector<glm::mat4> faceMatrices(MAX_LIGHTS * 6, glm::mat4(1.0f));
+            std::vector<glm::vec4> faceTiles(MAX_LIGHTS * 6, glm::vec4(0.0f));
+            // 有图块的光源，以及这一帧重新渲染过图块的光源
+            std::vector<bool> lightShadowed(lights.size(), false), lightUpdated(lights.size(), false);
+            glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+            atlasDepthShader.use();
+            for (unsigned int r = 0; r < requests.size(); ++r)
+            {
+                const ShadowAtlas::Tile& tile = tiles[r];
+                if (tile.Size == 0)
+                    continue; // 图集放不下
+                unsigned int light = requests[r].Key / 6, face = requests[r].Key % 6;
+                gpuLights[light].Faces.x |= 1 << face;
+                lightShadowed[light] = true;
+                faceMatrices[requests[r].Key] = requestMatrices[r];
+                faceTiles[requests[r].Key] = atlas->TileRect(tile);
+                if (tile.Cached)
+                {
+                    statCached++;
+                    continue;
+                }
+                statRendered++;
+                lightUpdated[light] = true;
+                atlas->BeginTile(tile);
+                atlasDepthShader.setMat4("shadowMatrix", requestMatrices[r]);
+                atlasDepthShader.setVec3("lightPos", lights[light].Position);
+                atlasDepthShader.setFloat("far_plane", lights[light].Range);
+                for (unsigned int c : requestCasters[r])
+                {
+                    atlasDepthShader.setMat4("model", casters[c]);
+                    renderCube();
+                }
+            }
+            atlas->End();
+            glEndQuery(GL_TIME_ELAPSED);
+            statShadowed += (unsigned int)std::count(lightShadowed.begin(), lightShadowed.end(), true);
+            statUpdated += (unsigned int)std::count(lightUpdated.begin(), lightUpdated.end(), true);
+
+            int lightCount = (int)lights.size();
+            glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, gpuLights.size() * sizeof(GpuLight), gpuLights.data());
+            glBufferSubData(GL_UNIFORM_BUFFER, MAX_LIGHTS * sizeof(GpuLight), sizeof(int), &lightCount);
+            glBindBuffer(GL_UNIFORM_BUFFER, facesUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, faceMatrices.size() * sizeof(glm::mat4), faceMatrices.data());
+            glBufferSubData(GL_UNIFORM_BUFFER, faceMatrices.size() * sizeof(glm::mat4),
+                            faceTiles.size() * sizeof(glm::vec4), faceTiles.data());
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            // 2. 用图集正常渲染场景
+            // -------------------------
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            atlasShader.use();
+            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
+                                                    100.0f);
+            atlasShader.setMat4("projection", projection);
+            atlasShader.setMat4("view", camera.GetViewMatrix());
+            atlasShader.setVec3("viewPos", camera.Position);
+            atlasShader.setInt("shadows", shadows);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, woodTexture);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, atlas->Texture());
+            renderScene(atlasShader);
+        }
+        else
+        {
+
+            // 0. 创建深度立方体变换矩阵
+            // -----------------------------------------------
+            float near_plane = 1.0f;
+            float far_plane = 25.0f;
+            glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT,
+                                                    near_plane, far_plane);
+            std::vector<glm::mat4> shadowTransforms;
+            shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(1.0f, 0.0f, 0.0f),
+                                                                glm::vec3(0.0f, -1.0f, 0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0f, 0.0f, 0.0f),
+                                                                glm::vec3(0.0f, -1.0f, 0.0f)));
+            shadowTransforms.push_back(
+                shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, -1.0f, 0.0f),
+                                                                glm::vec3(0.0f, 0.0f, -1.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, 1.0f),
+                                                                glm::vec3(0.0f, -1.0f, 0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, -1.0f),
+                                                                glm::vec3(0.0f, -1.0f, 0.0f)));
+
+            // 1. 将场景渲染到深度立方体贴图
+            // --------------------------------
+            glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+            glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            simpleDepthShader.use();
+            for (unsigned int i = 0; i < 6; ++i)
+                simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+            simpleDepthShader.setFloat("far_plane", far_plane);
+            simpleDepthShader.setVec3("lightPos", lightPos);
+            renderScene(simpleDepthShader);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glEndQuery(GL_TIME_ELAPSED);
+            statShadowed++;
+            statUpdated++;
+            statRendered += 6;
+
+            // 2. 正常渲染场景
+            // -------------------------
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            shader.use();
+            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
+                                                    100.0f);
+            glm::mat4 view = camera.GetViewMatrix();
+            shader.setMat4("projection", projection);
+            shader.setMat4("view", view);
+            // 设置光照相关的uniform变量
+            shader.setVec3("lightPos", lightPos);
+            shader.setVec3("viewPos", camera.Position);
+            shader.setInt("shadows", shadows); // 通过按“空格”键启用/禁用阴影
+            shader.setFloat("far_plane", far_plane);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, woodTexture);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+            renderScene(shader);
+        }
+
+        // 阴影渲染的 GPU 时间（纳秒）；等待查询结果会让 CPU 和 GPU 同步，只适合用来对比
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &elapsed);
+        statShadowNs += elapsed;
+        statTime += deltaTime;
+        statFrames++;
+        if (statTime >= 1.0f)
+        {
+            double shadowMs = statShadowNs * 1.0e-6 / statFrames;
+            std::cout << (atlasMode ? "atlas: " : "cubemap: ") << statShadowed / statFrames << " shadowed lights, "
+                      << statRendered / statFrames << " faces rendered, " << statCached / statFrames << " cached, "
+                      << statSkipped / statFrames << " without casters; shadow pass " << shadowMs << " ms, "
+                      << (statShadowed ? shadowMs * statFrames / statShadowed : 0.0) << " ms per shadowed light, "
+                      << (statUpdated ? shadowMs * statFrames / statUpdated : 0.0) << " ms per updated light" << std::endl;
+            statTime = 0.0f;
+            statFrames = 0;
+            statShadowNs = 0;
+            statShadowed = statUpdated = statRendered = statCached = statSkipped = 0;
+        }
 
         // glfw：交换缓冲区并轮询 IO 事件（键盘按下/释放，鼠标移动等）
         // -------------------------------------------------------------------------------
@@ -224,6 +439,10 @@ int main()
         glfwPollEvents();
     }
 
+    // 在上下文销毁之前释放 GL 资源
+    // ----------------------------
+    delete atlas;
+
     glfwTerminate();
     return 0;
 }
@@ -244,32 +463,125 @@ void renderScene(const Shader& shader)
     shader.setInt("reverse_normals", 0); // 然后关闭反转法线
     glEnable(GL_CULL_FACE);
     // 其他立方体
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(4.0f, -3.5f, 0.0));
-    model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 3.0f, 1.0));
-    model = glm::scale(model, glm::vec3(0.75f));
-    shader.setMat4("model", model);
-    renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-3.0f, -1.0f, 0.0));
-    model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.5f, 1.0f, 1.5));
-    model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.5f, 2.0f, -3.0));
-    model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-    model = glm::scale(model, glm::vec3(0.75f));
-    shader.setMat4("model", model);
-    renderCube();
+    for (const glm::mat4& caster : getCasterModels())
+    {
+        shader.setMat4("model", caster);
+        renderCube();
+    }
+}
+
+// 投射阴影的立方体
+// --------------------
+const std::vector<glm::mat4>& getCasterModels()
+{
+    static std::vector<glm::mat4> models;
+    if (models.empty())
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(4.0f, -3.5f, 0.0));
+        model = glm::scale(model, glm::vec3(0.5f));
+        models.push_back(model);
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(2.0f, 3.0f, 1.0));
+        model = glm::scale(model, glm::vec3(0.75f));
+        models.push_back(model);
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(-3.0f, -1.0f, 0.0));
+        model = glm::scale(model, glm::vec3(0.5f));
+        models.push_back(model);
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(-1.5f, 1.0f, 1.5));
+        model = glm::scale(model, glm::vec3(0.5f));
+        models.push_back(model);
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(-1.5f, 2.0f, -3.0));
+        model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
+        model = glm::scale(model, glm::vec3(0.75f));
+        models.push_back(model);
+    }
+    return models;
+}
+
+// 阴影图集模式的光源：16 个点光源，外加 8 个挂在天花板上朝下照的聚光灯
+// --------------------
+void createLights()
+{
+    const glm::vec3 palette[] = {
+        glm::vec3(1.0f, 0.8f, 0.6f), glm::vec3(0.6f, 0.8f, 1.0f), glm::vec3(1.0f, 0.5f, 0.5f),
+        glm::vec3(0.5f, 1.0f, 0.6f), glm::vec3(0.9f, 0.6f, 1.0f), glm::vec3(1.0f, 1.0f, 0.6f)
+    };
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        ShadowLight light;
+        // 两圈交错排列，避开立方体
+        float angle = glm::radians(22.5f * i + 11.25f);
+        float radius = i % 2 == 0 ? 3.8f : 2.6f;
+        light.Position = glm::vec3(std::cos(angle) * radius, i % 2 == 0 ? -2.0f : 0.0f, std::sin(angle) * radius);
+        light.Color = palette[i % 6] * 0.8f;
+        light.Range = 6.0f;
+        light.Spot = false;
+        light.Direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        light.CutOff = 0.0f;
+        // 0 号光源和原来的光源一样在 z 轴上来回移动，另外三个绕场景转圈
+        light.Moving = i < 4;
+        lights.push_back(light);
+    }
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        ShadowLight light;
+        light.Position = glm::vec3(i % 2 == 0 ? -2.5f : 2.5f, 4.5f, -3.5f + 2.0f * (i / 2));
+        light.Color = palette[(i + 3) % 6];
+        light.Range = 10.0f;
+        light.Spot = true;
+        light.Direction = glm::normalize(glm::vec3(0.0f, -1.0f, i % 2 == 0 ? 0.3f : -0.3f));
+        light.CutOff = glm::radians(35.0f);
+        light.Moving = false;
+        lights.push_back(light);
+    }
+}
+
+void updateLights(float time)
+{
+    lights[0].Position = glm::vec3(0.0f, 0.0f, std::sin(time * 0.5f) * 3.0f);
+    for (unsigned int i = 1; i < 4; ++i)
+    {
+        float angle = time * 0.3f + glm::radians(120.0f * i);
+        lights[i].Position = glm::vec3(std::cos(angle) * 3.2f, -1.0f + i, std::sin(angle) * 3.2f);
+    }
+}
+
+// 点光源的面和阴影立方体贴图的面顺序、朝向都相同，着色器按方向的主轴选择面
+// --------------------
+glm::mat4 getFaceView(const ShadowLight& light, int face)
+{
+    if (light.Spot)
+    {
+        glm::vec3 up = std::abs(light.Direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::lookAt(light.Position, light.Position + light.Direction, up);
+    }
+    const glm::vec3 directions[6] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+    };
+    const glm::vec3 ups[6] = {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+    };
+    return glm::lookAt(light.Position, light.Position + directions[face], ups[face]);
+}
+
+// 从视图投影矩阵的行取出视锥体的 6 个平面，球在任意一个平面外侧就不相交
+// --------------------
+bool sphereInFrustum(const glm::mat4& viewProjection, const glm::vec3& center, float radius)
+{
+    glm::mat4 m = glm::transpose(viewProjection);
+    const glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+    for (const glm::vec4& plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * glm::length(glm::vec3(plane)))
+            return false;
+    }
+    return true;
 }
 
 // renderCube() 渲染一个边长为1的3D立方体（在标准化设备坐标系下）。
@@ -373,6 +685,16 @@ void processInput(GLFWwindow* window)
     {
         shadowsKeyPressed = false;
     }
+
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !atlasKeyPressed)
+    {
+        atlasMode = !atlasMode;
+        atlasKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE)
+    {
+        atlasKeyPressed = false;
+    }
 }
 
 // glfw：每当窗口大小发生变化（由操作系统或用户调整）时，此回调函数被调用
@@ -9,12 +9,16 @@ in VS_OUT {
 
 uniform sampler2D diffuseTexture;
 uniform samplerCube depthMap;
+uniform samplerCube momentMap; // blurred, mipmapped EVSM moments (see 3.2.2.point_shadows_moments.fs)
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
 uniform float far_plane;
 uniform bool shadows;
+uniform bool filtered;          // EVSM lookup instead of PCF
+uniform vec2 exponents;         // positive and negative EVSM warp
+uniform float lightBleedReduction;
 
 
 // array of offset direction for sampling
@@ -79,6 +83,36 @@ float ShadowCalculation(vec3 fragPos)
     return shadow;
 }
 
+// upper bound on the lit fraction from the mean and variance of one warp (Chebyshev's inequality)
+float ChebyshevUpperBound(vec2 moments, float mean, float minVariance)
+{
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    // light bleeding reduction: the bound is loose where several occluders overlap, cut off its tail
+    pMax = clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+    return mean <= moments.x ? 1.0 : pMax;
+}
+
+float FilteredShadowCalculation(vec3 fragPos)
+{
+    vec3 fragToLight = fragPos - lightPos;
+    // the same [0,1] depth the moments were written with, biased like the PCF path; the blurred mean
+    // of a concave corner lies in front of it
+    float bias = 0.15;
+    float depth = (length(fragToLight) - bias) / far_plane;
+    // one trilinear (and anisotropic) fetch replaces the PCF loop
+    vec4 moments = texture(momentMap, fragToLight);
+    float positive = exp(exponents.x * depth);
+    float negative = -exp(-exponents.y * depth);
+    // a minimum variance of 1e-4 in depth units, scaled by the slope of each warp
+    vec2 minVariance = vec2(exponents.x * positive, exponents.y * negative) * 0.0001;
+    minVariance *= minVariance;
+    float lit = min(ChebyshevUpperBound(moments.xy, positive, minVariance.x),
+                    ChebyshevUpperBound(moments.zw, negative, minVariance.y));
+    return 1.0 - lit;
+}
+
 void main()
 {           
     vec3 color = texture(diffuseTexture, fs_in.TexCoords).rgb;
@@ -98,7 +132,9 @@ void main()
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
     // calculate shadow
-    float shadow = shadows ? ShadowCalculation(fs_in.FragPos) : 0.0;                      
+    float shadow = 0.0;
+    if (shadows)
+        shadow = filtered ? FilteredShadowCalculation(fs_in.FragPos) : ShadowCalculation(fs_in.FragPos);                      
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
     
     FragColor = vec4(lighting, 1.0);
@@ -0,0 +1,40 @@
+#version 430 core
+#define GROUP_SIZE 128
+#define MAX_RADIUS 16
+layout (local_size_x = GROUP_SIZE) in;
+
+// one pass of the separable Gaussian over shadow map moments
+layout (rgba32f, binding = 0) uniform readonly image2D source;
+layout (rgba32f, binding = 1) uniform writeonly image2D destination;
+
+uniform vec2 direction; // (1, 0) along rows, (0, 1) along columns
+uniform int radius;
+uniform float weights[MAX_RADIUS + 1];
+
+// the group's texels plus the radius on both sides, so every texel is read from the image once
+shared vec4 line[GROUP_SIZE + 2 * MAX_RADIUS];
+
+void main()
+{
+    ivec2 size = imageSize(source);
+    ivec2 along = ivec2(direction);
+    ivec2 across = ivec2(1) - along;
+    int length = along.x != 0 ? size.x : size.y;
+    int start = int(gl_WorkGroupID.x) * GROUP_SIZE;
+    int row = int(gl_WorkGroupID.y);
+
+    for (int i = int(gl_LocalInvocationID.x); i < GROUP_SIZE + 2 * radius; i += GROUP_SIZE)
+    {
+        int p = clamp(start + i - radius, 0, length - 1); // repeat the edge texels
+        line[i] = imageLoad(source, along * p + across * row);
+    }
+    barrier();
+
+    int x = int(gl_LocalInvocationID.x);
+    if (start + x >= length)
+        return;
+    vec4 sum = line[x + radius] * weights[0];
+    for (int i = 1; i <= radius; ++i)
+        sum += (line[x + radius - i] + line[x + radius + i]) * weights[i];
+    imageStore(destination, along * (start + x) + across * row, sum);
+}
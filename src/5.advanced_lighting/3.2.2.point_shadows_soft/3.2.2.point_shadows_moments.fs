@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec4 FragPos;
+
+uniform vec3 lightPos;
+uniform float far_plane;
+uniform vec2 exponents; // positive and negative EVSM warp
+
+void main()
+{
+    // same linear depth as 3.2.2.point_shadows_depth.fs
+    float lightDistance = length(FragPos.xyz - lightPos) / far_plane;
+    gl_FragDepth = lightDistance;
+
+    // store the warped depth and its square for both warps; these can be filtered
+    float positive = exp(exponents.x * lightDistance);
+    float negative = -exp(-exponents.y * lightDistance);
+    FragColor = vec4(positive, positive * positive, negative, negative * negative);
+}
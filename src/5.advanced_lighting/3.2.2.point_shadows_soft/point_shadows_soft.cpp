@@ -10,6 +10,7 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/moment_shadow_filter.h>
 
 #include <iostream>
 
@@ -26,6 +27,8 @@ const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 bool shadows = true;
 bool shadowsKeyPressed = false;
+bool filtered = true; // EVSM instead of PCF, toggled with 'F'
+bool filteredKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -42,7 +45,7 @@ int main()
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -84,6 +87,8 @@ int main()
     // -------------------------
     Shader shader("3.2.2.point_shadows.vs", "3.2.2.point_shadows.fs");
     Shader simpleDepthShader("3.2.2.point_shadows_depth.vs", "3.2.2.point_shadows_depth.fs", "3.2.2.point_shadows_depth.gs");
+    Shader momentsShader("3.2.2.point_shadows_depth.vs", "3.2.2.point_shadows_moments.fs", "3.2.2.point_shadows_depth.gs");
+    MomentShadowFilter *momentFilter = new MomentShadowFilter("3.2.2.point_shadows_blur.cs");
 
     // load textures
     // -------------
@@ -112,12 +117,53 @@ int main()
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // configure the filterable (EVSM) shadow map: moments in a mipmapped float cubemap. Blurred
+    // moments need far fewer texels than hard depth comparisons for the same softness, so this map
+    // is half the resolution of the depth cubemap; the blur radius matches the PCF disk roughly.
+    const unsigned int MOMENT_SIZE = 512;
+    const int blurRadius = 8;
+    unsigned int momentCubemap;
+    glGenTextures(1, &momentCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, momentCubemap);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, (int)std::log2(MOMENT_SIZE) + 1, GL_RGBA32F, MOMENT_SIZE, MOMENT_SIZE);
+    MomentShadowFilter::SetSampling(GL_TEXTURE_CUBE_MAP);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    unsigned int momentDepthCubemap;
+    glGenTextures(1, &momentDepthCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, momentDepthCubemap);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_DEPTH_COMPONENT24, MOMENT_SIZE, MOMENT_SIZE);
+    unsigned int momentFBO;
+    glGenFramebuffers(1, &momentFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, momentFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, momentCubemap, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, momentDepthCubemap, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Moment framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // texels nothing was drawn to are fully lit: the moments of the far plane
+    const glm::vec4 clearMoments = MomentShadowFilter::Moments(1.0f);
+
+    // GPU time of the shadow map (including the blur) and of the lighting pass, printed every second
+    unsigned int timeQueries[2];
+    glGenQueries(2, timeQueries);
+    GLuint64 shadowTime = 0, lightingTime = 0;
+    unsigned int timedFrames = 0;
+    float timedSeconds = 0.0f;
+
 
     // shader configuration
     // --------------------
     shader.use();
     shader.setInt("diffuseTexture", 0);
     shader.setInt("depthMap", 1);
+    shader.setInt("momentMap", 2);
+    shader.setVec2("exponents", glm::vec2(MomentShadowFilter::PositiveExponent, MomentShadowFilter::NegativeExponent));
+    shader.setFloat("lightBleedReduction", 0.3f);
+    momentsShader.use();
+    momentsShader.setVec2("exponents", glm::vec2(MomentShadowFilter::PositiveExponent, MomentShadowFilter::NegativeExponent));
 
     // lighting info
     // -------------
@@ -158,18 +204,38 @@ int main()
         shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
         shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
 
-        // 1. render scene to depth cubemap
+        // 1. render scene to depth cubemap (PCF) or to the moment cubemap, which is then blurred once (EVSM)
         // --------------------------------
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        simpleDepthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-        simpleDepthShader.setFloat("far_plane", far_plane);
-        simpleDepthShader.setVec3("lightPos", lightPos);
-        renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[0]);
+        if (!filtered)
+        {
+            glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            simpleDepthShader.use();
+            for (unsigned int i = 0; i < 6; ++i)
+                simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+            simpleDepthShader.setFloat("far_plane", far_plane);
+            simpleDepthShader.setVec3("lightPos", lightPos);
+            renderScene(simpleDepthShader);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        else
+        {
+            glViewport(0, 0, MOMENT_SIZE, MOMENT_SIZE);
+            glBindFramebuffer(GL_FRAMEBUFFER, momentFBO);
+            glClearBufferfv(GL_COLOR, 0, &clearMoments[0]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            momentsShader.use();
+            for (unsigned int i = 0; i < 6; ++i)
+                momentsShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+            momentsShader.setFloat("far_plane", far_plane);
+            momentsShader.setVec3("lightPos", lightPos);
+            renderScene(momentsShader);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            momentFilter->Filter(GL_TEXTURE_CUBE_MAP, momentCubemap, MOMENT_SIZE, blurRadius);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
 
         // 2. render scene as normal 
         // -------------------------
@@ -185,11 +251,33 @@ int main()
         shader.setVec3("viewPos", camera.Position);
         shader.setInt("shadows", shadows); // enable/disable shadows by pressing 'SPACE'
         shader.setFloat("far_plane", far_plane);
+        shader.setInt("filtered", filtered); // switch between PCF and EVSM by pressing 'F'
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, momentCubemap);
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[1]);
         renderScene(shader);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        // the results are waited for, which is fine for comparing the two modes
+        GLuint64 elapsed;
+        glGetQueryObjectui64v(timeQueries[0], GL_QUERY_RESULT, &elapsed);
+        shadowTime += elapsed;
+        glGetQueryObjectui64v(timeQueries[1], GL_QUERY_RESULT, &elapsed);
+        lightingTime += elapsed;
+        timedFrames++;
+        timedSeconds += deltaTime;
+        if (timedSeconds >= 1.0f)
+        {
+            std::cout << (filtered ? "EVSM" : "PCF") << ": shadow map " << shadowTime * 1.0e-6 / timedFrames
+                      << " ms, lighting " << lightingTime * 1.0e-6 / timedFrames << " ms" << std::endl;
+            shadowTime = lightingTime = 0;
+            timedFrames = 0;
+            timedSeconds = 0.0f;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -197,6 +285,10 @@ int main()
         glfwPollEvents();
     }
 
+    // de-allocate the GL resources while their context still exists:
+    // --------------------------------------------------------------
+    delete momentFilter;
+
     glfwTerminate();
     return 0;
 }
@@ -343,6 +435,16 @@ void processInput(GLFWwindow *window)
     {
         shadowsKeyPressed = false;
     }
+
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && !filteredKeyPressed)
+    {
+        filtered = !filtered;
+        filteredKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE)
+    {
+        filteredKeyPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -1,13 +1,23 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
+// one instance per light
+struct Light {
+    vec4 PositionRadius;
+    vec4 Color;
+};
+layout (std430, binding = 0) readonly buffer Lights { Light lights[]; };
+
+out vec3 LightColor;
+
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
+uniform float boxSize;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    LightColor = lights[gl_InstanceID].Color.rgb;
+    gl_Position = projection * view * vec4(aPos * boxSize + lights[gl_InstanceID].PositionRadius.xyz, 1.0);
+}
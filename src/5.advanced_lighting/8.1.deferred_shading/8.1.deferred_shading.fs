@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 out vec4 FragColor;
 
 in vec2 TexCoords;
@@ -6,41 +6,98 @@ in vec2 TexCoords;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth;
+
+uniform bool packedGBuffer; // position from depth, normals in two components (see GBuffer)
+uniform mat4 inverseViewProjection;
+
+// inverse of octahedralEncode() in the geometry pass
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0); // unfold the lower half
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// world space position of a pixel from its texture coordinates and depth
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
 
 struct Light {
-    vec3 Position;
-    vec3 Color;
-    
-    float Linear;
-    float Quadratic;
+    vec4 PositionRadius; // w: distance beyond which the light is ignored
+    vec4 Color;
 };
-const int NR_LIGHTS = 32;
-uniform Light lights[NR_LIGHTS];
+layout (std430, binding = 0) readonly buffer Lights { Light lights[]; };
+// per cluster the offset and count of its lights in lightIndices
+layout (std430, binding = 1) readonly buffer Clusters { uvec2 clusters[]; };
+layout (std430, binding = 2) readonly buffer LightIndices { uint lightIndices[]; };
+
+uniform int lightCount;
+uniform bool clustered; // false: every light is tested for every pixel
+uniform float linear;
+uniform float quadratic;
 uniform vec3 viewPos;
 
+// the cluster grid, see LightClusterBuilder
+uniform mat4 view;
+uniform ivec3 clusterGrid;
+uniform vec2 screenSize;
+uniform float sliceScale;
+uniform float sliceBias;
+
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos, Normal;
+    if (packedGBuffer)
+    {
+        FragPos = reconstructPosition(TexCoords, texture(gDepth, TexCoords).r);
+        Normal = octahedralDecode(texture(gNormal, TexCoords).rg);
+    }
+    else
+    {
+        FragPos = texture(gPosition, TexCoords).rgb;
+        Normal = texture(gNormal, TexCoords).rgb;
+    }
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     
+    // find the lights that can reach this pixel
+    uint first = 0u;
+    uint count = uint(lightCount);
+    if (clustered)
+    {
+        float depth = max(-(view * vec4(FragPos, 1.0)).z, 1e-4);
+        ivec3 cell = ivec3(ivec2(gl_FragCoord.xy / screenSize * vec2(clusterGrid.xy)), int(floor(log(depth) * sliceScale + sliceBias)));
+        cell = clamp(cell, ivec3(0), clusterGrid - 1);
+        uvec2 cluster = clusters[cell.x + clusterGrid.x * (cell.y + clusterGrid.y * cell.z)];
+        first = cluster.x;
+        count = cluster.y;
+    }
+
     // then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
     vec3 viewDir  = normalize(viewPos - FragPos);
-    for(int i = 0; i < NR_LIGHTS; ++i)
+    for(uint i = 0u; i < count; ++i)
     {
+        Light light = lights[clustered ? lightIndices[first + i] : i];
+        float distance = length(light.PositionRadius.xyz - FragPos);
+        if (distance >= light.PositionRadius.w)
+            continue;
         // diffuse
-        vec3 lightDir = normalize(lights[i].Position - FragPos);
-        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].Color;
+        vec3 lightDir = normalize(light.PositionRadius.xyz - FragPos);
+        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * light.Color.rgb;
         // specular
         vec3 halfwayDir = normalize(lightDir + viewDir);  
         float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-        vec3 specular = lights[i].Color * spec * Specular;
+        vec3 specular = light.Color.rgb * spec * Specular;
         // attenuation
-        float distance = length(lights[i].Position - FragPos);
-        float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
+        float attenuation = 1.0 / (1.0 + linear * distance + quadratic * distance * distance);
         diffuse *= attenuation;
         specular *= attenuation;
         lighting += diffuse + specular;        
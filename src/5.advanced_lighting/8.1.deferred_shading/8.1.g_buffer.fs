@@ -10,12 +10,25 @@ in vec3 Normal;
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
+uniform bool packedGBuffer; // no position target, normals in two components (see GBuffer)
+
+// the normal projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is folded over the
+// upper one, so it flattens to the square [-1, 1]^2; stored in [0, 1] for the GL_RG16 target
+vec2 octahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return folded * 0.5 + 0.5;
+}
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
+    // store the fragment position vector in the first gbuffer texture (dropped by the packed layout,
+    // which has no draw buffer 0)
     gPosition = FragPos;
     // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    vec3 normal = normalize(Normal);
+    gNormal = packedGBuffer ? vec3(octahedralEncode(normal), 0.0) : normal;
     // and the diffuse per-fragment color
     gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb;
     // store specular intensity in gAlbedoSpec's alpha component
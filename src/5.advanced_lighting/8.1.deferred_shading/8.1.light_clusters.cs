@@ -0,0 +1,84 @@
+#version 430 core
+#define GROUP_SIZE 128
+layout (local_size_x = GROUP_SIZE) in;
+
+// one invocation per cluster tests every light against the cluster's view space box; the group
+// moves the lights into view space and shared memory GROUP_SIZE at a time. The lights are walked
+// twice: the first pass counts the cluster's lights, then the cluster allocates exactly that many
+// entries of the index list with an atomic, and the second pass writes them.
+struct Light {
+    vec4 PositionRadius;
+    vec4 Color;
+};
+struct Bounds {
+    vec4 Min;
+    vec4 Max;
+};
+layout (std430, binding = 0) readonly buffer Lights { Light lights[]; };
+layout (std430, binding = 1) writeonly buffer Clusters { uvec2 clusters[]; };
+layout (std430, binding = 2) writeonly buffer LightIndices { uint lightIndices[]; };
+layout (std430, binding = 3) readonly buffer ClusterBounds { Bounds bounds[]; };
+// zeroed before the dispatch; afterwards the entries all clusters asked for, which may be more
+// than indexCapacity
+layout (std430, binding = 4) coherent buffer IndexCount { uint indexCount; };
+
+uniform mat4 view;
+uniform int lightCount;
+uniform int clusterCount;
+uniform int indexCapacity;
+
+shared vec4 batch[GROUP_SIZE]; // view space center, radius
+
+void main()
+{
+    int cluster = int(gl_GlobalInvocationID.x);
+    bool inRange = cluster < clusterCount;
+    vec3 boxMin = vec3(0.0), boxMax = vec3(0.0);
+    if (inRange)
+    {
+        boxMin = bounds[cluster].Min.xyz;
+        boxMax = bounds[cluster].Max.xyz;
+    }
+    uint capacity = uint(indexCapacity);
+    uint offset = 0u;
+    uint count = 0u;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1 && inRange)
+        {
+            offset = atomicAdd(indexCount, count);
+            count = 0u;
+        }
+        for (int first = 0; first < lightCount; first += GROUP_SIZE)
+        {
+            int i = first + int(gl_LocalInvocationID.x);
+            if (i < lightCount)
+            {
+                vec4 light = lights[i].PositionRadius;
+                batch[gl_LocalInvocationID.x] = vec4((view * vec4(light.xyz, 1.0)).xyz, light.w);
+            }
+            barrier();
+
+            int batchSize = min(GROUP_SIZE, lightCount - first);
+            for (int j = 0; inRange && j < batchSize; j++)
+            {
+                // the same test as LightClusterBuilder
+                vec3 center = batch[j].xyz;
+                vec3 d = max(max(boxMin - center, center - boxMax), 0.0);
+                if (d.x * d.x + d.y * d.y + d.z * d.z <= batch[j].w * batch[j].w)
+                {
+                    if (pass == 1 && offset + count < capacity)
+                        lightIndices[offset + count] = uint(first + j);
+                    count++;
+                }
+            }
+            barrier();
+        }
+    }
+
+    // a cluster whose entries do not fit keeps the ones that do; LightClusters grows the list and
+    // dispatches again before that is ever shaded
+    if (inRange)
+        clusters[cluster] = uvec2(offset, offset >= capacity ? 0u : min(count, capacity - offset));
+}
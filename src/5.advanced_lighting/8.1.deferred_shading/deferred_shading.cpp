@@ -9,8 +9,15 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/input_recorder.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/gbuffer.h>
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -18,11 +25,26 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
-void renderCube();
+void renderCube(unsigned int instances = 1);
+std::vector<ClusterLight> createLights(unsigned int count);
+int runClusterBenchmark(unsigned int lightCount, unsigned int frames);
 
 // settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
+unsigned int SCR_WIDTH = 800;
+unsigned int SCR_HEIGHT = 600;
+
+// light culling, cycled with 'C': every light for every pixel, or clusters built on the CPU or in a compute shader
+enum LightCulling { CULL_NONE, CULL_CPU_CLUSTERS, CULL_GPU_CLUSTERS };
+const char* CULLING_NAMES[] = { "no culling", "CPU clusters", "GPU clusters" };
+int lightCulling = CULL_CPU_CLUSTERS;
+bool cullingKeyPressed = false;
+// number of lights, cycled with 'L'
+const unsigned int LIGHT_COUNTS[] = { 32, 1024, 10000 };
+int lightCountIndex = 0;
+bool lightCountKeyPressed = false;
+// G-buffer layout, toggled with 'G'
+int gBufferLayout = GBuffer::GBUFFER_WIDE;
+bool layoutKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -34,12 +56,27 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+// input recording/replay (LOGL_RECORD_INPUT / LOGL_REPLAY_INPUT)
+InputRecorder input;
+
+// usage:
+//   deferred_shading                                   render the scene
+//   deferred_shading --size width height               render at another resolution, e.g. to time the G-buffer layouts at 1920 1080 or 3840 2160
+//   deferred_shading --benchmark [lights] [frames]     time the CPU cluster builder without a window
+int main(int argc, char* argv[])
 {
+    if (argc >= 2 && std::strcmp(argv[1], "--benchmark") == 0)
+        return runClusterBenchmark(argc > 2 ? std::atoi(argv[2]) : 10000, argc > 3 ? std::atoi(argv[3]) : 100);
+    if (argc == 4 && std::strcmp(argv[1], "--size") == 0)
+    {
+        SCR_WIDTH = std::atoi(argv[2]);
+        SCR_HEIGHT = std::atoi(argv[3]);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -60,6 +97,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    input.Attach(window);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -102,64 +140,14 @@ int main()
 
     // configure g-buffer framebuffer
     // ------------------------------
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedoSpec;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // color + specular color buffer
-    glGenTextures(1, &gAlbedoSpec);
-    glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // lighting info
-    // -------------
-    const unsigned int NR_LIGHTS = 32;
-    std::vector<glm::vec3> lightPositions;
-    std::vector<glm::vec3> lightColors;
-    srand(13);
-    for (unsigned int i = 0; i < NR_LIGHTS; i++)
-    {
-        // calculate slightly random offsets
-        float xPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 3.0);
-        float yPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 4.0);
-        float zPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 3.0);
-        lightPositions.push_back(glm::vec3(xPos, yPos, zPos));
-        // also calculate random color
-        float rColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        float gColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        lightColors.push_back(glm::vec3(rColor, gColor, bColor));
-    }
+    GBuffer *gBuffer = new GBuffer(SCR_WIDTH, SCR_HEIGHT, (GBuffer::Layout)gBufferLayout);
+
+    // lighting info: the lights and the per cluster light lists live in shader storage buffers
+    // ----------------------------------------------------------------------------------------
+    std::vector<ClusterLight> lights = createLights(LIGHT_COUNTS[lightCountIndex]);
+    LightClusters *lightClusters = new LightClusters("8.1.light_clusters.cs");
+    lightClusters->SetLights(lights);
+    float clusterZoom = 0.0f; // the zoom the cluster bounds were last computed for
 
     // shader configuration
     // --------------------
@@ -167,6 +155,22 @@ int main()
     shaderLightingPass.setInt("gPosition", 0);
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedoSpec", 2);
+    shaderLightingPass.setInt("gDepth", 3);
+    // attenuation parameters, the same for every light
+    shaderLightingPass.setFloat("linear", 0.7f);
+    shaderLightingPass.setFloat("quadratic", 1.8f);
+    glUniform3i(glGetUniformLocation(shaderLightingPass.ID, "clusterGrid"), LightClusterBuilder::GridX, LightClusterBuilder::GridY, LightClusterBuilder::GridZ);
+    shaderLightingPass.setVec2("screenSize", glm::vec2(SCR_WIDTH, SCR_HEIGHT));
+    shaderLightBox.use();
+    shaderLightBox.setFloat("boxSize", 0.125f);
+
+    // timing of the cluster build (CPU or GPU), the lighting pass and the geometry pass
+    unsigned int timeQueries[3];
+    glGenQueries(3, timeQueries);
+    double cpuBuildTime = 0.0;
+    GLuint64 gpuBuildTime = 0, lightingTime = 0, geometryTime = 0;
+    unsigned int timedFrames = 0;
+    float timedSeconds = 0.0f;
 
     // render loop
     // -----------
@@ -175,12 +179,18 @@ int main()
         // per-frame time logic
         // --------------------
         auto currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
+        deltaTime = input.Update(currentFrame - lastFrame);
         lastFrame = currentFrame;
 
         // input
         // -----
         processInput(window);
+        if (lights.size() != LIGHT_COUNTS[lightCountIndex])
+        {
+            lights = createLights(LIGHT_COUNTS[lightCountIndex]);
+            lightClusters->SetLights(lights);
+        }
+        gBuffer->SetLayout((GBuffer::Layout)gBufferLayout);
 
         // render
         // ------
@@ -189,7 +199,8 @@ int main()
 
         // 1. geometry pass: render scene's geometry/color data into gbuffer
         // -----------------------------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[2]);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer->FBO());
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
             glm::mat4 view = camera.GetViewMatrix();
@@ -197,6 +208,7 @@ int main()
             shaderGeometryPass.use();
             shaderGeometryPass.setMat4("projection", projection);
             shaderGeometryPass.setMat4("view", view);
+            shaderGeometryPass.setBool("packedGBuffer", gBuffer->Packed());
             for (unsigned int i = 0; i < objectPositions.size(); i++)
             {
                 model = glm::mat4(1.0f);
@@ -206,35 +218,49 @@ int main()
                 backpack.Draw(shaderGeometryPass);
             }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        // 1.5. assign the lights to the clusters of the current view
+        // ----------------------------------------------------------
+        if (camera.Zoom != clusterZoom)
+        {
+            lightClusters->SetProjection(projection, 0.1f, 100.0f);
+            clusterZoom = camera.Zoom;
+        }
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[0]);
+        if (lightCulling == CULL_CPU_CLUSTERS)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            lightClusters->BuildOnCpu(lights, view);
+            cpuBuildTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+        else if (lightCulling == CULL_GPU_CLUSTERS)
+            lightClusters->BuildOnGpu(view);
+        glEndQuery(GL_TIME_ELAPSED);
 
         // 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
         // -----------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderLightingPass.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-        // send light relevant uniforms
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
-        {
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
-            // update attenuation parameters and calculate radius
-            const float linear = 0.7f;
-            const float quadratic = 1.8f;
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Linear", linear);
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic);
-        }
+        gBuffer->BindTextures();
+        shaderLightingPass.setBool("packedGBuffer", gBuffer->Packed());
+        shaderLightingPass.setMat4("inverseViewProjection", glm::inverse(projection * view));
+        // send light relevant uniforms; the lights themselves are read from the storage buffers
+        lightClusters->Bind();
+        shaderLightingPass.setInt("lightCount", static_cast<int>(lights.size()));
+        shaderLightingPass.setBool("clustered", lightCulling != CULL_NONE);
+        shaderLightingPass.setMat4("view", view);
+        shaderLightingPass.setFloat("sliceScale", lightClusters->Builder().SliceScale());
+        shaderLightingPass.setFloat("sliceBias", lightClusters->Builder().SliceBias());
         shaderLightingPass.setVec3("viewPos", camera.Position);
         // finally render quad
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[1]);
         renderQuad();
+        glEndQuery(GL_TIME_ELAPSED);
 
         // 2.5. copy content of geometry's depth buffer to default framebuffer's depth buffer
         // ----------------------------------------------------------------------------------
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer->FBO());
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
         // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
         // the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the 		
@@ -247,14 +273,29 @@ int main()
         shaderLightBox.use();
         shaderLightBox.setMat4("projection", projection);
         shaderLightBox.setMat4("view", view);
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
+        renderCube(static_cast<unsigned int>(lights.size()));
+
+        // the results are waited for, which is fine for comparing the culling modes and G-buffer layouts
+        GLuint64 elapsed;
+        glGetQueryObjectui64v(timeQueries[0], GL_QUERY_RESULT, &elapsed);
+        gpuBuildTime += elapsed;
+        glGetQueryObjectui64v(timeQueries[1], GL_QUERY_RESULT, &elapsed);
+        lightingTime += elapsed;
+        glGetQueryObjectui64v(timeQueries[2], GL_QUERY_RESULT, &elapsed);
+        geometryTime += elapsed;
+        timedFrames++;
+        timedSeconds += deltaTime;
+        if (timedSeconds >= 1.0f)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, lightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.125f));
-            shaderLightBox.setMat4("model", model);
-            shaderLightBox.setVec3("lightColor", lightColors[i]);
-            renderCube();
+            std::cout << lights.size() << " lights, " << CULLING_NAMES[lightCulling] << ", "
+                      << GBuffer::LayoutName(gBuffer->GetLayout()) << " (" << gBuffer->BytesPerPixel() << " bytes/pixel at "
+                      << SCR_WIDTH << "x" << SCR_HEIGHT << "): geometry " << geometryTime * 1.0e-6 / timedFrames << " ms, cluster build "
+                      << (lightCulling == CULL_CPU_CLUSTERS ? cpuBuildTime / timedFrames : gpuBuildTime * 1.0e-6 / timedFrames)
+                      << " ms, lighting " << lightingTime * 1.0e-6 / timedFrames << " ms" << std::endl;
+            cpuBuildTime = 0.0;
+            gpuBuildTime = lightingTime = geometryTime = 0;
+            timedFrames = 0;
+            timedSeconds = 0.0f;
         }
 
 
@@ -264,15 +305,20 @@ int main()
         glfwPollEvents();
     }
 
+    // de-allocate the GL resources while their context still exists:
+    // --------------------------------------------------------------
+    delete lightClusters;
+    delete gBuffer;
+
     glfwTerminate();
     return 0;
 }
 
-// renderCube() renders a 1x1 3D cube in NDC.
+// renderCube() renders a 1x1 3D cube in NDC, 'instances' times.
 // -------------------------------------------------
 unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
-void renderCube()
+void renderCube(unsigned int instances)
 {
     // initialize (if necessary)
     if (cubeVAO == 0)
@@ -339,7 +385,7 @@ void renderCube()
     }
     // render Cube
     glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instances);
     glBindVertexArray(0);
 }
 
@@ -379,17 +425,47 @@ void renderQuad()
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_S) == GLFW_PRESS)
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_A) == GLFW_PRESS)
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (input.GetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cullingKeyPressed)
+    {
+        lightCulling = (lightCulling + 1) % 3;
+        cullingKeyPressed = true;
+    }
+    if (input.GetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
+    {
+        cullingKeyPressed = false;
+    }
+
+    if (input.GetKey(window, GLFW_KEY_L) == GLFW_PRESS && !lightCountKeyPressed)
+    {
+        lightCountIndex = (lightCountIndex + 1) % 3;
+        lightCountKeyPressed = true;
+    }
+    if (input.GetKey(window, GLFW_KEY_L) == GLFW_RELEASE)
+    {
+        lightCountKeyPressed = false;
+    }
+
+    if (input.GetKey(window, GLFW_KEY_G) == GLFW_PRESS && !layoutKeyPressed)
+    {
+        gBufferLayout = gBufferLayout == GBuffer::GBUFFER_WIDE ? GBuffer::GBUFFER_PACKED : GBuffer::GBUFFER_WIDE;
+        layoutKeyPressed = true;
+    }
+    if (input.GetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+    {
+        layoutKeyPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -432,3 +508,75 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
+
+// creates 'count' randomly placed and colored lights; the area they are spread over grows with
+// the count so the density stays that of the first 32, which light the backpacks
+// ------------------------------------------------------------------------------------------------
+std::vector<ClusterLight> createLights(unsigned int count)
+{
+    std::vector<ClusterLight> lights;
+    float extent = 3.0f * std::sqrt(count / 32.0f);
+    srand(13);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        // calculate slightly random offsets
+        float xPos = static_cast<float>(((rand() % 100) / 100.0) * 2.0 * extent - extent);
+        float yPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 4.0);
+        float zPos = static_cast<float>(((rand() % 100) / 100.0) * 2.0 * extent - extent);
+        // also calculate random color
+        float rColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        float gColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        // the distance at which the attenuated light drops below 5/256 of its brightest channel
+        const float constant = 1.0f;
+        const float linear = 0.7f;
+        const float quadratic = 1.8f;
+        const float maxBrightness = std::fmax(std::fmax(rColor, gColor), bColor);
+        float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
+        lights.push_back({ glm::vec4(xPos, yPos, zPos, radius), glm::vec4(rColor, gColor, bColor, 0.0f) });
+    }
+    return lights;
+}
+
+// assigns the lights to clusters on the CPU for 'frames' views circling the scene, with the SSE
+// builder and with the brute force reference, and checks both agree in every frame
+// ------------------------------------------------------------------------------------------------
+int runClusterBenchmark(unsigned int lightCount, unsigned int frames)
+{
+    std::vector<ClusterLight> lights = createLights(lightCount);
+    LightClusterBuilder builder, reference;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    builder.SetProjection(projection, 0.1f, 100.0f);
+    reference.SetProjection(projection, 0.1f, 100.0f);
+
+    double buildTime = 0.0, referenceTime = 0.0;
+    size_t assignments = 0;
+    unsigned int mismatches = 0;
+    for (unsigned int frame = 0; frame < frames; frame++)
+    {
+        float angle = glm::two_pi<float>() * frame / frames;
+        glm::vec3 position(std::sin(angle) * 8.0f, 1.0f, std::cos(angle) * 8.0f);
+        glm::mat4 view = glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        builder.Build(lights, view);
+        buildTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        assignments += builder.Indices().size();
+
+        start = std::chrono::high_resolution_clock::now();
+        reference.BuildReference(lights, view);
+        referenceTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (reference.Clusters() != builder.Clusters() || reference.Indices() != builder.Indices())
+            mismatches++;
+    }
+
+    std::cout << lightCount << " lights, " << LightClusterBuilder::ClusterCount << " clusters, "
+              << (double)assignments / frames << " light/cluster pairs per frame" << std::endl;
+    std::cout << "cluster build: " << buildTime / frames << " ms, reference: " << referenceTime / frames << " ms" << std::endl;
+    if (mismatches != 0)
+    {
+        std::cout << "ERROR::LIGHT_CLUSTERS: " << mismatches << " of " << frames << " frames differ from the reference" << std::endl;
+        return -1;
+    }
+    return 0;
+}
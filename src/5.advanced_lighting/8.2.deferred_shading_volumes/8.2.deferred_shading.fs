@@ -6,6 +6,27 @@ in vec2 TexCoords;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth;
+
+uniform bool packedGBuffer; // position from depth, normals in two components (see GBuffer)
+uniform mat4 inverseViewProjection;
+
+// inverse of octahedralEncode() in the geometry pass
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0); // unfold the lower half
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// world space position of a pixel from its texture coordinates and depth
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
 
 struct Light {
     vec3 Position;
@@ -17,20 +38,30 @@ struct Light {
 };
 const int NR_LIGHTS = 32;
 uniform Light lights[NR_LIGHTS];
+uniform int lightCount; // 0: only the ambient term, the light volumes add the lights
 uniform vec3 viewPos;
 
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos, Normal;
+    if (packedGBuffer)
+    {
+        FragPos = reconstructPosition(TexCoords, texture(gDepth, TexCoords).r);
+        Normal = octahedralDecode(texture(gNormal, TexCoords).rg);
+    }
+    else
+    {
+        FragPos = texture(gPosition, TexCoords).rgb;
+        Normal = texture(gNormal, TexCoords).rgb;
+    }
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     
     // then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
     vec3 viewDir  = normalize(viewPos - FragPos);
-    for(int i = 0; i < NR_LIGHTS; ++i)
+    for(int i = 0; i < lightCount; ++i)
     {
         // calculate distance between light source and current fragment
         float distance = length(lights[i].Position - FragPos);
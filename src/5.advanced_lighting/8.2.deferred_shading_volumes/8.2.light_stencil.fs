@@ -0,0 +1,6 @@
+#version 330 core
+
+// the stencil pass only counts faces, no color is written
+void main()
+{
+}
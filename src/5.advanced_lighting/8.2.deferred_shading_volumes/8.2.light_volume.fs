@@ -0,0 +1,75 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in vec4 LightPositionRadius;
+flat in vec3 LightColor;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth;
+
+uniform bool packedGBuffer; // position from depth, normals in two components (see GBuffer)
+uniform mat4 inverseViewProjection;
+
+// inverse of octahedralEncode() in the geometry pass
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0); // unfold the lower half
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// world space position of a pixel from its texture coordinates and depth
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+uniform float linear;
+uniform float quadratic;
+uniform vec3 viewPos;
+
+// shades one light for the pixel under the light volume; the results of all volumes are added up
+void main()
+{
+    // retrieve data from gbuffer, at this very pixel
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 FragPos, Normal;
+    if (packedGBuffer)
+    {
+        FragPos = reconstructPosition(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)), texelFetch(gDepth, texel, 0).r);
+        Normal = octahedralDecode(texelFetch(gNormal, texel, 0).rg);
+    }
+    else
+    {
+        FragPos = texelFetch(gPosition, texel, 0).rgb;
+        Normal = texelFetch(gNormal, texel, 0).rgb;
+    }
+    vec3 Diffuse = texelFetch(gAlbedoSpec, texel, 0).rgb;
+    float Specular = texelFetch(gAlbedoSpec, texel, 0).a;
+
+    // the volume's screen area also covers pixels in front of the sphere; they add nothing. Not a discard:
+    // the stencil-masked draw writes the stencil, and a discard would hold those writes, and with them the
+    // stencil test, back until after the shader
+    float distance = length(LightPositionRadius.xyz - FragPos);
+    if (distance >= LightPositionRadius.w)
+    {
+        FragColor = vec4(0.0);
+        return;
+    }
+    // diffuse
+    vec3 viewDir  = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(LightPositionRadius.xyz - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * LightColor;
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+    vec3 specular = LightColor * spec * Specular;
+    // attenuation
+    float attenuation = 1.0 / (1.0 + linear * distance + quadratic * distance * distance);
+    FragColor = vec4((diffuse + specular) * attenuation, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// per instance: one light
+layout (location = 1) in vec4 aLightPositionRadius;
+layout (location = 2) in vec3 aLightColor;
+
+flat out vec4 LightPositionRadius;
+flat out vec3 LightColor;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+    LightPositionRadius = aLightPositionRadius;
+    LightColor = aLightColor;
+    // the sphere mesh encloses the unit sphere, scaled it encloses the light's radius
+    gl_Position = projection * view * vec4(aLightPositionRadius.xyz + aPos * aLightPositionRadius.w, 1.0);
+}
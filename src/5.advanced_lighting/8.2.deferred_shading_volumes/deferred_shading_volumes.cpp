@@ -9,8 +9,17 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/gbuffer.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+// glad is generated without ARB_pipeline_statistics_query; the enum is the same as the GL 4.6 core one
+#ifndef GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -19,10 +28,22 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
 void renderCube();
+void renderLightVolumes(unsigned int lightVBO, unsigned int first, unsigned int count);
+bool pipelineStatisticsSupported();
 
 // settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
+unsigned int SCR_WIDTH = 800;
+unsigned int SCR_HEIGHT = 600;
+
+// how the lights are shaded, cycled with 'V': a full-screen loop over all lights, one instanced draw of light
+// volumes, or per light a stencil mask of the pixels inside its volume followed by a draw shading only those
+enum LightShading { FULL_SCREEN, LIGHT_VOLUMES, STENCIL_LIGHT_VOLUMES };
+const char* SHADING_NAMES[] = { "full-screen pass", "light volumes", "stencil-masked light volumes" };
+int lightShading = LIGHT_VOLUMES;
+bool shadingKeyPressed = false;
+// G-buffer layout, toggled with 'G'
+int gBufferLayout = GBuffer::GBUFFER_WIDE;
+bool layoutKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -34,8 +55,17 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+// usage:
+//   deferred_shading_volumes                           render the scene
+//   deferred_shading_volumes --size width height       render at another resolution, e.g. to time the G-buffer layouts at 1920 1080 or 3840 2160
+int main(int argc, char* argv[])
 {
+    if (argc == 4 && std::strcmp(argv[1], "--size") == 0)
+    {
+        SCR_WIDTH = std::atoi(argv[2]);
+        SCR_HEIGHT = std::atoi(argv[3]);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -84,6 +114,8 @@ int main()
     Shader shaderGeometryPass("8.2.g_buffer.vs", "8.2.g_buffer.fs");
     Shader shaderLightingPass("8.2.deferred_shading.vs", "8.2.deferred_shading.fs");
     Shader shaderLightBox("8.2.deferred_light_box.vs", "8.2.deferred_light_box.fs");
+    Shader shaderLightVolume("8.2.light_volume.vs", "8.2.light_volume.fs");
+    Shader shaderLightStencil("8.2.light_volume.vs", "8.2.light_stencil.fs");
 
     // load models
     // -----------
@@ -100,46 +132,9 @@ int main()
     objectPositions.push_back(glm::vec3( 3.0, -0.5,  3.0));
 
 
-    // configure g-buffer framebuffer
-    // ------------------------------
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedoSpec;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // color + specular color buffer
-    glGenTextures(1, &gAlbedoSpec);
-    glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // configure g-buffer framebuffer; its depth has a stencil part, so the format matches the default framebuffer's for the depth blit
+    // -------------------------------------------------------------------------------------------------------------------------------
+    GBuffer *gBuffer = new GBuffer(SCR_WIDTH, SCR_HEIGHT, (GBuffer::Layout)gBufferLayout);
 
     // lighting info
     // -------------
@@ -160,6 +155,28 @@ int main()
         float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.)
         lightColors.push_back(glm::vec3(rColor, gColor, bColor));
     }
+    // update attenuation parameters and calculate the radius of each light volume/sphere
+    const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
+    const float linear = 0.7f;
+    const float quadratic = 1.8f;
+    std::vector<float> lightRadii;
+    for (unsigned int i = 0; i < NR_LIGHTS; i++)
+    {
+        const float maxBrightness = std::fmaxf(std::fmaxf(lightColors[i].r, lightColors[i].g), lightColors[i].b);
+        lightRadii.push_back((-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic));
+    }
+    // per instance data of the light volumes: position and radius, color
+    std::vector<float> lightInstances;
+    for (unsigned int i = 0; i < NR_LIGHTS; i++)
+    {
+        float instance[] = { lightPositions[i].x, lightPositions[i].y, lightPositions[i].z, lightRadii[i], lightColors[i].r, lightColors[i].g, lightColors[i].b, 0.0f };
+        lightInstances.insert(lightInstances.end(), instance, instance + 8);
+    }
+    unsigned int lightVBO;
+    glGenBuffers(1, &lightVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+    glBufferData(GL_ARRAY_BUFFER, lightInstances.size() * sizeof(float), lightInstances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // shader configuration
     // --------------------
@@ -167,6 +184,34 @@ int main()
     shaderLightingPass.setInt("gPosition", 0);
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedoSpec", 2);
+    shaderLightingPass.setInt("gDepth", 3);
+    // send light relevant uniforms
+    for (unsigned int i = 0; i < lightPositions.size(); i++)
+    {
+        shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
+        shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
+        shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Linear", linear);
+        shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic);
+        shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Radius", lightRadii[i]);
+    }
+    shaderLightVolume.use();
+    shaderLightVolume.setInt("gPosition", 0);
+    shaderLightVolume.setInt("gNormal", 1);
+    shaderLightVolume.setInt("gAlbedoSpec", 2);
+    shaderLightVolume.setInt("gDepth", 3);
+    shaderLightVolume.setFloat("linear", linear);
+    shaderLightVolume.setFloat("quadratic", quadratic);
+
+    // GPU time and fragment shader invocations of the lighting pass, and GPU time of the geometry pass
+    unsigned int lightingQueries[2], geometryQuery;
+    glGenQueries(2, lightingQueries);
+    glGenQueries(1, &geometryQuery);
+    const bool countInvocations = pipelineStatisticsSupported();
+    if (!countInvocations)
+        std::cout << "GL_ARB_pipeline_statistics_query is not supported, fragment shader invocations are not counted" << std::endl;
+    GLuint64 lightingTime = 0, lightingInvocations = 0, geometryTime = 0;
+    unsigned int timedFrames = 0;
+    float timedSeconds = 0.0f;
 
     // render loop
     // -----------
@@ -181,15 +226,17 @@ int main()
         // input
         // -----
         processInput(window);
+        gBuffer->SetLayout((GBuffer::Layout)gBufferLayout);
 
         // render
         // ------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
         // 1. geometry pass: render scene's geometry/color data into gbuffer
         // -----------------------------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glBeginQuery(GL_TIME_ELAPSED, geometryQuery);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer->FBO());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
@@ -197,6 +244,7 @@ int main()
         shaderGeometryPass.use();
         shaderGeometryPass.setMat4("projection", projection);
         shaderGeometryPass.setMat4("view", view);
+        shaderGeometryPass.setBool("packedGBuffer", gBuffer->Packed());
         for (unsigned int i = 0; i < objectPositions.size(); i++)
         {
             model = glm::mat4(1.0f);
@@ -206,40 +254,11 @@ int main()
             backpack.Draw(shaderGeometryPass);
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEndQuery(GL_TIME_ELAPSED);
 
-        // 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
-        // -----------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shaderLightingPass.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-        // send light relevant uniforms
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
-        {
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
-            // update attenuation parameters and calculate radius
-            const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
-            const float linear = 0.7f;
-            const float quadratic = 1.8f;
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Linear", linear);
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic);
-            // then calculate radius of light volume/sphere
-            const float maxBrightness = std::fmaxf(std::fmaxf(lightColors[i].r, lightColors[i].g), lightColors[i].b);
-            float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Radius", radius);
-        }
-        shaderLightingPass.setVec3("viewPos", camera.Position);
-        // finally render quad
-        renderQuad();
-
-        // 2.5. copy content of geometry's depth buffer to default framebuffer's depth buffer
-        // ----------------------------------------------------------------------------------
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+        // 2. copy content of geometry's depth buffer to default framebuffer's depth buffer; the light volumes are depth tested against it
+        // -----------------------------------------------------------------------------------------------------------------------------
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer->FBO());
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
         // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
         // the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the 		
@@ -247,6 +266,91 @@ int main()
         glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        // 2.5. lighting pass: a screen filled quad iterating over all lights, or only the ambient term followed by the light volumes
+        // ---------------------------------------------------------------------------------------------------------------------------
+        glBeginQuery(GL_TIME_ELAPSED, lightingQueries[0]);
+        if (countInvocations)
+            glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, lightingQueries[1]);
+        glDisable(GL_DEPTH_TEST);
+        shaderLightingPass.use();
+        gBuffer->BindTextures();
+        const glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        shaderLightingPass.setBool("packedGBuffer", gBuffer->Packed());
+        shaderLightingPass.setMat4("inverseViewProjection", inverseViewProjection);
+        shaderLightingPass.setInt("lightCount", lightShading == FULL_SCREEN ? NR_LIGHTS : 0);
+        shaderLightingPass.setVec3("viewPos", camera.Position);
+        renderQuad();
+        glEnable(GL_DEPTH_TEST);
+
+        if (lightShading != FULL_SCREEN)
+        {
+            // the volumes never write depth, and are clamped instead of clipped at the near and far plane
+            glDepthMask(GL_FALSE);
+            glEnable(GL_DEPTH_CLAMP);
+            // the volumes are shaded from their back faces only, which are visible whether the camera is outside
+            // or inside the volume, and only where the scene lies in front of them; the results of all lights are
+            // added up
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            shaderLightVolume.use();
+            shaderLightVolume.setMat4("projection", projection);
+            shaderLightVolume.setMat4("view", view);
+            shaderLightVolume.setVec3("viewPos", camera.Position);
+            shaderLightVolume.setBool("packedGBuffer", gBuffer->Packed());
+            shaderLightVolume.setMat4("inverseViewProjection", inverseViewProjection);
+            if (lightShading == LIGHT_VOLUMES)
+            {
+                // one draw for all lights; pixels in front of a volume pass the depth test and are only
+                // rejected in the shader
+                glEnable(GL_CULL_FACE);
+                glCullFace(GL_FRONT);
+                glDepthFunc(GL_GEQUAL);
+                renderLightVolumes(lightVBO, 0, NR_LIGHTS);
+            }
+            else
+            {
+                shaderLightStencil.use();
+                shaderLightStencil.setMat4("projection", projection);
+                shaderLightStencil.setMat4("view", view);
+                glEnable(GL_STENCIL_TEST);
+                for (unsigned int i = 0; i < NR_LIGHTS; i++)
+                {
+                    // z-fail counting over both faces of this light's volume: a back face behind the scene
+                    // increments, a front face behind the scene decrements, so only pixels whose position lies
+                    // inside the volume end up non-zero. A front face the near plane cuts away (camera inside the
+                    // volume) correctly never decrements.
+                    glDisable(GL_CULL_FACE);
+                    glDepthFunc(GL_LESS);
+                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+                    glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+                    glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+                    shaderLightStencil.use();
+                    renderLightVolumes(lightVBO, i, 1);
+                    // shade the marked pixels and clear their mark for the next light; the back faces cover
+                    // every marked pixel, so the stencil is all zero again afterwards
+                    glEnable(GL_CULL_FACE);
+                    glCullFace(GL_FRONT);
+                    glDepthFunc(GL_GEQUAL);
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                    glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+                    glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+                    shaderLightVolume.use();
+                    renderLightVolumes(lightVBO, i, 1);
+                }
+            }
+            glDisable(GL_BLEND);
+            glDepthFunc(GL_LESS);
+            glCullFace(GL_BACK);
+            glDisable(GL_CULL_FACE);
+            glDisable(GL_STENCIL_TEST);
+            glDisable(GL_DEPTH_CLAMP);
+            glDepthMask(GL_TRUE);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        if (countInvocations)
+            glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+
         // 3. render lights on top of scene
         // --------------------------------
         shaderLightBox.use();
@@ -262,6 +366,31 @@ int main()
             renderCube();
         }
 
+        // the results are waited for, which is fine for comparing the shading modes and G-buffer layouts
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(geometryQuery, GL_QUERY_RESULT, &elapsed);
+        geometryTime += elapsed;
+        glGetQueryObjectui64v(lightingQueries[0], GL_QUERY_RESULT, &elapsed);
+        lightingTime += elapsed;
+        if (countInvocations)
+        {
+            glGetQueryObjectui64v(lightingQueries[1], GL_QUERY_RESULT, &elapsed);
+            lightingInvocations += elapsed;
+        }
+        timedFrames++;
+        timedSeconds += deltaTime;
+        if (timedSeconds >= 1.0f)
+        {
+            std::cout << SHADING_NAMES[lightShading] << ", " << GBuffer::LayoutName(gBuffer->GetLayout()) << " (" << gBuffer->BytesPerPixel()
+                      << " bytes/pixel at " << SCR_WIDTH << "x" << SCR_HEIGHT << "): geometry " << geometryTime * 1.0e-6 / timedFrames
+                      << " ms, lighting " << lightingTime * 1.0e-6 / timedFrames << " ms";
+            if (countInvocations)
+                std::cout << ", " << lightingInvocations / timedFrames << " fragment shader invocations";
+            std::cout << std::endl;
+            lightingTime = lightingInvocations = geometryTime = 0;
+            timedFrames = 0;
+            timedSeconds = 0.0f;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -269,6 +398,10 @@ int main()
         glfwPollEvents();
     }
 
+    // de-allocate the GL resources while their context still exists:
+    // --------------------------------------------------------------
+    delete gBuffer;
+
     glfwTerminate();
     return 0;
 }
@@ -349,6 +482,106 @@ void renderCube()
 }
 
 
+// renderLightVolumes() renders 'count' low-poly spheres, one per light in lightVBO (position and radius, color)
+// starting at light 'first'.
+// The mesh is scaled so that its faces enclose the unit sphere, so the volume never cuts off any lit pixel.
+// ----------------------------------------------------------------------------------------------------------
+unsigned int lightVolumeVAO = 0;
+unsigned int lightVolumeIndexCount = 0;
+void renderLightVolumes(unsigned int lightVBO, unsigned int first, unsigned int count)
+{
+    if (lightVolumeVAO == 0)
+    {
+        const unsigned int SEGMENTS = 12;
+        const unsigned int RINGS = 8;
+        const float PI = 3.14159265359f;
+        std::vector<glm::vec3> positions;
+        for (unsigned int ring = 0; ring <= RINGS; ++ring)
+        {
+            for (unsigned int segment = 0; segment <= SEGMENTS; ++segment)
+            {
+                float theta = (float)ring / RINGS * PI;
+                float phi = (float)segment / SEGMENTS * 2.0f * PI;
+                positions.push_back(glm::vec3(std::cos(phi) * std::sin(theta), std::cos(theta), std::sin(phi) * std::sin(theta)));
+            }
+        }
+        // counter-clockwise seen from outside; the triangles that collapse at the poles are left out
+        std::vector<unsigned int> indices;
+        for (unsigned int ring = 0; ring < RINGS; ++ring)
+        {
+            for (unsigned int segment = 0; segment < SEGMENTS; ++segment)
+            {
+                unsigned int current = ring * (SEGMENTS + 1) + segment;
+                unsigned int below = current + SEGMENTS + 1;
+                if (ring != 0)
+                {
+                    indices.push_back(current);
+                    indices.push_back(current + 1);
+                    indices.push_back(below);
+                }
+                if (ring != RINGS - 1)
+                {
+                    indices.push_back(current + 1);
+                    indices.push_back(below + 1);
+                    indices.push_back(below);
+                }
+            }
+        }
+        // push the faces out to the unit sphere: scale by the inverse of the nearest face's distance
+        float nearest = 1.0f;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            glm::vec3 normal = glm::normalize(glm::cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]));
+            nearest = std::min(nearest, glm::dot(normal, positions[indices[i]]));
+        }
+        for (glm::vec3& position : positions)
+            position /= nearest;
+        lightVolumeIndexCount = static_cast<unsigned int>(indices.size());
+
+        unsigned int vbo, ebo;
+        glGenVertexArrays(1, &lightVolumeVAO);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(lightVolumeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        // per instance attributes, pointed at the first light to draw below
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(2, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glBindVertexArray(lightVolumeVAO);
+    // GL 3.3 has no base instance, the instance attributes start at the first light instead
+    size_t offset = first * 8 * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)offset);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(offset + 4 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawElementsInstanced(GL_TRIANGLES, lightVolumeIndexCount, GL_UNSIGNED_INT, 0, count);
+    glBindVertexArray(0);
+}
+
+// whether fragment shader invocations can be counted with a query
+// ----------------------------------------------------------------
+bool pipelineStatisticsSupported()
+{
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_pipeline_statistics_query") == 0)
+            return true;
+    }
+    return false;
+}
+
 // renderQuad() renders a 1x1 XY quad in NDC
 // -----------------------------------------
 unsigned int quadVAO = 0;
@@ -395,6 +628,26 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && !shadingKeyPressed)
+    {
+        lightShading = (lightShading + 1) % 3;
+        shadingKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE)
+    {
+        shadingKeyPressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !layoutKeyPressed)
+    {
+        gBufferLayout = gBufferLayout == GBuffer::GBUFFER_WIDE ? GBuffer::GBUFFER_PACKED : GBuffer::GBUFFER_WIDE;
+        layoutKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+    {
+        layoutKeyPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
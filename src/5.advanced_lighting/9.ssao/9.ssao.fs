@@ -6,6 +6,9 @@ in vec2 TexCoords;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
+uniform sampler2D gDepth;
+
+uniform bool packedGBuffer; // position from depth, normals in two components (see GBuffer)
 
 uniform vec3 samples[64];
 
@@ -14,16 +17,48 @@ int kernelSize = 64;
 float radius = 0.5;
 float bias = 0.025;
 
-// tile noise texture over screen based on screen dimensions divided by noise size
-const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0); 
-
 uniform mat4 projection;
 
+// inverse of octahedralEncode() in the geometry pass
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0); // unfold the lower half
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// view space z of a pixel from its depth, by inverting the perspective projection's depth mapping
+float viewDepth(vec2 uv)
+{
+    return -projection[3][2] / (texture(gDepth, uv).r * 2.0 - 1.0 + projection[2][2]);
+}
+
+// view space position of a pixel: x and y in NDC scale with -z
+vec3 viewPosition(vec2 uv)
+{
+    float z = viewDepth(uv);
+    return vec3((uv * 2.0 - 1.0) / vec2(projection[0][0], projection[1][1]) * -z, z);
+}
+
 void main()
 {
+    // tile noise texture over screen based on screen dimensions divided by noise size
+    vec2 noiseScale = vec2(textureSize(gNormal, 0)) / 4.0;
+
     // get input for SSAO algorithm
-    vec3 fragPos = texture(gPosition, TexCoords).xyz;
-    vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+    vec3 fragPos, normal;
+    if (packedGBuffer)
+    {
+        fragPos = viewPosition(TexCoords);
+        normal = octahedralDecode(texture(gNormal, TexCoords).rg);
+    }
+    else
+    {
+        fragPos = texture(gPosition, TexCoords).xyz;
+        normal = normalize(texture(gNormal, TexCoords).rgb);
+    }
     vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
     // create TBN change-of-basis matrix: from tangent-space to view-space
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -44,7 +79,7 @@ void main()
         offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
         
         // get sample depth
-        float sampleDepth = texture(gPosition, offset.xy).z; // get depth value of kernel sample
+        float sampleDepth = packedGBuffer ? viewDepth(offset.xy) : texture(gPosition, offset.xy).z; // get depth value of kernel sample
         
         // range check & accumulate
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
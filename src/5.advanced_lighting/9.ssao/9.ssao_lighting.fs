@@ -7,6 +7,33 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
 uniform sampler2D ssao;
+uniform sampler2D gDepth;
+
+uniform bool packedGBuffer; // position from depth, normals in two components (see GBuffer)
+uniform mat4 projection;
+
+// inverse of octahedralEncode() in the geometry pass
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0); // unfold the lower half
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// view space z of a pixel from its depth, by inverting the perspective projection's depth mapping
+float viewDepth(vec2 uv)
+{
+    return -projection[3][2] / (texture(gDepth, uv).r * 2.0 - 1.0 + projection[2][2]);
+}
+
+// view space position of a pixel: x and y in NDC scale with -z
+vec3 viewPosition(vec2 uv)
+{
+    float z = viewDepth(uv);
+    return vec3((uv * 2.0 - 1.0) / vec2(projection[0][0], projection[1][1]) * -z, z);
+}
 
 struct Light {
     vec3 Position;
@@ -20,8 +47,17 @@ uniform Light light;
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos, Normal;
+    if (packedGBuffer)
+    {
+        FragPos = viewPosition(TexCoords);
+        Normal = octahedralDecode(texture(gNormal, TexCoords).rg);
+    }
+    else
+    {
+        FragPos = texture(gPosition, TexCoords).rgb;
+        Normal = texture(gNormal, TexCoords).rgb;
+    }
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
     float AmbientOcclusion = texture(ssao, TexCoords).r;
     
@@ -9,7 +9,10 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/gbuffer.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <random>
 
@@ -22,8 +25,12 @@ void renderQuad();
 void renderCube();
 
 // settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
+unsigned int SCR_WIDTH = 800;
+unsigned int SCR_HEIGHT = 600;
+
+// G-buffer layout, toggled with 'G'
+int gBufferLayout = GBuffer::GBUFFER_WIDE;
+bool layoutKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -40,8 +47,17 @@ float ourLerp(float a, float b, float f)
     return a + f * (b - a);
 }
 
-int main()
+// usage:
+//   ssao                           render the scene
+//   ssao --size width height       render at another resolution, e.g. to time the G-buffer layouts at 1920 1080 or 3840 2160
+int main(int argc, char* argv[])
 {
+    if (argc == 4 && std::strcmp(argv[1], "--size") == 0)
+    {
+        SCR_WIDTH = std::atoi(argv[2]);
+        SCR_HEIGHT = std::atoi(argv[3]);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -95,46 +111,7 @@ int main()
 
     // configure g-buffer framebuffer
     // ------------------------------
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedo;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // color + specular color buffer
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GBuffer *gBuffer = new GBuffer(SCR_WIDTH, SCR_HEIGHT, (GBuffer::Layout)gBufferLayout);
 
     // also create framebuffer to hold SSAO processing stage 
     // -----------------------------------------------------
@@ -208,14 +185,23 @@ int main()
     shaderLightingPass.setInt("gPosition", 0);
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedo", 2);
-    shaderLightingPass.setInt("ssao", 3);
+    shaderLightingPass.setInt("gDepth", 3);
+    shaderLightingPass.setInt("ssao", 4);
     shaderSSAO.use();
     shaderSSAO.setInt("gPosition", 0);
     shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("texNoise", 2);
+    shaderSSAO.setInt("gDepth", 3);
+    shaderSSAO.setInt("texNoise", 4);
     shaderSSAOBlur.use();
     shaderSSAOBlur.setInt("ssaoInput", 0);
 
+    // GPU time of the geometry pass, the SSAO pass with its blur, and the lighting pass
+    unsigned int timeQueries[3];
+    glGenQueries(3, timeQueries);
+    GLuint64 passTimes[3] = { 0, 0, 0 };
+    unsigned int timedFrames = 0;
+    float timedSeconds = 0.0f;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -229,6 +215,7 @@ int main()
         // input
         // -----
         processInput(window);
+        gBuffer->SetLayout((GBuffer::Layout)gBufferLayout);
 
         // render
         // ------
@@ -237,7 +224,8 @@ int main()
 
         // 1. geometry pass: render scene's geometry/color data into gbuffer
         // -----------------------------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[0]);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer->FBO());
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 50.0f);
             glm::mat4 view = camera.GetViewMatrix();
@@ -245,6 +233,7 @@ int main()
             shaderGeometryPass.use();
             shaderGeometryPass.setMat4("projection", projection);
             shaderGeometryPass.setMat4("view", view);
+            shaderGeometryPass.setBool("packedGBuffer", gBuffer->Packed());
             // room cube
             model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
@@ -261,10 +250,12 @@ int main()
             shaderGeometryPass.setMat4("model", model);
             backpack.Draw(shaderGeometryPass);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEndQuery(GL_TIME_ELAPSED);
 
 
         // 2. generate SSAO texture
         // ------------------------
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[1]);
         glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
             glClear(GL_COLOR_BUFFER_BIT);
             shaderSSAO.use();
@@ -272,11 +263,9 @@ int main()
             for (unsigned int i = 0; i < 64; ++i)
                 shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
             shaderSSAO.setMat4("projection", projection);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
-            glActiveTexture(GL_TEXTURE2);
+            shaderSSAO.setBool("packedGBuffer", gBuffer->Packed());
+            gBuffer->BindTextures();
+            glActiveTexture(GL_TEXTURE4);
             glBindTexture(GL_TEXTURE_2D, noiseTexture);
             renderQuad();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -291,10 +280,12 @@ int main()
             glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
             renderQuad();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEndQuery(GL_TIME_ELAPSED);
 
 
         // 4. lighting pass: traditional deferred Blinn-Phong lighting with added screen-space ambient occlusion
         // -----------------------------------------------------------------------------------------------------
+        glBeginQuery(GL_TIME_ELAPSED, timeQueries[2]);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderLightingPass.use();
         // send light relevant uniforms
@@ -306,15 +297,32 @@ int main()
         const float quadratic = 0.032f;
         shaderLightingPass.setFloat("light.Linear", linear);
         shaderLightingPass.setFloat("light.Quadratic", quadratic);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedo);
-        glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
+        shaderLightingPass.setBool("packedGBuffer", gBuffer->Packed());
+        shaderLightingPass.setMat4("projection", projection);
+        gBuffer->BindTextures();
+        glActiveTexture(GL_TEXTURE4); // add extra SSAO texture to lighting pass
         glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
         renderQuad();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        // the results are waited for, which is fine for comparing the G-buffer layouts
+        for (int i = 0; i < 3; i++)
+        {
+            GLuint64 elapsed;
+            glGetQueryObjectui64v(timeQueries[i], GL_QUERY_RESULT, &elapsed);
+            passTimes[i] += elapsed;
+        }
+        timedFrames++;
+        timedSeconds += deltaTime;
+        if (timedSeconds >= 1.0f)
+        {
+            std::cout << GBuffer::LayoutName(gBuffer->GetLayout()) << " (" << gBuffer->BytesPerPixel() << " bytes/pixel at "
+                      << SCR_WIDTH << "x" << SCR_HEIGHT << "): geometry " << passTimes[0] * 1.0e-6 / timedFrames
+                      << " ms, SSAO " << passTimes[1] * 1.0e-6 / timedFrames << " ms, lighting " << passTimes[2] * 1.0e-6 / timedFrames << " ms" << std::endl;
+            passTimes[0] = passTimes[1] = passTimes[2] = 0;
+            timedFrames = 0;
+            timedSeconds = 0.0f;
+        }
 
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -323,6 +331,10 @@ int main()
         glfwPollEvents();
     }
 
+    // de-allocate the GL resources while their context still exists:
+    // --------------------------------------------------------------
+    delete gBuffer;
+
     glfwTerminate();
     return 0;
 }
@@ -449,6 +461,16 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !layoutKeyPressed)
+    {
+        gBufferLayout = gBufferLayout == GBuffer::GBUFFER_WIDE ? GBuffer::GBUFFER_PACKED : GBuffer::GBUFFER_WIDE;
+        layoutKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+    {
+        layoutKeyPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -1,6 +1,7 @@
+#include <algorithm>
 #include <iostream>
-#include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -25,13 +26,16 @@ const unsigned int SCR_HEIGHT = 600;
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
+    glm::vec2    TexOffset; // Top-left corner of the glyph in the atlas (texture coordinates)
     glm::ivec2   Size;      // Size of glyph
     glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
     unsigned int Advance;   // Horizontal offset to advance to next glyph
 };
 
-std::map<GLchar, Character> Characters;
+// all glyphs live in one texture (the atlas) so a whole string is drawn with a single draw call
+Character Characters[128];
+unsigned int AtlasTexture;
+glm::vec2 AtlasSize;
 unsigned int VAO, VBO;
 
 int main()
@@ -108,10 +112,10 @@ int main()
         // set size to load glyphs as
         FT_Set_Pixel_Sizes(face, 0, 48);
 
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        // load first 128 characters of ASCII set
+        // load the metrics of the first 128 characters of ASCII set and pack their bitmaps on
+        // shelves: rows of glyphs, tallest first, each row as high as its first glyph
+        const unsigned int atlasWidth = 1024;
+        std::vector<unsigned char> bitmaps[128];
         for (unsigned char c = 0; c < 128; c++)
         {
             // Load character glyph 
@@ -120,35 +124,53 @@ int main()
                 std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
                 continue;
             }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
+            FT_Bitmap& bitmap = face->glyph->bitmap;
+            for (unsigned int row = 0; row < bitmap.rows; row++)
+                bitmaps[c].insert(bitmaps[c].end(), bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width);
+            Characters[c].Size = glm::ivec2(bitmap.width, bitmap.rows);
+            Characters[c].Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+            Characters[c].Advance = static_cast<unsigned int>(face->glyph->advance.x);
+        }
+        unsigned char order[128];
+        for (unsigned int c = 0; c < 128; c++)
+            order[c] = c;
+        std::stable_sort(order, order + 128, [](unsigned char a, unsigned char b) { return Characters[a].Size.y > Characters[b].Size.y; });
+        glm::ivec2 positions[128];
+        int x = 0, shelfY = 0, shelfHeight = 0;
+        for (unsigned char c : order)
+        {
+            glm::ivec2 size = Characters[c].Size;
+            if (x + size.x > static_cast<int>(atlasWidth))
+            {
+                // start a new shelf
+                shelfY += shelfHeight + 1;
+                shelfHeight = 0;
+                x = 0;
+            }
+            positions[c] = glm::ivec2(x, shelfY);
+            shelfHeight = std::max(shelfHeight, size.y);
+            x += size.x + 1; // leave a pixel between glyphs so filtering doesn't bleed into neighbours
         }
+        AtlasSize = glm::vec2(atlasWidth, shelfY + shelfHeight);
+
+        // copy the glyphs into place and upload the atlas in one go
+        std::vector<unsigned char> atlas(atlasWidth * (shelfY + shelfHeight), 0);
+        for (unsigned int c = 0; c < 128; c++)
+        {
+            for (int row = 0; row < Characters[c].Size.y; row++)
+                std::copy_n(&bitmaps[c][row * Characters[c].Size.x], Characters[c].Size.x, &atlas[(positions[c].y + row) * atlasWidth + positions[c].x]);
+            Characters[c].TexOffset = glm::vec2(positions[c]) / AtlasSize;
+        }
+        // disable byte-alignment restriction
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &AtlasTexture);
+        glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, static_cast<int>(AtlasSize.x), static_cast<int>(AtlasSize.y), 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+        // set texture options
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
     // destroy FreeType once we're finished
@@ -156,13 +178,12 @@ int main()
     FT_Done_FreeType(ft);
 
     
-    // configure VAO/VBO for texture quads
-    // -----------------------------------
+    // configure VAO/VBO for texture quads (the buffer is filled per string in RenderText)
+    // ---------------------------------------------------------------------------------
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -216,45 +237,50 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // -------------------
 void RenderText(Shader &shader, std::string text, float x, float y, float scale, glm::vec3 color)
 {
-    // activate corresponding render state	
-    shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
-
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++) 
+    // build the quads of all characters first
+    std::vector<float> vertices;
+    vertices.reserve(text.size() * 6 * 4);
+    for (unsigned char c : text)
     {
-        Character ch = Characters[*c];
+        if (c >= 128)
+            continue;
+        const Character& ch = Characters[c];
 
         float xpos = x + ch.Bearing.x * scale;
         float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },            
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
+        // texture coordinates of the glyph's rectangle in the atlas
+        float u0 = ch.TexOffset.x, v0 = ch.TexOffset.y;
+        float u1 = u0 + ch.Size.x / AtlasSize.x, v1 = v0 + ch.Size.y / AtlasSize.y;
+        float quad[6][4] = {
+            { xpos,     ypos + h,   u0, v0 },            
+            { xpos,     ypos,       u0, v1 },
+            { xpos + w, ypos,       u1, v1 },
 
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }           
+            { xpos,     ypos + h,   u0, v0 },
+            { xpos + w, ypos,       u1, v1 },
+            { xpos + w, ypos + h,   u1, v0 }           
         };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 6 * 4);
         // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
     }
+    if (vertices.empty())
+        return;
+
+    // activate corresponding render state	
+    shader.use();
+    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+    glBindVertexArray(VAO);
+    // upload the whole string and render it with one draw call
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size() / 4));
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
 }
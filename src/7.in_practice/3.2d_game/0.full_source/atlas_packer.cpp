@@ -0,0 +1,110 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+
+#include "atlas_packer.h"
+
+
+AtlasPacker::AtlasPacker(unsigned int width, unsigned int height, unsigned int padding)
+    : Width(width), Height(height), padding(padding)
+{
+    this->Clear();
+}
+
+void AtlasPacker::Clear()
+{
+    this->skyline.clear();
+    this->skyline.push_back({ 0, 0, this->Width });
+}
+
+bool AtlasPacker::Pack(unsigned int width, unsigned int height, glm::uvec2 &position)
+{
+    // reserve the padding on the right and bottom of every rectangle
+    unsigned int paddedWidth = width + this->padding;
+    unsigned int paddedHeight = height + this->padding;
+    // bottom-left: the lowest resulting top edge wins, ties go to the narrowest segment
+    unsigned int bestIndex = static_cast<unsigned int>(this->skyline.size());
+    unsigned int bestTop = this->Height + 1, bestWidth = 0, bestY = 0;
+    for (unsigned int i = 0; i < this->skyline.size(); ++i)
+    {
+        unsigned int y;
+        if (!this->fit(i, paddedWidth, paddedHeight, y))
+            continue;
+        unsigned int top = y + paddedHeight;
+        if (top < bestTop || (top == bestTop && this->skyline[i].Width < bestWidth))
+        {
+            bestIndex = i;
+            bestTop = top;
+            bestWidth = this->skyline[i].Width;
+            bestY = y;
+        }
+    }
+    if (bestIndex == this->skyline.size())
+        return false;
+    position = glm::uvec2(this->skyline[bestIndex].X, bestY);
+
+    // raise the skyline under the new rectangle
+    Segment segment = { position.x, bestTop, paddedWidth };
+    this->skyline.insert(this->skyline.begin() + bestIndex, segment);
+    unsigned int right = segment.X + segment.Width;
+    for (unsigned int i = bestIndex + 1; i < this->skyline.size(); )
+    {
+        Segment &next = this->skyline[i];
+        if (next.X >= right)
+            break;
+        unsigned int nextRight = next.X + next.Width;
+        if (nextRight <= right)
+        {
+            // completely covered
+            this->skyline.erase(this->skyline.begin() + i);
+            continue;
+        }
+        next.Width = nextRight - right;
+        next.X = right;
+        break;
+    }
+    // merge neighbours of equal height
+    for (unsigned int i = 0; i + 1 < this->skyline.size(); )
+    {
+        if (this->skyline[i].Y == this->skyline[i + 1].Y)
+        {
+            this->skyline[i].Width += this->skyline[i + 1].Width;
+            this->skyline.erase(this->skyline.begin() + i + 1);
+        }
+        else
+            ++i;
+    }
+    return true;
+}
+
+unsigned int AtlasPacker::UsedHeight() const
+{
+    unsigned int height = 0;
+    for (const Segment &segment : this->skyline)
+        height = std::max(height, segment.Y);
+    return height;
+}
+
+bool AtlasPacker::fit(unsigned int index, unsigned int width, unsigned int height, unsigned int &y) const
+{
+    unsigned int x = this->skyline[index].X;
+    if (x + width > this->Width)
+        return false;
+    // the rectangle rests on the highest segment it spans
+    y = 0;
+    unsigned int remaining = width;
+    for (unsigned int i = index; remaining > 0; ++i)
+    {
+        y = std::max(y, this->skyline[i].Y);
+        if (y + height > this->Height)
+            return false;
+        remaining -= std::min(remaining, this->skyline[i].Width);
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+// AtlasPacker places rectangles into a fixed-size atlas page using the
+// skyline bottom-left heuristic: the packed area is described by its top
+// outline (the skyline) and every rectangle goes where its top edge ends
+// up lowest. Packing works best with rectangles sorted by height, tallest
+// first. It only does the bookkeeping; callers copy the pixels.
+class AtlasPacker
+{
+public:
+    // page dimensions in pixels
+    unsigned int Width, Height;
+    // constructor; 'padding' empty pixels are kept between rectangles to avoid filtering bleed
+    AtlasPacker(unsigned int width, unsigned int height, unsigned int padding = 1);
+    // empties the page
+    void Clear();
+    // finds room for a width x height rectangle; returns false if the page is full
+    bool Pack(unsigned int width, unsigned int height, glm::uvec2 &position);
+    // height of the tallest skyline segment, the rows above it are still unused
+    unsigned int UsedHeight() const;
+private:
+    // one horizontal segment of the skyline
+    struct Segment {
+        unsigned int X, Y, Width;
+    };
+    std::vector<Segment> skyline;
+    unsigned int         padding;
+    // lowest y at which a rectangle of the given width fits when starting at segment 'index'
+    bool fit(unsigned int index, unsigned int width, unsigned int height, unsigned int &y) const;
+};
+
+#endif
@@ -0,0 +1,249 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "audio_system.h"
+
+
+// .wav files are little endian, as is every platform Breakout runs on
+static uint32_t readU32(const unsigned char *data) { return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24); }
+static uint16_t readU16(const unsigned char *data) { return static_cast<uint16_t>(data[0] | (data[1] << 8)); }
+
+bool DecodeWav(const std::string &file, SoundBuffer &buffer)
+{
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream)
+        return false;
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+        return false;
+    // walk the chunks for the format and the samples
+    unsigned int channels = 0, sampleRate = 0, bits = 0;
+    const unsigned char *samples = nullptr;
+    size_t sampleBytes = 0;
+    for (size_t offset = 12; offset + 8 <= data.size(); )
+    {
+        const unsigned char *chunk = data.data() + offset;
+        size_t size = std::min<size_t>(readU32(chunk + 4), data.size() - offset - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            if (readU16(chunk + 8) != 1) // only uncompressed PCM
+                return false;
+            channels = readU16(chunk + 10);
+            sampleRate = readU32(chunk + 12);
+            bits = readU16(chunk + 22);
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            samples = chunk + 8;
+            sampleBytes = size;
+        }
+        offset += 8 + size + (size & 1); // chunks are padded to an even size
+    }
+    if (!samples || channels == 0 || sampleRate == 0 || (bits != 8 && bits != 16))
+        return false;
+
+    buffer.Channels = channels;
+    buffer.SampleRate = sampleRate;
+    buffer.Samples.resize(sampleBytes / (bits / 8) / channels * channels);
+    for (size_t i = 0; i < buffer.Samples.size(); ++i)
+    {
+        if (bits == 16)
+            buffer.Samples[i] = static_cast<short>(readU16(samples + i * 2));
+        else // 8 bit samples are unsigned
+            buffer.Samples[i] = static_cast<short>((samples[i] - 128) << 8);
+    }
+    return true;
+}
+
+
+WavWriterAudioBackend::WavWriterAudioBackend(const std::string &file, unsigned int sampleRate)
+    : file(file), sampleRate(sampleRate), time(0.0)
+{
+
+}
+
+WavWriterAudioBackend::~WavWriterAudioBackend()
+{
+    std::ofstream stream(this->file, std::ios::binary);
+    if (!stream)
+    {
+        std::cout << "ERROR::AUDIO: Failed to write " << this->file << std::endl;
+        return;
+    }
+    auto writeU32 = [&stream](uint32_t value) { unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) }; stream.write((const char*)bytes, 4); };
+    auto writeU16 = [&stream](uint16_t value) { unsigned char bytes[2] = { (unsigned char)value, (unsigned char)(value >> 8) }; stream.write((const char*)bytes, 2); };
+    uint32_t dataSize = static_cast<uint32_t>(this->output.size() * 2);
+    stream.write("RIFF", 4);
+    writeU32(36 + dataSize);
+    stream.write("WAVEfmt ", 8);
+    writeU32(16);                    // format chunk size
+    writeU16(1);                     // PCM
+    writeU16(2);                     // channels
+    writeU32(this->sampleRate);
+    writeU32(this->sampleRate * 4);  // bytes per second
+    writeU16(4);                     // bytes per frame
+    writeU16(16);                    // bits per sample
+    stream.write("data", 4);
+    writeU32(dataSize);
+    for (short sample : this->output)
+        writeU16(static_cast<uint16_t>(sample));
+}
+
+void WavWriterAudioBackend::Upload(SoundHandle sound, const SoundBuffer &buffer)
+{
+    if (sound >= this->sounds.size())
+        this->sounds.resize(sound + 1);
+    this->sounds[sound] = buffer;
+}
+
+void WavWriterAudioBackend::Start(unsigned int voice, SoundHandle sound, bool loop)
+{
+    if (voice >= this->voices.size())
+        this->voices.resize(voice + 1, { INVALID_SOUND, 0.0, false });
+    this->voices[voice] = { sound, 0.0, loop };
+}
+
+void WavWriterAudioBackend::Stop(unsigned int voice)
+{
+    if (voice < this->voices.size())
+        this->voices[voice].Sound = INVALID_SOUND;
+}
+
+void WavWriterAudioBackend::Update(float dt)
+{
+    // mix up to the frame the (accumulated) time has reached, so rounding never drifts
+    this->time += dt;
+    size_t target = static_cast<size_t>(std::llround(this->time * this->sampleRate));
+    for (size_t frame = this->output.size() / 2; frame < target; ++frame)
+    {
+        int left = 0, right = 0;
+        for (Voice &voice : this->voices)
+        {
+            if (voice.Sound == INVALID_SOUND)
+                continue;
+            const SoundBuffer &sound = this->sounds[voice.Sound];
+            unsigned int frames = sound.Frames();
+            if (frames == 0)
+            {
+                voice.Sound = INVALID_SOUND;
+                continue;
+            }
+            // nearest sample; all of Breakout's sounds are at the output rate anyway
+            const short *sample = &sound.Samples[static_cast<size_t>(voice.Position) * sound.Channels];
+            left += sample[0];
+            right += sound.Channels > 1 ? sample[1] : sample[0];
+            voice.Position += static_cast<double>(sound.SampleRate) / this->sampleRate;
+            if (voice.Position >= frames)
+            {
+                if (voice.Loop)
+                    voice.Position = std::fmod(voice.Position, static_cast<double>(frames));
+                else
+                    voice.Sound = INVALID_SOUND;
+            }
+        }
+        this->output.push_back(static_cast<short>(std::max(-32768, std::min(32767, left))));
+        this->output.push_back(static_cast<short>(std::max(-32768, std::min(32767, right))));
+    }
+}
+
+
+AudioSystem::AudioSystem(AudioBackend *backend, unsigned int voices)
+    : Played(0), Stolen(0), Dropped(0), backend(backend), voices(voices, { 0.0, 0.0, false, false }), time(0.0)
+{
+
+}
+
+AudioSystem::~AudioSystem()
+{
+    this->StopAll();
+    delete this->backend;
+}
+
+SoundHandle AudioSystem::Load(const std::string &file)
+{
+    SoundBuffer buffer;
+    if (!DecodeWav(file, buffer) && !this->backend->Decode(file, buffer))
+    {
+        std::cout << "ERROR::AUDIO: Failed to decode " << file << std::endl;
+        return INVALID_SOUND;
+    }
+    SoundHandle sound = static_cast<SoundHandle>(this->durations.size());
+    this->durations.push_back(buffer.Duration());
+    this->backend->Upload(sound, buffer);
+    return sound;
+}
+
+void AudioSystem::Play(SoundHandle sound, bool loop)
+{
+    if (sound >= this->durations.size())
+        return;
+    // a free voice, else the oldest one-shot
+    unsigned int free = static_cast<unsigned int>(this->voices.size());
+    unsigned int oldest = free;
+    for (unsigned int i = 0; i < this->voices.size(); ++i)
+    {
+        const Voice &voice = this->voices[i];
+        if (!voice.Active)
+        {
+            free = i;
+            break;
+        }
+        if (!voice.Loop && (oldest == this->voices.size() || voice.StartTime < this->voices[oldest].StartTime))
+            oldest = i;
+    }
+    unsigned int index = free;
+    if (index == this->voices.size())
+    {
+        if (oldest == this->voices.size())
+        {
+            this->Dropped++;
+            return;
+        }
+        index = oldest;
+        this->Stolen++;
+    }
+    this->voices[index] = { this->time, this->time + this->durations[sound], loop, true };
+    this->backend->Start(index, sound, loop);
+    this->Played++;
+}
+
+void AudioSystem::StopAll()
+{
+    for (unsigned int i = 0; i < this->voices.size(); ++i)
+        if (this->voices[i].Active)
+        {
+            this->voices[i].Active = false;
+            this->backend->Stop(i);
+        }
+}
+
+void AudioSystem::Update(float dt)
+{
+    this->time += dt;
+    // the voices' end times follow from the sound lengths, no need to ask the backend
+    for (Voice &voice : this->voices)
+        if (voice.Active && !voice.Loop && voice.EndTime <= this->time)
+            voice.Active = false;
+    this->backend->Update(dt);
+}
+
+unsigned int AudioSystem::ActiveVoices() const
+{
+    unsigned int active = 0;
+    for (const Voice &voice : this->voices)
+        active += voice.Active ? 1 : 0;
+    return active;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef AUDIO_SYSTEM_H
+#define AUDIO_SYSTEM_H
+
+#include <string>
+#include <vector>
+
+
+// Handle of a sound loaded with AudioSystem::Load
+typedef unsigned int SoundHandle;
+const SoundHandle INVALID_SOUND = ~0u;
+
+// A decoded sound: interleaved signed 16 bit PCM samples
+struct SoundBuffer {
+    std::vector<short> Samples;
+    unsigned int       Channels;
+    unsigned int       SampleRate;
+    SoundBuffer() : Channels(0), SampleRate(0) { }
+    // number of sample frames (one sample per channel)
+    unsigned int Frames() const { return this->Channels ? static_cast<unsigned int>(this->Samples.size() / this->Channels) : 0; }
+    // length in seconds
+    float Duration() const { return this->SampleRate ? static_cast<float>(this->Frames()) / this->SampleRate : 0.0f; }
+};
+
+// reads an uncompressed (8 or 16 bit PCM) .wav file
+bool DecodeWav(const std::string &file, SoundBuffer &buffer);
+
+
+// An AudioBackend is the output the AudioSystem's voices play on. Voices
+// are numbered 0..voices-1; the AudioSystem decides which voice plays
+// what, the backend only starts and stops them.
+class AudioBackend
+{
+public:
+    virtual ~AudioBackend() { }
+    // decodes files the AudioSystem can't read itself (anything but .wav), false if unsupported
+    virtual bool Decode(const std::string &file, SoundBuffer &buffer) { return false; }
+    // makes a decoded sound playable as 'sound'
+    virtual void Upload(SoundHandle sound, const SoundBuffer &buffer) = 0;
+    // starts 'sound' on 'voice', cutting off whatever the voice played before
+    virtual void Start(unsigned int voice, SoundHandle sound, bool loop) = 0;
+    // silences 'voice'
+    virtual void Stop(unsigned int voice) = 0;
+    // advances the output by dt seconds, for backends that don't run on an audio thread of their own
+    virtual void Update(float dt) { }
+};
+
+// Plays nothing; for headless runs and machines without an audio device.
+class NullAudioBackend : public AudioBackend
+{
+public:
+    void Upload(SoundHandle sound, const SoundBuffer &buffer) override { }
+    void Start(unsigned int voice, SoundHandle sound, bool loop) override { }
+    void Stop(unsigned int voice) override { }
+};
+
+// Mixes all voices in software, in step with Update, and writes the
+// result to a 16 bit stereo .wav file when destroyed. Driven by the
+// game's fixed timestep the output is the same on every run.
+class WavWriterAudioBackend : public AudioBackend
+{
+public:
+    // constructor/destructor
+    WavWriterAudioBackend(const std::string &file, unsigned int sampleRate = 44100);
+    ~WavWriterAudioBackend();
+    // AudioBackend
+    void Upload(SoundHandle sound, const SoundBuffer &buffer) override;
+    void Start(unsigned int voice, SoundHandle sound, bool loop) override;
+    void Stop(unsigned int voice) override;
+    void Update(float dt) override;
+private:
+    struct Voice {
+        SoundHandle Sound;
+        double      Position; // in frames of the sound, fractional when the sample rates differ
+        bool        Loop;
+    };
+    std::string              file;
+    unsigned int             sampleRate;
+    std::vector<SoundBuffer> sounds;
+    std::vector<Voice>       voices;
+    std::vector<short>       output; // interleaved stereo
+    double                   time;   // seconds of output requested so far
+};
+
+
+// AudioSystem decodes all sounds once at load time and plays them from a
+// fixed pool of voices. Playing a sound is a handle lookup and a scan
+// over the pool: a free voice is used if there is one, otherwise the
+// one-shot voice that started longest ago is stolen. Looping voices
+// (music) are never stolen.
+class AudioSystem
+{
+public:
+    // statistics
+    unsigned int Played;  // sounds started
+    unsigned int Stolen;  // sounds that cut off an older one
+    unsigned int Dropped; // sounds not played because every voice was looping
+    // constructor/destructor, the audio system owns the backend
+    AudioSystem(AudioBackend *backend, unsigned int voices = 16);
+    ~AudioSystem();
+    // decodes a sound file, returns INVALID_SOUND if it couldn't be decoded
+    SoundHandle Load(const std::string &file);
+    // plays a loaded sound
+    void Play(SoundHandle sound, bool loop = false);
+    // stops all voices
+    void StopAll();
+    // advances the audio clock (frees voices that finished) and the backend
+    void Update(float dt);
+    // number of voices currently playing
+    unsigned int ActiveVoices() const;
+private:
+    struct Voice {
+        double StartTime, EndTime;
+        bool   Loop;
+        bool   Active;
+    };
+    AudioBackend       *backend;
+    std::vector<float>  durations; // per sound, in seconds
+    std::vector<Voice>  voices;
+    double              time;
+};
+
+#endif
@@ -24,12 +24,13 @@ class BallObject : public GameObject
 {
 public:
     // ball state	
+    glm::vec2 LastPosition; // position before the last Move, spans the swept area together with Position
     float   Radius;
     bool    Stuck;
     bool    Sticky, PassThrough;
     // constructor(s)
     BallObject();
-    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite);
+    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, TextureHandle sprite);
     // moves the ball, keeping it constrained within the window bounds (except bottom edge); returns new position
     glm::vec2 Move(float dt, unsigned int window_width);
     // resets the ball to original state with given position and velocity
@@ -0,0 +1,140 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Headless benchmark of ball/brick collisions against brick count: the
+// brute-force scan over all bricks against the level's SpatialGrid.
+// Both paths simulate the same balls (grid path: CollideBall, as used by
+// Game::DoCollisions) and must end up in the same state.
+// No window or GL context is created. Built by the
+// breakout_collision_benchmark target of the root CMakeLists.txt.
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../collision.h"
+#include "../game_level.h"
+#include "../ball_object.h"
+
+
+const unsigned int LEVEL_WIDTH = 800, LEVEL_HEIGHT = 300;
+const unsigned int BALLS = 8;
+const float        DT = 1.0f / 60.0f;
+
+// collision response as in Game::DoCollisions
+static void resolve(BallObject &ball, GameLevel &level, unsigned int brick, Collision collision)
+{
+    level.Destroy(brick);
+    Direction dir = std::get<1>(collision);
+    glm::vec2 diff_vector = std::get<2>(collision);
+    if (dir == LEFT || dir == RIGHT)
+    {
+        ball.Velocity.x = -ball.Velocity.x;
+        float penetration = ball.Radius - std::abs(diff_vector.x);
+        ball.Position.x += dir == LEFT ? penetration : -penetration;
+    }
+    else
+    {
+        ball.Velocity.y = -ball.Velocity.y;
+        float penetration = ball.Radius - std::abs(diff_vector.y);
+        ball.Position.y += dir == UP ? -penetration : penetration;
+    }
+}
+
+static std::vector<BallObject> makeBalls()
+{
+    std::vector<BallObject> balls;
+    for (unsigned int i = 0; i < BALLS; ++i)
+    {
+        float angle = 0.3f + i * 0.7f;
+        BallObject ball(glm::vec2(50.0f + i * 90.0f, 150.0f), 12.5f, glm::vec2(std::cos(angle), std::sin(angle)) * 400.0f, INVALID_TEXTURE);
+        ball.Stuck = false;
+        balls.push_back(ball);
+    }
+    return balls;
+}
+
+static void move(BallObject &ball)
+{
+    ball.Move(DT, LEVEL_WIDTH);
+    // keep the balls inside the level area instead of letting them drop out at the bottom
+    if (ball.Position.y + ball.Size.y >= LEVEL_HEIGHT)
+    {
+        ball.Velocity.y = -std::abs(ball.Velocity.y);
+        ball.Position.y = LEVEL_HEIGHT - ball.Size.y;
+    }
+}
+
+static void bruteForce(GameLevel &level, std::vector<BallObject> &balls)
+{
+    for (BallObject &ball : balls)
+    {
+        move(ball);
+        for (unsigned int brick = 0; brick < level.BrickCount(); ++brick)
+        {
+            if (level.IsDestroyed(brick))
+                continue;
+            Collision collision = CheckCollision(ball, level.BrickPositions[brick], level.BrickSize);
+            if (std::get<0>(collision))
+                resolve(ball, level, brick, collision);
+        }
+    }
+}
+
+static void grid(GameLevel &level, std::vector<BallObject> &balls, std::vector<unsigned int> &candidates)
+{
+    for (BallObject &ball : balls)
+    {
+        move(ball);
+        CollideBall(ball, level, candidates, [&](unsigned int brick, Collision collision) { resolve(ball, level, brick, collision); });
+    }
+}
+
+static unsigned int destroyed(const GameLevel &level)
+{
+    unsigned int count = 0;
+    for (unsigned int brick = 0; brick < level.BrickCount(); ++brick)
+        count += level.IsDestroyed(brick);
+    return count;
+}
+
+int main()
+{
+    const unsigned int sizes[] = { 10, 32, 100, 316, 1000 };
+    for (unsigned int size : sizes)
+    {
+        GameLevel bruteLevel;
+        bruteLevel.Generate(size, size, LEVEL_WIDTH, LEVEL_HEIGHT);
+        GameLevel gridLevel = bruteLevel;
+        std::vector<BallObject> bruteBalls = makeBalls(), gridBalls = makeBalls();
+        std::vector<unsigned int> candidates;
+        unsigned int frames = size >= 1000 ? 30 : 300;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int f = 0; f < frames; ++f)
+            bruteForce(bruteLevel, bruteBalls);
+        auto middle = std::chrono::high_resolution_clock::now();
+        gridLevel.Grid.ResetStats();
+        for (unsigned int f = 0; f < frames; ++f)
+            grid(gridLevel, gridBalls, candidates);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double bruteTime = std::chrono::duration<double, std::micro>(middle - start).count() / frames;
+        double gridTime = std::chrono::duration<double, std::micro>(end - middle).count() / frames;
+        bool same = destroyed(bruteLevel) == destroyed(gridLevel);
+        for (unsigned int i = 0; i < BALLS; ++i)
+            same = same && bruteBalls[i].Position == gridBalls[i].Position && bruteBalls[i].Velocity == gridBalls[i].Velocity;
+        std::cout << bruteLevel.BrickCount() << " bricks, " << BALLS << " balls: brute force " << bruteTime
+                  << " us/frame, grid " << gridTime << " us/frame (" << gridLevel.Grid.CellsVisited() / (frames * BALLS)
+                  << " cells/query), " << destroyed(gridLevel) << " bricks destroyed, results "
+                  << (same ? "identical" : "DIFFER") << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Headless driver: runs Game::Tick (ProcessInput + Update) for a number of
+// fixed steps, feeding key presses from a script, without a window, GL
+// context or audio device. Prints the simulation rate and a hash of the
+// final game state; with the same script and seed the hash must not change
+// between runs, builds or machines.
+//
+// Usage: headless_driver <script> <ticks> [seed] [out.wav]
+// Every script line is '<tick> <key> press|release', where key is one of
+// A, D, W, S, SPACE, ENTER or a GLFW key code; '#' starts a comment, e.g.
+//   0   ENTER press
+//   1   ENTER release
+//   2   SPACE press
+//   30  D     press
+//   200 D     release
+// Sounds play on the null audio backend, or are mixed into out.wav when
+// given. Only .wav sounds decode without irrKlang; the mp3 music and brick
+// sounds stay silent here.
+//
+// Built by the breakout_headless_driver target of the root CMakeLists.txt,
+// like all benchmarks in this directory; run it from 0.full_source.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../game.h"
+
+
+struct ScriptEvent
+{
+    unsigned int Tick;
+    int          Key;
+    bool         Pressed;
+};
+
+static int keyCode(const std::string &name)
+{
+    if (name == "A")     return GLFW_KEY_A;
+    if (name == "D")     return GLFW_KEY_D;
+    if (name == "W")     return GLFW_KEY_W;
+    if (name == "S")     return GLFW_KEY_S;
+    if (name == "SPACE") return GLFW_KEY_SPACE;
+    if (name == "ENTER") return GLFW_KEY_ENTER;
+    return std::atoi(name.c_str());
+}
+
+static bool loadScript(const char *file, std::vector<ScriptEvent> &events)
+{
+    std::ifstream script(file);
+    if (!script)
+        return false;
+    std::string line;
+    while (std::getline(script, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream sstream(line);
+        ScriptEvent event;
+        std::string key, action;
+        if (!(sstream >> event.Tick >> key >> action))
+            continue;
+        event.Key = keyCode(key);
+        event.Pressed = action == "press";
+        events.push_back(event);
+    }
+    std::stable_sort(events.begin(), events.end(), [](const ScriptEvent &a, const ScriptEvent &b) { return a.Tick < b.Tick; });
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: headless_driver <script> <ticks> [seed] [out.wav]" << std::endl;
+        return -1;
+    }
+    std::vector<ScriptEvent> events;
+    if (!loadScript(argv[1], events))
+    {
+        std::cout << "ERROR::DRIVER: Failed to read script " << argv[1] << std::endl;
+        return -1;
+    }
+    unsigned int ticks = std::atoi(argv[2]);
+    unsigned int seed = argc > 3 ? std::atoi(argv[3]) : 5489u;
+
+    Game breakout(800, 600, seed);
+    breakout.InitState();
+    if (argc > 4)
+        breakout.InitAudio(new WavWriterAudioBackend(argv[4]));
+    else
+        breakout.InitAudio(new NullAudioBackend());
+
+    size_t next = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int tick = 0; tick < ticks; ++tick)
+    {
+        for (; next < events.size() && events[next].Tick <= tick; ++next)
+            breakout.SetKey(events[next].Key, events[next].Pressed);
+        breakout.Tick(FIXED_TIMESTEP);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", breakout.StateHash());
+    std::cout << ticks << " ticks in " << seconds * 1000.0 << " ms (" << ticks / seconds << " ticks/s)" << std::endl;
+    std::cout << "state hash: " << hash << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Benchmark of level loading against level size: generated levels are
+// written as text .lvl and as binary level, then loaded by the previous
+// GameLevel (std::getline plus an istringstream per line, a GameObject
+// per brick), by GameLevel::Load from the text file and by GameLevel::Load
+// from the binary file (memory mapped). Also times IsCompleted, which used
+// to scan every brick and now reads a counter. All loads must produce the
+// same bricks.
+// Writes its level files to the working directory. No window or GL context
+// is created. Built by the breakout_level_benchmark target of the root
+// CMakeLists.txt.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../game_level.h"
+
+
+const unsigned int LEVEL_WIDTH = 800, LEVEL_HEIGHT = 300;
+const unsigned int RUNS = 5;
+
+// the GameLevel this replaced: a getline plus an istringstream per line, the rows copied
+// into init and a GameObject per brick; IsCompleted scans all bricks
+class LegacyLevel
+{
+public:
+    std::vector<GameObject> Bricks;
+    SpatialGrid             Grid;
+
+    void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
+    {
+        this->Bricks.clear();
+        this->Grid.Clear();
+        unsigned int tileCode;
+        std::string line;
+        std::ifstream fstream(file);
+        std::vector<std::vector<unsigned int>> tileData;
+        while (std::getline(fstream, line))
+        {
+            std::istringstream sstream(line);
+            std::vector<unsigned int> row;
+            while (sstream >> tileCode)
+                row.push_back(tileCode);
+            tileData.push_back(row);
+        }
+        if (tileData.size() > 0)
+            this->init(tileData, levelWidth, levelHeight);
+    }
+    bool IsCompleted()
+    {
+        for (GameObject &tile : this->Bricks)
+            if (!tile.IsSolid && !tile.Destroyed)
+                return false;
+        return true;
+    }
+private:
+    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+    {
+        unsigned int height = tileData.size();
+        unsigned int width = tileData[0].size();
+        float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / static_cast<float>(height);
+        for (unsigned int y = 0; y < height; ++y)
+            for (unsigned int x = 0; x < width; ++x)
+                if (tileData[y][x] > 0)
+                {
+                    GameObject obj(glm::vec2(unit_width * x, unit_height * y), glm::vec2(unit_width, unit_height), INVALID_TEXTURE, glm::vec3(1.0f));
+                    obj.IsSolid = tileData[y][x] == 1;
+                    this->Bricks.push_back(obj);
+                }
+        std::vector<glm::vec4> bounds;
+        bounds.reserve(this->Bricks.size());
+        for (GameObject &tile : this->Bricks)
+            bounds.push_back(glm::vec4(tile.Position, tile.Position + tile.Size));
+        this->Grid.Build(glm::vec2(0.0f), glm::vec2(unit_width, unit_height), width, height, bounds);
+    }
+};
+
+static void saveText(const char *file, const std::vector<unsigned char> &tiles, unsigned int columns, unsigned int rows)
+{
+    std::ofstream stream(file);
+    for (unsigned int y = 0; y < rows; ++y)
+    {
+        for (unsigned int x = 0; x < columns; ++x)
+            stream << static_cast<unsigned int>(tiles[y * columns + x]) << ' ';
+        stream << '\n';
+    }
+}
+
+// best time of a few runs in milliseconds
+template <typename Function>
+static double best(Function function)
+{
+    double result = 0.0;
+    for (unsigned int run = 0; run < RUNS; ++run)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        result = run == 0 ? time : std::min(result, time);
+    }
+    return result;
+}
+
+static bool sameBricks(const GameLevel &one, const GameLevel &two)
+{
+    if (one.BrickCount() != two.BrickCount() || one.BrickSize != two.BrickSize)
+        return false;
+    for (unsigned int brick = 0; brick < one.BrickCount(); ++brick)
+        if (one.BrickPositions[brick] != two.BrickPositions[brick] || one.BrickColors[brick] != two.BrickColors[brick]
+            || one.IsSolid(brick) != two.IsSolid(brick))
+            return false;
+    return true;
+}
+
+int main()
+{
+    const unsigned int sizes[] = { 16, 100, 316, 1000, 2000 };
+    for (unsigned int size : sizes)
+    {
+        std::vector<unsigned char> tiles = GameLevel::GenerateTiles(size, size);
+        saveText("level_benchmark.lvl", tiles, size, size);
+        GameLevel::SaveBinary("level_benchmark.blvl", tiles, size, size);
+
+        LegacyLevel legacyLevel;
+        GameLevel textLevel, binaryLevel;
+        double legacyTime = best([&]() { legacyLevel.Load("level_benchmark.lvl", LEVEL_WIDTH, LEVEL_HEIGHT); });
+        double textTime = best([&]() { textLevel.Load("level_benchmark.lvl", LEVEL_WIDTH, LEVEL_HEIGHT); });
+        double binaryTime = best([&]() { binaryLevel.Load("level_benchmark.blvl", LEVEL_WIDTH, LEVEL_HEIGHT); });
+        // IsCompleted is called every frame, on a level with one brick left
+        for (unsigned int brick = 0; brick + 1 < binaryLevel.BrickCount(); ++brick)
+            binaryLevel.Destroy(brick);
+        for (unsigned int brick = 0; brick + 1 < legacyLevel.Bricks.size(); ++brick)
+            legacyLevel.Bricks[brick].Destroyed = true;
+        volatile bool completed = false;
+        double legacyCompleted = best([&]() { for (unsigned int i = 0; i < 100; ++i) completed = legacyLevel.IsCompleted(); }) * 10.0;
+        double counterCompleted = best([&]() { for (unsigned int i = 0; i < 100; ++i) completed = binaryLevel.IsCompleted(); }) * 10.0;
+
+        bool same = sameBricks(textLevel, binaryLevel) && legacyLevel.Bricks.size() == binaryLevel.BrickCount();
+        std::cout << size << "x" << size << " tiles, " << binaryLevel.BrickCount() << " bricks: load getline/istringstream "
+                  << legacyTime << " ms, text " << textTime << " ms, binary " << binaryTime << " ms; IsCompleted scan "
+                  << legacyCompleted << " us, counter " << counterCompleted << " us; levels " << (same ? "identical" : "DIFFER") << std::endl;
+    }
+    std::remove("level_benchmark.lvl");
+    std::remove("level_benchmark.blvl");
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Headless benchmark of the particle simulation: the original
+// array-of-structs generator (linear search for a free slot, rand())
+// against ParticleStore. No window or GL context is created. Built by
+// the breakout_particle_benchmark target of the root CMakeLists.txt.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../particle_generator.h"
+
+
+// the particle update as it was before ParticleStore, kept as reference
+struct ReferenceParticle {
+    glm::vec2 Position, Velocity;
+    glm::vec4 Color;
+    float     Life;
+};
+
+struct ReferenceGenerator {
+    std::vector<ReferenceParticle> Particles;
+    unsigned int LastUsed = 0;
+
+    ReferenceGenerator(unsigned int amount) : Particles(amount, ReferenceParticle{ glm::vec2(0.0f), glm::vec2(0.0f), glm::vec4(1.0f), 0.0f }) { }
+
+    unsigned int firstUnused()
+    {
+        for (unsigned int i = LastUsed; i < Particles.size(); ++i)
+            if (Particles[i].Life <= 0.0f)
+                return LastUsed = i;
+        for (unsigned int i = 0; i < LastUsed; ++i)
+            if (Particles[i].Life <= 0.0f)
+                return LastUsed = i;
+        return LastUsed = 0;
+    }
+
+    void Update(float dt, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles)
+    {
+        for (unsigned int i = 0; i < newParticles; ++i)
+        {
+            ReferenceParticle &p = Particles[firstUnused()];
+            float random = ((rand() % 100) - 50) / 10.0f;
+            float rColor = 0.5f + ((rand() % 100) / 100.0f);
+            p.Position = position + random;
+            p.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
+            p.Life = 1.0f;
+            p.Velocity = velocity;
+        }
+        for (ReferenceParticle &p : Particles)
+        {
+            p.Life -= dt;
+            if (p.Life > 0.0f)
+            {
+                p.Position -= p.Velocity * dt;
+                p.Color.a -= dt * 2.5f;
+            }
+        }
+    }
+};
+
+// runs 'frames' updates at 60Hz and returns the average time per update in microseconds
+template <typename Step>
+double measure(unsigned int frames, Step step)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int f = 0; f < frames; ++f)
+        step();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+int main()
+{
+    const float dt = 1.0f / 60.0f;
+    const unsigned int counts[] = { 500, 100000, 1000000 };
+    const glm::vec2 position(400.0f, 300.0f), velocity(25.0f, -35.0f);
+    for (unsigned int amount : counts)
+    {
+        // spawn enough per frame to keep the pool saturated, as the ball trail does
+        unsigned int spawn = amount / 60 + 1;
+        unsigned int frames = amount >= 1000000 ? 60 : 240;
+
+        ReferenceGenerator reference(amount);
+        for (unsigned int f = 0; f < 60; ++f) // warm up until particles start dying
+            reference.Update(dt, position, velocity, spawn);
+        double referenceTime = measure(frames, [&]() { reference.Update(dt, position, velocity, spawn); });
+
+        ParticleStore store(amount, 1234u);
+        for (unsigned int f = 0; f < 60; ++f)
+        {
+            store.Spawn(spawn, position, velocity);
+            store.Update(dt);
+        }
+        double storeTime = measure(frames, [&]() { store.Spawn(spawn, position, velocity); store.Update(dt); });
+
+        std::cout << amount << " particles (" << store.Alive << " alive): reference " << referenceTime
+                  << " us/update, ParticleStore " << storeTime << " us/update, speedup "
+                  << referenceTime / storeTime << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Runs ParticleGenerator's CPU simulation (ParticleStore) and
+// GpuParticleGenerator side by side on fixed seeds and checks that both
+// end up with the same particles. Needs an OpenGL 4.3 context but no
+// GPU; run it from the 0.full_source directory (it loads particle.cs)
+// on Mesa's software rasterizer with
+//   LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe ../../../../bin/7.in_practice/breakout_particle_gpu_check
+// Built by the breakout_particle_gpu_check target of the root CMakeLists.txt.
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "../resource_manager.h"
+#include "../game_object.h"
+#include "../particle_generator.h"
+#include "../gpu_particle_generator.h"
+
+
+// particles are in a different order on each backend; sort before comparing
+static std::vector<std::vector<float>> sorted(const ParticleStore &store)
+{
+    std::vector<std::vector<float>> particles;
+    for (unsigned int i = 0; i < store.Alive; ++i)
+        particles.push_back({ store.Life[i], store.ColorR[i], store.PositionX[i], store.PositionY[i],
+                              store.VelocityX[i], store.VelocityY[i], store.ColorG[i], store.ColorB[i], store.ColorA[i] });
+    std::sort(particles.begin(), particles.end());
+    return particles;
+}
+
+int main()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "particle_gpu_check", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create an OpenGL 4.3 context" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) || !GpuParticleGenerator::Supported())
+    {
+        std::cout << "GPU particles are not supported by this context" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    Shader compute = ResourceManager::LoadComputeShader("particle.cs", "particle_compute");
+    const unsigned int seeds[] = { 1u, 42u, 0x9E3779B9u };
+    const unsigned int capacity = 1000;
+    const float dt = 1.0f / 60.0f;
+    bool passed = true;
+    for (unsigned int seed : seeds)
+    {
+        ParticleStore cpu(capacity, seed);
+        GpuParticleGenerator gpu(compute, Shader(), Texture2D(), capacity, seed);
+        GameObject emitter(glm::vec2(400.0f, 300.0f), glm::vec2(12.5f), INVALID_TEXTURE, glm::vec3(1.0f), glm::vec2(100.0f, -350.0f));
+        float maxError = 0.0f;
+        unsigned int mismatches = 0;
+        for (unsigned int frame = 1; frame <= 300; ++frame)
+        {
+            // varying emission saturates the pool now and then, so dropped spawns are covered too
+            unsigned int spawn = (frame * 7) % 50;
+            emitter.Position += emitter.Velocity * dt;
+            cpu.Spawn(spawn, emitter.Position, emitter.Velocity * 0.1f);
+            cpu.Update(dt);
+            gpu.Update(dt, emitter, spawn);
+            if (frame % 30 != 0)
+                continue;
+            ParticleStore readBack(capacity);
+            gpu.ReadBack(readBack);
+            std::vector<std::vector<float>> expected = sorted(cpu), actual = sorted(readBack);
+            if (expected.size() != actual.size())
+            {
+                std::cout << "seed " << seed << " frame " << frame << ": " << expected.size() << " CPU particles, "
+                          << actual.size() << " GPU particles" << std::endl;
+                ++mismatches;
+                continue;
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+                for (size_t c = 0; c < expected[i].size(); ++c)
+                    maxError = std::max(maxError, std::abs(expected[i][c] - actual[i][c]));
+        }
+        bool agree = mismatches == 0 && maxError <= 1e-4f;
+        passed = passed && agree;
+        std::cout << "seed " << seed << ": " << cpu.Alive << " particles alive, max difference " << maxError
+                  << (agree ? " (ok)" : " (FAILED)") << std::endl;
+    }
+    ResourceManager::Clear();
+    glfwTerminate();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Benchmark of the power-up system against power-up count. First the
+// power-up update alone: the previous vector of PowerUp objects (a
+// GameObject each, string types, every expiring PowerUp scanning all
+// others for one of its type) against the PowerUpStore with per-type
+// counters, on power-ups that were all collected and run out one after
+// another. Both must deactivate the same effects at the same steps.
+// Then the stress mode: Game::Stress puts thousands of balls and falling
+// PowerUps into a running game and the time per Game::Tick is measured.
+// No window, GL context or audio device is created. Built by the
+// breakout_powerup_benchmark target of the root CMakeLists.txt.
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../game.h"
+
+
+const float DT = 1.0f / 60.0f;
+
+// the PowerUp this replaced
+class LegacyPowerUp : public GameObject
+{
+public:
+    std::string Type;
+    float       Duration;
+    bool        Activated;
+    LegacyPowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position)
+        : GameObject(position, POWERUP_SIZE, INVALID_TEXTURE, color, VELOCITY), Type(type), Duration(duration), Activated() { }
+};
+
+static bool isOtherPowerUpActive(std::vector<LegacyPowerUp> &powerUps, std::string type)
+{
+    for (const LegacyPowerUp &powerUp : powerUps)
+    {
+        if (powerUp.Activated)
+            if (powerUp.Type == type)
+                return true;
+    }
+    return false;
+}
+
+// Game::UpdatePowerUps before the store; returns the number of effects switched off
+static unsigned int legacyUpdate(std::vector<LegacyPowerUp> &powerUps, float dt)
+{
+    unsigned int deactivated = 0;
+    for (LegacyPowerUp &powerUp : powerUps)
+    {
+        powerUp.Position += powerUp.Velocity * dt;
+        if (powerUp.Activated)
+        {
+            powerUp.Duration -= dt;
+            if (powerUp.Duration <= 0.0f)
+            {
+                powerUp.Activated = false;
+                if (powerUp.Type == "sticky" || powerUp.Type == "pass-through" || powerUp.Type == "confuse" || powerUp.Type == "chaos")
+                    if (!isOtherPowerUpActive(powerUps, powerUp.Type))
+                        deactivated++;
+            }
+        }
+    }
+    powerUps.erase(std::remove_if(powerUps.begin(), powerUps.end(),
+        [](const LegacyPowerUp &powerUp) { return powerUp.Destroyed && !powerUp.Activated; }
+    ), powerUps.end());
+    return deactivated;
+}
+
+// Game::UpdatePowerUps
+static unsigned int storeUpdate(PowerUpStore &powerUps, unsigned int active[POWERUP_TYPE_COUNT], float dt)
+{
+    unsigned int deactivated = 0;
+    for (unsigned int i = 0; i < powerUps.Size(); ++i)
+        powerUps.Positions[i] += VELOCITY * dt;
+    for (unsigned int i = 0; i < powerUps.Size(); ++i)
+    {
+        if (!powerUps.Activated[i])
+            continue;
+        powerUps.Durations[i] -= dt;
+        if (powerUps.Durations[i] <= 0.0f)
+        {
+            powerUps.Activated[i] = false;
+            if (--active[powerUps.Types[i]] == 0 && POWERUP_INFO[powerUps.Types[i]].Duration > 0.0f)
+                deactivated++;
+        }
+    }
+    powerUps.RemoveFinished();
+    return deactivated;
+}
+
+// count collected PowerUps of every type, their durations spread so they run out one after another
+static void collect(unsigned int count, std::vector<LegacyPowerUp> &legacy, PowerUpStore &store, unsigned int active[POWERUP_TYPE_COUNT])
+{
+    legacy.clear();
+    store.Clear();
+    std::fill(active, active + POWERUP_TYPE_COUNT, 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        PowerUpType type = static_cast<PowerUpType>(i % POWERUP_TYPE_COUNT);
+        const PowerUpInfo &info = POWERUP_INFO[type];
+        glm::vec2 position(0.0f, 100.0f);
+        float duration = info.Duration * (i + 1) / count;
+        legacy.push_back(LegacyPowerUp(info.Name, info.Color, duration, position));
+        legacy.back().Activated = legacy.back().Destroyed = true;
+        unsigned int index = store.Add(type, position);
+        store.Durations[index] = duration;
+        store.Activated[index] = store.Destroyed[index] = true;
+        active[type]++;
+    }
+}
+
+int main()
+{
+    const unsigned int counts[] = { 100, 1000, 10000 };
+    for (unsigned int count : counts)
+    {
+        std::vector<LegacyPowerUp> legacy;
+        PowerUpStore store;
+        unsigned int active[POWERUP_TYPE_COUNT];
+        collect(count, legacy, store, active);
+        // all run out within 20 seconds
+        unsigned int steps = static_cast<unsigned int>(20.0f / DT) + 1;
+        bool same = true;
+        double legacyTime = 0.0, storeTime = 0.0;
+        for (unsigned int step = 0; step < steps; ++step)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            unsigned int legacyOff = legacyUpdate(legacy, DT);
+            auto middle = std::chrono::high_resolution_clock::now();
+            unsigned int storeOff = storeUpdate(store, active, DT);
+            auto end = std::chrono::high_resolution_clock::now();
+            legacyTime += std::chrono::duration<double, std::milli>(middle - start).count();
+            storeTime += std::chrono::duration<double, std::milli>(end - middle).count();
+            same = same && legacyOff == storeOff && legacy.size() == store.Size();
+        }
+        std::cout << count << " collected power-ups over " << steps << " steps: objects + string scan " << legacyTime
+                  << " ms, store + counters " << storeTime << " ms; " << (same && store.Size() == 0 ? "identical" : "DIFFER") << std::endl;
+    }
+
+    const unsigned int stress[] = { 100, 1000, 5000 };
+    const unsigned int ticks = 600;
+    for (unsigned int count : stress)
+    {
+        Game breakout(800, 600);
+        breakout.InitState();
+        // start the first level, the player's ball stays on the paddle
+        breakout.SetKey(GLFW_KEY_ENTER, true);
+        breakout.Tick(DT);
+        breakout.SetKey(GLFW_KEY_ENTER, false);
+        breakout.Stress(count, count);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int tick = 0; tick < ticks; ++tick)
+            breakout.Tick(DT);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "stress " << count << " balls + " << count << " power-ups: " << time / ticks << " ms per tick, "
+                  << breakout.PowerUps.Size() << " power-ups left after " << ticks << " ticks" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Benchmark of Breakout's texture loading at startup: every texture
+// decoded and uploaded one after the other (LoadTexture), decoded on
+// loader threads (QueueTexture + FinishLoading), and decoded on loader
+// threads with the small sprites packed into one atlas. For each it
+// reports the load time, and the draw calls and resource lookups of
+// drawing the first level with the paddle, ball and all powerups.
+// Needs an OpenGL 3.3 context; run it from the 0.full_source directory
+// (it loads sprite.vs/fs). Built by the breakout_startup_benchmark
+// target of the root CMakeLists.txt.
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/filesystem.h>
+
+#include "../resource_manager.h"
+#include "../sprite_renderer.h"
+#include "../game_level.h"
+
+
+enum LoadMode {
+    LOAD_SYNCHRONOUS,
+    LOAD_ASYNCHRONOUS,
+    LOAD_ASYNCHRONOUS_ATLAS
+};
+
+struct TextureFile {
+    const char *File;
+    const char *Name;
+    bool        Alpha;
+    bool        Sprite; // small sprite, goes into the atlas
+};
+
+// the textures Game::Init loads
+const TextureFile TEXTURES[] = {
+    { "background.jpg",          "background",          false, false },
+    { "awesomeface.png",         "face",                true,  true  },
+    { "block.png",               "block",               false, true  },
+    { "block_solid.png",         "block_solid",         false, true  },
+    { "paddle.png",              "paddle",              true,  true  },
+    { "particle.png",            "particle",            true,  false },
+    { "powerup_speed.png",       "powerup_speed",       true,  true  },
+    { "powerup_sticky.png",      "powerup_sticky",      true,  true  },
+    { "powerup_increase.png",    "powerup_increase",    true,  true  },
+    { "powerup_confuse.png",     "powerup_confuse",     true,  true  },
+    { "powerup_chaos.png",       "powerup_chaos",       true,  true  },
+    { "powerup_passthrough.png", "powerup_passthrough", true,  true  }
+};
+const unsigned int RUNS = 5;
+
+static double loadTextures(LoadMode mode)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const TextureFile &texture : TEXTURES)
+    {
+        std::string path = FileSystem::getPath(std::string("resources/textures/") + texture.File);
+        if (mode == LOAD_SYNCHRONOUS)
+            ResourceManager::LoadTexture(path.c_str(), texture.Alpha, texture.Name);
+        else
+            ResourceManager::QueueTexture(path.c_str(), texture.Alpha, texture.Name, mode == LOAD_ASYNCHRONOUS_ATLAS && texture.Sprite);
+    }
+    ResourceManager::FinishLoading();
+    glFinish();
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// draws a frame of the first level the way Game::Render does
+static void drawFrame(SpriteRenderer &renderer, TextureHandle background, GameLevel &level, std::vector<GameObject> &objects)
+{
+    renderer.DrawSprite(ResourceManager::GetTexture(background).Texture, glm::vec2(0.0f), glm::vec2(800.0f, 600.0f));
+    renderer.Begin();
+    level.Draw(renderer);
+    for (GameObject &object : objects)
+        object.Draw(renderer);
+    renderer.End();
+}
+
+int main()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(800, 600, "startup_benchmark", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create an OpenGL 3.3 context" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    const char *names[] = { "synchronous", "loader threads", "loader threads + atlas" };
+    for (LoadMode mode : { LOAD_SYNCHRONOUS, LOAD_ASYNCHRONOUS, LOAD_ASYNCHRONOUS_ATLAS })
+    {
+        // best of a few runs, the first one also pays for reading the files from disk
+        double best = 0.0;
+        for (unsigned int run = 0; run < RUNS; ++run)
+        {
+            ResourceManager::Clear();
+            double time = loadTextures(mode);
+            best = run == 0 ? time : std::min(best, time);
+        }
+
+        Shader shader = ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
+        shader.SetMatrix4("projection", glm::ortho(0.0f, 800.0f, 600.0f, 0.0f, -1.0f, 1.0f), true);
+        SpriteRenderer renderer(shader);
+        GameLevel level;
+        level.Load(FileSystem::getPath("resources/levels/one.lvl").c_str(), 800, 300);
+        std::vector<GameObject> objects;
+        for (const char *name : { "paddle", "face", "powerup_speed", "powerup_sticky", "powerup_increase", "powerup_confuse", "powerup_chaos", "powerup_passthrough" })
+            objects.push_back(GameObject(glm::vec2(objects.size() * 90.0f, 500.0f), glm::vec2(60.0f, 20.0f), ResourceManager::FindTexture(name)));
+
+        TextureHandle background = ResourceManager::FindTexture("background");
+        drawFrame(renderer, background, level, objects);
+        renderer.ResetStats();
+        ResourceManager::ResetStats();
+        drawFrame(renderer, background, level, objects);
+        glFinish();
+        std::cout << names[mode] << ": " << best << " ms to load, " << renderer.DrawCalls << " draw calls, "
+                  << ResourceManager::HandleLookups << " handle and " << ResourceManager::NameLookups << " name lookups per frame" << std::endl;
+    }
+
+    ResourceManager::Clear();
+    glfwTerminate();
+    return 0;
+}
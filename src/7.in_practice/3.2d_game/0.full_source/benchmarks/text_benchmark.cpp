@@ -0,0 +1,253 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// Benchmark of a text heavy HUD (5,000 characters a frame): the previous
+// TextRenderer, one texture per glyph and one glBufferSubData plus draw
+// call per character, against the atlas TextRenderer that draws the
+// whole frame of text in one call. Reports draw calls and CPU time per
+// frame (submission only, and including glFinish) and checks that both
+// produce the same image.
+// Needs an OpenGL 3.3 context; run it from the 0.full_source directory
+// (it loads text_2d.vs/fs). Built by the breakout_text_benchmark target
+// of the root CMakeLists.txt.
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <learnopengl/filesystem.h>
+
+#include "../text_renderer.h"
+#include "../resource_manager.h"
+
+
+const unsigned int SCREEN_WIDTH = 800, SCREEN_HEIGHT = 600;
+const unsigned int HUD_LINES = 100, HUD_COLUMNS = 50;
+const unsigned int FRAMES = 50;
+
+// the TextRenderer this replaced: a texture per glyph, a draw call per character
+class LegacyTextRenderer
+{
+public:
+    std::map<char, Character> Characters;
+    std::map<char, unsigned int> Textures;
+    unsigned int DrawCalls = 0;
+
+    LegacyTextRenderer(Shader shader) : shader(shader)
+    {
+        glGenVertexArrays(1, &this->VAO);
+        glGenBuffers(1, &this->VBO);
+        glBindVertexArray(this->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+    void Load(std::string font, unsigned int fontSize)
+    {
+        FT_Library ft;
+        FT_Init_FreeType(&ft);
+        FT_Face face;
+        FT_New_Face(ft, font.c_str(), 0, &face);
+        FT_Set_Pixel_Sizes(face, 0, fontSize);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (GLubyte c = 0; c < 128; c++)
+        {
+            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+                continue;
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            Character character;
+            character.Size = glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows);
+            character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+            character.Advance = static_cast<unsigned int>(face->glyph->advance.x);
+            this->Characters[c] = character;
+            this->Textures[c] = texture;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        FT_Done_Face(face);
+        FT_Done_FreeType(ft);
+    }
+    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+    {
+        this->shader.Use();
+        // text_2d.vs now takes the color per vertex, feed it as a constant attribute
+        glVertexAttrib3f(1, color.x, color.y, color.z);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(this->VAO);
+        for (std::string::const_iterator c = text.begin(); c != text.end(); c++)
+        {
+            Character ch = this->Characters[*c];
+            float xpos = x + ch.Bearing.x * scale;
+            float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+            float w = ch.Size.x * scale;
+            float h = ch.Size.y * scale;
+            float vertices[6][4] = {
+                { xpos,     ypos + h,   0.0f, 1.0f },
+                { xpos + w, ypos,       1.0f, 0.0f },
+                { xpos,     ypos,       0.0f, 0.0f },
+
+                { xpos,     ypos + h,   0.0f, 1.0f },
+                { xpos + w, ypos + h,   1.0f, 1.0f },
+                { xpos + w, ypos,       1.0f, 0.0f }
+            };
+            glBindTexture(GL_TEXTURE_2D, this->Textures[*c]);
+            glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            this->DrawCalls++;
+            x += (ch.Advance >> 6) * scale;
+        }
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+private:
+    Shader shader;
+    unsigned int VAO, VBO;
+};
+
+// HUD_LINES lines of HUD_COLUMNS characters in a few different colors
+static std::vector<std::string> hudLines()
+{
+    std::vector<std::string> lines;
+    for (unsigned int i = 0; i < HUD_LINES; ++i)
+    {
+        std::string line;
+        while (line.size() < HUD_COLUMNS)
+            line += "Score:" + std::to_string(i * 7919 % 100000) + " Lives:3 ";
+        lines.push_back(line.substr(0, HUD_COLUMNS));
+    }
+    return lines;
+}
+
+static glm::vec3 lineColor(unsigned int line)
+{
+    return glm::vec3((line % 3) / 2.0f, ((line / 3) % 3) / 2.0f, 1.0f);
+}
+
+static std::vector<unsigned char> readPixels()
+{
+    std::vector<unsigned char> pixels(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    glReadPixels(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// 'frame' renders one HUD and returns the number of draw calls it took
+template <typename Frame>
+static void measure(const char *name, Frame frame)
+{
+    // warm up, then time submission and submission + execution separately
+    frame();
+    glFinish();
+    double submit = 0.0, total = 0.0;
+    unsigned int drawCalls = 0;
+    for (unsigned int i = 0; i < FRAMES; ++i)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        auto start = std::chrono::high_resolution_clock::now();
+        drawCalls = frame();
+        auto submitted = std::chrono::high_resolution_clock::now();
+        glFinish();
+        auto finished = std::chrono::high_resolution_clock::now();
+        submit += std::chrono::duration<double, std::milli>(submitted - start).count();
+        total += std::chrono::duration<double, std::milli>(finished - start).count();
+    }
+    std::cout << name << ": " << drawCalls << " draw calls, " << submit / FRAMES << " ms submit, "
+              << total / FRAMES << " ms with glFinish per frame" << std::endl;
+}
+
+int main()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "text_benchmark", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create an OpenGL 3.3 context" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    // render offscreen so the glyphs are rasterized even without a visible default framebuffer
+    unsigned int framebuffer, colorbuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCREEN_WIDTH, SCREEN_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorbuffer);
+    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    std::string font = FileSystem::getPath("resources/fonts/OCRAEXT.TTF");
+    TextRenderer text(SCREEN_WIDTH, SCREEN_HEIGHT);
+    text.Load(font, 12);
+    LegacyTextRenderer legacy(text.TextShader);
+    legacy.Load(font, 12);
+    std::cout << "atlas: " << text.Atlas.Width << "x" << text.Atlas.Height << " for 128 glyphs" << std::endl;
+
+    std::vector<std::string> lines = hudLines();
+    float lineHeight = static_cast<float>(SCREEN_HEIGHT) / HUD_LINES * 2.0f;
+    measure("per-glyph textures", [&]() {
+        legacy.DrawCalls = 0;
+        for (unsigned int i = 0; i < lines.size(); ++i)
+            legacy.RenderText(lines[i], (i % 2) * 400.0f, (i / 2) * lineHeight, 1.0f, lineColor(i));
+        return legacy.DrawCalls;
+    });
+    std::vector<unsigned char> legacyPixels = readPixels();
+    measure("glyph atlas, batched", [&]() {
+        text.ResetStats();
+        text.Begin();
+        for (unsigned int i = 0; i < lines.size(); ++i)
+            text.RenderText(lines[i], (i % 2) * 400.0f, (i / 2) * lineHeight, 1.0f, lineColor(i));
+        text.End();
+        return text.DrawCalls;
+    });
+    // both paths sample the same glyph bitmaps, the output should only differ by rounding
+    std::vector<unsigned char> atlasPixels = readPixels();
+    unsigned int different = 0;
+    for (size_t i = 0; i < atlasPixels.size(); i += 4)
+        for (size_t c = 0; c < 4; ++c)
+            if (std::abs(atlasPixels[i + c] - legacyPixels[i + c]) > 2)
+            {
+                different++;
+                break;
+            }
+    std::cout << "pixels that differ: " << different << " of " << SCREEN_WIDTH * SCREEN_HEIGHT << std::endl;
+
+    ResourceManager::Clear();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "collision.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+bool CheckCollision(GameObject &one, GameObject &two) // AABB - AABB collision
+{
+    return CheckCollision(one, two.Position, two.Size);
+}
+
+bool CheckCollision(GameObject &one, glm::vec2 position, glm::vec2 size) // AABB - AABB collision
+{
+    // collision x-axis?
+    bool collisionX = one.Position.x + one.Size.x >= position.x &&
+        position.x + size.x >= one.Position.x;
+    // collision y-axis?
+    bool collisionY = one.Position.y + one.Size.y >= position.y &&
+        position.y + size.y >= one.Position.y;
+    // collision only if on both axes
+    return collisionX && collisionY;
+}
+
+Collision CheckCollision(BallObject &one, GameObject &two) // AABB - Circle collision
+{
+    return CheckCollision(one, two.Position, two.Size);
+}
+
+Collision CheckCollision(BallObject &one, glm::vec2 position, glm::vec2 size) // AABB - Circle collision
+{
+    // get center point circle first 
+    glm::vec2 center(one.Position + one.Radius);
+    // calculate AABB info (center, half-extents)
+    glm::vec2 aabb_half_extents(size.x / 2.0f, size.y / 2.0f);
+    glm::vec2 aabb_center(position.x + aabb_half_extents.x, position.y + aabb_half_extents.y);
+    // get difference vector between both centers
+    glm::vec2 difference = center - aabb_center;
+    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
+    // now that we know the clamped values, add this to AABB_center and we get the value of box closest to circle
+    glm::vec2 closest = aabb_center + clamped;
+    // now retrieve vector between center circle and closest point AABB and check if length < radius
+    difference = closest - center;
+    
+    if (glm::length(difference) < one.Radius) // not <= since in that case a collision also occurs when object one exactly touches object two, which they are at the end of each collision resolution stage.
+        return std::make_tuple(true, VectorDirection(difference), difference);
+    else
+        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+}
+
+// calculates which direction a vector is facing (N,E,S or W)
+Direction VectorDirection(glm::vec2 target)
+{
+    glm::vec2 compass[] = {
+        glm::vec2(0.0f, 1.0f),	// up
+        glm::vec2(1.0f, 0.0f),	// right
+        glm::vec2(0.0f, -1.0f),	// down
+        glm::vec2(-1.0f, 0.0f)	// left
+    };
+    float max = 0.0f;
+    unsigned int best_match = -1;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        float dot_product = glm::dot(glm::normalize(target), compass[i]);
+        if (dot_product > max)
+        {
+            max = dot_product;
+            best_match = i;
+        }
+    }
+    return (Direction)best_match;
+}
+
+void CollideBall(BallObject &ball, GameLevel &level, std::vector<unsigned int> &candidates, const std::function<void(unsigned int, Collision)> &onHit)
+{
+    // only bricks in the tiles the ball swept over this frame can be hit; the box is grown by
+    // the radius as resolving a hit moves the ball by up to that much
+    glm::vec2 queryMin = glm::min(ball.LastPosition, ball.Position) - ball.Radius;
+    glm::vec2 queryMax = glm::max(ball.LastPosition, ball.Position) + ball.Size + ball.Radius;
+    level.Grid.Query(queryMin, queryMax, candidates);
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        unsigned int index = candidates[c];
+        if (level.IsDestroyed(index))
+            continue;
+        Collision collision = CheckCollision(ball, level.BrickPositions[index], level.BrickSize);
+        if (!std::get<0>(collision))
+            continue;
+        onHit(index, collision);
+        // several hits in a row (small bricks) can push the ball out of the queried box; then also
+        // visit the bricks around its new position that a linear scan would still reach
+        if (glm::any(glm::lessThan(ball.Position, queryMin)) || glm::any(glm::greaterThan(ball.Position + ball.Size, queryMax)))
+        {
+            queryMin = glm::min(queryMin, ball.Position - ball.Radius);
+            queryMax = glm::max(queryMax, ball.Position + ball.Size + ball.Radius);
+            std::vector<unsigned int> grown, merged;
+            level.Grid.Query(queryMin, queryMax, grown);
+            // bricks up to the current one were already visited (or out of reach when their turn came)
+            std::vector<unsigned int>::iterator later = std::upper_bound(grown.begin(), grown.end(), index);
+            std::set_union(candidates.begin() + c + 1, candidates.end(), later, grown.end(), std::back_inserter(merged));
+            candidates.resize(c + 1);
+            candidates.insert(candidates.end(), merged.begin(), merged.end());
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef COLLISION_H
+#define COLLISION_H
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "game_object.h"
+#include "ball_object.h"
+#include "game_level.h"
+
+
+// Represents the four possible (collision) directions
+enum Direction {
+    UP,
+    RIGHT,
+    DOWN,
+    LEFT
+};
+// Defines a Collision typedef that represents collision data
+typedef std::tuple<bool, Direction, glm::vec2> Collision; // <collision?, what direction?, difference vector center - closest point>
+
+// AABB - AABB collision
+bool      CheckCollision(GameObject &one, GameObject &two);
+bool      CheckCollision(GameObject &one, glm::vec2 position, glm::vec2 size);
+// AABB - Circle collision
+Collision CheckCollision(BallObject &one, GameObject &two);
+Collision CheckCollision(BallObject &one, glm::vec2 position, glm::vec2 size);
+// calculates which direction a vector is facing (N,E,S or W)
+Direction VectorDirection(glm::vec2 target);
+// tests ball against the bricks of level that its last move could reach (found through the level's
+// grid, candidates is scratch space) and calls onHit with the index of every hit brick; hits are reported in brick
+// order and onHit may move the ball, so the outcome equals testing every brick in turn
+void      CollideBall(BallObject &ball, GameLevel &level, std::vector<unsigned int> &candidates, const std::function<void(unsigned int, Collision)> &onHit);
+
+#endif
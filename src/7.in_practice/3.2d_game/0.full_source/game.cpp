@@ -7,38 +7,44 @@
 ** option) any later version.
 ******************************************************************/
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <iostream>
 
 #include <learnopengl/filesystem.h>
 
-#include <irrklang/irrKlang.h>
-using namespace irrklang;
-
 #include "game.h"
 #include "resource_manager.h"
 #include "sprite_renderer.h"
 #include "game_object.h"
 #include "ball_object.h"
 #include "particle_generator.h"
+#include "gpu_particle_generator.h"
 #include "post_processor.h"
 #include "text_renderer.h"
+#include "spatial_grid.h"
 
 
 // Game-related State data
 SpriteRenderer    *Renderer;
 GameObject        *Player;
-BallObject        *Ball;
-ParticleGenerator *Particles;
+std::vector<BallObject> Balls; // all balls in play, stored by value; Balls[0] is the player's ball
+ParticleEmitter   *Particles;
 PostProcessor     *Effects;
-ISoundEngine      *SoundEngine = createIrrKlangDevice();
 TextRenderer      *Text;
+SpatialGrid        PowerUpGrid;
+std::vector<unsigned int> Candidates; // reused broadphase query results
+// texture handles, resolved once in InitState
+TextureHandle      BackgroundTexture, PowerUpTextures[POWERUP_TYPE_COUNT];
+// sound handles, decoded once in InitAudio
+SoundHandle        MusicSound = INVALID_SOUND, BrickSound = INVALID_SOUND, PowerUpSound = INVALID_SOUND, PaddleSound = INVALID_SOUND;
 
 float ShakeTime = 0.0f;
+// post-processing effects switched on and off by gameplay, handed to Effects when rendering
+bool  ShakeEffect = false, ConfuseEffect = false, ChaosEffect = false;
 
-
-Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3)
+Game::Game(unsigned int width, unsigned int height, unsigned int seed) 
+    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), ActivePowerUps(), Level(0), Lives(3), Time(0.0f), Random(seed)
 { 
 
 }
@@ -47,15 +53,27 @@ Game::~Game()
 {
     delete Renderer;
     delete Player;
-    delete Ball;
     delete Particles;
     delete Effects;
     delete Text;
-    SoundEngine->drop();
 }
 
 void Game::Init()
 {
+    // start decoding the textures in the background, meanwhile we compile the shaders
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/background.jpg").c_str(), false, "background");
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), true, "face", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/block.png").c_str(), false, "block", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/block_solid.png").c_str(), false, "block_solid", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/paddle.png").c_str(), true, "paddle", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/particle.png").c_str(), true, "particle"); // sampled as a whole by the particle shaders
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_speed.png").c_str(), true, "powerup_speed", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_sticky.png").c_str(), true, "powerup_sticky", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_increase.png").c_str(), true, "powerup_increase", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_confuse.png").c_str(), true, "powerup_confuse", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_chaos.png").c_str(), true, "powerup_chaos", PACK_SPRITE_ATLAS);
+    ResourceManager::QueueTexture(FileSystem::getPath("resources/textures/powerup_passthrough.png").c_str(), true, "powerup_passthrough", PACK_SPRITE_ATLAS);
+    ResourceManager::UpdateLoading();
     // load shaders
     ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
     ResourceManager::LoadShader("particle.vs", "particle.fs", nullptr, "particle");
@@ -66,25 +84,51 @@ void Game::Init()
     ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
     ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
     ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
-    // load textures
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/background.jpg").c_str(), false, "background");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), true, "face");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block.png").c_str(), false, "block");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block_solid.png").c_str(), false, "block_solid");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/paddle.png").c_str(), true, "paddle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/particle.png").c_str(), true, "particle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_speed.png").c_str(), true, "powerup_speed");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_sticky.png").c_str(), true, "powerup_sticky");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_increase.png").c_str(), true, "powerup_increase");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_confuse.png").c_str(), true, "powerup_confuse");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_chaos.png").c_str(), true, "powerup_chaos");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_passthrough.png").c_str(), true, "powerup_passthrough");
     // set render-specific controls
     Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500);
+    // the remaining objects need the textures, wait for the loaders (and build the sprite atlas)
+    ResourceManager::FinishLoading();
+    Texture2D particleTexture = ResourceManager::GetTexture(ResourceManager::FindTexture("particle")).Texture;
+    if (GpuParticleGenerator::Supported())
+    {
+        ResourceManager::LoadComputeShader("particle.cs", "particle_compute");
+        ResourceManager::LoadShader("particle_gpu.vs", "particle.fs", nullptr, "particle_gpu");
+        ResourceManager::GetShader("particle_gpu").Use().SetInteger("sprite", 0);
+        ResourceManager::GetShader("particle_gpu").SetMatrix4("projection", projection);
+        Particles = new GpuParticleGenerator(ResourceManager::GetShader("particle_compute"), ResourceManager::GetShader("particle_gpu"), particleTexture, 500);
+    }
+    else
+        Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), particleTexture, 500);
     Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
     Text = new TextRenderer(this->Width, this->Height);
     Text->Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF").c_str(), 24);
+    // load levels and game objects
+    this->InitState();
+}
+
+void Game::InitAudio(AudioBackend *backend)
+{
+    this->Audio.reset(new AudioSystem(backend));
+    // decode everything up front, playing a sound during the game is then only a voice lookup
+    MusicSound = this->Audio->Load(FileSystem::getPath("resources/audio/breakout.mp3"));
+    BrickSound = this->Audio->Load(FileSystem::getPath("resources/audio/bleep.mp3"));
+    PowerUpSound = this->Audio->Load(FileSystem::getPath("resources/audio/powerup.wav"));
+    PaddleSound = this->Audio->Load(FileSystem::getPath("resources/audio/bleep.wav"));
+    this->PlayAudio(MusicSound, true);
+}
+
+void Game::PlayAudio(SoundHandle sound, bool loop)
+{
+    if (this->Audio)
+        this->Audio->Play(sound, loop);
+}
+
+void Game::InitState()
+{
+    // resolve the textures used during play once
+    BackgroundTexture = ResourceManager::FindTexture("background");
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type)
+        PowerUpTextures[type] = ResourceManager::FindTexture(POWERUP_INFO[type].Texture);
     // load levels
     GameLevel one; one.Load(FileSystem::getPath("resources/levels/one.lvl").c_str(), this->Width, this->Height / 2);
     GameLevel two; two.Load(FileSystem::getPath("resources/levels/two.lvl").c_str(), this->Width, this->Height /2 );
@@ -94,24 +138,52 @@ void Game::Init()
     this->Levels.push_back(two);
     this->Levels.push_back(three);
     this->Levels.push_back(four);
+    GameLevel stress; stress.Generate(STRESS_LEVEL_COLUMNS, STRESS_LEVEL_ROWS, this->Width, this->Height / 2);
+    this->Levels.push_back(stress);
     this->Level = 0;
     // configure game objects
     glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
+    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::FindTexture("paddle"));
     glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
-    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
-    // audio
-    SoundEngine->play2D(FileSystem::getPath("resources/audio/breakout.mp3").c_str(), true);
+    // the balls outlive a Game, a previous one may have left some behind
+    Balls.clear();
+    Balls.push_back(BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::FindTexture("face")));
+}
+
+void Game::SetKey(int key, bool pressed)
+{
+    if (key < 0 || key >= 1024)
+        return;
+    this->Keys[key] = pressed;
+    if (!pressed)
+        this->KeysProcessed[key] = false;
+}
+
+void Game::Tick(float dt)
+{
+    // remember where moving objects start this step, Render interpolates from there
+    Player->PreviousPosition = Player->Position;
+    for (BallObject &ball : Balls)
+        ball.PreviousPosition = ball.Position;
+    this->PowerUps.PreviousPositions = this->PowerUps.Positions;
+    this->ProcessInput(dt);
+    this->Update(dt);
+    this->Time += dt;
+    // the audio clock runs on simulation time, so voices free up identically in every run
+    if (this->Audio)
+        this->Audio->Update(dt);
 }
 
 void Game::Update(float dt)
 {
     // update objects
-    Ball->Move(dt, this->Width);
+    for (BallObject &ball : Balls)
+        ball.Move(dt, this->Width);
     // check for collisions
     this->DoCollisions();
     // update particles
-    Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
+    if (Particles)
+        Particles->Update(dt, Balls[0], 2, glm::vec2(Balls[0].Radius / 2.0f));
     // update PowerUps
     this->UpdatePowerUps(dt);
     // reduce shake time
@@ -119,10 +191,14 @@ void Game::Update(float dt)
     {
         ShakeTime -= dt;
         if (ShakeTime <= 0.0f)
-            Effects->Shake = false;
+            ShakeEffect = false;
     }
+    // extra balls that reach the bottom edge are simply removed
+    Balls.erase(std::remove_if(Balls.begin() + 1, Balls.end(),
+        [this](const BallObject &ball) { return ball.Position.y >= this->Height; }
+    ), Balls.end());
     // check loss condition
-    if (Ball->Position.y >= this->Height) // did ball reach bottom edge?
+    if (Balls[0].Position.y >= this->Height) // did ball reach bottom edge?
     {
         --this->Lives;
         // did the player lose all his lives? : game over
@@ -138,7 +214,7 @@ void Game::Update(float dt)
     {
         this->ResetLevel();
         this->ResetPlayer();
-        Effects->Chaos = true;
+        ChaosEffect = true;
         this->State = GAME_WIN;
     }
 }
@@ -152,10 +228,11 @@ void Game::ProcessInput(float dt)
         {
             this->State = GAME_ACTIVE;
             this->KeysProcessed[GLFW_KEY_ENTER] = true;
+            this->ResetPlayer(); // puts the balls of the selected level in play
         }
         if (this->Keys[GLFW_KEY_W] && !this->KeysProcessed[GLFW_KEY_W])
         {
-            this->Level = (this->Level + 1) % 4;
+            this->Level = (this->Level + 1) % this->Levels.size();
             this->KeysProcessed[GLFW_KEY_W] = true;
         }
         if (this->Keys[GLFW_KEY_S] && !this->KeysProcessed[GLFW_KEY_S])
@@ -163,7 +240,7 @@ void Game::ProcessInput(float dt)
             if (this->Level > 0)
                 --this->Level;
             else
-                this->Level = 3;
+                this->Level = this->Levels.size() - 1;
             //this->Level = (this->Level - 1) % 4;
             this->KeysProcessed[GLFW_KEY_S] = true;
         }
@@ -173,7 +250,7 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_ENTER])
         {
             this->KeysProcessed[GLFW_KEY_ENTER] = true;
-            Effects->Chaos = false;
+            ChaosEffect = false;
             this->State = GAME_MENU;
         }
     }
@@ -186,8 +263,9 @@ void Game::ProcessInput(float dt)
             if (Player->Position.x >= 0.0f)
             {
                 Player->Position.x -= velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x -= velocity;
+                for (BallObject &ball : Balls)
+                    if (ball.Stuck)
+                        ball.Position.x -= velocity;
             }
         }
         if (this->Keys[GLFW_KEY_D])
@@ -195,42 +273,66 @@ void Game::ProcessInput(float dt)
             if (Player->Position.x <= this->Width - Player->Size.x)
             {
                 Player->Position.x += velocity;
-                if (Ball->Stuck)
-                    Ball->Position.x += velocity;
+                for (BallObject &ball : Balls)
+                    if (ball.Stuck)
+                        ball.Position.x += velocity;
             }
         }
         if (this->Keys[GLFW_KEY_SPACE])
-            Ball->Stuck = false;
+            for (BallObject &ball : Balls)
+                ball.Stuck = false;
     }
 }
 
-void Game::Render()
+void Game::Render(float alpha)
 {
+    // text is collected throughout and drawn last in one draw call, on top of the post-processed scene
+    Text->Begin();
     if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
     {
+        Renderer->ResetStats();
+        Text->ResetStats();
+        Effects->Shake = ShakeEffect;
+        Effects->Confuse = ConfuseEffect;
+        Effects->Chaos = ChaosEffect;
         // begin rendering to postprocessing framebuffer
         Effects->BeginRender();
             // draw background
-            Renderer->DrawSprite(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
-            // draw level
-            this->Levels[this->Level].Draw(*Renderer);
-            // draw player
-            Player->Draw(*Renderer);
-            // draw PowerUps
-            for (PowerUp &powerUp : this->PowerUps)
-                if (!powerUp.Destroyed)
-                    powerUp.Draw(*Renderer);
+            Renderer->DrawSprite(ResourceManager::GetTexture(BackgroundTexture).Texture, glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
+            // draw level, player and PowerUps as one batch (one draw call per texture)
+            Renderer->Begin();
+                this->Levels[this->Level].Draw(*Renderer);
+                Player->Draw(*Renderer, alpha);
+                for (unsigned int i = 0; i < this->PowerUps.Size(); ++i)
+                {
+                    if (this->PowerUps.Destroyed[i])
+                        continue;
+                    const PowerUpInfo &info = POWERUP_INFO[this->PowerUps.Types[i]];
+                    const TextureRegion &sprite = ResourceManager::GetTexture(PowerUpTextures[this->PowerUps.Types[i]]);
+                    glm::vec2 position = glm::mix(this->PowerUps.PreviousPositions[i], this->PowerUps.Positions[i], alpha);
+                    Renderer->DrawSprite(sprite.Texture, position, POWERUP_SIZE, 0.0f, info.Color, sprite.TexRect);
+                }
+            Renderer->End();
             // draw particles	
             Particles->Draw();
-            // draw ball
-            Ball->Draw(*Renderer);            
+            // draw balls
+            for (BallObject &ball : Balls)
+                ball.Draw(*Renderer, alpha);
         // end rendering to postprocessing framebuffer
         Effects->EndRender();
         // render postprocessing quad
-        Effects->Render(glfwGetTime());
+        Effects->Render(this->Time);
         // render text (don't include in postprocessing)
         std::stringstream ss; ss << this->Lives;
         Text->RenderText("Lives:" + ss.str(), 5.0f, 5.0f, 1.0f);
+        if (this->Level == STRESS_LEVEL)
+        {
+            std::stringstream stats; stats << "Sprites:" << Renderer->SpritesDrawn << " Draw calls:" << Renderer->DrawCalls
+                << " Lookups:" << ResourceManager::HandleLookups << " by name:" << ResourceManager::NameLookups;
+            if (this->Audio)
+                stats << " Voices:" << this->Audio->ActiveVoices() << " stolen:" << this->Audio->Stolen;
+            Text->RenderText(stats.str(), 5.0f, 30.0f, 0.75f);
+        }
     }
     if (this->State == GAME_MENU)
     {
@@ -242,19 +344,16 @@ void Game::Render()
         Text->RenderText("You WON!!!", 320.0f, this->Height / 2.0f - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
         Text->RenderText("Press ENTER to retry or ESC to quit", 130.0f, this->Height / 2.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f));
     }
+    Text->End();
+    // lookups are counted from one frame's text to the next, ticks included
+    ResourceManager::ResetStats();
 }
 
 
 void Game::ResetLevel()
 {
-    if (this->Level == 0)
-        this->Levels[0].Load("levels/one.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 1)
-        this->Levels[1].Load("levels/two.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 2)
-        this->Levels[2].Load("levels/three.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 3)
-        this->Levels[3].Load("levels/four.lvl", this->Width, this->Height / 2);
+    // the levels stay loaded, only the destroyed bricks come back
+    this->Levels[this->Level].Reset();
 
     this->Lives = 3;
 }
@@ -264,291 +363,319 @@ void Game::ResetPlayer()
     // reset player/ball stats
     Player->Size = PLAYER_SIZE;
     Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+    Player->PreviousPosition = Player->Position;
+    glm::vec2 ballPos = Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f));
+    Balls[0].Reset(ballPos, INITIAL_BALL_VELOCITY);
+    Balls.erase(Balls.begin() + 1, Balls.end());
+    // the stress level launches a fan of extra balls together with the regular one
+    if (this->Level == STRESS_LEVEL)
+    {
+        for (unsigned int i = 1; i < STRESS_LEVEL_BALLS; ++i)
+        {
+            float spread = i / (STRESS_LEVEL_BALLS - 1.0f) * 2.0f - 1.0f;
+            glm::vec2 velocity = glm::normalize(glm::vec2(spread, -1.0f)) * glm::length(INITIAL_BALL_VELOCITY);
+            Balls.push_back(BallObject(ballPos, BALL_RADIUS, velocity, Balls[0].Sprite));
+        }
+    }
     // also disable all active powerups
-    Effects->Chaos = Effects->Confuse = false;
-    Ball->PassThrough = Ball->Sticky = false;
+    ChaosEffect = ConfuseEffect = false;
     Player->Color = glm::vec3(1.0f);
-    Ball->Color = glm::vec3(1.0f);
+    for (BallObject &ball : Balls)
+    {
+        ball.PassThrough = ball.Sticky = false;
+        ball.Color = glm::vec3(1.0f);
+    }
 }
 
+void Game::Stress(unsigned int balls, unsigned int powerUps)
+{
+    // balls fan out upwards from the paddle, PowerUps of every type spread over the upper half
+    glm::vec2 ballPos = Player->Position + glm::vec2(Player->Size.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f));
+    std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+    for (unsigned int i = 0; i < balls; ++i)
+    {
+        glm::vec2 velocity = glm::normalize(glm::vec2(spread(this->Random), -1.0f)) * glm::length(INITIAL_BALL_VELOCITY);
+        Balls.push_back(BallObject(ballPos, BALL_RADIUS, velocity, Balls[0].Sprite));
+        Balls.back().Stuck = false;
+    }
+    for (unsigned int i = 0; i < powerUps; ++i)
+    {
+        glm::vec2 position((spread(this->Random) * 0.5f + 0.5f) * (this->Width - POWERUP_SIZE.x), (spread(this->Random) * 0.5f + 0.5f) * this->Height / 2.0f);
+        this->PowerUps.Add(static_cast<PowerUpType>(i % POWERUP_TYPE_COUNT), position);
+    }
+}
 
-// powerups
-bool IsOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type);
 
-void Game::UpdatePowerUps(float dt)
+// powerups: the effect of every type, switched on when a PowerUp is collected and off
+// when the last activated PowerUp of that type runs out (no function for one-off effects)
+struct PowerUpEffect
 {
-    for (PowerUp &powerUp : this->PowerUps)
-    {
-        powerUp.Position += powerUp.Velocity * dt;
-        if (powerUp.Activated)
-        {
-            powerUp.Duration -= dt;
+    void (*Activate)();
+    void (*Deactivate)();
+};
 
-            if (powerUp.Duration <= 0.0f)
-            {
-                // remove powerup from list (will later be removed)
-                powerUp.Activated = false;
-                // deactivate effects
-                if (powerUp.Type == "sticky")
-                {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "sticky"))
-                    {	// only reset if no other PowerUp of type sticky is active
-                        Ball->Sticky = false;
-                        Player->Color = glm::vec3(1.0f);
-                    }
-                }
-                else if (powerUp.Type == "pass-through")
-                {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "pass-through"))
-                    {	// only reset if no other PowerUp of type pass-through is active
-                        Ball->PassThrough = false;
-                        Ball->Color = glm::vec3(1.0f);
-                    }
-                }
-                else if (powerUp.Type == "confuse")
-                {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "confuse"))
-                    {	// only reset if no other PowerUp of type confuse is active
-                        Effects->Confuse = false;
-                    }
-                }
-                else if (powerUp.Type == "chaos")
-                {
-                    if (!IsOtherPowerUpActive(this->PowerUps, "chaos"))
-                    {	// only reset if no other PowerUp of type chaos is active
-                        Effects->Chaos = false;
-                    }
-                }
-            }
-        }
-    }
-    // Remove all PowerUps from vector that are destroyed AND !activated (thus either off the map or finished)
-    // Note we use a lambda expression to remove each PowerUp which is destroyed and not activated
-    this->PowerUps.erase(std::remove_if(this->PowerUps.begin(), this->PowerUps.end(),
-        [](const PowerUp &powerUp) { return powerUp.Destroyed && !powerUp.Activated; }
-    ), this->PowerUps.end());
+void ActivateSpeed()
+{
+    for (BallObject &ball : Balls)
+        ball.Velocity *= 1.2;
 }
 
-bool ShouldSpawn(unsigned int chance)
+void ActivateSticky()
 {
-    unsigned int random = rand() % chance;
-    return random == 0;
+    for (BallObject &ball : Balls)
+        ball.Sticky = true;
+    Player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
 }
-void Game::SpawnPowerUps(GameObject &block)
+
+void DeactivateSticky()
 {
-    if (ShouldSpawn(75)) // 1 in 75 chance
-        this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")));
-    if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetTexture("powerup_increase")));
-    if (ShouldSpawn(15)) // Negative powerups should spawn more often
-        this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")));
-    if (ShouldSpawn(15))
-        this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")));
+    for (BallObject &ball : Balls)
+        ball.Sticky = false;
+    Player->Color = glm::vec3(1.0f);
 }
 
-void ActivatePowerUp(PowerUp &powerUp)
+void ActivatePassThrough()
 {
-    if (powerUp.Type == "speed")
-    {
-        Ball->Velocity *= 1.2;
-    }
-    else if (powerUp.Type == "sticky")
-    {
-        Ball->Sticky = true;
-        Player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
-    }
-    else if (powerUp.Type == "pass-through")
-    {
-        Ball->PassThrough = true;
-        Ball->Color = glm::vec3(1.0f, 0.5f, 0.5f);
-    }
-    else if (powerUp.Type == "pad-size-increase")
+    for (BallObject &ball : Balls)
     {
-        Player->Size.x += 50;
+        ball.PassThrough = true;
+        ball.Color = glm::vec3(1.0f, 0.5f, 0.5f);
     }
-    else if (powerUp.Type == "confuse")
-    {
-        if (!Effects->Chaos)
-            Effects->Confuse = true; // only activate if chaos wasn't already active
-    }
-    else if (powerUp.Type == "chaos")
+}
+
+void DeactivatePassThrough()
+{
+    for (BallObject &ball : Balls)
     {
-        if (!Effects->Confuse)
-            Effects->Chaos = true;
+        ball.PassThrough = false;
+        ball.Color = glm::vec3(1.0f);
     }
 }
 
-bool IsOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type)
+void ActivatePadSizeIncrease()
 {
-    // Check if another PowerUp of the same type is still active
-    // in which case we don't disable its effect (yet)
-    for (const PowerUp &powerUp : powerUps)
+    Player->Size.x += 50;
+}
+
+void ActivateConfuse()
+{
+    if (!ChaosEffect)
+        ConfuseEffect = true; // only activate if chaos wasn't already active
+}
+
+void DeactivateConfuse()
+{
+    ConfuseEffect = false;
+}
+
+void ActivateChaos()
+{
+    if (!ConfuseEffect)
+        ChaosEffect = true;
+}
+
+void DeactivateChaos()
+{
+    ChaosEffect = false;
+}
+
+// indexed by PowerUpType
+const PowerUpEffect POWERUP_EFFECTS[POWERUP_TYPE_COUNT] = {
+    { ActivateSpeed,           nullptr },
+    { ActivateSticky,          DeactivateSticky },
+    { ActivatePassThrough,     DeactivatePassThrough },
+    { ActivatePadSizeIncrease, nullptr },
+    { ActivateConfuse,         DeactivateConfuse },
+    { ActivateChaos,           DeactivateChaos }
+};
+
+void Game::UpdatePowerUps(float dt)
+{
+    PowerUpStore &powerUps = this->PowerUps;
+    for (unsigned int i = 0; i < powerUps.Size(); ++i)
+        powerUps.Positions[i] += VELOCITY * dt;
+    for (unsigned int i = 0; i < powerUps.Size(); ++i)
     {
-        if (powerUp.Activated)
-            if (powerUp.Type == type)
-                return true;
+        if (!powerUps.Activated[i])
+            continue;
+        powerUps.Durations[i] -= dt;
+        if (powerUps.Durations[i] <= 0.0f)
+        {
+            // remove powerup from list (will later be removed)
+            powerUps.Activated[i] = false;
+            // deactivate effects, but only if no other PowerUp of the same type is still active
+            PowerUpType type = powerUps.Types[i];
+            if (--this->ActivePowerUps[type] == 0 && POWERUP_EFFECTS[type].Deactivate)
+                POWERUP_EFFECTS[type].Deactivate();
+        }
     }
-    return false;
+    powerUps.RemoveFinished();
 }
 
+bool ShouldSpawn(std::mt19937 &random, unsigned int chance)
+{
+    return random() % chance == 0;
+}
+void Game::SpawnPowerUps(glm::vec2 position)
+{
+    // every type rolls its own chance, in the order of POWERUP_INFO
+    for (unsigned int type = 0; type < POWERUP_TYPE_COUNT; ++type)
+        if (ShouldSpawn(this->Random, POWERUP_INFO[type].SpawnChance))
+            this->PowerUps.Add(static_cast<PowerUpType>(type), position);
+}
 
-// collision detection
-bool CheckCollision(GameObject &one, GameObject &two);
-Collision CheckCollision(BallObject &one, GameObject &two);
-Direction VectorDirection(glm::vec2 closest);
 
+// collision detection
 void Game::DoCollisions()
 {
-    for (GameObject &box : this->Levels[this->Level].Bricks)
+    for (BallObject &ball : Balls)
     {
-        if (!box.Destroyed)
+        GameLevel &level = this->Levels[this->Level];
+        CollideBall(ball, level, Candidates, [&](unsigned int brick, Collision collision)
         {
-            Collision collision = CheckCollision(*Ball, box);
-            if (std::get<0>(collision)) // if collision is true
+            bool solid = level.IsSolid(brick);
+            // destroy block if not solid
+            if (!solid)
+            {
+                level.Destroy(brick);
+                this->SpawnPowerUps(level.BrickPositions[brick]);
+                this->PlayAudio(BrickSound);
+            }
+            else
+            {   // if block is solid, enable shake effect
+                ShakeTime = 0.05f;
+                ShakeEffect = true;
+                this->PlayAudio(BrickSound);
+            }
+            // collision resolution
+            Direction dir = std::get<1>(collision);
+            glm::vec2 diff_vector = std::get<2>(collision);
+            if (!(ball.PassThrough && !solid)) // don't do collision resolution on non-solid bricks if pass-through is activated
             {
-                // destroy block if not solid
-                if (!box.IsSolid)
+                if (dir == LEFT || dir == RIGHT) // horizontal collision
                 {
-                    box.Destroyed = true;
-                    this->SpawnPowerUps(box);
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
-                }
-                else
-                {   // if block is solid, enable shake effect
-                    ShakeTime = 0.05f;
-                    Effects->Shake = true;
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
+                    ball.Velocity.x = -ball.Velocity.x; // reverse horizontal velocity
+                    // relocate
+                    float penetration = ball.Radius - std::abs(diff_vector.x);
+                    if (dir == LEFT)
+                        ball.Position.x += penetration; // move ball to right
+                    else
+                        ball.Position.x -= penetration; // move ball to left;
                 }
-                // collision resolution
-                Direction dir = std::get<1>(collision);
-                glm::vec2 diff_vector = std::get<2>(collision);
-                if (!(Ball->PassThrough && !box.IsSolid)) // don't do collision resolution on non-solid bricks if pass-through is activated
+                else // vertical collision
                 {
-                    if (dir == LEFT || dir == RIGHT) // horizontal collision
-                    {
-                        Ball->Velocity.x = -Ball->Velocity.x; // reverse horizontal velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.x);
-                        if (dir == LEFT)
-                            Ball->Position.x += penetration; // move ball to right
-                        else
-                            Ball->Position.x -= penetration; // move ball to left;
-                    }
-                    else // vertical collision
-                    {
-                        Ball->Velocity.y = -Ball->Velocity.y; // reverse vertical velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.y);
-                        if (dir == UP)
-                            Ball->Position.y -= penetration; // move ball bback up
-                        else
-                            Ball->Position.y += penetration; // move ball back down
-                    }
+                    ball.Velocity.y = -ball.Velocity.y; // reverse vertical velocity
+                    // relocate
+                    float penetration = ball.Radius - std::abs(diff_vector.y);
+                    if (dir == UP)
+                        ball.Position.y -= penetration; // move ball bback up
+                    else
+                        ball.Position.y += penetration; // move ball back down
                 }
             }
-        }    
+        });
     }
 
-    // also check collisions on PowerUps and if so, activate them
-    for (PowerUp &powerUp : this->PowerUps)
+    // also check collisions on PowerUps and if so, activate them; falling power-ups move every
+    // frame, so their grid is rebuilt and the paddle then only visits the cells it covers
+    std::vector<glm::vec4> bounds;
+    bounds.reserve(this->PowerUps.Size());
+    for (const glm::vec2 &position : this->PowerUps.Positions)
+        bounds.push_back(glm::vec4(position, position + POWERUP_SIZE));
+    PowerUpGrid.Build(glm::vec2(0.0f), POWERUP_SIZE, static_cast<unsigned int>(this->Width / POWERUP_SIZE.x) + 1, static_cast<unsigned int>(this->Height / POWERUP_SIZE.y) + 1, bounds);
+    PowerUpGrid.Query(Player->Position, Player->Position + Player->Size, Candidates);
+    for (unsigned int index : Candidates)
     {
-        if (!powerUp.Destroyed)
-        {
-            // first check if powerup passed bottom edge, if so: keep as inactive and destroy
-            if (powerUp.Position.y >= this->Height)
-                powerUp.Destroyed = true;
-
-            if (CheckCollision(*Player, powerUp))
-            {	// collided with player, now activate powerup
-                ActivatePowerUp(powerUp);
-                powerUp.Destroyed = true;
-                powerUp.Activated = true;
-                SoundEngine->play2D(FileSystem::getPath("resources/audio/powerup.wav").c_str(), false);
-            }
+        if (!this->PowerUps.Destroyed[index] && CheckCollision(*Player, this->PowerUps.Positions[index], POWERUP_SIZE))
+        {	// collided with player, now activate powerup
+            PowerUpType type = this->PowerUps.Types[index];
+            POWERUP_EFFECTS[type].Activate();
+            this->ActivePowerUps[type]++;
+            this->PowerUps.Destroyed[index] = true;
+            this->PowerUps.Activated[index] = true;
+            this->PlayAudio(PowerUpSound);
         }
     }
+    // check if powerups passed the bottom edge, if so: keep as inactive and destroy
+    for (unsigned int i = 0; i < this->PowerUps.Size(); ++i)
+        if (this->PowerUps.Positions[i].y >= this->Height)
+            this->PowerUps.Destroyed[i] = true;
 
     // and finally check collisions for player pad (unless stuck)
-    Collision result = CheckCollision(*Ball, *Player);
-    if (!Ball->Stuck && std::get<0>(result))
+    for (BallObject &ball : Balls)
     {
-        // check where it hit the board, and change velocity based on where it hit the board
-        float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
-        float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
-        float percentage = distance / (Player->Size.x / 2.0f);
-        // then move accordingly
-        float strength = 2.0f;
-        glm::vec2 oldVelocity = Ball->Velocity;
-        Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength; 
-        //Ball->Velocity.y = -Ball->Velocity.y;
-        Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity); // keep speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
-        // fix sticky paddle
-        Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
-
-        // if Sticky powerup is activated, also stick ball to paddle once new velocity vectors were calculated
-        Ball->Stuck = Ball->Sticky;
-
-        SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.wav").c_str(), false);
+        Collision result = CheckCollision(ball, *Player);
+        if (!ball.Stuck && std::get<0>(result))
+        {
+            // check where it hit the board, and change velocity based on where it hit the board
+            float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
+            float distance = (ball.Position.x + ball.Radius) - centerBoard;
+            float percentage = distance / (Player->Size.x / 2.0f);
+            // then move accordingly
+            float strength = 2.0f;
+            glm::vec2 oldVelocity = ball.Velocity;
+            ball.Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength; 
+            //ball.Velocity.y = -ball.Velocity.y;
+            ball.Velocity = glm::normalize(ball.Velocity) * glm::length(oldVelocity); // keep speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
+            // fix sticky paddle
+            ball.Velocity.y = -1.0f * abs(ball.Velocity.y);
+
+            // if Sticky powerup is activated, also stick ball to paddle once new velocity vectors were calculated
+            ball.Stuck = ball.Sticky;
+
+            this->PlayAudio(PaddleSound);
+        }
     }
 }
 
-bool CheckCollision(GameObject &one, GameObject &two) // AABB - AABB collision
+// FNV-1a over the raw bytes of each value, floats are hashed by their bit pattern
+void HashBytes(unsigned long long &hash, const void *data, size_t size)
 {
-    // collision x-axis?
-    bool collisionX = one.Position.x + one.Size.x >= two.Position.x &&
-        two.Position.x + two.Size.x >= one.Position.x;
-    // collision y-axis?
-    bool collisionY = one.Position.y + one.Size.y >= two.Position.y &&
-        two.Position.y + two.Size.y >= one.Position.y;
-    // collision only if on both axes
-    return collisionX && collisionY;
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
 }
 
-Collision CheckCollision(BallObject &one, GameObject &two) // AABB - Circle collision
+template <typename T>
+void HashValue(unsigned long long &hash, const T &value)
 {
-    // get center point circle first 
-    glm::vec2 center(one.Position + one.Radius);
-    // calculate AABB info (center, half-extents)
-    glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
-    glm::vec2 aabb_center(two.Position.x + aabb_half_extents.x, two.Position.y + aabb_half_extents.y);
-    // get difference vector between both centers
-    glm::vec2 difference = center - aabb_center;
-    glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
-    // now that we know the clamped values, add this to AABB_center and we get the value of box closest to circle
-    glm::vec2 closest = aabb_center + clamped;
-    // now retrieve vector between center circle and closest point AABB and check if length < radius
-    difference = closest - center;
-    
-    if (glm::length(difference) < one.Radius) // not <= since in that case a collision also occurs when object one exactly touches object two, which they are at the end of each collision resolution stage.
-        return std::make_tuple(true, VectorDirection(difference), difference);
-    else
-        return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
+    HashBytes(hash, &value, sizeof(T));
 }
 
-// calculates which direction a vector is facing (N,E,S or W)
-Direction VectorDirection(glm::vec2 target)
+unsigned long long Game::StateHash() const
 {
-    glm::vec2 compass[] = {
-        glm::vec2(0.0f, 1.0f),	// up
-        glm::vec2(1.0f, 0.0f),	// right
-        glm::vec2(0.0f, -1.0f),	// down
-        glm::vec2(-1.0f, 0.0f)	// left
-    };
-    float max = 0.0f;
-    unsigned int best_match = -1;
-    for (unsigned int i = 0; i < 4; i++)
+    unsigned long long hash = 14695981039346656037ull;
+    HashValue(hash, this->State);
+    HashValue(hash, this->Level);
+    HashValue(hash, this->Lives);
+    HashValue(hash, Player->Position);
+    HashValue(hash, Player->Size);
+    for (const BallObject &ball : Balls)
     {
-        float dot_product = glm::dot(glm::normalize(target), compass[i]);
-        if (dot_product > max)
-        {
-            max = dot_product;
-            best_match = i;
-        }
+        HashValue(hash, ball.Position);
+        HashValue(hash, ball.Velocity);
+        HashValue(hash, ball.Stuck);
+        HashValue(hash, ball.Sticky);
+        HashValue(hash, ball.PassThrough);
+    }
+    for (const GameLevel &level : this->Levels)
+        for (unsigned int brick = 0; brick < level.BrickCount(); ++brick)
+            HashValue(hash, level.IsDestroyed(brick));
+    for (unsigned int i = 0; i < this->PowerUps.Size(); ++i)
+    {
+        const char *name = POWERUP_INFO[this->PowerUps.Types[i]].Name;
+        HashBytes(hash, name, std::strlen(name));
+        HashValue(hash, this->PowerUps.Positions[i]);
+        HashValue(hash, this->PowerUps.Durations[i]);
+        HashValue(hash, this->PowerUps.Activated[i]);
+        HashValue(hash, this->PowerUps.Destroyed[i]);
     }
-    return (Direction)best_match;
+    HashValue(hash, ShakeEffect);
+    HashValue(hash, ConfuseEffect);
+    HashValue(hash, ChaosEffect);
+    HashValue(hash, ShakeTime);
+    return hash;
 }
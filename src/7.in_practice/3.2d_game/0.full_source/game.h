@@ -10,12 +10,16 @@
 #define GAME_H
 #include <vector>
 #include <tuple>
+#include <random>
+#include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "game_level.h"
 #include "power_up.h"
+#include "collision.h"
+#include "audio_system.h"
 
 // Represents the current state of the game
 enum GameState {
@@ -24,16 +28,10 @@ enum GameState {
     GAME_WIN
 };
 
-// Represents the four possible (collision) directions
-enum Direction {
-    UP,
-    RIGHT,
-    DOWN,
-    LEFT
-};
-// Defines a Collision typedef that represents collision data
-typedef std::tuple<bool, Direction, glm::vec2> Collision; // <collision?, what direction?, difference vector center - closest point>
-
+// Length of one simulation step in seconds; the game always advances in steps of this size
+const float FIXED_TIMESTEP = 1.0f / 120.0f;
+// Whether the small sprites (bricks, paddle, ball, powerups) are packed into one atlas texture
+const bool PACK_SPRITE_ATLAS = true;
 // Initial size of the player paddle
 const glm::vec2 PLAYER_SIZE(100.0f, 20.0f);
 // Initial velocity of the player paddle
@@ -42,6 +40,13 @@ const float PLAYER_VELOCITY(500.0f);
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 // Radius of the ball object
 const float BALL_RADIUS = 12.5f;
+// Index in Levels of the generated stress level, it follows the four regular levels
+const unsigned int STRESS_LEVEL = 4;
+// Dimensions (in bricks) of the generated stress level that follows the regular levels
+const unsigned int STRESS_LEVEL_COLUMNS = 250;
+const unsigned int STRESS_LEVEL_ROWS = 200;
+// Number of balls in play on the stress level
+const unsigned int STRESS_LEVEL_BALLS = 8;
 
 // Game holds all game-related state and functionality.
 // Combines all game-related data into a single class for
@@ -55,25 +60,41 @@ public:
     bool                    KeysProcessed[1024];
     unsigned int            Width, Height;
     std::vector<GameLevel>  Levels;
-    std::vector<PowerUp>    PowerUps;
+    PowerUpStore            PowerUps;
+    unsigned int            ActivePowerUps[POWERUP_TYPE_COUNT]; // activated PowerUps per type
     unsigned int            Level;
     unsigned int            Lives;
+    float                   Time;   // simulated seconds, advanced by Tick; drives the post-processing effects
+    std::mt19937            Random; // all gameplay randomness, seeded for reproducible runs
+    std::unique_ptr<AudioSystem> Audio; // null until InitAudio, so headless runs stay silent
     // constructor/destructor
-    Game(unsigned int width, unsigned int height);
+    Game(unsigned int width, unsigned int height, unsigned int seed = 5489u);
     ~Game();
     // initialize game state (load all shaders/textures/levels)
     void Init();
+    // initialize levels and game objects only; needs no GL context or audio device (headless runs)
+    void InitState();
+    // decode all sounds and start the music; the game takes ownership of the backend
+    void InitAudio(AudioBackend *backend);
+    // plays a sound effect, does nothing if InitAudio wasn't called
+    void PlayAudio(SoundHandle sound, bool loop = false);
     // game loop
+    void SetKey(int key, bool pressed);
+    void Tick(float dt); // one fixed step: ProcessInput followed by Update
     void ProcessInput(float dt);
     void Update(float dt);
-    void Render();
+    void Render(float alpha = 1.0f); // alpha: fraction of a step elapsed since the last Tick
     void DoCollisions();
+    // hash over all gameplay state, equal hashes mean identical runs
+    unsigned long long StateHash() const;
     // reset
     void ResetLevel();
     void ResetPlayer();
     // powerups
-    void SpawnPowerUps(GameObject &block);
+    void SpawnPowerUps(glm::vec2 position);
     void UpdatePowerUps(float dt);
+    // stress test: adds extra balls launched from the paddle and PowerUps falling all over the screen
+    void Stress(unsigned int balls, unsigned int powerUps);
 };
 
 #endif
\ No newline at end of file
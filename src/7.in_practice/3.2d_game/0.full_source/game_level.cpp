@@ -8,86 +8,293 @@
 ******************************************************************/
 #include "game_level.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+    // read-only view of a whole file, mapped into memory instead of copied
+    class MappedFile
+    {
+    public:
+        const unsigned char *Data;
+        size_t               Size;
+        MappedFile(const char *file) : Data(nullptr), Size(0)
+        {
+#ifdef _WIN32
+            this->file = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            this->mapping = nullptr;
+            LARGE_INTEGER size;
+            if (this->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->file, &size) || size.QuadPart == 0)
+                return;
+            this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (this->mapping)
+                this->Data = static_cast<const unsigned char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+            if (this->Data)
+                this->Size = static_cast<size_t>(size.QuadPart);
+#else
+            this->descriptor = open(file, O_RDONLY);
+            struct stat info;
+            if (this->descriptor < 0 || fstat(this->descriptor, &info) != 0 || info.st_size == 0)
+                return;
+            void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, this->descriptor, 0);
+            if (data == MAP_FAILED)
+                return;
+            this->Data = static_cast<const unsigned char*>(data);
+            this->Size = info.st_size;
+#endif
+        }
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (this->Data)
+                UnmapViewOfFile(this->Data);
+            if (this->mapping)
+                CloseHandle(this->mapping);
+            if (this->file != INVALID_HANDLE_VALUE)
+                CloseHandle(this->file);
+#else
+            if (this->Data)
+                munmap(const_cast<unsigned char*>(this->Data), this->Size);
+            if (this->descriptor >= 0)
+                close(this->descriptor);
+#endif
+        }
+    private:
+#ifdef _WIN32
+        HANDLE file, mapping;
+#else
+        int    descriptor;
+#endif
+    };
+
+    const char         BINARY_LEVEL_MAGIC[4] = { 'B', 'K', 'L', 'V' };
+    const unsigned int BINARY_LEVEL_VERSION  = 1;
+    const size_t       BINARY_LEVEL_HEADER   = 16;
+
+    uint32_t readU32(const unsigned char *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    // parses a text level: a row per line, tile codes separated by whitespace; lines without
+    // tiles are skipped and short rows are padded with empty tiles
+    bool parseText(const unsigned char *data, size_t size, std::vector<unsigned char> &tiles, unsigned int &columns, unsigned int &rows)
+    {
+        std::vector<unsigned int> rowEnds; // end of every row in tiles
+        size_t rowStart = 0;
+        for (size_t i = 0; i <= size; )
+        {
+            if (i == size || data[i] == '\n')
+            {
+                if (tiles.size() > rowStart)
+                {
+                    rowEnds.push_back(static_cast<unsigned int>(tiles.size()));
+                    rowStart = tiles.size();
+                }
+                ++i;
+            }
+            else if (data[i] >= '0' && data[i] <= '9')
+            {
+                unsigned int code = 0;
+                for (; i < size && data[i] >= '0' && data[i] <= '9'; ++i)
+                    code = std::min(code * 10 + (data[i] - '0'), 255u);
+                tiles.push_back(static_cast<unsigned char>(code));
+            }
+            else if (data[i] == ' ' || data[i] == '\t' || data[i] == '\r')
+                ++i;
+            else
+                return false;
+        }
+        if (rowEnds.empty())
+            return false;
+        // the first row sets the level width
+        columns = rowEnds[0];
+        rows = static_cast<unsigned int>(rowEnds.size());
+        std::vector<unsigned char> grid(static_cast<size_t>(columns) * rows, 0);
+        for (unsigned int y = 0, start = 0; y < rows; start = rowEnds[y++])
+            std::copy(tiles.begin() + start, tiles.begin() + std::min(rowEnds[y], start + columns), grid.begin() + static_cast<size_t>(y) * columns);
+        tiles.swap(grid);
+        return true;
+    }
+}
 
 
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
 {
     // clear old data
-    this->Bricks.clear();
+    this->BrickPositions.clear();
+    this->BrickColors.clear();
+    this->solid.clear();
+    this->destroyed.clear();
+    this->remaining = 0;
+    this->Grid.Clear();
     // load from file
-    unsigned int tileCode;
-    GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
-    std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
+    MappedFile level(file);
+    if (!level.Data)
+        return;
+    if (level.Size >= BINARY_LEVEL_HEADER && std::memcmp(level.Data, BINARY_LEVEL_MAGIC, 4) == 0)
     {
-        while (std::getline(fstream, line)) // read each line from level file
+        // binary level, the tiles are used straight from the mapping
+        unsigned int columns = readU32(level.Data + 8), rows = readU32(level.Data + 12);
+        if (readU32(level.Data + 4) == BINARY_LEVEL_VERSION && columns > 0 && rows > 0
+            && (level.Size - BINARY_LEVEL_HEADER) / columns >= rows)
+            this->init(level.Data + BINARY_LEVEL_HEADER, columns, rows, levelWidth, levelHeight);
+    }
+    else
+    {
+        std::vector<unsigned char> tiles;
+        unsigned int columns, rows;
+        if (parseText(level.Data, level.Size, tiles, columns, rows))
+            this->init(tiles.data(), columns, rows, levelWidth, levelHeight);
+    }
+}
+
+void GameLevel::Generate(unsigned int columns, unsigned int rows, unsigned int levelWidth, unsigned int levelHeight)
+{
+    // clear old data
+    this->BrickPositions.clear();
+    this->BrickColors.clear();
+    this->solid.clear();
+    this->destroyed.clear();
+    this->remaining = 0;
+    this->Grid.Clear();
+    if (rows > 0 && columns > 0)
+        this->init(GenerateTiles(columns, rows).data(), columns, rows, levelWidth, levelHeight);
+}
+
+std::vector<unsigned char> GameLevel::GenerateTiles(unsigned int columns, unsigned int rows)
+{
+    // fill every tile: colored bricks in horizontal bands, sprinkled with solid blocks
+    std::vector<unsigned char> tiles(static_cast<size_t>(columns) * rows);
+    for (unsigned int y = 0; y < rows; ++y)
+        for (unsigned int x = 0; x < columns; ++x)
+            tiles[static_cast<size_t>(y) * columns + x] = (x % 11 == 5 && y % 7 == 3) ? 1 : 2 + (y / 4) % 4;
+    return tiles;
+}
+
+bool GameLevel::SaveBinary(const char *file, const std::vector<unsigned char> &tiles, unsigned int columns, unsigned int rows)
+{
+    if (tiles.size() != static_cast<size_t>(columns) * rows)
+        return false;
+    std::ofstream stream(file, std::ios::binary);
+    if (!stream)
+        return false;
+    unsigned char header[BINARY_LEVEL_HEADER];
+    std::memcpy(header, BINARY_LEVEL_MAGIC, 4);
+    const uint32_t values[3] = { BINARY_LEVEL_VERSION, columns, rows };
+    for (unsigned int i = 0; i < 3; ++i)
+        for (unsigned int b = 0; b < 4; ++b)
+            header[4 + i * 4 + b] = static_cast<unsigned char>(values[i] >> (b * 8));
+    stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(tiles.data()), tiles.size());
+    return static_cast<bool>(stream);
+}
+
+void GameLevel::Draw(SpriteRenderer &renderer)
+{
+    const TextureRegion &block = ResourceManager::GetTexture(this->blockTexture);
+    const TextureRegion &solidBlock = ResourceManager::GetTexture(this->solidTexture);
+    // visit the bricks still standing 64 at a time
+    for (unsigned int word = 0; word < this->destroyed.size(); ++word)
+    {
+        uint64_t standing = ~this->destroyed[word];
+        while (standing)
         {
-            std::istringstream sstream(line);
-            std::vector<unsigned int> row;
-            while (sstream >> tileCode) // read each word separated by spaces
-                row.push_back(tileCode);
-            tileData.push_back(row);
+            unsigned int bit = 0;
+            while (!((standing >> bit) & 1))
+                ++bit;
+            standing &= standing - 1;
+            unsigned int brick = word * 64 + bit;
+            if (brick >= this->BrickPositions.size())
+                break;
+            const TextureRegion &sprite = this->IsSolid(brick) ? solidBlock : block;
+            renderer.DrawSprite(sprite.Texture, this->BrickPositions[brick], this->BrickSize, 0.0f, this->BrickColors[brick], sprite.TexRect);
         }
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
     }
 }
 
-void GameLevel::Draw(SpriteRenderer &renderer)
+void GameLevel::Destroy(unsigned int brick)
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.Destroyed)
-            tile.Draw(renderer);
+    if (this->IsSolid(brick) || this->IsDestroyed(brick))
+        return;
+    this->destroyed[brick / 64] |= uint64_t(1) << (brick % 64);
+    this->remaining--;
 }
 
-bool GameLevel::IsCompleted()
+void GameLevel::Reset()
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.IsSolid && !tile.Destroyed)
-            return false;
-    return true;
+    std::fill(this->destroyed.begin(), this->destroyed.end(), 0);
+    this->remaining = 0;
+    for (unsigned int brick = 0; brick < this->BrickPositions.size(); ++brick)
+        this->remaining += this->IsSolid(brick) ? 0 : 1;
 }
 
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::init(const unsigned char *tiles, unsigned int columns, unsigned int rows, unsigned int levelWidth, unsigned int levelHeight)
 {
     // calculate dimensions
-    unsigned int height = tileData.size();
-    unsigned int width = tileData[0].size(); // note we can index vector at [0] since this function is only called if height > 0
-    float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / height; 
-    // initialize level tiles based on tileData		
-    for (unsigned int y = 0; y < height; ++y)
+    float unit_width = levelWidth / static_cast<float>(columns), unit_height = levelHeight / static_cast<float>(rows);
+    this->BrickSize = glm::vec2(unit_width, unit_height);
+    // resolve the textures once, not per brick
+    this->solidTexture = ResourceManager::FindTexture("block_solid");
+    this->blockTexture = ResourceManager::FindTexture("block");
+    size_t tileCount = static_cast<size_t>(columns) * rows;
+    size_t brickCount = tileCount - std::count(tiles, tiles + tileCount, 0);
+    this->BrickPositions.reserve(brickCount);
+    this->BrickColors.reserve(brickCount);
+    // initialize level tiles based on the tile codes
+    for (unsigned int y = 0; y < rows; ++y)
     {
-        for (unsigned int x = 0; x < width; ++x)
+        for (unsigned int x = 0; x < columns; ++x)
         {
             // check block type from level data (2D level array)
-            if (tileData[y][x] == 1) // solid
+            unsigned char tile = tiles[static_cast<size_t>(y) * columns + x];
+            if (tile == 0)
+                continue;
+            unsigned int brick = static_cast<unsigned int>(this->BrickPositions.size());
+            if (brick % 64 == 0)
+            {
+                this->solid.push_back(0);
+                this->destroyed.push_back(0);
+            }
+            glm::vec3 color = glm::vec3(1.0f); // original: white
+            if (tile == 1) // solid
             {
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
-                obj.IsSolid = true;
-                this->Bricks.push_back(obj);
+                color = glm::vec3(0.8f, 0.8f, 0.7f);
+                this->solid.back() |= uint64_t(1) << (brick % 64);
             }
-            else if (tileData[y][x] > 1)	// non-solid; now determine its color based on level data
+            else	// non-solid; now determine its color based on level data
             {
-                glm::vec3 color = glm::vec3(1.0f); // original: white
-                if (tileData[y][x] == 2)
+                if (tile == 2)
                     color = glm::vec3(0.2f, 0.6f, 1.0f);
-                else if (tileData[y][x] == 3)
+                else if (tile == 3)
                     color = glm::vec3(0.0f, 0.7f, 0.0f);
-                else if (tileData[y][x] == 4)
+                else if (tile == 4)
                     color = glm::vec3(0.8f, 0.8f, 0.4f);
-                else if (tileData[y][x] == 5)
+                else if (tile == 5)
                     color = glm::vec3(1.0f, 0.5f, 0.0f);
-
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
+                this->remaining++;
             }
+            this->BrickPositions.push_back(glm::vec2(unit_width * x, unit_height * y));
+            this->BrickColors.push_back(color);
         }
     }
-}
\ No newline at end of file
+    // index the bricks by tile so collision queries only visit the tiles around an object
+    std::vector<glm::vec4> bounds;
+    bounds.reserve(this->BrickPositions.size());
+    for (const glm::vec2 &position : this->BrickPositions)
+        bounds.push_back(glm::vec4(position, position + this->BrickSize));
+    this->Grid.Build(glm::vec2(0.0f), this->BrickSize, columns, rows, bounds);
+}
@@ -8,6 +8,7 @@
 ******************************************************************/
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
+#include <cstdint>
 #include <vector>
 
 #include <glad/glad.h>
@@ -16,26 +17,53 @@
 #include "game_object.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
+#include "spatial_grid.h"
 
 
 /// GameLevel holds all Tiles as part of a Breakout level and 
 /// hosts functionality to Load/render levels from the harddisk.
+/// Bricks are stored as parallel arrays indexed by brick number, with
+/// their solid and destroyed flags packed into bitsets, so the loops over
+/// all bricks (drawing, collision, hashing) only touch the data they use.
 class GameLevel
 {
 public:
-    // level state
-    std::vector<GameObject> Bricks;
+    // level state, one entry per brick
+    std::vector<glm::vec2>  BrickPositions;
+    std::vector<glm::vec3>  BrickColors;
+    glm::vec2               BrickSize; // every brick covers exactly one tile
+    // broadphase index from level tile to brick, one cell per tile
+    SpatialGrid             Grid;
     // constructor
-    GameLevel() { }
-    // loads level from file
+    GameLevel() : BrickSize(0.0f), remaining(0), blockTexture(INVALID_TEXTURE), solidTexture(INVALID_TEXTURE) { }
+    // loads level from file, either a text .lvl (rows of space separated tile codes) or a binary level (see SaveBinary)
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
+    // generates a columns x rows level (used as a rendering/collision stress test)
+    void Generate(unsigned int columns, unsigned int rows, unsigned int levelWidth, unsigned int levelHeight);
+    // tile codes of the level Generate builds, row by row
+    static std::vector<unsigned char> GenerateTiles(unsigned int columns, unsigned int rows);
+    // writes row by row tile codes as a binary level: "BKLV", version, columns and rows as 32 bit little endian, then a byte per tile
+    static bool SaveBinary(const char *file, const std::vector<unsigned char> &tiles, unsigned int columns, unsigned int rows);
     // render level
     void Draw(SpriteRenderer &renderer);
+    // brick state
+    unsigned int BrickCount() const { return static_cast<unsigned int>(this->BrickPositions.size()); }
+    bool IsSolid(unsigned int brick) const { return (this->solid[brick / 64] >> (brick % 64)) & 1; }
+    bool IsDestroyed(unsigned int brick) const { return (this->destroyed[brick / 64] >> (brick % 64)) & 1; }
+    // destroys a non-solid brick, solid bricks can't be destroyed
+    void Destroy(unsigned int brick);
+    // restores all destroyed bricks
+    void Reset();
     // check if the level is completed (all non-solid tiles are destroyed)
-    bool IsCompleted();
+    bool IsCompleted() const { return this->remaining == 0; }
 private:
-    // initialize level from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    // one bit per brick
+    std::vector<uint64_t> solid, destroyed;
+    // non-solid bricks that are not destroyed yet
+    unsigned int          remaining;
+    TextureHandle         blockTexture, solidTexture;
+    // initialize level from columns x rows tile codes, stored row by row
+    void init(const unsigned char *tiles, unsigned int columns, unsigned int rows, unsigned int levelWidth, unsigned int levelHeight);
 };
 
 #endif
\ No newline at end of file
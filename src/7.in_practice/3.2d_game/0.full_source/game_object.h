@@ -14,6 +14,7 @@
 
 #include "texture.h"
 #include "sprite_renderer.h"
+#include "resource_manager.h"
 
 
 // Container object for holding all state relevant for a single
@@ -24,17 +25,18 @@ class GameObject
 public:
     // object state
     glm::vec2   Position, Size, Velocity;
+    glm::vec2   PreviousPosition; // position at the start of the current simulation step, for render interpolation
     glm::vec3   Color;
     float       Rotation;
     bool        IsSolid;
     bool        Destroyed;
     // render state
-    Texture2D   Sprite;	
+    TextureHandle Sprite;
     // constructor(s)
     GameObject();
-    GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
-    // draw sprite
-    virtual void Draw(SpriteRenderer &renderer);
+    GameObject(glm::vec2 pos, glm::vec2 size, TextureHandle sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
+    // draw sprite, alpha interpolates between the previous and the current position
+    virtual void Draw(SpriteRenderer &renderer, float alpha = 1.0f);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "gpu_particle_generator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// compute stages in particle.cs
+enum ParticleStage {
+    PARTICLE_STAGE_PREPARE,
+    PARTICLE_STAGE_EMIT,
+    PARTICLE_STAGE_SIMULATE,
+    PARTICLE_STAGE_FINISH
+};
+
+// layout of the counter buffer, must match the Counters block in particle.cs
+struct ParticleCounters {
+    unsigned int DrawCommand[4];    // DrawArraysIndirectCommand: count, instanceCount, first, baseInstance
+    unsigned int EmitGroups[3];     // glDispatchComputeIndirect arguments of the emit stage
+    unsigned int SimulateGroups[3]; // glDispatchComputeIndirect arguments of the simulate stage
+    unsigned int AliveCount[2];
+    unsigned int DeadCount;
+    unsigned int EmitCount;
+    unsigned int EmitIndex;         // spawn index of the first particle emitted this frame
+    unsigned int Spawned;
+};
+
+// must match local_size_x in particle.cs
+const unsigned int PARTICLE_GROUP_SIZE = 64;
+
+
+GpuParticleGenerator::GpuParticleGenerator(Shader compute, Shader shader, Texture2D texture, unsigned int amount, unsigned int seed)
+    : amount(amount), seed(ParticleHash(seed)), current(0), compute(compute), shader(shader), texture(texture)
+{
+    this->init();
+}
+
+GpuParticleGenerator::~GpuParticleGenerator()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->particleBuffer);
+    glDeleteBuffers(1, &this->aliveBuffer);
+    glDeleteBuffers(1, &this->deadBuffer);
+    glDeleteBuffers(1, &this->counterBuffer);
+}
+
+bool GpuParticleGenerator::Supported()
+{
+    if (!GLAD_GL_VERSION_4_3)
+        return false;
+    // particle_gpu.vs reads the particle and alive list buffers
+    int vertexBlocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexBlocks);
+    return vertexBlocks >= 2;
+}
+
+void GpuParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
+{
+    // the compute program may be shared between generators, so set everything every update
+    this->compute.Use();
+    this->compute.SetUnsigned("capacity", this->amount);
+    this->compute.SetUnsigned("seed", this->seed);
+    this->compute.SetFloat("particleLife", PARTICLE_LIFE);
+    this->compute.SetFloat("particleFade", PARTICLE_FADE);
+    this->compute.SetFloat("dt", dt);
+    this->compute.SetUnsigned("current", this->current);
+    this->compute.SetUnsigned("emitRequested", newParticles);
+    this->compute.SetVector2f("emitPosition", object.Position + offset);
+    this->compute.SetVector2f("emitVelocity", object.Velocity * 0.1f);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->aliveBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->deadBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->counterBuffer);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, this->counterBuffer);
+    // clamp emission to the free slots and size the following dispatches
+    this->compute.SetUnsigned("stage", PARTICLE_STAGE_PREPARE);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    // pop free slots from the dead list and append them to the alive list
+    this->compute.SetUnsigned("stage", PARTICLE_STAGE_EMIT);
+    glDispatchComputeIndirect(offsetof(ParticleCounters, EmitGroups));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    // integrate, survivors go to the other alive list and the rest back to the dead list
+    this->compute.SetUnsigned("stage", PARTICLE_STAGE_SIMULATE);
+    glDispatchComputeIndirect(offsetof(ParticleCounters, SimulateGroups));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    // publish the survivor count as the instance count of the indirect draw
+    this->compute.SetUnsigned("stage", PARTICLE_STAGE_FINISH);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    this->current = 1 - this->current;
+}
+
+// render all particles
+void GpuParticleGenerator::Draw()
+{
+    // use additive blending to give it a 'glow' effect
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    this->shader.Use();
+    this->shader.SetUnsigned("aliveOffset", this->current * this->amount);
+    glActiveTexture(GL_TEXTURE0);
+    this->texture.Bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->aliveBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->counterBuffer);
+    glBindVertexArray(this->VAO);
+    glDrawArraysIndirect(GL_TRIANGLES, (void*)offsetof(ParticleCounters, DrawCommand));
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    // don't forget to reset to default blending mode
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+unsigned int GpuParticleGenerator::AliveCount() const
+{
+    unsigned int alive = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(ParticleCounters, DrawCommand) + sizeof(unsigned int), sizeof(unsigned int), &alive);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return alive;
+}
+
+void GpuParticleGenerator::ReadBack(ParticleStore &store) const
+{
+    unsigned int alive = this->AliveCount();
+    std::vector<unsigned int> slots(alive);
+    std::vector<GpuParticle> particles(this->amount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->aliveBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, this->current * this->amount * sizeof(unsigned int), alive * sizeof(unsigned int), slots.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->particleBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->amount * sizeof(GpuParticle), particles.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    store.Alive = std::min(alive, store.Capacity());
+    for (unsigned int i = 0; i < store.Alive; ++i)
+    {
+        const GpuParticle &p = particles[slots[i]];
+        store.PositionX[i] = p.Position.x;
+        store.PositionY[i] = p.Position.y;
+        store.VelocityX[i] = p.Velocity.x;
+        store.VelocityY[i] = p.Velocity.y;
+        store.ColorR[i] = p.Color.r;
+        store.ColorG[i] = p.Color.g;
+        store.ColorB[i] = p.Color.b;
+        store.ColorA[i] = p.Color.a;
+        store.Life[i] = p.Life;
+    }
+}
+
+void GpuParticleGenerator::init()
+{
+    // set up mesh and attribute properties
+    float particle_quad[] = {
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f
+    };
+    glGenVertexArrays(1, &this->VAO);
+    glGenBuffers(1, &this->quadVBO);
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    // particle storage, contents only matter once a slot has been emitted
+    glGenBuffers(1, &this->particleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->particleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, this->amount * sizeof(GpuParticle), NULL, GL_DYNAMIC_DRAW);
+    // two alive lists, ping-ponged every update
+    glGenBuffers(1, &this->aliveBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->aliveBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * this->amount * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+    // every slot starts out on the dead list
+    std::vector<unsigned int> dead(this->amount);
+    for (unsigned int i = 0; i < this->amount; ++i)
+        dead[i] = this->amount - 1 - i;
+    glGenBuffers(1, &this->deadBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->deadBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, this->amount * sizeof(unsigned int), dead.data(), GL_DYNAMIC_DRAW);
+    ParticleCounters counters = { };
+    counters.DrawCommand[0] = 6;
+    counters.EmitGroups[1] = counters.EmitGroups[2] = 1;
+    counters.SimulateGroups[1] = counters.SimulateGroups[2] = 1;
+    counters.DeadCount = this->amount;
+    glGenBuffers(1, &this->counterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ParticleCounters), &counters, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,70 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GPU_PARTICLE_GENERATOR_H
+#define GPU_PARTICLE_GENERATOR_H
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "texture.h"
+#include "game_object.h"
+#include "particle_generator.h"
+
+
+// Particle state as laid out in the particle storage buffer (std430),
+// must match struct Particle in particle.cs and particle_gpu.vs.
+struct GpuParticle {
+    glm::vec2 Position, Velocity;
+    glm::vec4 Color;
+    float     Life;
+    float     Padding[3];
+};
+
+
+// GpuParticleGenerator is a drop-in alternative to ParticleGenerator
+// that keeps all particle state in shader storage buffers. Emitting,
+// integrating and killing particles happens in compute passes that
+// maintain an alive list and a dead (free) list with atomic counters;
+// drawing is a single indirect instanced draw whose instance count is
+// written by the GPU, so the CPU never touches individual particles.
+// Requires OpenGL 4.3.
+class GpuParticleGenerator : public ParticleEmitter
+{
+public:
+    // constructor
+    GpuParticleGenerator(Shader compute, Shader shader, Texture2D texture, unsigned int amount, unsigned int seed = 0x9E3779B9u);
+    // destructor
+    ~GpuParticleGenerator();
+    // true if the current context can run this backend
+    static bool Supported();
+    // update all particles
+    void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f)) override;
+    // render all particles
+    void Draw() override;
+    // number of particles currently alive; reads back from the GPU, so it stalls the pipeline
+    unsigned int AliveCount() const override;
+    // copies the alive particles into store (in unspecified order); for validation only
+    void ReadBack(ParticleStore &store) const;
+private:
+    // state
+    unsigned int amount;
+    unsigned int seed;
+    unsigned int current; // which of the two alive lists holds this frame's particles
+    // render state
+    Shader compute;
+    Shader shader;
+    Texture2D texture;
+    unsigned int VAO;
+    unsigned int quadVBO;
+    unsigned int particleBuffer, aliveBuffer, deadBuffer, counterBuffer;
+    // initializes buffers and vertex attributes
+    void init();
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <string>
+
+#include <irrklang/irrKlang.h>
+
+#include "irrklang_audio_backend.h"
+
+using namespace irrklang;
+
+
+IrrKlangAudioBackend::IrrKlangAudioBackend()
+    : engine(createIrrKlangDevice())
+{
+
+}
+
+IrrKlangAudioBackend::~IrrKlangAudioBackend()
+{
+    for (unsigned int i = 0; i < this->voices.size(); ++i)
+        this->Stop(i);
+    if (this->engine)
+        this->engine->drop();
+}
+
+bool IrrKlangAudioBackend::Decode(const std::string &file, SoundBuffer &buffer)
+{
+    if (!this->engine)
+        return false;
+    // not preloaded: nothing is read before the streaming threshold is lifted below
+    ISoundSource *source = this->engine->addSoundSourceFromFile(file.c_str(), ESM_NO_STREAMING, false);
+    if (!source)
+        return false;
+    // files over the threshold (about 1 MB decoded) would be streamed despite ESM_NO_STREAMING and
+    // have no sample data; disable it and drop anything loaded so far, so the samples are decoded
+    // whole by getSampleData()
+    source->setForcedStreamingThreshold(0);
+    source->forceReloadAtNextUse();
+    const void *data = source->getSampleData();
+    SAudioStreamFormat format = source->getAudioFormat();
+    bool decoded = data && format.ChannelCount > 0 && format.FrameCount > 0;
+    if (decoded)
+    {
+        buffer.Channels = format.ChannelCount;
+        buffer.SampleRate = format.SampleRate;
+        buffer.Samples.resize(static_cast<size_t>(format.FrameCount) * format.ChannelCount);
+        for (size_t i = 0; i < buffer.Samples.size(); ++i)
+        {
+            if (format.SampleFormat == ESF_S16)
+                buffer.Samples[i] = static_cast<const short*>(data)[i];
+            else
+                buffer.Samples[i] = static_cast<short>((static_cast<const unsigned char*>(data)[i] - 128) * 256);
+        }
+    }
+    this->engine->removeSoundSource(source);
+    return decoded;
+}
+
+void IrrKlangAudioBackend::Upload(SoundHandle sound, const SoundBuffer &buffer)
+{
+    if (sound >= this->sources.size())
+        this->sources.resize(sound + 1, nullptr);
+    if (!this->engine || buffer.Frames() == 0)
+        return;
+    SAudioStreamFormat format;
+    format.ChannelCount = buffer.Channels;
+    format.FrameCount = buffer.Frames();
+    format.SampleRate = buffer.SampleRate;
+    format.SampleFormat = ESF_S16;
+    std::string name = "breakout_sound_" + std::to_string(sound);
+    this->sources[sound] = this->engine->addSoundSourceFromPCMData(const_cast<short*>(buffer.Samples.data()),
+        format.getSampleDataSize(), name.c_str(), format, true);
+}
+
+void IrrKlangAudioBackend::Start(unsigned int voice, SoundHandle sound, bool loop)
+{
+    if (voice >= this->voices.size())
+        this->voices.resize(voice + 1, nullptr);
+    this->Stop(voice);
+    if (this->engine && sound < this->sources.size() && this->sources[sound])
+        this->voices[voice] = this->engine->play2D(this->sources[sound], loop, false, true);
+}
+
+void IrrKlangAudioBackend::Stop(unsigned int voice)
+{
+    if (voice < this->voices.size() && this->voices[voice])
+    {
+        this->voices[voice]->stop();
+        this->voices[voice]->drop();
+        this->voices[voice] = nullptr;
+    }
+}
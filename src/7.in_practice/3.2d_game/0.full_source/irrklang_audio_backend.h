@@ -0,0 +1,45 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef IRRKLANG_AUDIO_BACKEND_H
+#define IRRKLANG_AUDIO_BACKEND_H
+
+#include <vector>
+
+#include "audio_system.h"
+
+namespace irrklang {
+    class ISoundEngine;
+    class ISoundSource;
+    class ISound;
+}
+
+
+// Plays the AudioSystem's voices on the default audio device through
+// irrKlang. Sounds are handed to irrKlang already decoded, so starting
+// a voice never touches the disk. irrKlang also decodes the formats the
+// AudioSystem can't (mp3, ogg). Without an audio device every call is
+// a no-op.
+class IrrKlangAudioBackend : public AudioBackend
+{
+public:
+    // constructor/destructor
+    IrrKlangAudioBackend();
+    ~IrrKlangAudioBackend();
+    // AudioBackend
+    bool Decode(const std::string &file, SoundBuffer &buffer) override;
+    void Upload(SoundHandle sound, const SoundBuffer &buffer) override;
+    void Start(unsigned int voice, SoundHandle sound, bool loop) override;
+    void Stop(unsigned int voice) override;
+private:
+    irrklang::ISoundEngine              *engine;
+    std::vector<irrklang::ISoundSource*> sources; // per SoundHandle
+    std::vector<irrklang::ISound*>       voices;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#version 430 core
+// GPU particle simulation, see gpu_particle_generator.cpp. One program runs
+// all four stages of an update, selected by the 'stage' uniform.
+layout (local_size_x = 64) in;
+
+#define STAGE_PREPARE  0u
+#define STAGE_EMIT     1u
+#define STAGE_SIMULATE 2u
+#define STAGE_FINISH   3u
+
+struct Particle {
+    vec2 position;
+    vec2 velocity;
+    vec4 color;
+    float life;
+};
+
+layout (std430, binding = 0) buffer Particles {
+    Particle particles[];
+};
+// two alive lists of 'capacity' entries each
+layout (std430, binding = 1) buffer AliveList {
+    uint alive[];
+};
+layout (std430, binding = 2) buffer DeadList {
+    uint dead[];
+};
+// must match ParticleCounters in gpu_particle_generator.cpp
+layout (std430, binding = 3) buffer Counters {
+    uint drawCount, drawInstanceCount, drawFirst, drawBaseInstance;
+    uint emitGroupsX, emitGroupsY, emitGroupsZ;
+    uint simulateGroupsX, simulateGroupsY, simulateGroupsZ;
+    uint aliveCount[2];
+    uint deadCount;
+    uint emitCount;
+    uint emitIndex;
+    uint spawned;
+};
+
+uniform uint stage;
+uniform uint capacity;
+uniform uint current;
+uniform uint seed;
+uniform uint emitRequested;
+uniform vec2 emitPosition;
+uniform vec2 emitVelocity;
+uniform float dt;
+uniform float particleLife;
+uniform float particleFade;
+
+// must match ParticleHash in particle_generator.h
+uint particleHash(uint value)
+{
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    uint next = 1u - current;
+    if (stage == STAGE_PREPARE)
+    {
+        if (id != 0u)
+            return;
+        // emission is clamped to the free slots, the rest is dropped like on the CPU
+        emitCount = min(emitRequested, deadCount);
+        deadCount -= emitCount;
+        emitIndex = spawned;
+        spawned += emitCount;
+        aliveCount[next] = 0u;
+        emitGroupsX = (emitCount + 63u) / 64u;
+        simulateGroupsX = (aliveCount[current] + emitCount + 63u) / 64u;
+    }
+    else if (stage == STAGE_EMIT)
+    {
+        if (id >= emitCount)
+            return;
+        // popped slots sit right above the dead count lowered in the prepare stage
+        uint slot = dead[deadCount + id];
+        // same derivation as ParticleStore::Spawn
+        uint h0 = particleHash(seed ^ (emitIndex + id));
+        uint h1 = particleHash(h0);
+        precise float offset = float(int(h0 % 100u) - 50) * 0.1;
+        precise vec2 position = emitPosition + offset;
+        float rColor = 0.5 + float(h1 >> 8u) * (1.0 / 16777216.0);
+        particles[slot].position = position;
+        particles[slot].velocity = emitVelocity;
+        particles[slot].color = vec4(rColor, rColor, rColor, 1.0);
+        particles[slot].life = particleLife;
+        alive[current * capacity + atomicAdd(aliveCount[current], 1u)] = slot;
+    }
+    else if (stage == STAGE_SIMULATE)
+    {
+        if (id >= aliveCount[current])
+            return;
+        uint slot = alive[current * capacity + id];
+        Particle p = particles[slot];
+        // 'precise' keeps the compiler from fusing into FMAs, so results match the SSE path
+        precise float fade = dt * particleFade;
+        precise float life = p.life - dt;
+        precise vec2 position = p.position - p.velocity * dt;
+        precise float alpha = p.color.a - fade;
+        particles[slot].life = life;
+        particles[slot].position = position;
+        particles[slot].color.a = alpha;
+        if (life > 0.0)
+            alive[next * capacity + atomicAdd(aliveCount[next], 1u)] = slot;
+        else
+            dead[atomicAdd(deadCount, 1u)] = slot;
+    }
+    else if (stage == STAGE_FINISH)
+    {
+        if (id == 0u)
+            drawInstanceCount = aliveCount[next];
+    }
+}
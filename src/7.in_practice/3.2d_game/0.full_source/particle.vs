@@ -1,17 +1,22 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+// per-instance particle state, one float stream per attribute (see ParticleGenerator::init)
+layout (location = 1) in float offsetX;
+layout (location = 2) in float offsetY;
+layout (location = 3) in float colorR;
+layout (location = 4) in float colorG;
+layout (location = 5) in float colorB;
+layout (location = 6) in float colorA;
 
 out vec2 TexCoords;
 out vec4 ParticleColor;
 
 uniform mat4 projection;
-uniform vec2 offset;
-uniform vec4 color;
 
 void main()
 {
     float scale = 10.0f;
     TexCoords = vertex.zw;
-    ParticleColor = color;
-    gl_Position = projection * vec4((vertex.xy * scale) + offset, 0.0, 1.0);
-}
\ No newline at end of file
+    ParticleColor = vec4(colorR, colorG, colorB, colorA);
+    gl_Position = projection * vec4((vertex.xy * scale) + vec2(offsetX, offsetY), 0.0, 1.0);
+}
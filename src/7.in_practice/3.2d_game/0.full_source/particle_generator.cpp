@@ -8,51 +8,138 @@
 ******************************************************************/
 #include "particle_generator.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : shader(shader), texture(texture), amount(amount)
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_USE_SSE 1
+#endif
+
+
+ParticleStore::ParticleStore(unsigned int capacity, unsigned int seed)
+    : PositionX(capacity), PositionY(capacity), VelocityX(capacity), VelocityY(capacity),
+      ColorR(capacity), ColorG(capacity), ColorB(capacity), ColorA(capacity), Life(capacity),
+      Alive(0), capacity(capacity), seed(ParticleHash(seed)), spawned(0)
 {
-    this->init();
+
 }
 
-void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
+void ParticleStore::Spawn(unsigned int count, glm::vec2 position, glm::vec2 velocity)
 {
-    // add new particles 
-    for (unsigned int i = 0; i < newParticles; ++i)
+    count = std::min(count, this->capacity - this->Alive);
+    for (unsigned int n = 0; n < count; ++n)
     {
-        int unusedParticle = this->firstUnusedParticle();
-        this->respawnParticle(this->particles[unusedParticle], object, offset);
+        unsigned int i = this->Alive++;
+        // same derivation as the emit stage in particle.cs
+        unsigned int h0 = ParticleHash(this->seed ^ this->spawned++);
+        unsigned int h1 = ParticleHash(h0);
+        float offset = (static_cast<int>(h0 % 100u) - 50) * 0.1f;
+        float rColor = 0.5f + (h1 >> 8) * (1.0f / 16777216.0f);
+        this->PositionX[i] = position.x + offset;
+        this->PositionY[i] = position.y + offset;
+        this->VelocityX[i] = velocity.x;
+        this->VelocityY[i] = velocity.y;
+        this->ColorR[i] = this->ColorG[i] = this->ColorB[i] = rColor;
+        this->ColorA[i] = 1.0f;
+        this->Life[i] = PARTICLE_LIFE;
     }
-    // update all particles
-    for (unsigned int i = 0; i < this->amount; ++i)
+}
+
+void ParticleStore::Update(float dt)
+{
+    unsigned int count = this->Alive;
+    unsigned int i = 0;
+    float *px = this->PositionX.data(), *py = this->PositionY.data();
+    const float *vx = this->VelocityX.data(), *vy = this->VelocityY.data();
+    float *alpha = this->ColorA.data(), *life = this->Life.data();
+#ifdef PARTICLES_USE_SSE
+    // integrate four particles at a time
+    __m128 delta = _mm_set1_ps(dt);
+    __m128 fade = _mm_set1_ps(dt * PARTICLE_FADE);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), delta));
+        _mm_storeu_ps(px + i, _mm_sub_ps(_mm_loadu_ps(px + i), _mm_mul_ps(_mm_loadu_ps(vx + i), delta)));
+        _mm_storeu_ps(py + i, _mm_sub_ps(_mm_loadu_ps(py + i), _mm_mul_ps(_mm_loadu_ps(vy + i), delta)));
+        _mm_storeu_ps(alpha + i, _mm_sub_ps(_mm_loadu_ps(alpha + i), fade));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        life[i] -= dt;
+        px[i] -= vx[i] * dt;
+        py[i] -= vy[i] * dt;
+        alpha[i] -= dt * PARTICLE_FADE;
+    }
+    // swap-remove dead particles to keep [0, Alive) dense
+    i = 0;
+    while (i < this->Alive)
     {
-        Particle &p = this->particles[i];
-        p.Life -= dt; // reduce life
-        if (p.Life > 0.0f)
-        {	// particle is alive, thus update
-            p.Position -= p.Velocity * dt; 
-            p.Color.a -= dt * 2.5f;
+        if (life[i] > 0.0f)
+        {
+            ++i;
+            continue;
         }
+        unsigned int last = --this->Alive;
+        this->PositionX[i] = this->PositionX[last];
+        this->PositionY[i] = this->PositionY[last];
+        this->VelocityX[i] = this->VelocityX[last];
+        this->VelocityY[i] = this->VelocityY[last];
+        this->ColorR[i] = this->ColorR[last];
+        this->ColorG[i] = this->ColorG[last];
+        this->ColorB[i] = this->ColorB[last];
+        this->ColorA[i] = this->ColorA[last];
+        this->Life[i] = this->Life[last];
     }
 }
 
+
+ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, unsigned int seed)
+    : particles(amount, seed), shader(shader), texture(texture)
+{
+    this->init();
+}
+
+ParticleGenerator::~ParticleGenerator()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->instanceVBO);
+}
+
+void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
+{
+    // add new particles 
+    this->particles.Spawn(newParticles, object.Position + offset, object.Velocity * 0.1f);
+    // update all particles
+    this->particles.Update(dt);
+}
+
 // render all particles
 void ParticleGenerator::Draw()
 {
+    unsigned int alive = this->particles.Alive;
+    if (alive == 0)
+        return;
+    // stream the alive range of every SoA array straight into its slice of the instance buffer
+    unsigned int capacity = this->particles.Capacity();
+    const std::vector<float> *streams[] = {
+        &this->particles.PositionX, &this->particles.PositionY,
+        &this->particles.ColorR, &this->particles.ColorG, &this->particles.ColorB, &this->particles.ColorA
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 6 * capacity * sizeof(float), NULL, GL_STREAM_DRAW); // orphan last frame's data
+    for (unsigned int i = 0; i < 6; ++i)
+        glBufferSubData(GL_ARRAY_BUFFER, i * capacity * sizeof(float), alive * sizeof(float), streams[i]->data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     // use additive blending to give it a 'glow' effect
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     this->shader.Use();
-    for (Particle particle : this->particles)
-    {
-        if (particle.Life > 0.0f)
-        {
-            this->shader.SetVector2f("offset", particle.Position);
-            this->shader.SetVector4f("color", particle.Color);
-            this->texture.Bind();
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
-        }
-    }
+    glActiveTexture(GL_TEXTURE0);
+    this->texture.Bind();
+    glBindVertexArray(this->VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, alive);
+    glBindVertexArray(0);
     // don't forget to reset to default blending mode
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
@@ -60,7 +147,6 @@ void ParticleGenerator::Draw()
 void ParticleGenerator::init()
 {
     // set up mesh and attribute properties
-    unsigned int VBO;
     float particle_quad[] = {
         0.0f, 1.0f, 0.0f, 1.0f,
         1.0f, 0.0f, 1.0f, 0.0f,
@@ -71,50 +157,25 @@ void ParticleGenerator::init()
         1.0f, 0.0f, 1.0f, 0.0f
     }; 
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
+    glGenBuffers(1, &this->instanceVBO);
     glBindVertexArray(this->VAO);
     // fill mesh buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
-
-    // create this->amount default particle instances
-    for (unsigned int i = 0; i < this->amount; ++i)
-        this->particles.push_back(Particle());
-}
-
-// stores the index of the last particle used (for quick access to next dead particle)
-unsigned int lastUsedParticle = 0;
-unsigned int ParticleGenerator::firstUnusedParticle()
-{
-    // first search from last used particle, this will usually return almost instantly
-    for (unsigned int i = lastUsedParticle; i < this->amount; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
-        }
-    }
-    // otherwise, do a linear search
-    for (unsigned int i = 0; i < lastUsedParticle; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
-        }
+    // per-instance attributes: one tightly packed float stream per SoA array (x, y, r, g, b, a)
+    unsigned int capacity = this->particles.Capacity();
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 6 * capacity * sizeof(float), NULL, GL_STREAM_DRAW);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glEnableVertexAttribArray(1 + i);
+        glVertexAttribPointer(1 + i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(i * capacity * sizeof(float)));
+        glVertexAttribDivisor(1 + i, 1);
     }
-    // all particles are taken, override the first one (note that if it repeatedly hits this case, more particles should be reserved)
-    lastUsedParticle = 0;
-    return 0;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
-
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
-{
-    float random = ((rand() % 100) - 50) / 10.0f;
-    float rColor = 0.5f + ((rand() % 100) / 100.0f);
-    particle.Position = object.Position + random + offset;
-    particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-    particle.Life = 1.0f;
-    particle.Velocity = object.Velocity * 0.1f;
-}
\ No newline at end of file
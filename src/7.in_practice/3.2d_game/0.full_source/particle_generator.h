@@ -18,42 +18,92 @@
 #include "game_object.h"
 
 
-// Represents a single particle and its state
-struct Particle {
-    glm::vec2 Position, Velocity;
-    glm::vec4 Color;
-    float     Life;
+// lifetime of a freshly spawned particle in seconds
+const float PARTICLE_LIFE = 1.0f;
+// rate at which a particle fades out (alpha per second)
+const float PARTICLE_FADE = 2.5f;
 
-    Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
+
+// Counter-based random numbers (PCG hash): the n-th particle spawned by a
+// generator gets the same values on every backend, see particle.cs.
+inline unsigned int ParticleHash(unsigned int value)
+{
+    unsigned int state = value * 747796405u + 2891336453u;
+    unsigned int word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+
+// Structure-of-arrays particle storage. Particles [0, Alive) are alive;
+// dead particles are swap-removed so updating and drawing only ever
+// touch a dense range. Holds no GL state so it can be simulated headless.
+// Spawns beyond capacity are dropped.
+class ParticleStore
+{
+public:
+    // particle state, one entry per particle
+    std::vector<float> PositionX, PositionY;
+    std::vector<float> VelocityX, VelocityY;
+    std::vector<float> ColorR, ColorG, ColorB, ColorA;
+    std::vector<float> Life;
+    unsigned int       Alive;
+    // constructor
+    ParticleStore(unsigned int capacity, unsigned int seed = 0x9E3779B9u);
+    // maximum number of simultaneously alive particles
+    unsigned int Capacity() const { return this->capacity; }
+    // spawns particles around position with the given velocity
+    void Spawn(unsigned int count, glm::vec2 position, glm::vec2 velocity);
+    // integrates all alive particles and removes the ones that died
+    void Update(float dt);
+private:
+    unsigned int capacity;
+    unsigned int seed;
+    unsigned int spawned; // particles spawned so far, indexes the random sequence
+};
+
+
+// Common interface of the CPU (ParticleGenerator) and compute shader
+// (GpuParticleGenerator) particle backends.
+class ParticleEmitter
+{
+public:
+    virtual ~ParticleEmitter() { }
+    // spawn newParticles at the object's position and update all particles
+    virtual void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f)) = 0;
+    // render all particles
+    virtual void Draw() = 0;
+    // number of particles currently alive
+    virtual unsigned int AliveCount() const = 0;
 };
 
 
 // ParticleGenerator acts as a container for rendering a large number of 
 // particles by repeatedly spawning and updating particles and killing 
-// them after a given amount of time.
-class ParticleGenerator
+// them after a given amount of time. All alive particles are drawn with
+// a single instanced draw call.
+class ParticleGenerator : public ParticleEmitter
 {
 public:
     // constructor
-    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
+    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, unsigned int seed = 0x9E3779B9u);
+    // destructor
+    ~ParticleGenerator();
     // update all particles
-    void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f)) override;
     // render all particles
-    void Draw();
+    void Draw() override;
+    // number of particles currently alive
+    unsigned int AliveCount() const override { return this->particles.Alive; }
 private:
     // state
-    std::vector<Particle> particles;
-    unsigned int amount;
+    ParticleStore particles;
     // render state
     Shader shader;
     Texture2D texture;
     unsigned int VAO;
+    unsigned int quadVBO, instanceVBO;
     // initializes buffer and vertex attributes
     void init();
-    // returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
-    unsigned int firstUnusedParticle();
-    // respawns particle
-    void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,32 @@
+#version 430 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+
+out vec2 TexCoords;
+out vec4 ParticleColor;
+
+// particle state written by particle.cs
+struct Particle {
+    vec2 position;
+    vec2 velocity;
+    vec4 color;
+    float life;
+};
+
+layout (std430, binding = 0) readonly buffer Particles {
+    Particle particles[];
+};
+layout (std430, binding = 1) readonly buffer AliveList {
+    uint alive[];
+};
+
+uniform mat4 projection;
+uniform uint aliveOffset; // start of the alive list holding this frame's particles
+
+void main()
+{
+    Particle particle = particles[alive[aliveOffset + uint(gl_InstanceID)]];
+    float scale = 10.0f;
+    TexCoords = vertex.zw;
+    ParticleColor = particle.color;
+    gl_Position = projection * vec4((vertex.xy * scale) + particle.position, 0.0, 1.0);
+}
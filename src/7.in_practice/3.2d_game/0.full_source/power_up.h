@@ -8,13 +8,11 @@
 ******************************************************************/
 #ifndef POWER_UP_H
 #define POWER_UP_H
-#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include "game_object.h"
-
 
 // The size of a PowerUp block
 const glm::vec2 POWERUP_SIZE(60.0f, 20.0f);
@@ -22,20 +20,101 @@ const glm::vec2 POWERUP_SIZE(60.0f, 20.0f);
 const glm::vec2 VELOCITY(0.0f, 150.0f);
 
 
-// PowerUp inherits its state and rendering functions from
-// GameObject but also holds extra information to state its
-// active duration and whether it is activated or not. 
-// The type of PowerUp is stored as a string.
-class PowerUp : public GameObject 
+// The kinds of PowerUp, also an index into POWERUP_INFO
+enum PowerUpType : unsigned char {
+    POWERUP_SPEED,
+    POWERUP_STICKY,
+    POWERUP_PASS_THROUGH,
+    POWERUP_PAD_SIZE_INCREASE,
+    POWERUP_CONFUSE,
+    POWERUP_CHAOS,
+    POWERUP_TYPE_COUNT
+};
+
+// Everything that is the same for all PowerUps of one type
+struct PowerUpInfo
+{
+    const char  *Name;
+    const char  *Texture;     // name of the texture in the ResourceManager
+    glm::vec3    Color;
+    float        Duration;    // seconds the effect lasts once activated, 0 for a one-off effect
+    unsigned int SpawnChance; // spawns with a 1 in SpawnChance chance per destroyed brick
+};
+
+// in spawn order; negative powerups should spawn more often
+const PowerUpInfo POWERUP_INFO[POWERUP_TYPE_COUNT] = {
+    { "speed",             "powerup_speed",       glm::vec3(0.5f, 0.5f, 1.0f),   0.0f, 75 },
+    { "sticky",            "powerup_sticky",      glm::vec3(1.0f, 0.5f, 1.0f),  20.0f, 75 },
+    { "pass-through",      "powerup_passthrough", glm::vec3(0.5f, 1.0f, 0.5f),  10.0f, 75 },
+    { "pad-size-increase", "powerup_increase",    glm::vec3(1.0f, 0.6f, 0.4f),   0.0f, 75 },
+    { "confuse",           "powerup_confuse",     glm::vec3(1.0f, 0.3f, 0.3f),  15.0f, 15 },
+    { "chaos",             "powerup_chaos",       glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, 15 }
+};
+
+
+// PowerUpStore holds all PowerUps in play as parallel arrays, one
+// per component, indexed by PowerUp. Size, velocity, color and
+// sprite follow from the type, so only the state that differs per
+// PowerUp is stored. A PowerUp is destroyed once collected or
+// fallen off the screen and activated while its effect lasts.
+class PowerUpStore
 {
 public:
     // powerup state
-    std::string Type;
-    float       Duration;	
-    bool        Activated;
-    // constructor
-    PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, Texture2D texture) 
-        : GameObject(position, POWERUP_SIZE, texture, color, VELOCITY), Type(type), Duration(duration), Activated() { }
+    std::vector<glm::vec2>     Positions;
+    std::vector<glm::vec2>     PreviousPositions; // for render interpolation
+    std::vector<PowerUpType>   Types;
+    std::vector<float>         Durations;
+    std::vector<unsigned char> Activated;
+    std::vector<unsigned char> Destroyed;
+    // adds a falling PowerUp, returns its index
+    unsigned int Add(PowerUpType type, glm::vec2 position)
+    {
+        this->Positions.push_back(position);
+        this->PreviousPositions.push_back(position);
+        this->Types.push_back(type);
+        this->Durations.push_back(POWERUP_INFO[type].Duration);
+        this->Activated.push_back(false);
+        this->Destroyed.push_back(false);
+        return static_cast<unsigned int>(this->Types.size() - 1);
+    }
+    unsigned int Size() const { return static_cast<unsigned int>(this->Types.size()); }
+    void Clear()
+    {
+        this->Positions.clear();
+        this->PreviousPositions.clear();
+        this->Types.clear();
+        this->Durations.clear();
+        this->Activated.clear();
+        this->Destroyed.clear();
+    }
+    // removes the PowerUps that are destroyed and not activated (thus either off the map or finished),
+    // the others keep their order
+    void RemoveFinished()
+    {
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < this->Size(); ++i)
+        {
+            if (this->Destroyed[i] && !this->Activated[i])
+                continue;
+            if (kept != i)
+            {
+                this->Positions[kept] = this->Positions[i];
+                this->PreviousPositions[kept] = this->PreviousPositions[i];
+                this->Types[kept] = this->Types[i];
+                this->Durations[kept] = this->Durations[i];
+                this->Activated[kept] = this->Activated[i];
+                this->Destroyed[kept] = this->Destroyed[i];
+            }
+            ++kept;
+        }
+        this->Positions.resize(kept);
+        this->PreviousPositions.resize(kept);
+        this->Types.resize(kept);
+        this->Durations.resize(kept);
+        this->Activated.resize(kept);
+        this->Destroyed.resize(kept);
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -11,7 +11,11 @@
 
 #include "game.h"
 #include "resource_manager.h"
+#include "irrklang_audio_backend.h"
 
+#include <learnopengl/input_recorder.h>
+
+#include <algorithm>
 #include <iostream>
 
 // GLFW function declarations
@@ -24,11 +28,14 @@ const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
 
 Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
+// records or replays the key presses (LOGL_RECORD_INPUT / LOGL_REPLAY_INPUT)
+InputRecorder Input;
 
 int main(int argc, char *argv[])
 {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // 4.3 for the compute shader particles, we fall back to 3.3 (CPU particles) below
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
@@ -37,6 +44,12 @@ int main(int argc, char *argv[])
     glfwWindowHint(GLFW_RESIZABLE, false);
 
     GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
+    }
     glfwMakeContextCurrent(window);
 
     // glad: load all OpenGL function pointers
@@ -49,6 +62,7 @@ int main(int argc, char *argv[])
 
     glfwSetKeyCallback(window, key_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    Input.Attach(window);
 
     // OpenGL configuration
     // --------------------
@@ -59,11 +73,14 @@ int main(int argc, char *argv[])
     // initialize game
     // ---------------
     Breakout.Init();
+    Breakout.InitAudio(new IrrKlangAudioBackend());
 
     // deltaTime variables
     // -------------------
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
+    // frame time not yet simulated, consumed in steps of FIXED_TIMESTEP
+    float accumulator = 0.0f;
 
     while (!glfwWindowShouldClose(window))
     {
@@ -73,20 +90,24 @@ int main(int argc, char *argv[])
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
-
-        // manage user input
-        // -----------------
-        Breakout.ProcessInput(deltaTime);
-
-        // update game state
-        // -----------------
-        Breakout.Update(deltaTime);
+        // a replay feeds the recorded keys and steps a fixed time per frame, so the ticks match every run
+        deltaTime = Input.Update(deltaTime);
+
+        // manage user input and update game state in fixed steps
+        // -------------------------------------------------------
+        // clamp long frames (window dragged, breakpoint) so we don't spiral trying to catch up
+        accumulator += std::min(deltaTime, 0.25f);
+        while (accumulator >= FIXED_TIMESTEP)
+        {
+            Breakout.Tick(FIXED_TIMESTEP);
+            accumulator -= FIXED_TIMESTEP;
+        }
 
         // render
         // ------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        Breakout.Render();
+        Breakout.Render(accumulator / FIXED_TIMESTEP);
 
         glfwSwapBuffers(window);
     }
@@ -104,16 +125,10 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     // when a user presses the escape key, we set the WindowShouldClose property to true, closing the application
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (key >= 0 && key < 1024)
-    {
-        if (action == GLFW_PRESS)
-            Breakout.Keys[key] = true;
-        else if (action == GLFW_RELEASE)
-        {
-            Breakout.Keys[key] = false;
-            Breakout.KeysProcessed[key] = false;
-        }
-    }
+    if (action == GLFW_PRESS)
+        Breakout.SetKey(key, true);
+    else if (action == GLFW_RELEASE)
+        Breakout.SetKey(key, false);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -8,15 +8,69 @@
 ******************************************************************/
 #include "resource_manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <fstream>
+#include <thread>
 
 #include "stb_image.h"
+#include "atlas_packer.h"
 
 // Instantiate static variables
-std::map<std::string, Texture2D>    ResourceManager::Textures;
-std::map<std::string, Shader>       ResourceManager::Shaders;
+std::vector<TextureRegion>              ResourceManager::Textures;
+std::map<std::string, TextureHandle>    ResourceManager::TextureHandles;
+std::map<std::string, Shader>           ResourceManager::Shaders;
+unsigned int                            ResourceManager::NameLookups = 0;
+unsigned int                            ResourceManager::HandleLookups = 0;
+
+// Background texture loading state. Loads run in batches: the loader
+// threads work through 'loadJobs' while textures queued in the meantime
+// collect in 'queuedJobs' for the next batch, so the loader threads
+// never see a vector that is being resized.
+namespace {
+    // a texture on its way from file to GL
+    struct TextureJob {
+        TextureHandle  Handle;
+        std::string    File;
+        bool           Alpha;
+        bool           Atlas;
+        int            Width, Height;
+        unsigned char *Data;
+    };
+    std::vector<TextureJob>  loadJobs;         // current batch, each job is only written by the thread decoding it
+    std::vector<TextureJob>  queuedJobs;       // waiting for the next batch
+    std::vector<std::thread> loaders;
+    std::atomic<size_t>      nextJob(0);
+    size_t                   jobsDone = 0;     // uploaded jobs of the current batch
+    // completion queue: indices into loadJobs, filled by the loaders and emptied on the GL thread
+    std::mutex               completedMutex;
+    std::condition_variable  completedCondition;
+    std::vector<size_t>      completed;
+    // decoded images (RGBA) waiting to be packed into the sprite atlas
+    std::vector<TextureJob>  atlasImages;
+    const TextureRegion      emptyTexture = { Texture2D(), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) };
+
+    void decodeJobs()
+    {
+        for (size_t i = nextJob++; i < loadJobs.size(); i = nextJob++)
+        {
+            TextureJob &job = loadJobs[i];
+            int nrChannels;
+            // atlas images always become RGBA, they share one texture
+            job.Data = stbi_load(job.File.c_str(), &job.Width, &job.Height, &nrChannels, job.Atlas ? 4 : 0);
+            {
+                std::lock_guard<std::mutex> lock(completedMutex);
+                completed.push_back(i);
+            }
+            completedCondition.notify_one();
+        }
+    }
+}
 
 
 Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name)
@@ -25,30 +79,132 @@ Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderF
     return Shaders[name];
 }
 
+Shader ResourceManager::LoadComputeShader(const char *cShaderFile, std::string name)
+{
+    Shaders[name] = loadComputeShaderFromFile(cShaderFile);
+    return Shaders[name];
+}
+
 Shader ResourceManager::GetShader(std::string name)
 {
     return Shaders[name];
 }
 
-Texture2D ResourceManager::LoadTexture(const char *file, bool alpha, std::string name)
+TextureHandle ResourceManager::LoadTexture(const char *file, bool alpha, std::string name)
+{
+    TextureHandle handle = addTexture(name);
+    Textures[handle].Texture = loadTextureFromFile(file, alpha);
+    return handle;
+}
+
+TextureHandle ResourceManager::QueueTexture(const char *file, bool alpha, std::string name, bool atlas)
+{
+    TextureHandle handle = addTexture(name);
+    queuedJobs.push_back({ handle, file, alpha, atlas, 0, 0, nullptr });
+    return handle;
+}
+
+void ResourceManager::UpdateLoading()
+{
+    // start the next batch once the loaders are idle
+    if (loaders.empty() && !queuedJobs.empty())
+    {
+        loadJobs.swap(queuedJobs);
+        queuedJobs.clear();
+        nextJob = 0;
+        jobsDone = 0;
+        unsigned int threads = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(loadJobs.size())));
+        for (unsigned int i = 0; i < threads; ++i)
+            loaders.push_back(std::thread(decodeJobs));
+    }
+    // upload whatever finished decoding
+    std::vector<size_t> finished;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        finished.swap(completed);
+    }
+    for (size_t i : finished)
+    {
+        TextureJob &job = loadJobs[i];
+        if (!job.Data)
+            std::cout << "ERROR::TEXTURE: Failed to load " << job.File << std::endl;
+        else if (job.Atlas)
+        {
+            atlasImages.push_back(job);
+            continue; // keeps the pixels until buildAtlas
+        }
+        else
+        {
+            Texture2D &texture = Textures[job.Handle].Texture;
+            if (job.Alpha)
+            {
+                texture.Internal_Format = GL_RGBA;
+                texture.Image_Format = GL_RGBA;
+            }
+            texture.Generate(job.Width, job.Height, job.Data);
+        }
+        stbi_image_free(job.Data);
+    }
+    jobsDone += finished.size();
+    if (!loaders.empty() && jobsDone == loadJobs.size())
+    {
+        for (std::thread &loader : loaders)
+            loader.join();
+        loaders.clear();
+        loadJobs.clear();
+    }
+}
+
+void ResourceManager::FinishLoading()
+{
+    UpdateLoading();
+    while (!loaders.empty() || !queuedJobs.empty())
+    {
+        if (!loaders.empty())
+        {
+            std::unique_lock<std::mutex> lock(completedMutex);
+            completedCondition.wait(lock, [] { return !completed.empty(); });
+        }
+        UpdateLoading();
+    }
+    if (!atlasImages.empty())
+        buildAtlas();
+}
+
+TextureHandle ResourceManager::FindTexture(const std::string &name)
 {
-    Textures[name] = loadTextureFromFile(file, alpha);
-    return Textures[name];
+    NameLookups++;
+    std::map<std::string, TextureHandle>::const_iterator iter = TextureHandles.find(name);
+    return iter != TextureHandles.end() ? iter->second : INVALID_TEXTURE;
 }
 
-Texture2D ResourceManager::GetTexture(std::string name)
+const TextureRegion &ResourceManager::GetTexture(TextureHandle handle)
 {
-    return Textures[name];
+    HandleLookups++;
+    return handle < Textures.size() ? Textures[handle] : emptyTexture;
+}
+
+void ResourceManager::ResetStats()
+{
+    NameLookups = 0;
+    HandleLookups = 0;
 }
 
 void ResourceManager::Clear()
 {
+    FinishLoading();
     // (properly) delete all shaders	
     for (auto iter : Shaders)
         glDeleteProgram(iter.second.ID);
-    // (properly) delete all textures
-    for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+    // (properly) delete all textures, atlas images share a texture
+    std::set<unsigned int> textures;
+    for (const TextureRegion &region : Textures)
+        if (region.Texture.ID != 0)
+            textures.insert(region.Texture.ID);
+    for (unsigned int id : textures)
+        glDeleteTextures(1, &id);
+    Textures.clear();
+    TextureHandles.clear();
 }
 
 Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
@@ -95,6 +251,26 @@ Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *
     return shader;
 }
 
+Shader ResourceManager::loadComputeShaderFromFile(const char *cShaderFile)
+{
+    std::string computeCode;
+    try
+    {
+        std::ifstream computeShaderFile(cShaderFile);
+        std::stringstream cShaderStream;
+        cShaderStream << computeShaderFile.rdbuf();
+        computeShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+    }
+    Shader shader;
+    shader.CompileCompute(computeCode.c_str());
+    return shader;
+}
+
 Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
 {
     // create texture object
@@ -112,4 +288,80 @@ Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
     // and finally free image data
     stbi_image_free(data);
     return texture;
-}
\ No newline at end of file
+}
+
+TextureHandle ResourceManager::addTexture(const std::string &name)
+{
+    std::map<std::string, TextureHandle>::iterator iter = TextureHandles.find(name);
+    if (iter != TextureHandles.end())
+        return iter->second;
+    TextureHandle handle = static_cast<TextureHandle>(Textures.size());
+    Textures.push_back(emptyTexture);
+    TextureHandles[name] = handle;
+    return handle;
+}
+
+void ResourceManager::buildAtlas()
+{
+    // every image gets a one pixel border copied from its edge, so linear filtering at the
+    // edge of a sprite samples the sprite itself and never its neighbour
+    const int border = 1;
+    std::stable_sort(atlasImages.begin(), atlasImages.end(), [](const TextureJob &a, const TextureJob &b) {
+        return a.Height > b.Height;
+    });
+    std::vector<glm::uvec2> positions(atlasImages.size());
+    AtlasPacker packer(1024, 1024, 0);
+    for (bool packed = false; !packed; )
+    {
+        packer.Clear();
+        packed = true;
+        for (size_t i = 0; i < atlasImages.size() && packed; ++i)
+        {
+            if (!packer.Pack(atlasImages[i].Width + 2 * border, atlasImages[i].Height + 2 * border, positions[i]))
+            {
+                // grow the page and start over
+                if (packer.Width <= packer.Height)
+                    packer.Width *= 2;
+                else
+                    packer.Height *= 2;
+                packed = false;
+            }
+        }
+    }
+    std::vector<unsigned char> pixels(packer.Width * packer.Height * 4, 0);
+    for (size_t i = 0; i < atlasImages.size(); ++i)
+    {
+        const TextureJob &image = atlasImages[i];
+        for (int y = -border; y < image.Height + border; ++y)
+        {
+            int sourceY = std::min(std::max(y, 0), image.Height - 1);
+            for (int x = -border; x < image.Width + border; ++x)
+            {
+                int sourceX = std::min(std::max(x, 0), image.Width - 1);
+                const unsigned char *source = &image.Data[(sourceY * image.Width + sourceX) * 4];
+                unsigned char *target = &pixels[((positions[i].y + border + y) * packer.Width + positions[i].x + border + x) * 4];
+                std::copy_n(source, 4, target);
+                // images loaded without alpha are opaque, whatever the file says
+                if (!image.Alpha)
+                    target[3] = 255;
+            }
+        }
+        stbi_image_free(image.Data);
+    }
+    // upload the atlas; atlas images queued after this are packed into a new atlas by the next FinishLoading
+    Texture2D atlas;
+    atlas.Internal_Format = GL_RGBA;
+    atlas.Image_Format = GL_RGBA;
+    atlas.Wrap_S = GL_CLAMP_TO_EDGE;
+    atlas.Wrap_T = GL_CLAMP_TO_EDGE;
+    atlas.Generate(packer.Width, packer.Height, pixels.data());
+    for (size_t i = 0; i < atlasImages.size(); ++i)
+    {
+        TextureRegion &region = Textures[atlasImages[i].Handle];
+        region.Texture = atlas;
+        region.TexRect = glm::vec4(
+            static_cast<float>(positions[i].x + border) / packer.Width, static_cast<float>(positions[i].y + border) / packer.Height,
+            static_cast<float>(atlasImages[i].Width) / packer.Width, static_cast<float>(atlasImages[i].Height) / packer.Height);
+    }
+    atlasImages.clear();
+}
@@ -11,32 +11,68 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include "texture.h"
 #include "shader.h"
 
 
+// Integer handle of a loaded texture, resolve it once by name with
+// ResourceManager::FindTexture and keep it instead of the name.
+typedef unsigned int TextureHandle;
+const TextureHandle INVALID_TEXTURE = ~0u;
+
+// What a texture handle resolves to: the GL texture to bind and the
+// rectangle of it to sample (a sub-rectangle if the image was packed
+// into the sprite atlas, otherwise the whole texture).
+struct TextureRegion {
+    Texture2D Texture;
+    glm::vec4 TexRect; // xy = uv offset, zw = uv scale, as expected by SpriteRenderer
+};
+
 // A static singleton ResourceManager class that hosts several
-// functions to load Textures and Shaders. Each loaded texture
-// and/or shader is also stored for future reference by string
-// handles. All functions and resources are static and no 
-// public constructor is defined.
+// functions to load Textures and Shaders. Each loaded shader is
+// stored for future reference by string handles, each texture by
+// an integer handle. Textures can be decoded in the background: 
+// QueueTexture hands out the handle right away, decoding happens
+// on loader threads and finished images are uploaded on the GL
+// thread by UpdateLoading/FinishLoading. All functions and
+// resources are static and no public constructor is defined.
 class ResourceManager
 {
 public:
     // resource storage
-    static std::map<std::string, Shader>    Shaders;
-    static std::map<std::string, Texture2D> Textures;
+    static std::map<std::string, Shader>        Shaders;
+    static std::vector<TextureRegion>           Textures;        // indexed by TextureHandle
+    static std::map<std::string, TextureHandle> TextureHandles;
+    // lookup statistics, accumulated until ResetStats()
+    static unsigned int NameLookups;   // FindTexture calls (string compares)
+    static unsigned int HandleLookups; // GetTexture calls (array index)
     // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
     static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
+    // loads (and generates) a compute shader program from file (requires OpenGL 4.3)
+    static Shader    LoadComputeShader(const char *cShaderFile, std::string name);
     // retrieves a stored sader
     static Shader    GetShader(std::string name);
-    // loads (and generates) a texture from file
-    static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
-    // retrieves a stored texture
-    static Texture2D GetTexture(std::string name);
+    // loads (and generates) a texture from file, right away
+    static TextureHandle LoadTexture(const char *file, bool alpha, std::string name);
+    // queues a texture for decoding on a loader thread; with 'atlas' set the image is packed into the
+    // shared sprite atlas instead of getting a texture of its own. The handle is valid right away, the
+    // texture only after the image was uploaded
+    static TextureHandle QueueTexture(const char *file, bool alpha, std::string name, bool atlas = false);
+    // uploads all queued textures that finished decoding since the last call, never blocks (GL thread only)
+    static void      UpdateLoading();
+    // waits for all queued textures, uploads them and builds the sprite atlas (GL thread only)
+    static void      FinishLoading();
+    // returns the handle of a loaded or queued texture, or INVALID_TEXTURE if there is none by that name
+    static TextureHandle FindTexture(const std::string &name);
+    // retrieves a stored texture; INVALID_TEXTURE resolves to an empty texture
+    static const TextureRegion &GetTexture(TextureHandle handle);
+    // resets the lookup statistics
+    static void      ResetStats();
     // properly de-allocates all loaded resources
     static void      Clear();
 private:
@@ -44,8 +80,14 @@ private:
     ResourceManager() { }
     // loads and generates a shader from file
     static Shader    loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile = nullptr);
+    // loads and generates a compute shader from file
+    static Shader    loadComputeShaderFromFile(const char *cShaderFile);
     // loads a single texture from file
     static Texture2D loadTextureFromFile(const char *file, bool alpha);
+    // returns the handle registered for 'name', adding a new one if needed
+    static TextureHandle addTexture(const std::string &name);
+    // packs all decoded atlas images into one texture
+    static void      buildAtlas();
 };
 
 #endif
\ No newline at end of file
@@ -52,6 +52,21 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glDeleteShader(gShader);
 }
 
+void Shader::CompileCompute(const char* computeSource)
+{
+    // compute Shader
+    unsigned int sCompute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(sCompute, 1, &computeSource, NULL);
+    glCompileShader(sCompute);
+    checkCompileErrors(sCompute, "COMPUTE");
+    // shader program
+    this->ID = glCreateProgram();
+    glAttachShader(this->ID, sCompute);
+    glLinkProgram(this->ID);
+    checkCompileErrors(this->ID, "PROGRAM");
+    glDeleteShader(sCompute);
+}
+
 void Shader::SetFloat(const char *name, float value, bool useShader)
 {
     if (useShader)
@@ -64,6 +79,12 @@ void Shader::SetInteger(const char *name, int value, bool useShader)
         this->Use();
     glUniform1i(glGetUniformLocation(this->ID, name), value);
 }
+void Shader::SetUnsigned(const char *name, unsigned int value, bool useShader)
+{
+    if (useShader)
+        this->Use();
+    glUniform1ui(glGetUniformLocation(this->ID, name), value);
+}
 void Shader::SetVector2f(const char *name, float x, float y, bool useShader)
 {
     if (useShader)
@@ -30,9 +30,12 @@ public:
     Shader  &Use();
     // compiles the shader from given source code
     void    Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional 
+    // compiles a compute shader program from given source code (requires OpenGL 4.3)
+    void    CompileCompute(const char *computeSource);
     // utility functions
     void    SetFloat    (const char *name, float value, bool useShader = false);
     void    SetInteger  (const char *name, int value, bool useShader = false);
+    void    SetUnsigned (const char *name, unsigned int value, bool useShader = false);
     void    SetVector2f (const char *name, float x, float y, bool useShader = false);
     void    SetVector2f (const char *name, const glm::vec2 &value, bool useShader = false);
     void    SetVector3f (const char *name, float x, float y, float z, bool useShader = false);
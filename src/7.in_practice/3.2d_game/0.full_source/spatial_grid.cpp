@@ -0,0 +1,106 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+// fraction of a cell by which boxes are shrunk (items) or grown (queries) at cell borders: an
+// item ending exactly on a border, like every brick, then only occupies the cell it lies in
+// while a query touching that border still finds it
+const float CELL_EPSILON = 1e-4f;
+
+
+SpatialGrid::SpatialGrid()
+    : origin(0.0f), cellSize(1.0f), columns(0), rows(0), stamp(0), cellsVisited(0)
+{
+
+}
+
+void SpatialGrid::Build(glm::vec2 origin, glm::vec2 cellSize, unsigned int columns, unsigned int rows, const std::vector<glm::vec4> &bounds)
+{
+    this->origin = origin;
+    this->cellSize = cellSize;
+    this->columns = columns;
+    this->rows = rows;
+    this->cellStart.assign(columns * rows + 1, 0);
+    this->stamps.assign(bounds.size(), 0);
+    this->stamp = 0;
+    // first pass: count the items per cell
+    glm::ivec2 first, last;
+    for (const glm::vec4 &box : bounds)
+        if (this->cellRange(glm::vec2(box.x, box.y), glm::vec2(box.z, box.w), 0.0f, -CELL_EPSILON, first, last))
+            for (int y = first.y; y <= last.y; ++y)
+                for (int x = first.x; x <= last.x; ++x)
+                    ++this->cellStart[y * columns + x + 1];
+    // prefix sum turns the counts into offsets
+    for (unsigned int c = 0; c < columns * rows; ++c)
+        this->cellStart[c + 1] += this->cellStart[c];
+    // second pass: scatter the item indices, cursor starts at each cell's offset
+    this->items.resize(this->cellStart.back());
+    std::vector<unsigned int> cursor(this->cellStart.begin(), this->cellStart.end() - 1);
+    for (unsigned int i = 0; i < bounds.size(); ++i)
+        if (this->cellRange(glm::vec2(bounds[i].x, bounds[i].y), glm::vec2(bounds[i].z, bounds[i].w), 0.0f, -CELL_EPSILON, first, last))
+            for (int y = first.y; y <= last.y; ++y)
+                for (int x = first.x; x <= last.x; ++x)
+                    this->items[cursor[y * columns + x]++] = i;
+}
+
+void SpatialGrid::Clear()
+{
+    this->columns = this->rows = 0;
+    this->cellStart.clear();
+    this->items.clear();
+    this->stamps.clear();
+}
+
+void SpatialGrid::Query(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &result) const
+{
+    result.clear();
+    glm::ivec2 first, last;
+    if (!this->cellRange(min, max, -CELL_EPSILON, 0.0f, first, last))
+        return;
+    if (++this->stamp == 0)
+    {   // stamp wrapped around, forget all old stamps
+        std::fill(this->stamps.begin(), this->stamps.end(), 0);
+        this->stamp = 1;
+    }
+    for (int y = first.y; y <= last.y; ++y)
+    {
+        for (int x = first.x; x <= last.x; ++x)
+        {
+            unsigned int cell = y * this->columns + x;
+            for (unsigned int i = this->cellStart[cell]; i < this->cellStart[cell + 1]; ++i)
+            {
+                unsigned int item = this->items[i];
+                if (this->stamps[item] != this->stamp)
+                {
+                    this->stamps[item] = this->stamp;
+                    result.push_back(item);
+                }
+            }
+        }
+    }
+    this->cellsVisited += (last.x - first.x + 1) * (last.y - first.y + 1);
+    // report in item order, so callers resolve collisions in the same order as a linear scan would
+    std::sort(result.begin(), result.end());
+}
+
+bool SpatialGrid::cellRange(glm::vec2 min, glm::vec2 max, float minBias, float maxBias, glm::ivec2 &first, glm::ivec2 &last) const
+{
+    if (this->columns == 0 || this->rows == 0)
+        return false;
+    glm::vec2 from = glm::floor((min - this->origin) / this->cellSize + minBias);
+    glm::vec2 to = glm::max(glm::floor((max - this->origin) / this->cellSize + maxBias), from);
+    // boxes reaching outside are clamped to the border cells, so nothing is ever lost
+    glm::vec2 limit(this->columns - 1.0f, this->rows - 1.0f);
+    first = glm::ivec2(glm::clamp(from, glm::vec2(0.0f), limit));
+    last = glm::ivec2(glm::clamp(to, glm::vec2(0.0f), limit));
+    return true;
+}
@@ -0,0 +1,49 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+// SpatialGrid is a uniform grid used as collision broadphase. Items
+// are given as axis-aligned bounding boxes and referenced by their
+// index; an item is stored in every cell its box overlaps. Cells are
+// kept in one flat array (cell offsets + item indices), so building
+// is two linear passes and a query only touches the cells its box
+// overlaps.
+class SpatialGrid
+{
+public:
+    // constructor
+    SpatialGrid();
+    // builds the grid over columns x rows cells of cellSize starting at origin; bounds holds <min.x, min.y, max.x, max.y> per item
+    void Build(glm::vec2 origin, glm::vec2 cellSize, unsigned int columns, unsigned int rows, const std::vector<glm::vec4> &bounds);
+    // removes all items
+    void Clear();
+    // stores the indices of all items sharing a cell with the box [min, max] in result, ascending and without duplicates
+    void Query(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &result) const;
+    // number of cells touched by queries since the last call to ResetStats
+    unsigned int CellsVisited() const { return this->cellsVisited; }
+    void         ResetStats() { this->cellsVisited = 0; }
+private:
+    glm::vec2    origin, cellSize;
+    unsigned int columns, rows;
+    std::vector<unsigned int> cellStart; // items of cell c are items[cellStart[c]] .. items[cellStart[c + 1] - 1]
+    std::vector<unsigned int> items;
+    // per-item query stamps, used to report items spanning several cells once
+    mutable std::vector<unsigned int> stamps;
+    mutable unsigned int stamp;
+    mutable unsigned int cellsVisited;
+    // converts a box (with its borders moved by the given fraction of a cell) to an inclusive cell range, returns false if the grid is empty
+    bool cellRange(glm::vec2 min, glm::vec2 max, float minBias, float maxBias, glm::ivec2 &first, glm::ivec2 &last) const;
+};
+
+#endif
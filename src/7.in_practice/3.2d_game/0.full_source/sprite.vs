@@ -1,14 +1,27 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+// per-instance data, see SpriteInstance in sprite_renderer.h
+layout (location = 1) in vec4 positionSize;  // <vec2 position, vec2 size>
+layout (location = 2) in vec4 texRect;       // <vec2 uv offset, vec2 uv scale>
+layout (location = 3) in vec4 colorRotation; // <vec3 color, float rotation (radians)>
 
 out vec2 TexCoords;
+out vec3 SpriteColor;
 
-uniform mat4 model;
 // note that we're omitting the view matrix; the view never changes so we basically have an identity view matrix and can therefore omit it.
 uniform mat4 projection;
 
 void main()
 {
-    TexCoords = vertex.zw;
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
-}
\ No newline at end of file
+    // same transform the old per-sprite model matrix did: scale, rotate around the quad's center, translate
+    vec2 size = positionSize.zw;
+    vec2 local = (vertex.xy - 0.5) * size;
+    float s = sin(colorRotation.a);
+    float c = cos(colorRotation.a);
+    vec2 rotated = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    vec2 position = positionSize.xy + 0.5 * size + rotated;
+
+    TexCoords = texRect.xy + vertex.zw * texRect.zw;
+    SpriteColor = colorRotation.rgb;
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+}
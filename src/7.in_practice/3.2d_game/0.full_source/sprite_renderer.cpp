@@ -9,7 +9,8 @@
 #include "sprite_renderer.h"
 
 
-SpriteRenderer::SpriteRenderer(Shader &shader)
+SpriteRenderer::SpriteRenderer(const Shader &shader)
+    : DrawCalls(0), SpritesDrawn(0), usedBatches(0), begun(false)
 {
     this->shader = shader;
     this->initRenderData();
@@ -18,32 +19,98 @@ SpriteRenderer::SpriteRenderer(Shader &shader)
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteBuffers(1, &this->instanceVBO);
 }
 
-void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
+void SpriteRenderer::Begin()
 {
-    // prepare transformations
-    this->shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));  // first translate (transformations are: scale happens first, then rotation, and then final translation happens; reversed order)
-
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)); // move origin of rotation to center of quad
-    model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f)); // then rotate
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)); // move origin back
-
-    model = glm::scale(model, glm::vec3(size, 1.0f)); // last scale
+    for (unsigned int i = 0; i < this->usedBatches; ++i)
+        this->batches[i].Instances.clear();
+    this->usedBatches = 0;
+    this->begun = true;
+}
 
-    this->shader.SetMatrix4("model", model);
+void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color, glm::vec4 texRect)
+{
+    // immediate mode: a batch of one
+    if (!this->begun)
+    {
+        this->Begin();
+        this->DrawSprite(texture, position, size, rotate, color, texRect);
+        this->End();
+        return;
+    }
+    // find the batch of this texture (only a handful of textures are used per frame)
+    Batch *batch = nullptr;
+    for (unsigned int i = 0; i < this->usedBatches; ++i)
+    {
+        if (this->batches[i].TextureID == texture.ID)
+        {
+            batch = &this->batches[i];
+            break;
+        }
+    }
+    if (!batch)
+    {
+        if (this->usedBatches == this->batches.size())
+            this->batches.push_back(Batch());
+        batch = &this->batches[this->usedBatches++];
+        batch->TextureID = texture.ID;
+    }
+    // the model transform (rotate around the center, then scale) is rebuilt in sprite.vs
+    SpriteInstance instance;
+    instance.PositionSize = glm::vec4(position, size);
+    instance.TexRect = texRect;
+    instance.ColorRotation = glm::vec4(color, glm::radians(rotate));
+    batch->Instances.push_back(instance);
+}
 
-    // render textured quad
-    this->shader.SetVector3f("spriteColor", color);
+void SpriteRenderer::End()
+{
+    this->begun = false;
+    size_t total = 0;
+    for (unsigned int i = 0; i < this->usedBatches; ++i)
+        total += this->batches[i].Instances.size();
+    if (total == 0)
+        return;
+    // stream all instances of this block into one buffer; orphaning the old storage avoids
+    // waiting on draws that still read from it. Only this block's instances are allocated, so
+    // an immediate-mode sprite costs one instance, not the largest batch seen so far
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, total * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+    size_t offset = 0;
+    for (unsigned int i = 0; i < this->usedBatches; ++i)
+    {
+        const std::vector<SpriteInstance> &instances = this->batches[i].Instances;
+        if (!instances.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(SpriteInstance), instances.size() * sizeof(SpriteInstance), &instances[0]);
+        offset += instances.size();
+    }
 
+    this->shader.Use();
     glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
-
     glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    offset = 0;
+    for (unsigned int i = 0; i < this->usedBatches; ++i)
+    {
+        const Batch &batch = this->batches[i];
+        if (batch.Instances.empty())
+            continue;
+        this->setInstanceOffset(offset);
+        glBindTexture(GL_TEXTURE_2D, batch.TextureID);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(batch.Instances.size()));
+        offset += batch.Instances.size();
+        this->DrawCalls++;
+        this->SpritesDrawn += static_cast<unsigned int>(batch.Instances.size());
+    }
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SpriteRenderer::ResetStats()
+{
+    this->DrawCalls = 0;
+    this->SpritesDrawn = 0;
 }
 
 void SpriteRenderer::initRenderData()
@@ -63,6 +130,7 @@ void SpriteRenderer::initRenderData()
 
     glGenVertexArrays(1, &this->quadVAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->instanceVBO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -70,6 +138,23 @@ void SpriteRenderer::initRenderData()
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // per-instance attributes, sourced from the stream buffer
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    for (unsigned int i = 1; i <= 3; ++i)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    this->setInstanceOffset(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+void SpriteRenderer::setInstanceOffset(size_t firstInstance)
+{
+    // expects quadVAO and instanceVBO to be bound
+    size_t base = firstInstance * sizeof(SpriteInstance);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, PositionSize)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, TexRect)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, ColorRotation)));
+}
@@ -8,6 +8,7 @@
 ******************************************************************/
 #ifndef SPRITE_RENDERER_H
 #define SPRITE_RENDERER_H
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -17,21 +18,54 @@
 #include "shader.h"
 
 
+// Per-sprite data as streamed to the GPU (one instance per sprite, see sprite.vs)
+struct SpriteInstance {
+    glm::vec4 PositionSize;  // xy = top-left position, zw = size
+    glm::vec4 TexRect;       // xy = uv offset, zw = uv scale (sub-rectangle of an atlas page)
+    glm::vec4 ColorRotation; // rgb = color, a = rotation in radians
+};
+
+// SpriteRenderer batches sprites: everything drawn between Begin() and
+// End() is collected per texture and flushed as one instanced draw call
+// per texture (or atlas page). Within a texture the submission order is
+// kept; textures are flushed in the order they were first used, so sprites
+// of different textures that must overlap in a specific order belong in
+// separate Begin()/End() blocks.
 class SpriteRenderer
 {
 public:
+    // render statistics, accumulated until ResetStats()
+    unsigned int DrawCalls;
+    unsigned int SpritesDrawn;
     // Constructor (inits shaders/shapes)
-    SpriteRenderer(Shader &shader);
+    SpriteRenderer(const Shader &shader);
     // Destructor
     ~SpriteRenderer();
-    // Renders a defined quad textured with given sprite
-    void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // starts collecting sprites
+    void Begin();
+    // queues a textured quad; outside of Begin()/End() it is drawn immediately
+    void DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f), glm::vec4 texRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    // uploads all queued sprites and issues one instanced draw per texture
+    void End();
+    // resets the render statistics (call once per frame)
+    void ResetStats();
 private:
+    // all sprites queued for a single texture
+    struct Batch {
+        unsigned int                TextureID;
+        std::vector<SpriteInstance> Instances;
+    };
     // Render state
-    Shader       shader; 
-    unsigned int quadVAO;
+    Shader              shader; 
+    unsigned int        quadVAO;
+    unsigned int        instanceVBO;
+    std::vector<Batch>  batches;
+    unsigned int        usedBatches;
+    bool                begun;
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
+    // points the instance attributes at the given instance of the stream buffer
+    void setInstanceOffset(size_t firstInstance);
 };
 
-#endif
\ No newline at end of file
+#endif
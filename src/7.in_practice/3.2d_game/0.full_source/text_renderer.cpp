@@ -6,6 +6,8 @@
 ** Creative Commons, either version 4 of the License, or (at your
 ** option) any later version.
 ******************************************************************/
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,31 +15,47 @@
 #include FT_FREETYPE_H
 
 #include "text_renderer.h"
+#include "atlas_packer.h"
 #include "resource_manager.h"
 
 
 TextRenderer::TextRenderer(unsigned int width, unsigned int height)
+    : Characters(), DrawCalls(0), GlyphsDrawn(0), vertexCapacity(0), begun(false)
 {
     // load and configure shader
     this->TextShader = ResourceManager::LoadShader("text_2d.vs", "text_2d.fs", nullptr, "text");
     this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f), true);
     this->TextShader.SetInteger("text", 0);
-    // configure VAO/VBO for texture quads
+    // configure VAO/VBO for the glyph quads, the buffer is sized on first use
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
     glBindVertexArray(this->VAO);
     glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, PositionTex));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, Color));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+    // single channel glyph coverage, clamped so glyphs never sample their neighbours
+    this->Atlas.Internal_Format = GL_RED;
+    this->Atlas.Image_Format = GL_RED;
+    this->Atlas.Wrap_S = GL_CLAMP_TO_EDGE;
+    this->Atlas.Wrap_T = GL_CLAMP_TO_EDGE;
+}
+
+TextRenderer::~TextRenderer()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
+    if (this->Atlas.ID != 0)
+        glDeleteTextures(1, &this->Atlas.ID);
 }
 
 void TextRenderer::Load(std::string font, unsigned int fontSize)
 {
     // first clear the previously loaded Characters
-    this->Characters.clear();
+    std::fill(this->Characters, this->Characters + 128, Character());
     // then initialize and load the FreeType library
     FT_Library ft;    
     if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
@@ -48,9 +66,8 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
     // set size to load glyphs as
     FT_Set_Pixel_Sizes(face, 0, fontSize);
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
-    // then for the first 128 ASCII characters, pre-load/compile their characters and store them
+    // then for the first 128 ASCII characters, pre-load their bitmaps and metrics
+    std::vector<std::vector<unsigned char>> bitmaps(128);
     for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
     {
         // load character glyph 
@@ -59,82 +76,139 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-            );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-       
+        FT_Bitmap &bitmap = face->glyph->bitmap;
+        for (unsigned int row = 0; row < bitmap.rows; ++row)
+            bitmaps[c].insert(bitmaps[c].end(), bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width);
         // now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
-        };
-        Characters.insert(std::pair<char, Character>(c, character));
+        Character &character = this->Characters[c];
+        character.Size = glm::ivec2(bitmap.width, bitmap.rows);
+        character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        character.Advance = static_cast<unsigned int>(face->glyph->advance.x);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
     // destroy FreeType once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
+
+    // pack the glyphs tallest first into the smallest square-ish atlas they fit in
+    std::vector<unsigned int> order;
+    for (unsigned int c = 0; c < 128; ++c)
+        if (!bitmaps[c].empty())
+            order.push_back(c);
+    std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+        return this->Characters[a].Size.y > this->Characters[b].Size.y;
+    });
+    std::vector<glm::uvec2> positions(128);
+    AtlasPacker packer(64, 64);
+    for (bool packed = false; !packed; )
+    {
+        packer.Clear();
+        packed = true;
+        for (unsigned int c : order)
+        {
+            if (!packer.Pack(this->Characters[c].Size.x, this->Characters[c].Size.y, positions[c]))
+            {
+                // grow the page and start over
+                if (packer.Width <= packer.Height)
+                    packer.Width *= 2;
+                else
+                    packer.Height *= 2;
+                packed = false;
+                break;
+            }
+        }
+    }
+    // copy the glyphs into place, then upload the whole atlas at once
+    std::vector<unsigned char> pixels(packer.Width * packer.Height, 0);
+    for (unsigned int c : order)
+    {
+        Character &character = this->Characters[c];
+        for (int row = 0; row < character.Size.y; ++row)
+            std::copy_n(&bitmaps[c][row * character.Size.x], character.Size.x, &pixels[(positions[c].y + row) * packer.Width + positions[c].x]);
+        character.TexRect = glm::vec4(
+            static_cast<float>(positions[c].x) / packer.Width, static_cast<float>(positions[c].y) / packer.Height,
+            static_cast<float>(character.Size.x) / packer.Width, static_cast<float>(character.Size.y) / packer.Height);
+    }
+    // disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
+    this->Atlas.Generate(packer.Width, packer.Height, pixels.data());
 }
 
-void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+void TextRenderer::Begin()
 {
-    // activate corresponding render state	
-    this->TextShader.Use();
-    this->TextShader.SetVector3f("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+    this->vertices.clear();
+    this->begun = true;
+}
 
+void TextRenderer::RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color)
+{
+    // immediate mode: a batch of one string
+    if (!this->begun)
+    {
+        this->Begin();
+        this->RenderText(text, x, y, scale, color);
+        this->End();
+        return;
+    }
     // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    float baseline = this->Characters['H'].Bearing.y * scale;
+    for (unsigned char c : text)
     {
-        Character ch = Characters[*c];
+        if (c >= 128)
+            continue;
+        const Character &ch = this->Characters[c];
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + baseline - ch.Bearing.y * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 0.0f },
+        // whitespace has no quad, only an advance
+        if (ch.Size.x > 0 && ch.Size.y > 0)
+        {
+            float u0 = ch.TexRect.x, v0 = ch.TexRect.y;
+            float u1 = u0 + ch.TexRect.z, v1 = v0 + ch.TexRect.w;
+            TextVertex quad[6] = {
+                { glm::vec4(xpos,     ypos + h, u0, v1), color },
+                { glm::vec4(xpos + w, ypos,     u1, v0), color },
+                { glm::vec4(xpos,     ypos,     u0, v0), color },
 
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+                { glm::vec4(xpos,     ypos + h, u0, v1), color },
+                { glm::vec4(xpos + w, ypos + h, u1, v1), color },
+                { glm::vec4(xpos + w, ypos,     u1, v0), color }
+            };
+            this->vertices.insert(this->vertices.end(), quad, quad + 6);
+        }
         // now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
+}
+
+void TextRenderer::End()
+{
+    this->begun = false;
+    if (this->vertices.empty())
+        return;
+    // stream all glyphs into one buffer, orphaning the storage of the previous batch
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    if (this->vertices.size() > this->vertexCapacity)
+        this->vertexCapacity = this->vertices.size() * 2;
+    glBufferData(GL_ARRAY_BUFFER, this->vertexCapacity * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, this->vertices.size() * sizeof(TextVertex), &this->vertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // render all glyph quads from the atlas
+    this->TextShader.Use();
+    glActiveTexture(GL_TEXTURE0);
+    this->Atlas.Bind();
+    glBindVertexArray(this->VAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(this->vertices.size()));
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+    this->DrawCalls++;
+    this->GlyphsDrawn += static_cast<unsigned int>(this->vertices.size() / 6);
+}
+
+void TextRenderer::ResetStats()
+{
+    this->DrawCalls = 0;
+    this->GlyphsDrawn = 0;
+}
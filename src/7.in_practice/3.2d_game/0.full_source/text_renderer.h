@@ -9,7 +9,8 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -20,32 +21,55 @@
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
+    glm::vec4    TexRect;   // xy = uv offset, zw = uv scale of the glyph in the atlas
     glm::ivec2   Size;      // size of glyph
     glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
     unsigned int Advance;   // horizontal offset to advance to next glyph
 };
 
+// Vertex layout of the text quads as streamed to the GPU (see text_2d.vs)
+struct TextVertex {
+    glm::vec4 PositionTex; // xy = position, zw = texture coordinates
+    glm::vec3 Color;
+};
+
 
 // A renderer class for rendering text displayed by a font loaded using the 
-// FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// FreeType library. A single font is loaded and all its glyphs are packed
+// into one atlas texture. Like SpriteRenderer, everything rendered between
+// Begin() and End() is collected into one vertex buffer and drawn with a
+// single draw call; outside of Begin()/End() every string is drawn at once.
 class TextRenderer
 {
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters; 
+    // metrics of the first 128 ASCII characters, indexed by character code
+    Character Characters[128];
+    // all glyphs of the loaded font
+    Texture2D Atlas;
     // shader used for text rendering
     Shader TextShader;
-    // constructor
+    // render statistics, accumulated until ResetStats()
+    unsigned int DrawCalls;
+    unsigned int GlyphsDrawn;
+    // constructor/destructor
     TextRenderer(unsigned int width, unsigned int height);
+    ~TextRenderer();
     // pre-compiles a list of characters from the given font
     void Load(std::string font, unsigned int fontSize);
+    // starts collecting text
+    void Begin();
     // renders a string of text using the precompiled list of characters
-    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    void RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // uploads all queued glyphs and draws them with one draw call
+    void End();
+    // resets the render statistics (call once per frame)
+    void ResetStats();
 private:
     // render state
-    unsigned int VAO, VBO;
+    unsigned int            VAO, VBO;
+    size_t                  vertexCapacity;
+    std::vector<TextVertex> vertices;
+    bool                    begun;
 };
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -30,7 +30,7 @@ public:
     unsigned int Filter_Max; // filtering mode if texture pixels > screen pixels
     // constructor (sets default texture modes)
     Texture2D();
-    // generates texture from image data
+    // generates texture from image data (creates the texture object on first use)
     void Generate(unsigned int width, unsigned int height, unsigned char* data);
     // binds the texture as the current active GL_TEXTURE_2D texture object
     void Bind() const;
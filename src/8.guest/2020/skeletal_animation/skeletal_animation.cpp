@@ -9,11 +9,15 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/animator.h>
+#include <learnopengl/animation_scheduler.h>
 #include <learnopengl/model_animation.h>
+#include <learnopengl/vertex_animation_baker.h>
+#include <learnopengl/skinning.h>
 
 
 
 #include <iostream>
+#include <memory>
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -35,12 +39,28 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// distant crowd, played back from baked vertex animation textures
+const unsigned int CROWD_ROWS = 32;
+const unsigned int CROWD_COLUMNS = 32;
+const float VAT_SAMPLE_RATE = 30.0f;
+
+// skinned dancers between the hero and the crowd, updated at a rate that follows their size on screen
+const unsigned int DANCER_ROWS = 4;
+const unsigned int DANCER_COLUMNS = 8;
+
+struct CrowdInstance
+{
+	glm::mat4 model;
+	glm::vec2 playback; // time offset (s), playback rate
+};
+
 int main()
 {
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	// 4.3 for the compute skinning pre-pass, we fall back to 3.3 (vertex shader skinning) below
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -52,6 +72,12 @@ int main()
 	// --------------------
 	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
 	if (window == NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+	}
+	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
 		glfwTerminate();
@@ -83,6 +109,8 @@ int main()
 	// build and compile shaders
 	// -------------------------
 	Shader ourShader("anim_model.vs", "anim_model.fs");
+	Shader crowdShader("vat_model.vs", "anim_model.fs");
+	Shader skinnedStaticShader("skinned_static.vs", "anim_model.fs");
 
 	
 	// load models
@@ -91,6 +119,81 @@ int main()
 	Animation danceAnimation(FileSystem::getPath("resources/objects/vampire/dancing_vampire.dae"),&ourModel);
 	Animator animator(&danceAnimation);
 
+	// skin the hero once per frame in a compute pre-pass, the depth and color passes then draw it as a static mesh
+	// -----------------------------------------------------------------------------------------------------------
+	std::unique_ptr<ComputeShader> skinningShader;
+	std::unique_ptr<SkinningPrePass> heroSkinning;
+	bool validateSkinning = true;
+	if (GLAD_GL_VERSION_4_3)
+	{
+		skinningShader.reset(new ComputeShader("skinning.cs"));
+		heroSkinning.reset(new SkinningPrePass(ourModel, *skinningShader));
+	}
+	else
+		std::cout << "OpenGL 4.3 not available, skinning in the vertex shader" << std::endl;
+
+	// bake the dance into vertex animation textures once and cache the result next to the model
+	// ------------------------------------------------------------------------------------------
+	BakedVertexAnimation bakedDance;
+	std::string vatCachePath = FileSystem::getPath("resources/objects/vampire/dancing_vampire.vat");
+	if (!VertexAnimationBaker::Load(bakedDance, vatCachePath, ourModel, danceAnimation, VAT_SAMPLE_RATE))
+	{
+		bakedDance = VertexAnimationBaker::Bake(ourModel, danceAnimation, VAT_SAMPLE_RATE);
+		VertexAnimationBaker::Save(bakedDance, vatCachePath);
+	}
+	VertexAnimationBaker::Upload(bakedDance);
+
+	// crowd instances: transform plus a per-instance time offset so the dancers don't move in lockstep
+	std::vector<CrowdInstance> crowd;
+	crowd.reserve(CROWD_ROWS * CROWD_COLUMNS);
+	for (unsigned int row = 0; row < CROWD_ROWS; row++)
+	{
+		for (unsigned int column = 0; column < CROWD_COLUMNS; column++)
+		{
+			CrowdInstance instance;
+			instance.model = glm::translate(glm::mat4(1.0f), glm::vec3((column - CROWD_COLUMNS / 2.0f) * 1.5f, -0.4f, -10.0f - row * 1.5f));
+			instance.model = glm::scale(instance.model, glm::vec3(.5f, .5f, .5f));
+			instance.playback = glm::vec2((rand() % 1000) / 1000.0f * bakedDance.Duration(), 0.8f + (rand() % 400) / 1000.0f);
+			crowd.push_back(instance);
+		}
+	}
+	unsigned int crowdBuffer;
+	glGenBuffers(1, &crowdBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, crowdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, crowd.size() * sizeof(CrowdInstance), &crowd[0], GL_STATIC_DRAW);
+	for (unsigned int i = 0; i < ourModel.meshes.size(); i++)
+	{
+		glBindVertexArray(ourModel.meshes[i].VAO);
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			glEnableVertexAttribArray(7 + column);
+			glVertexAttribPointer(7 + column, 4, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance), (void*)(column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(7 + column, 1);
+		}
+		glEnableVertexAttribArray(11);
+		glVertexAttribPointer(11, 2, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance), (void*)offsetof(CrowdInstance, playback));
+		glVertexAttribDivisor(11, 1);
+		glBindVertexArray(0);
+	}
+
+
+	// skinned dancers share evaluated poses when they play the same clip at (nearly) the same time
+	// -------------------------------------------------------------------------------------------
+	AnimationScheduler scheduler;
+	std::vector<glm::vec3> dancerPositions;
+	for (unsigned int row = 0; row < DANCER_ROWS; row++)
+	{
+		for (unsigned int column = 0; column < DANCER_COLUMNS; column++)
+		{
+			glm::vec3 position((column - DANCER_COLUMNS / 2.0f + 0.5f) * 1.2f, -0.4f, -2.0f - row * 2.0f);
+			// every other dancer starts in sync with its neighbour so their poses can be shared
+			float startTime = ((row * DANCER_COLUMNS + column) / 2) * 0.37f;
+			unsigned int dancer = scheduler.AddInstance(&danceAnimation, startTime, 1.0f, 0.5f);
+			scheduler.SetPosition(dancer, position + glm::vec3(0.0f, 0.5f, 0.0f));
+			dancerPositions.push_back(position);
+		}
+	}
+	float lastStatsTime = 0.0f;
 
 	// draw in wireframe
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -125,16 +228,83 @@ int main()
 		ourShader.setMat4("view", view);
 
         auto transforms = animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transforms.size(); ++i)
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-
 
 		// render the loaded model
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -0.4f, 0.0f)); // translate it down so it's at the center of the scene
 		model = glm::scale(model, glm::vec3(.5f, .5f, .5f));	// it's a bit too big for our scene, so scale it down
-		ourShader.setMat4("model", model);
-		ourModel.Draw(ourShader);
+		if (heroSkinning)
+		{
+			heroSkinning->Dispatch(transforms);
+			if (validateSkinning)
+			{
+				std::cout << "compute skinning max error vs CPU reference: " << heroSkinning->Validate(transforms) << std::endl;
+				validateSkinning = false;
+			}
+			skinnedStaticShader.use();
+			skinnedStaticShader.setMat4("projection", projection);
+			skinnedStaticShader.setMat4("view", view);
+			skinnedStaticShader.setMat4("model", model);
+			// depth pre-pass and color pass both reuse the skinned vertices, nothing is skinned twice
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			heroSkinning->Draw(skinnedStaticShader);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_LEQUAL);
+			heroSkinning->Draw(skinnedStaticShader);
+			glDepthFunc(GL_LESS);
+			ourShader.use();
+		}
+		else
+		{
+			for (int i = 0; i < transforms.size(); ++i)
+				ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+			ourShader.setMat4("model", model);
+			ourModel.Draw(ourShader);
+		}
+
+		// render the scheduled dancers
+		scheduler.Update(deltaTime, projection, view, (float)SCR_HEIGHT);
+		for (unsigned int dancer = 0; dancer < dancerPositions.size(); dancer++)
+		{
+			const std::vector<glm::mat4>& dancerTransforms = scheduler.GetFinalBoneMatrices(dancer);
+			for (unsigned int i = 0; i < dancerTransforms.size(); ++i)
+				ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", dancerTransforms[i]);
+			model = glm::translate(glm::mat4(1.0f), dancerPositions[dancer]);
+			model = glm::scale(model, glm::vec3(.5f, .5f, .5f));
+			ourShader.setMat4("model", model);
+			ourModel.Draw(ourShader);
+		}
+		if (currentFrame - lastStatsTime >= 1.0f)
+		{
+			const AnimationSchedulerStats& stats = scheduler.GetStats();
+			std::cout << "skeletons evaluated: " << stats.skeletonsEvaluated << " / " << stats.instanceCount << " instances ("
+				<< stats.posesRequested << " poses due, " << stats.posesShared << " shared)" << std::endl;
+			lastStatsTime = currentFrame;
+		}
+
+		// render the crowd: one instanced draw per mesh, no skeleton evaluation at all
+		crowdShader.use();
+		crowdShader.setMat4("projection", projection);
+		crowdShader.setMat4("view", view);
+		crowdShader.setFloat("time", currentFrame);
+		crowdShader.setInt("texture_diffuse1", 0);
+		VertexAnimationBaker::Bind(bakedDance, crowdShader, 1, 2);
+		for (unsigned int i = 0; i < ourModel.meshes.size(); i++)
+		{
+			const Mesh& mesh = ourModel.meshes[i];
+			crowdShader.setInt("vatBaseVertex", bakedDance.meshBaseVertex[i]);
+			for (unsigned int t = 0; t < mesh.textures.size(); t++)
+			{
+				if (mesh.textures[t].type == "texture_diffuse")
+				{
+					glBindTexture(GL_TEXTURE_2D, mesh.textures[t].id);
+					break;
+				}
+			}
+			glBindVertexArray(mesh.VAO);
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, 0, static_cast<GLsizei>(crowd.size()));
+			glBindVertexArray(0);
+		}
 
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -143,6 +313,10 @@ int main()
 		glfwPollEvents();
 	}
 
+	// de-allocate the GL resources while their context still exists:
+	// --------------------------------------------------------------
+	heroSkinning.reset();
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
 	glfwTerminate();
@@ -0,0 +1,20 @@
+#version 330 core
+
+// draws the output of the skinning pre-pass (skinning.cs) like any static mesh
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+out vec2 TexCoords;
+out vec3 Normal;
+
+void main()
+{
+    Normal = mat3(model) * norm;
+    TexCoords = tex;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
@@ -0,0 +1,62 @@
+#version 430 core
+
+// skins every vertex of a model once per frame, see SkinningPrePass in includes/learnopengl/skinning.h
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct InputVertex
+{
+    vec4 position;
+    vec4 normal;
+    ivec4 boneIds;
+    vec4 weights;
+};
+
+struct SkinnedVertex
+{
+    vec4 position;
+    vec4 normal;
+};
+
+layout(std430, binding = 0) readonly buffer InputVertices { InputVertex inputVertices[]; };
+layout(std430, binding = 1) readonly buffer BoneMatrices { mat4 bones[]; };
+layout(std430, binding = 2) writeonly buffer SkinnedVertices { SkinnedVertex skinnedVertices[]; };
+
+uniform int vertexCount;
+uniform int boneCount;
+
+const int MAX_BONE_INFLUENCE = 4;
+
+void main()
+{
+    int id = int(gl_GlobalInvocationID.x);
+    if (id >= vertexCount)
+        return;
+
+    InputVertex vertex = inputVertices[id];
+    // blend the bone matrices first, then transform once (same as CpuSkinner); the weights are used
+    // as they are, like in anim_model.vs
+    mat4 skin = mat4(0.0);
+    float total = 0.0;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        int boneId = vertex.boneIds[i];
+        if (boneId < 0)
+            continue;
+        if (boneId >= boneCount)
+        {
+            skin = mat4(1.0);
+            total = 1.0;
+            break;
+        }
+        skin += bones[boneId] * vertex.weights[i];
+        total += vertex.weights[i];
+    }
+    if (total <= 0.0)
+        skin = mat4(1.0);
+
+    vec3 position = (skin * vec4(vertex.position.xyz, 1.0)).xyz;
+    vec3 normal = mat3(skin) * vertex.normal.xyz;
+    float len = length(normal);
+    skinnedVertices[id].position = vec4(position, 1.0);
+    skinnedVertices[id].normal = vec4(len > 0.0 ? normal / len : vertex.normal.xyz, 0.0);
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+layout(location = 2) in vec2 tex;
+// per-instance data, see CrowdInstance in skeletal_animation.cpp
+layout(location = 7) in mat4 instanceModel;
+layout(location = 11) in vec2 instancePlayback; // x = time offset (s), y = playback rate
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform float time;
+
+// baked vertex animation, see includes/learnopengl/vertex_animation_baker.h
+uniform sampler2D vatPositions;
+uniform sampler2D vatNormals;
+uniform int vatTextureWidth;
+uniform int vatRowsPerFrame;
+uniform int vatFrameCount;
+uniform float vatSampleRate;
+uniform int vatBaseVertex; // first baked vertex of the mesh being drawn
+
+out vec2 TexCoords;
+out vec3 Normal;
+
+ivec2 vatTexel(int frame, int vertex)
+{
+    return ivec2(vertex % vatTextureWidth, frame * vatRowsPerFrame + vertex / vatTextureWidth);
+}
+
+void main()
+{
+    // no skeleton: fetch the two baked frames around the instance's local time and blend them
+    float frame = (time * instancePlayback.y + instancePlayback.x) * vatSampleRate;
+    int frame0 = int(floor(frame)) % vatFrameCount;
+    if (frame0 < 0)
+        frame0 += vatFrameCount;
+    int frame1 = (frame0 + 1) % vatFrameCount;
+    float blend = fract(frame);
+
+    int vertex = vatBaseVertex + gl_VertexID;
+    vec3 position = mix(texelFetch(vatPositions, vatTexel(frame0, vertex), 0).xyz,
+                        texelFetch(vatPositions, vatTexel(frame1, vertex), 0).xyz, blend);
+    vec3 normal = mix(texelFetch(vatNormals, vatTexel(frame0, vertex), 0).xyz,
+                      texelFetch(vatNormals, vatTexel(frame1, vertex), 0).xyz, blend);
+
+    Normal = mat3(instanceModel) * normal;
+    TexCoords = tex;
+    gl_Position = projection * view * instanceModel * vec4(position, 1.0);
+}
@@ -0,0 +1,43 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D depthMap;
+uniform float nearPlane;
+uniform float farPlane;
+
+// texel 0 holds the nearest, texel 1 the farthest view distance, as float bits
+layout (r32ui, binding = 0) uniform uimage2D range;
+
+shared uint groupNear;
+shared uint groupFar;
+
+void main()
+{
+    if (gl_LocalInvocationIndex == 0)
+    {
+        groupNear = 0xFFFFFFFFu;
+        groupFar = 0u;
+    }
+    barrier();
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (all(lessThan(texel, textureSize(depthMap, 0))))
+    {
+        float depth = texelFetch(depthMap, texel, 0).r;
+        // cleared pixels have no receiver
+        if (depth < 1.0)
+        {
+            float z = depth * 2.0 - 1.0; // back to NDC
+            float distance = (2.0 * nearPlane * farPlane) / (farPlane + nearPlane - z * (farPlane - nearPlane));
+            atomicMin(groupNear, floatBitsToUint(distance));
+            atomicMax(groupFar, floatBitsToUint(distance));
+        }
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0 && groupNear <= groupFar)
+    {
+        imageAtomicMin(range, ivec2(0, 0), groupNear);
+        imageAtomicMax(range, ivec2(1, 0), groupFar);
+    }
+}
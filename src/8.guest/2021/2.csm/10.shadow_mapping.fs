@@ -12,7 +12,6 @@ uniform sampler2DArray shadowMap;
 
 uniform vec3 lightDir;
 uniform vec3 viewPos;
-uniform float farPlane;
 
 uniform mat4 view;
 
@@ -22,6 +21,8 @@ layout (std140) uniform LightSpaceMatrices
 };
 uniform float cascadePlaneDistances[16];
 uniform int cascadeCount;   // number of frusta - 1
+uniform float cascadeTexelSizes[16];   // world size of a depth map texel
+uniform float cascadeDepthRanges[16];  // world depth the light projection spans
 
 float ShadowCalculation(vec3 fragPosWorldSpace)
 {
@@ -57,18 +58,12 @@ float ShadowCalculation(vec3 fragPosWorldSpace)
     {
         return 0.0;
     }
-    // calculate bias (based on depth map resolution and slope)
+    // calculate bias (based on depth map resolution and slope): the surface depth under a texel
+    // changes by the texel size times the tangent of the light angle, and PCF looks one texel further
     vec3 normal = normalize(fs_in.Normal);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    const float biasModifier = 0.5f;
-    if (layer == cascadeCount)
-    {
-        bias *= 1 / (farPlane * biasModifier);
-    }
-    else
-    {
-        bias *= 1 / (cascadePlaneDistances[layer] * biasModifier);
-    }
+    float cosTheta = clamp(dot(normal, lightDir), 0.1, 1.0);
+    float slope = sqrt(1.0 - cosTheta * cosTheta) / cosTheta;
+    float bias = cascadeTexelSizes[layer] * (1.0 + 2.0 * slope) / cascadeDepthRanges[layer];
 
     // PCF
     float shadow = 0.0;
@@ -1,9 +1,10 @@
 #version 410 core
 layout (location = 0) in vec3 aPos;
 
+uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
 }
@@ -10,9 +10,13 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/input_recorder.h>
+#include <learnopengl/depth_range_reducer.h>
 
 #include <iostream>
 #include <random>
+#include <cmath>
+#include <limits>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -20,8 +24,15 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
 void renderScene(const Shader &shader);
+const std::vector<glm::mat4>& getCubeModelMatrices();
 void renderCube();
 void renderQuad();
+void createSceneFramebuffer();
+void computeCascadeSplits(const glm::vec2& receiverRange);
+struct ShadowCascade;
+ShadowCascade fitCascade(size_t cascade);
+bool cascadeCovers(const ShadowCascade& cached, const ShadowCascade& wanted);
+unsigned int renderShadowCasters(const Shader& shader, const ShadowCascade& cascade);
 std::vector<glm::mat4> getLightSpaceMatrices();
 std::vector<glm::vec4> getFrustumCornersWorldSpace(const glm::mat4& projview);
 void drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& lightMatrices, Shader* shader);
@@ -46,23 +57,75 @@ float cameraFarPlane = 500.0f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-std::vector<float> shadowCascadeLevels{ cameraFarPlane / 50.0f, cameraFarPlane / 25.0f, cameraFarPlane / 10.0f, cameraFarPlane / 2.0f };
+// input recording/replay (LOGL_RECORD_INPUT / LOGL_REPLAY_INPUT)
+InputRecorder input;
+
+const std::vector<float> fixedCascadeLevels{ cameraFarPlane / 50.0f, cameraFarPlane / 25.0f, cameraFarPlane / 10.0f, cameraFarPlane / 2.0f };
+std::vector<float> shadowCascadeLevels = fixedCascadeLevels;
 int debugLayer = 0;
 
+// receiver fitting
+// ----------------
+// With fitToReceivers the camera depth buffer is reduced to the nearest and farthest visible
+// distance on the GPU (DepthRangeReducer, read back a frame late). The split distances are spread
+// over that range with the practical split scheme, a blend of logarithmic and uniform splits, and
+// every cascade box is clipped to the scene bounds seen from the light, so no depth map texel is
+// spent on empty space and the depth range only spans the casters. Off, the splits are the fixed
+// fractions of the camera far plane and the boxes enclose the whole slice (P toggles).
+bool fitToReceivers = true;
+constexpr float splitLambda = 0.75f;
+float receiverNear = cameraNearPlane;
+float receiverFar = cameraFarPlane;
+
+// the scene is rendered off screen so its depth can be reduced
+unsigned int sceneFBO = 0;
+unsigned int sceneColor = 0;
+unsigned int sceneDepth = 0;
+int sceneWidth = 0;
+int sceneHeight = 0;
+
 // meshes
 unsigned int planeVAO;
 
 // lighting info
 // -------------
-const glm::vec3 lightDir = glm::normalize(glm::vec3(20.0f, 50, 20.0f));
+const glm::vec3 initialLightDir = glm::normalize(glm::vec3(20.0f, 50, 20.0f));
+glm::vec3 lightDir = initialLightDir;
+float lightAngle = 0.0f;
+bool animateLight = false;
 unsigned int lightFBO;
 unsigned int lightDepthMaps;
-constexpr unsigned int depthMapResolution = 4096;
+constexpr unsigned int depthMapResolution = 2048;
+
+// cached cascades
+// ---------------
+// Every cascade is an orthographic box around the bounding sphere of its slice of the view frustum,
+// seen from a light view that only depends on the light direction. The box size follows from the
+// sphere radius alone, so it does not change when the camera turns, and its centre is snapped to
+// whole depth map texels, so moving the camera never shifts the texel grid. A depth map therefore
+// stays correct until the camera has moved its slice out of the box, and cascades other than the
+// nearest are only redrawn every farCascadeInterval frames (one of them per frame), when the light
+// changes or when the slice no longer fits. Those get a guard band around the sphere to fit longer.
+struct ShadowCascade
+{
+    glm::mat4 lightSpaceMatrix;
+    glm::mat4 lightView;
+    glm::vec3 boundsMin;   // light view space box the depth map covers
+    glm::vec3 boundsMax;
+    glm::vec3 receiverMin; // light view space box the frustum slice needs covered
+    glm::vec3 receiverMax;
+    glm::vec3 lightDir;    // light direction the depth map was rendered with
+    bool valid = false;
+};
+std::vector<ShadowCascade> cascades;
+constexpr unsigned int farCascadeInterval = 4;
+constexpr float cascadeGuardBand = 0.1f;
 
 bool showQuad = false;
 
 std::random_device device;
-std::mt19937 generator = std::mt19937(device());
+// replays place the cubes the same way every run
+std::mt19937 generator = std::mt19937(input.IsReplaying() ? 5489u : device());
 
 std::vector<glm::mat4> lightMatricesCache;
 
@@ -73,7 +136,7 @@ int main()
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -93,6 +156,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    input.Attach(window);
     glfwGetFramebufferSize(window, &fb_width, &fb_height);
 
     // tell GLFW to capture our mouse
@@ -113,7 +177,7 @@ int main()
     // build and compile shaders
     // -------------------------
     Shader shader("10.shadow_mapping.vs", "10.shadow_mapping.fs");
-    Shader simpleDepthShader("10.shadow_mapping_depth.vs", "10.shadow_mapping_depth.fs", "10.shadow_mapping_depth.gs");
+    Shader simpleDepthShader("10.shadow_mapping_depth.vs", "10.shadow_mapping_depth.fs");
     Shader debugDepthQuad("10.debug_quad.vs", "10.debug_quad_depth.fs");
     Shader debugCascadeShader("10.debug_cascade.vs", "10.debug_cascade.fs");
 
@@ -179,6 +243,9 @@ int main()
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    createSceneFramebuffer();
+    DepthRangeReducer *depthReducer = new DepthRangeReducer("10.depth_reduce.cs");
+
     // configure UBO
     // --------------------
     unsigned int matricesUBO;
@@ -196,6 +263,15 @@ int main()
     debugDepthQuad.use();
     debugDepthQuad.setInt("depthMap", 0);
 
+    cascades.resize(shadowCascadeLevels.size() + 1);
+    unsigned int frameIndex = 0;
+
+    // shadow pass statistics, printed once a second
+    float statTime = 0.0f;
+    unsigned int statFrames = 0;
+    unsigned int statTriangles = 0;
+    unsigned int statCascades = 0;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -203,52 +279,108 @@ int main()
         // per-frame time logic
         // --------------------
         float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+        deltaTime = input.Update(currentFrame - lastFrame);
         lastFrame = currentFrame;
 
         // input
         // -----
         processInput(window);
 
-        // change light position over time
-        //lightPos.x = sin(glfwGetTime()) * 3.0f;
-        //lightPos.z = cos(glfwGetTime()) * 2.0f;
-        //lightPos.y = 5.0 + cos(glfwGetTime()) * 1.0f;
+        // change light direction over time
+        if (animateLight)
+        {
+            lightAngle += deltaTime * 0.2f;
+            lightDir = glm::vec3(glm::rotate(glm::mat4(1.0f), lightAngle, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(initialLightDir, 0.0f));
+        }
 
         // render
         // ------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // 0. UBO setup
-        const auto lightMatrices = getLightSpaceMatrices();
+        // 0. fit the splits to last frame's receivers, pick the cascades to redraw this frame and upload their matrices
+        glm::vec2 receiverRange;
+        if (fitToReceivers && depthReducer->Latest(receiverRange))
+        {
+            computeCascadeSplits(receiverRange);
+        }
+        else
+        {
+            shadowCascadeLevels = fixedCascadeLevels;
+            receiverNear = cameraNearPlane;
+            receiverFar = cameraFarPlane;
+        }
+        std::vector<size_t> updatedCascades;
         glBindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
-        for (size_t i = 0; i < lightMatrices.size(); ++i)
+        for (size_t i = 0; i < cascades.size(); ++i)
         {
-            glBufferSubData(GL_UNIFORM_BUFFER, i * sizeof(glm::mat4x4), sizeof(glm::mat4x4), &lightMatrices[i]);
+            const ShadowCascade wanted = fitCascade(i);
+            const ShadowCascade& cached = cascades[i];
+            const bool due = i == 0 || frameIndex % farCascadeInterval == (i - 1) % farCascadeInterval;
+            if (!cached.valid || due || cached.lightDir != lightDir || !cascadeCovers(cached, wanted))
+            {
+                cascades[i] = wanted;
+                updatedCascades.push_back(i);
+                glBufferSubData(GL_UNIFORM_BUFFER, i * sizeof(glm::mat4x4), sizeof(glm::mat4x4), &cascades[i].lightSpaceMatrix);
+            }
         }
         glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        frameIndex++;
 
         // 1. render depth of scene to texture (from light's perspective)
         // --------------------------------------------------------------
-        //lightProjection = glm::perspective(glm::radians(45.0f), (GLfloat)SHADOW_WIDTH / (GLfloat)SHADOW_HEIGHT, near_plane, far_plane); // note that if you use a perspective projection matrix you'll have to change the light position as the current light position isn't enough to reflect the whole scene
-        // render scene from light's point of view
+        // render scene from light's point of view, one layer at a time and only the casters inside it
         simpleDepthShader.use();
 
         glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
         glViewport(0, 0, depthMapResolution, depthMapResolution);
-        glClear(GL_DEPTH_BUFFER_BIT);
         glCullFace(GL_FRONT);  // peter panning
-        renderScene(simpleDepthShader);
+        unsigned int shadowTriangles = 0;
+        for (size_t i : updatedCascades)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, lightDepthMaps, 0, int(i));
+            glClear(GL_DEPTH_BUFFER_BIT);
+            simpleDepthShader.setMat4("lightSpaceMatrix", cascades[i].lightSpaceMatrix);
+            shadowTriangles += renderShadowCasters(simpleDepthShader, cascades[i]);
+        }
         glCullFace(GL_BACK);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        statTime += deltaTime;
+        statFrames++;
+        statTriangles += shadowTriangles;
+        statCascades += (unsigned int)updatedCascades.size();
+        if (statTime >= 1.0f)
+        {
+            // what drawing every caster into every layer would cost: 2 floor triangles and 12 per cube
+            const unsigned int layeredTriangles = (2 + 12 * (unsigned int)getCubeModelMatrices().size()) * (unsigned int)cascades.size();
+            std::cout << "shadow pass: " << statTriangles / statFrames << " triangles/frame (all casters into all layers: " << layeredTriangles
+                      << "), " << (float)statCascades / statFrames << " of " << cascades.size() << " cascades redrawn/frame" << std::endl;
+            std::cout << "cascades: receivers " << receiverNear << " to " << receiverFar << ", splits";
+            for (float split : shadowCascadeLevels)
+            {
+                std::cout << " " << split;
+            }
+            std::cout << ", texel size nearest " << (cascades.front().boundsMax.x - cascades.front().boundsMin.x) / depthMapResolution
+                      << " farthest " << (cascades.back().boundsMax.x - cascades.back().boundsMin.x) / depthMapResolution
+                      << (fitToReceivers ? "" : " (fixed splits)") << std::endl;
+            statTime = 0.0f;
+            statFrames = 0;
+            statTriangles = 0;
+            statCascades = 0;
+        }
+
         // reset viewport
         glViewport(0, 0, fb_width, fb_height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // 2. render scene as normal using the generated depth/shadow map  
         // --------------------------------------------------------------
+        if (sceneWidth != fb_width || sceneHeight != fb_height)
+        {
+            createSceneFramebuffer();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
         glViewport(0, 0, fb_width, fb_height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shader.use();
@@ -259,18 +391,30 @@ int main()
         // set light uniforms
         shader.setVec3("viewPos", camera.Position);
         shader.setVec3("lightDir", lightDir);
-        shader.setFloat("farPlane", cameraFarPlane);
         shader.setInt("cascadeCount", shadowCascadeLevels.size());
         for (size_t i = 0; i < shadowCascadeLevels.size(); ++i)
         {
             shader.setFloat("cascadePlaneDistances[" + std::to_string(i) + "]", shadowCascadeLevels[i]);
         }
+        for (size_t i = 0; i < cascades.size(); ++i)
+        {
+            const glm::vec3 size = cascades[i].boundsMax - cascades[i].boundsMin;
+            shader.setFloat("cascadeTexelSizes[" + std::to_string(i) + "]", std::max(size.x, size.y) / depthMapResolution);
+            shader.setFloat("cascadeDepthRanges[" + std::to_string(i) + "]", size.z);
+        }
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
         renderScene(shader);
 
+        // 3. reduce the depth of the frame to the range of visible receivers
+        // --------------------------------------------------------------------
+        if (fitToReceivers)
+        {
+            depthReducer->Reduce(sceneDepth, fb_width, fb_height, cameraNearPlane, cameraFarPlane);
+        }
+
         if (lightMatricesCache.size() != 0)
         {
             glEnable(GL_BLEND);
@@ -293,6 +437,11 @@ int main()
             renderQuad();
         }
 
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, fb_width, fb_height, 0, 0, fb_width, fb_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
@@ -303,6 +452,7 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
+    delete depthReducer;
 
     glfwTerminate();
     return 0;
@@ -318,6 +468,17 @@ void renderScene(const Shader &shader)
     glBindVertexArray(planeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
+    for (const auto& model : getCubeModelMatrices())
+    {
+        shader.setMat4("model", model);
+        renderCube();
+    }
+}
+
+// places the cubes on first use
+// -----------------------------
+const std::vector<glm::mat4>& getCubeModelMatrices()
+{
     static std::vector<glm::mat4> modelMatrices;
     if (modelMatrices.size() == 0)
     {
@@ -334,12 +495,42 @@ void renderScene(const Shader &shader)
             modelMatrices.push_back(model);
         }
     }
+    return modelMatrices;
+}
+
+// sphere against the box of a cascade, both in light view space; the box is open towards the light
+// only up to its near plane, casters beyond that would be clipped anyway
+// ---------------------------------------------------------------------------------------------------
+bool casterInCascade(const ShadowCascade& cascade, const glm::vec3& worldCenter, float radius)
+{
+    const glm::vec3 center = glm::vec3(cascade.lightView * glm::vec4(worldCenter, 1.0f));
+    return glm::all(glm::greaterThanEqual(center + radius, cascade.boundsMin)) && glm::all(glm::lessThanEqual(center - radius, cascade.boundsMax));
+}
 
-    for (const auto& model : modelMatrices)
+// renders the shadow casters that touch the cascade and returns the number of triangles submitted
+// -----------------------------------------------------------------------------------------------
+unsigned int renderShadowCasters(const Shader& shader, const ShadowCascade& cascade)
+{
+    unsigned int triangles = 0;
+    // floor, 50 x 50 at y = -2
+    if (casterInCascade(cascade, glm::vec3(0.0f, -2.0f, 0.0f), 25.0f * std::sqrt(2.0f)))
     {
-        shader.setMat4("model", model);
-        renderCube();
+        shader.setMat4("model", glm::mat4(1.0f));
+        glBindVertexArray(planeVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        triangles += 2;
+    }
+    // cubes span [-1, 1] before their uniform scale
+    for (const auto& model : getCubeModelMatrices())
+    {
+        if (casterInCascade(cascade, glm::vec3(model[3]), glm::length(glm::vec3(model[0])) * std::sqrt(3.0f)))
+        {
+            shader.setMat4("model", model);
+            renderCube();
+            triangles += 12;
+        }
     }
+    return triangles;
 }
 
 
@@ -449,6 +640,39 @@ void renderQuad()
     glBindVertexArray(0);
 }
 
+// (re)creates the off screen target of the scene at the framebuffer size; depth is a texture the
+// reduction can read
+// ------------------------------------------------------------------------------------------------
+void createSceneFramebuffer()
+{
+    if (sceneFBO != 0)
+    {
+        glDeleteFramebuffers(1, &sceneFBO);
+        glDeleteRenderbuffers(1, &sceneColor);
+        glDeleteTextures(1, &sceneDepth);
+    }
+    sceneWidth = fb_width;
+    sceneHeight = fb_height;
+
+    glGenFramebuffers(1, &sceneFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glGenRenderbuffers(1, &sceneColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, sceneWidth, sceneHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+    glGenTextures(1, &sceneDepth);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, sceneWidth, sceneHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, sceneDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER:: Scene framebuffer is not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 std::vector<GLuint> visualizerVAOs;
 std::vector<GLuint> visualizerVBOs;
 std::vector<GLuint> visualizerEBOs;
@@ -523,29 +747,29 @@ void drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& lightMatrices, S
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    camera.MovementSpeed = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ? 2.5 * 10 : 2.5;
+    camera.MovementSpeed = input.GetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ? 2.5 * 10 : 2.5;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_S) == GLFW_PRESS)
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_A) == GLFW_PRESS)
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
     static int fPress = GLFW_RELEASE;
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE && fPress == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_F) == GLFW_RELEASE && fPress == GLFW_PRESS)
     {
         showQuad = !showQuad;
     }
-    fPress = glfwGetKey(window, GLFW_KEY_F);
+    fPress = input.GetKey(window, GLFW_KEY_F);
 
     static int plusPress = GLFW_RELEASE;
-    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE && plusPress == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_N) == GLFW_RELEASE && plusPress == GLFW_PRESS)
     {
         debugLayer++;
         if (debugLayer > shadowCascadeLevels.size())
@@ -553,14 +777,28 @@ void processInput(GLFWwindow *window)
             debugLayer = 0;
         }
     }
-    plusPress = glfwGetKey(window, GLFW_KEY_N);
+    plusPress = input.GetKey(window, GLFW_KEY_N);
 
     static int cPress = GLFW_RELEASE;
-    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE && cPress == GLFW_PRESS)
+    if (input.GetKey(window, GLFW_KEY_C) == GLFW_RELEASE && cPress == GLFW_PRESS)
     {
         lightMatricesCache = getLightSpaceMatrices();
     }
-    cPress = glfwGetKey(window, GLFW_KEY_C);
+    cPress = input.GetKey(window, GLFW_KEY_C);
+
+    static int lPress = GLFW_RELEASE;
+    if (input.GetKey(window, GLFW_KEY_L) == GLFW_RELEASE && lPress == GLFW_PRESS)
+    {
+        animateLight = !animateLight;
+    }
+    lPress = input.GetKey(window, GLFW_KEY_L);
+
+    static int pPress = GLFW_RELEASE;
+    if (input.GetKey(window, GLFW_KEY_P) == GLFW_RELEASE && pPress == GLFW_PRESS)
+    {
+        fitToReceivers = !fitToReceivers;
+    }
+    pPress = input.GetKey(window, GLFW_KEY_P);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -669,7 +907,48 @@ std::vector<glm::vec4> getFrustumCornersWorldSpace(const glm::mat4& proj, const
     return getFrustumCornersWorldSpace(proj * view);
 }
 
-glm::mat4 getLightSpaceMatrix(const float nearPlane, const float farPlane)
+// world space bounds of everything that casts or receives a shadow, seen from the light
+// -----------------------------------------------------------------------------------------
+void getSceneBounds(const glm::mat4& lightView, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    // floor, then the cubes by their bounding spheres
+    glm::vec3 worldMin = glm::vec3(-25.0f, -2.0f, -25.0f);
+    glm::vec3 worldMax = glm::vec3(25.0f, -2.0f, 25.0f);
+    for (const auto& model : getCubeModelMatrices())
+    {
+        const float radius = glm::length(glm::vec3(model[0])) * std::sqrt(3.0f);
+        worldMin = glm::min(worldMin, glm::vec3(model[3]) - radius);
+        worldMax = glm::max(worldMax, glm::vec3(model[3]) + radius);
+    }
+
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        const glm::vec3 corner = glm::vec3(i & 1 ? worldMax.x : worldMin.x, i & 2 ? worldMax.y : worldMin.y, i & 4 ? worldMax.z : worldMin.z);
+        const glm::vec3 trf = glm::vec3(lightView * glm::vec4(corner, 1.0f));
+        boundsMin = glm::min(boundsMin, trf);
+        boundsMax = glm::max(boundsMax, trf);
+    }
+}
+
+// practical split scheme over the visible depth range; the range is padded as it is a frame old
+// ---------------------------------------------------------------------------------------------
+void computeCascadeSplits(const glm::vec2& receiverRange)
+{
+    receiverNear = std::max(cameraNearPlane, receiverRange.x * 0.9f);
+    receiverFar = std::min(cameraFarPlane, std::max(receiverRange.y * 1.1f, receiverNear * 1.5f));
+    const size_t count = fixedCascadeLevels.size() + 1;
+    for (size_t i = 1; i < count; ++i)
+    {
+        const float fraction = float(i) / count;
+        const float logarithmic = receiverNear * std::pow(receiverFar / receiverNear, fraction);
+        const float uniform = receiverNear + (receiverFar - receiverNear) * fraction;
+        shadowCascadeLevels[i - 1] = splitLambda * logarithmic + (1.0f - splitLambda) * uniform;
+    }
+}
+
+ShadowCascade fitCascade(float nearPlane, float farPlane, float guardBand)
 {
     const auto proj = glm::perspective(
         glm::radians(camera.Zoom), (float)fb_width / (float)fb_height, nearPlane,
@@ -683,65 +962,98 @@ glm::mat4 getLightSpaceMatrix(const float nearPlane, const float farPlane)
     }
     center /= corners.size();
 
-    const auto lightView = glm::lookAt(center + lightDir, center, glm::vec3(0.0f, 1.0f, 0.0f));
-
-    float minX = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float minY = std::numeric_limits<float>::max();
-    float maxY = std::numeric_limits<float>::lowest();
-    float minZ = std::numeric_limits<float>::max();
-    float maxZ = std::numeric_limits<float>::lowest();
+    // the radius only depends on the projection; rounding it up keeps float noise from resizing the box
+    float radius = 0.0f;
     for (const auto& v : corners)
     {
-        const auto trf = lightView * v;
-        minX = std::min(minX, trf.x);
-        maxX = std::max(maxX, trf.x);
-        minY = std::min(minY, trf.y);
-        maxY = std::max(maxY, trf.y);
-        minZ = std::min(minZ, trf.z);
-        maxZ = std::max(maxZ, trf.z);
+        radius = std::max(radius, glm::length(glm::vec3(v) - center));
     }
-
-    // Tune this parameter according to the scene
-    constexpr float zMult = 10.0f;
-    if (minZ < 0)
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    ShadowCascade cascade;
+    cascade.lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, glm::vec3(0.0f, 1.0f, 0.0f));
+    cascade.lightDir = lightDir;
+    cascade.valid = true;
+
+    const glm::vec3 sliceCenter = glm::vec3(cascade.lightView * glm::vec4(center, 1.0f));
+    const float extent = radius * (1.0f + guardBand);
+    cascade.receiverMin = sliceCenter - radius;
+    cascade.receiverMax = sliceCenter + radius;
+    glm::vec3 boundsMin = sliceCenter - extent;
+    glm::vec3 boundsMax = sliceCenter + extent;
+    if (fitToReceivers)
     {
-        minZ *= zMult;
+        // nothing outside the scene receives a shadow, and every caster towards the light is inside it
+        glm::vec3 sceneMin, sceneMax;
+        getSceneBounds(cascade.lightView, sceneMin, sceneMax);
+        cascade.receiverMin = glm::clamp(cascade.receiverMin, sceneMin, sceneMax);
+        cascade.receiverMax = glm::clamp(cascade.receiverMax, sceneMin, sceneMax);
+        boundsMin = glm::clamp(boundsMin, sceneMin, sceneMax);
+        boundsMax = glm::clamp(boundsMax, sceneMin, sceneMax);
+        boundsMax.z = sceneMax.z;
     }
     else
     {
-        minZ /= zMult;
+        // Tune this parameter according to the scene: how far towards the light casters are picked up
+        constexpr float zMult = 10.0f;
+        boundsMax.z = sliceCenter.z + extent * zMult;
     }
-    if (maxZ < 0)
+
+    // The box size is rounded up to an eighth of its power of two, so it only changes in steps, and
+    // the box moves in whole texels only. One texel of slack on either side keeps the snapped box
+    // around the unsnapped one.
+    for (int axis = 0; axis < 2; ++axis)
     {
-        maxZ /= zMult;
+        float size = std::max(boundsMax[axis] - boundsMin[axis], 1.0f / 16.0f) * (1.0f + 2.0f / depthMapResolution);
+        const float step = std::exp2(std::floor(std::log2(size)) - 3.0f);
+        size = std::ceil(size / step) * step;
+        const float texelSize = size / depthMapResolution;
+        boundsMin[axis] = std::floor((boundsMin[axis] - texelSize) / texelSize) * texelSize;
+        boundsMax[axis] = boundsMin[axis] + size;
     }
-    else
+    boundsMax.z = std::max(boundsMax.z, boundsMin.z + 1.0f / 16.0f);
+    cascade.boundsMin = boundsMin;
+    cascade.boundsMax = boundsMax;
+
+    // the light looks down -z
+    const glm::mat4 lightProjection = glm::ortho(boundsMin.x, boundsMax.x, boundsMin.y, boundsMax.y, -boundsMax.z, -boundsMin.z);
+    cascade.lightSpaceMatrix = lightProjection * cascade.lightView;
+    return cascade;
+}
+
+ShadowCascade fitCascade(size_t cascade)
+{
+    // the nearest cascade is redrawn every frame and needs no guard band
+    const float guardBand = cascade == 0 ? 0.0f : cascadeGuardBand;
+    if (cascade == 0)
+    {
+        return fitCascade(receiverNear, shadowCascadeLevels[cascade], guardBand);
+    }
+    else if (cascade < shadowCascadeLevels.size())
     {
-        maxZ *= zMult;
+        return fitCascade(shadowCascadeLevels[cascade - 1], shadowCascadeLevels[cascade], guardBand);
     }
+    return fitCascade(shadowCascadeLevels[cascade - 1], receiverFar, guardBand);
+}
 
-    const glm::mat4 lightProjection = glm::ortho(minX, maxX, minY, maxY, minZ, maxZ);
-    return lightProjection * lightView;
+// whether a cached depth map still holds everything the current slice of the frustum needs
+bool cascadeCovers(const ShadowCascade& cached, const ShadowCascade& wanted)
+{
+    if (cached.lightDir != wanted.lightDir)
+    {
+        return false;
+    }
+    return glm::all(glm::greaterThanEqual(wanted.receiverMin, cached.boundsMin)) &&
+        glm::all(glm::lessThanEqual(wanted.receiverMax, cached.boundsMax));
 }
 
+// the matrices the depth maps currently hold
 std::vector<glm::mat4> getLightSpaceMatrices()
 {
     std::vector<glm::mat4> ret;
-    for (size_t i = 0; i < shadowCascadeLevels.size() + 1; ++i)
+    for (const auto& cascade : cascades)
     {
-        if (i == 0)
-        {
-            ret.push_back(getLightSpaceMatrix(cameraNearPlane, shadowCascadeLevels[i]));
-        }
-        else if (i < shadowCascadeLevels.size())
-        {
-            ret.push_back(getLightSpaceMatrix(shadowCascadeLevels[i - 1], shadowCascadeLevels[i]));
-        }
-        else
-        {
-            ret.push_back(getLightSpaceMatrix(shadowCascadeLevels[i - 1], cameraFarPlane));
-        }
+        ret.push_back(cascade.lightSpaceMatrix);
     }
     return ret;
 }
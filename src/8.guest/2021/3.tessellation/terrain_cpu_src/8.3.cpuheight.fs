@@ -3,9 +3,14 @@
 out vec4 FragColor;
 
 in float Height;
+in vec3 Normal;
+
+uniform bool shaded;
 
 void main()
 {
     float h = (Height + 16)/32.0f;	// shift and scale the height into a grayscale value
+    if (shaded)
+        h *= 0.3 + 0.7 * max(dot(normalize(Normal), normalize(vec3(0.5, 1.0, 0.3))), 0.0);
     FragColor = vec4(h, h, h, 1.0);
-}
\ No newline at end of file
+}
@@ -1,16 +1,29 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-
+// vertex pulling: no vertex attributes, every instance is the triangle strip between two heightmap rows
 out float Height;
 out vec3 Position;
+out vec3 Normal;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+uniform sampler2D heights;  // heightmap pixel per texel, columns along s
+uniform sampler2D normals;  // normal x and z
+uniform vec2 mapSize;       // heightmap rows, columns
+uniform float yScale;
+uniform float yShift;
+
 void main()
 {
-    Height = aPos.y;
-    Position = (view * model * vec4(aPos, 1.0)).xyz;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    // the strip alternates between the instance's row and the next one
+    ivec2 texel = ivec2(gl_VertexID / 2, gl_InstanceID + (gl_VertexID & 1));
+    float y = texelFetch(heights, texel, 0).r * 255.0 * yScale - yShift;
+    vec3 pos = vec3(texel.y - mapSize.x / 2.0, y, texel.x - mapSize.y / 2.0);
+
+    vec2 n = texelFetch(normals, texel, 0).rg;
+    Normal = mat3(model) * vec3(n.x, sqrt(max(1.0 - dot(n, n), 0.0)), n.y);
+    Height = pos.y;
+    Position = (view * model * vec4(pos, 1.0)).xyz;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 330 core
+layout (location = 0) in vec2 aHeights; // heightmap value of the vertex and of the vertex it morphs to
+
+out float Height;
+out vec3 Position;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform int gridSize;       // quads per node side
+uniform vec2 nodeOrigin;    // first heightmap pixel (row, column) of the node
+uniform float nodeStep;     // heightmap pixels between vertices
+uniform vec2 mapSize;       // heightmap rows, columns
+uniform vec2 morphRange;    // distance at which morphing to the coarser grid starts and ends
+uniform vec3 cameraPos;
+uniform float yScale;
+uniform float yShift;
+uniform sampler2D normals;  // normal x and z per heightmap pixel, see Heightfield
+
+void main()
+{
+    // x and z follow from the vertex's place in the node grid
+    ivec2 cell = ivec2(gl_VertexID / (gridSize + 1), gl_VertexID % (gridSize + 1));
+    vec2 pixel = min(nodeOrigin + vec2(cell) * nodeStep, mapSize - 1.0);
+    vec3 pos = vec3(pixel.x - mapSize.x / 2.0, aHeights.x * yScale - yShift, pixel.y - mapSize.y / 2.0);
+
+    // odd rows move back and odd columns on to the coarser grid (along the strips' diagonal), the further away the more
+    float morph = clamp((distance(pos, cameraPos) - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+    ivec2 morphCell = cell + ivec2(-(cell.x & 1), cell.y & 1);
+    vec2 morphPixel = min(nodeOrigin + vec2(morphCell) * nodeStep, mapSize - 1.0);
+    pos.xz = mix(pixel, morphPixel, morph) - mapSize / 2.0;
+    pos.y = mix(aHeights.x, aHeights.y, morph) * yScale - yShift;
+
+    vec2 n = texture(normals, (mix(pixel, morphPixel, morph).yx + 0.5) / mapSize.yx).rg;
+    Normal = mat3(model) * vec3(n.x, sqrt(max(1.0 - dot(n, n), 0.0)), n.y);
+
+    Height = pos.y;
+    Position = (view * model * vec4(pos, 1.0)).xyz;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
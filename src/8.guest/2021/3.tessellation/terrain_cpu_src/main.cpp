@@ -9,6 +9,8 @@
 
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/chunked_terrain.h>
+#include <learnopengl/heightfield.h>
 
 #include <iostream>
 #include <vector>
@@ -23,7 +25,8 @@ void processInput(GLFWwindow *window);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 int useWireframe = 0;
-int displayGrayscale = 0;
+int displayGrayscale = 0;   // G toggles between plain height and height shaded with the normals
+int useFullMesh = 0;    // L toggles between the chunked LOD terrain and the full-resolution mesh
 
 // camera - give pretty starting point
 Camera camera(glm::vec3(67.0f, 627.5f, 169.9f),
@@ -36,6 +39,8 @@ bool firstMouse = true;
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+unsigned int frameCount = 0;
+float frameTimeTotal = 0.0f;
 
 int main()
 {
@@ -83,6 +88,7 @@ int main()
     // build and compile our shader program
     // ------------------------------------
     Shader heightMapShader("8.3.cpuheight.vs","8.3.cpuheight.fs");
+    Shader chunkedShader("8.3.cpuheight_lod.vs","8.3.cpuheight.fs");
 
     // load and create a texture
     // -------------------------
@@ -101,62 +107,20 @@ int main()
     }
 
 
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    std::vector<float> vertices;
+    // chunked terrain: a quadtree of LOD chunks, only the heights go to the GPU
+    // ------------------------------------------------------------------------
     float yScale = 64.0f / 256.0f, yShift = 16.0f;
-    int rez = 1;
-    unsigned bytePerPixel = nrChannels;
-    for(int i = 0; i < height; i++)
-    {
-        for(int j = 0; j < width; j++)
-        {
-            unsigned char* pixelOffset = data + (j + width * i) * bytePerPixel;
-            unsigned char y = pixelOffset[0];
-
-            // vertex
-            vertices.push_back( -height/2.0f + height*i/(float)height );   // vx
-            vertices.push_back( (int) y * yScale - yShift);   // vy
-            vertices.push_back( -width/2.0f + width*j/(float)width );   // vz
-        }
-    }
-    std::cout << "Loaded " << vertices.size() / 3 << " vertices" << std::endl;
-    stbi_image_free(data);
-
-    std::vector<unsigned> indices;
-    for(unsigned i = 0; i < height-1; i += rez)
-    {
-        for(unsigned j = 0; j < width; j += rez)
-        {
-            for(unsigned k = 0; k < 2; k++)
-            {
-                indices.push_back(j + width * (i + k*rez));
-            }
-        }
-    }
-    std::cout << "Loaded " << indices.size() << " indices" << std::endl;
-
-    const int numStrips = (height-1)/rez;
-    const int numTrisPerStrip = (width/rez)*2-2;
-    std::cout << "Created lattice of " << numStrips << " strips with " << numTrisPerStrip << " triangles each" << std::endl;
-    std::cout << "Created " << numStrips * numTrisPerStrip << " triangles total" << std::endl;
-
-    // first, configure the cube's VAO (and terrainVBO + terrainIBO)
-    unsigned int terrainVAO, terrainVBO, terrainIBO;
-    glGenVertexArrays(1, &terrainVAO);
-    glBindVertexArray(terrainVAO);
-
-    glGenBuffers(1, &terrainVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &terrainIBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainIBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned), &indices[0], GL_STATIC_DRAW);
+    double buildStart = glfwGetTime();
+    ChunkedTerrain *terrain = new ChunkedTerrain(data, height, width, nrChannels, yScale, yShift);
+    std::cout << "Created chunked terrain of " << terrain->NodeCount() << " nodes, " << terrain->GpuBytes() / (1024.0 * 1024.0)
+              << " MB in " << (glfwGetTime() - buildStart) * 1000.0 << " ms" << std::endl;
+
+    // full-resolution heightfield: heights and normals in textures, the vertices are pulled from them
+    // -----------------------------------------------------------------------------------------------
+    Heightfield *heightfield = new Heightfield(data, height, width, nrChannels, yScale, yShift);
+    std::cout << "Created heightfield of " << heightfield->Triangles() << " triangles, " << heightfield->GpuBytes() / (1024.0 * 1024.0)
+              << " MB (" << heightfield->MeshBytes() / (1024.0 * 1024.0) << " MB as a vertex buffer mesh) in "
+              << heightfield->BuildMilliseconds << " ms" << std::endl;
 
     // render loop
     // -----------
@@ -191,16 +155,43 @@ int main()
         // world transformation
         glm::mat4 model = glm::mat4(1.0f);
         heightMapShader.setMat4("model", model);
-        
-        // render the cube
-        glBindVertexArray(terrainVAO);
-//        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        for(unsigned strip = 0; strip < numStrips; strip++)
+
+        heightMapShader.setBool("shaded", !displayGrayscale);
+
+        unsigned int drawCalls, triangles;
+        if (useFullMesh)
         {
-            glDrawElements(GL_TRIANGLE_STRIP,   // primitive type
-                           numTrisPerStrip+2,   // number of indices to render
-                           GL_UNSIGNED_INT,     // index data type
-                           (void*)(sizeof(unsigned) * (numTrisPerStrip+2) * strip)); // offset to starting index
+            // a single instanced draw: one triangle strip per pair of heightmap rows
+            heightfield->Draw(heightMapShader);
+            drawCalls = 1;
+            triangles = heightfield->Triangles();
+        }
+        else
+        {
+            // select the chunks for this camera, then draw them with the morphing shader
+            terrain->Select(projection * view, camera.Position);
+            chunkedShader.use();
+            chunkedShader.setMat4("projection", projection);
+            chunkedShader.setMat4("view", view);
+            chunkedShader.setMat4("model", model);
+            chunkedShader.setBool("shaded", !displayGrayscale);
+            heightfield->Bind(chunkedShader, 1);
+            terrain->Draw(chunkedShader, camera.Position);
+            drawCalls = terrain->DrawCalls;
+            triangles = terrain->Triangles;
+        }
+
+        // once a second: triangles and draw calls of the current mode
+        frameCount++;
+        frameTimeTotal += deltaTime;
+        if (frameTimeTotal >= 1.0f)
+        {
+            std::cout << (useFullMesh ? "full mesh: " : "chunked LOD: ") << triangles << " triangles, " << drawCalls << " draw calls";
+            if (!useFullMesh)
+                std::cout << ", " << terrain->CulledNodes << " nodes culled";
+            std::cout << ", " << frameTimeTotal * 1000.0f / frameCount << " ms/frame" << std::endl;
+            frameCount = 0;
+            frameTimeTotal = 0.0f;
         }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -211,9 +202,9 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &terrainVAO);
-    glDeleteBuffers(1, &terrainVBO);
-    glDeleteBuffers(1, &terrainIBO);
+    delete terrain;
+    delete heightfield;
+    stbi_image_free(data);
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -261,6 +252,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             case GLFW_KEY_G:
                 displayGrayscale = 1 - displayGrayscale;
                 break;
+            case GLFW_KEY_L:
+                useFullMesh = 1 - useFullMesh;
+                break;
             default:
                 break;
         }
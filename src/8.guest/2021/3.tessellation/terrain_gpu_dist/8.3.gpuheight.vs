@@ -1,11 +1,21 @@
-#version 410 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTex;
+#version 430 core
+// vertex pulling: four vertices per visible patch, the corners of patch visiblePatches[gl_VertexID / 4]
+layout(std430, binding = 1) readonly buffer VisiblePatches
+{
+    uint visiblePatches[];
+};
+
+uniform int patchesPerSide;
+uniform vec2 mapSize;
 
 out vec2 TexCoord;
 
 void main()
 {
-    gl_Position = vec4(aPos, 1.0);
-    TexCoord = aTex;
-}
\ No newline at end of file
+    uint patchIndex = visiblePatches[gl_VertexID / 4];
+    uint i = patchIndex / uint(patchesPerSide) + uint(gl_VertexID & 1);
+    uint j = patchIndex % uint(patchesPerSide) + uint((gl_VertexID >> 1) & 1);
+    gl_Position = vec4(-mapSize.x / 2.0 + float(uint(mapSize.x) * i) / float(patchesPerSide), 0.0,
+                       -mapSize.y / 2.0 + float(uint(mapSize.y) * j) / float(patchesPerSide), 1.0);
+    TexCoord = vec2(i, j) / float(patchesPerSide);
+}
@@ -0,0 +1,121 @@
+#version 430 core
+layout(local_size_x = 64) in;
+
+// indirect draw command: vertex count, instance count, first vertex, base instance
+layout(std430, binding = 0) buffer DrawCommand
+{
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint baseInstance;
+};
+layout(std430, binding = 1) writeonly buffer VisiblePatches
+{
+    uint visiblePatches[];
+};
+// per visible patchIndex: 4 outer and 2 inner tessellation levels
+layout(std430, binding = 2) writeonly buffer TessLevels
+{
+    float tessLevels[];
+};
+
+uniform mat4 viewModel;
+uniform mat4 viewProjection;
+uniform bool frustumCull;
+uniform int patchesPerSide;
+uniform vec2 mapSize;
+uniform float tileSize;
+uniform float margin;       // pixels beyond the patchIndex that its heights are filtered from
+uniform int rangeLevels;
+uniform float yScale;
+uniform float yShift;
+uniform sampler2D heightRanges; // tile min and max, mip pyramid
+
+// corner (i, j) of the patchIndex grid, as the vertex shader places it
+vec4 gridPoint(uint i, uint j)
+{
+    return vec4(-mapSize.x / 2.0 + float(uint(mapSize.x) * i) / float(patchesPerSide), 0.0,
+                -mapSize.y / 2.0 + float(uint(mapSize.y) * j) / float(patchesPerSide), 1.0);
+}
+
+// "distance" from camera scaled between 0 and 1, as 8.3.gpuheight.tcs did per patchIndex
+float scaledDistance(vec4 p)
+{
+    const float MIN_DISTANCE = 20;
+    const float MAX_DISTANCE = 800;
+    return clamp((abs((viewModel * p).z) - MIN_DISTANCE) / (MAX_DISTANCE - MIN_DISTANCE), 0.0, 1.0);
+}
+
+// height range of patchIndex (i, j): the pyramid level where its tiles fall into at most 2 x 2 texels
+vec2 heightRange(uint i, uint j)
+{
+    vec2 low = max(vec2(i, j) * mapSize / float(patchesPerSide) - margin, vec2(0.0));
+    vec2 high = min(vec2(i + 1u, j + 1u) * mapSize / float(patchesPerSide) + margin, mapSize - 1.0);
+    ivec2 first = ivec2(low / tileSize), last = ivec2(high / tileSize);
+    int level = 0;
+    while (level < rangeLevels - 1 && any(greaterThan((last >> level) - (first >> level), ivec2(1))))
+        level++;
+    vec2 range = vec2(1.0, 0.0);
+    for (int k = 0; k < 4; k++)
+    {
+        ivec2 texel = min((first >> level) + ivec2(k & 1, k >> 1), last >> level);
+        vec2 tile = texelFetch(heightRanges, texel, level).rg;
+        range = vec2(min(range.x, tile.x), max(range.y, tile.y));
+    }
+    return range * yScale - yShift;
+}
+
+bool inFrustum(vec3 boxMin, vec3 boxMax)
+{
+    for (int k = 0; k < 6; k++)
+    {
+        // planes from the rows of the view projection matrix: w + x, w - x, w + y, ...
+        vec4 row = vec4(viewProjection[0][k / 2], viewProjection[1][k / 2], viewProjection[2][k / 2], viewProjection[3][k / 2]);
+        vec4 w = vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        vec4 plane = (k & 1) == 0 ? w + row : w - row;
+        // corner of the box furthest along the plane normal
+        vec3 corner = mix(boxMin, boxMax, greaterThan(plane.xyz, vec3(0.0)));
+        if (dot(plane.xyz, corner) + plane.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+void main()
+{
+    uint patchIndex = gl_GlobalInvocationID.x;
+    if (patchIndex >= uint(patchesPerSide * patchesPerSide))
+        return;
+    uint i = patchIndex / uint(patchesPerSide), j = patchIndex % uint(patchesPerSide);
+    vec4 p00 = gridPoint(i, j);
+    vec4 p01 = gridPoint(i + 1u, j);
+    vec4 p10 = gridPoint(i, j + 1u);
+    vec4 p11 = gridPoint(i + 1u, j + 1u);
+
+    if (frustumCull)
+    {
+        vec2 range = heightRange(i, j);
+        if (!inFrustum(vec3(p00.x, range.x, p00.z), vec3(p11.x, range.y, p11.z)))
+            return;
+    }
+
+    const int MIN_TESS_LEVEL = 4;
+    const int MAX_TESS_LEVEL = 64;
+    float distance00 = scaledDistance(p00);
+    float distance01 = scaledDistance(p01);
+    float distance10 = scaledDistance(p10);
+    float distance11 = scaledDistance(p11);
+    float tessLevel0 = mix(MAX_TESS_LEVEL, MIN_TESS_LEVEL, min(distance10, distance00));
+    float tessLevel1 = mix(MAX_TESS_LEVEL, MIN_TESS_LEVEL, min(distance00, distance01));
+    float tessLevel2 = mix(MAX_TESS_LEVEL, MIN_TESS_LEVEL, min(distance01, distance11));
+    float tessLevel3 = mix(MAX_TESS_LEVEL, MIN_TESS_LEVEL, min(distance11, distance10));
+
+    uint slot = atomicAdd(vertexCount, 4u) / 4u;
+    visiblePatches[slot] = patchIndex;
+    tessLevels[slot * 6u + 0u] = tessLevel0;
+    tessLevels[slot * 6u + 1u] = tessLevel1;
+    tessLevels[slot * 6u + 2u] = tessLevel2;
+    tessLevels[slot * 6u + 3u] = tessLevel3;
+    tessLevels[slot * 6u + 4u] = max(tessLevel1, tessLevel3);
+    tessLevels[slot * 6u + 5u] = max(tessLevel0, tessLevel2);
+}
@@ -9,8 +9,15 @@
 
 #include <learnopengl/shader_t.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/tiled_heightmap.h>
+#include <learnopengl/heightmap_streamer.h>
+#include <learnopengl/patch_culler.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -18,11 +25,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+bool convertImage(const char* imagePath, const char* path);
+void flythrough(HeightmapStreamer& streamer, const TiledHeightmap& heightmap, float time);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
-const unsigned int NUM_PATCH_PTS = 4;
+int cullPatches = 1;    // C toggles the compute frustum culling of patches
 
 // camera - give pretty starting point
 Camera camera(glm::vec3(67.0f, 627.5f, 169.9f),
@@ -35,14 +44,42 @@ bool firstMouse = true;
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
-
-int main()
+unsigned int frameCount = 0;
+float frameTimeTotal = 0.0f;
+
+// usage:
+//   terrain_gpu_dist [heightmap.thm] [--flythrough]   render a tiled heightmap, by default the Iceland one
+//   terrain_gpu_dist --convert image.png out.thm      convert an image to a tiled heightmap
+//   terrain_gpu_dist --convert-raw raw width height out.thm   convert headerless 16-bit little-endian samples
+//   terrain_gpu_dist --synthetic size out.thm         write a size x size synthetic heightmap
+// --flythrough flies diagonally across the map, printing the streaming statistics, and then quits.
+int main(int argc, char* argv[])
 {
+    // tiled heightmap conversion
+    // --------------------------
+    if (argc == 4 && std::strcmp(argv[1], "--convert") == 0)
+        return convertImage(argv[2], argv[3]) ? 0 : -1;
+    if (argc == 6 && std::strcmp(argv[1], "--convert-raw") == 0)
+        return TiledHeightmap::ConvertRaw(argv[2], std::atoi(argv[3]), std::atoi(argv[4]), argv[5]) ? 0 : -1;
+    if (argc == 4 && std::strcmp(argv[1], "--synthetic") == 0)
+        return TiledHeightmap::WriteSynthetic(argv[3], std::atoi(argv[2])) ? 0 : -1;
+
+    const std::string defaultHeightmap = "heightmaps/iceland_heightmap.thm";
+    std::string heightmapPath = defaultHeightmap;
+    bool flythroughMode = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--flythrough") == 0)
+            flythroughMode = true;
+        else
+            heightmapPath = argv[i];
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -88,90 +125,33 @@ int main()
     Shader tessHeightMapShader("8.3.gpuheight.vs","8.3.gpuheight.fs", nullptr,            // if wishing to render as is
                                "8.3.gpuheight.tcs", "8.3.gpuheight.tes");
 
-    // load and create a texture
-    // -------------------------
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    // The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with your own image path.
-    unsigned char *data = stbi_load("heightmaps/iceland_heightmap.png", &width, &height, &nrChannels, 0);
-    if (data)
+    // open the tiled heightmap; only its overview is loaded here, the tiles are streamed in around the camera
+    // ------------------------------------------------------------------------------------------------------
+    TiledHeightmap heightmap;
+    if (!heightmap.Open(heightmapPath) && heightmapPath == defaultHeightmap)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        tessHeightMapShader.setInt("heightMap", 0);
-        std::cout << "Loaded heightmap of size " << height << " x " << width << std::endl;
+        // first run, or a file of an older format
+        std::cout << "Converting heightmaps/iceland_heightmap.png" << std::endl;
+        if (convertImage("heightmaps/iceland_heightmap.png", heightmapPath.c_str()))
+            heightmap.Open(heightmapPath);
     }
-    else
+    if (!heightmap.IsOpen())
     {
-        std::cout << "Failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    std::vector<float> vertices;
-
-    unsigned rez = 20;
-    for(unsigned i = 0; i <= rez-1; i++)
-    {
-        for(unsigned j = 0; j <= rez-1; j++)
-        {
-            vertices.push_back(-width/2.0f + width*i/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*j/(float)rez); // v.z
-            vertices.push_back(i / (float)rez); // u
-            vertices.push_back(j / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*(i+1)/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*j/(float)rez); // v.z
-            vertices.push_back((i+1) / (float)rez); // u
-            vertices.push_back(j / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*i/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*(j+1)/(float)rez); // v.z
-            vertices.push_back(i / (float)rez); // u
-            vertices.push_back((j+1) / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*(i+1)/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*(j+1)/(float)rez); // v.z
-            vertices.push_back((i+1) / (float)rez); // u
-            vertices.push_back((j+1) / (float)rez); // v
-        }
+        glfwTerminate();
+        return -1;
     }
+    int width = heightmap.Width(), height = heightmap.Height();
+    std::cout << "Mapped heightmap of size " << height << " x " << width << " in " << heightmap.TilesX() * heightmap.TilesY()
+              << " tiles, " << heightmap.FileBytes() / (1024 * 1024) << " MB" << std::endl;
+    HeightmapStreamer* streamer = new HeightmapStreamer(heightmap);
+
+    // patch grid: no vertex data, a compute pass lists the visible patches every frame and the
+    // vertex shader pulls their corners from that list
+    // ------------------------------------------------------------------------------------------
+    // about a patch per tile on large heightmaps
+    unsigned rez = std::max(20, std::max(width, height) / 256);
+    PatchCuller* patches = new PatchCuller(heightmap, rez);
     std::cout << "Loaded " << rez*rez << " patches of 4 control points each" << std::endl;
-    std::cout << "Processing " << rez*rez*4 << " vertices in vertex shader" << std::endl;
-
-    // first, configure the cube's VAO (and terrainVBO)
-    unsigned int terrainVAO, terrainVBO;
-    glGenVertexArrays(1, &terrainVAO);
-    glBindVertexArray(terrainVAO);
-
-    glGenBuffers(1, &terrainVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // texCoord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(sizeof(float) * 3));
-    glEnableVertexAttribArray(1);
-
-    glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
 
     // render loop
     // -----------
@@ -186,28 +166,48 @@ int main()
         // input
         // -----
         processInput(window);
+        if (flythroughMode)
+            flythrough(*streamer, heightmap, currentFrame);
+
+        // stream the tiles around the camera; x and z of the camera are raster pixels from the centre
+        glm::vec2 cameraPixel(camera.Position.x + width / 2.0f, camera.Position.z + height / 2.0f);
+        streamer->Update(cameraPixel, glm::vec2(camera.Front.x, camera.Front.z));
 
         // render
         // ------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // be sure to activate shader when setting uniforms/drawing objects
-        tessHeightMapShader.use();
-
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100000.0f);
         glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 model = glm::mat4(1.0f);
+
+        // list the patches to tessellate, with their tessellation levels
+        patches->Cull(projection, view, model, cullPatches);
+
+        // be sure to activate shader when setting uniforms/drawing objects
+        tessHeightMapShader.use();
         tessHeightMapShader.setMat4("projection", projection);
         tessHeightMapShader.setMat4("view", view);
 
         // world transformation
-        glm::mat4 model = glm::mat4(1.0f);
         tessHeightMapShader.setMat4("model", model);
+        streamer->Bind(tessHeightMapShader, 0);
 
         // render the terrain
-        glBindVertexArray(terrainVAO);
-        glDrawArrays(GL_PATCHES, 0, NUM_PATCH_PTS*rez*rez);
+        patches->Draw(tessHeightMapShader);
+
+        // once a second: patches sent through tessellation
+        frameCount++;
+        frameTimeTotal += deltaTime;
+        if (frameTimeTotal >= 1.0f)
+        {
+            std::cout << patches->VisiblePatches() << " of " << patches->PatchCount() << " patches tessellated"
+                      << (cullPatches ? "" : " (culling off)") << ", " << frameTimeTotal * 1000.0f / frameCount << " ms/frame" << std::endl;
+            frameCount = 0;
+            frameTimeTotal = 0.0f;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -217,8 +217,8 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &terrainVAO);
-    glDeleteBuffers(1, &terrainVBO);
+    delete patches;
+    delete streamer;
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -260,6 +260,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     {
         switch(key)
         {
+            case GLFW_KEY_C:
+                cullPatches = 1 - cullPatches;
+                break;
             default:
                 break;
         }
@@ -294,4 +297,77 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(yoffset);
-}
\ No newline at end of file
+}
+
+// converts the heightmap images of this demo, which keep the height in their second channel
+// -------------------------------------------------------------------------------------------
+bool convertImage(const char* imagePath, const char* path)
+{
+    int width, height, nrChannels;
+    unsigned short *data = stbi_load_16(imagePath, &width, &height, &nrChannels, 0);
+    if (!data)
+    {
+        std::cout << "Failed to load " << imagePath << std::endl;
+        return false;
+    }
+    int channel = std::min(1, nrChannels - 1);
+    bool written = TiledHeightmap::Write(path, width, height, [&](int x, int y)
+    {
+        return data[((size_t)y * width + x) * nrChannels + channel];
+    });
+    stbi_image_free(data);
+    return written;
+}
+
+// scripted flight from one corner of the map to the other, for measuring streaming hitches
+// -----------------------------------------------------------------------------------------
+void flythrough(HeightmapStreamer& streamer, const TiledHeightmap& heightmap, float time)
+{
+    static float startTime = -1.0f;
+    static unsigned int warmupFrames = 0, frames = 0, missingFrames = 0, uploads = 0, loads = 0;
+    static double updateTotal = 0.0, updateMax = 0.0;
+    static size_t cpuMax = 0;
+    const float speed = 1024.0f; // raster pixels per second, four tiles at the default tile size
+
+    glm::vec2 from(-heightmap.Width() * 0.45f, -heightmap.Height() * 0.45f);
+    glm::vec2 to = -from;
+    // hold still at the start until the tiles around it are resident, so the statistics cover
+    // the flight and not the initial load
+    if (startTime < 0.0f && (warmupFrames == 0 || streamer.LastFrame.Missing > 0))
+        warmupFrames++;
+    else if (startTime < 0.0f)
+        startTime = time;
+    float t = startTime < 0.0f ? 0.0f : std::min((time - startTime) * speed / glm::length(to - from), 1.0f);
+    glm::vec2 position = from + (to - from) * t;
+    camera.Position = glm::vec3(position.x, 200.0f, position.y);
+    camera.Yaw = glm::degrees(std::atan2(to.y - from.y, to.x - from.x));
+    camera.Pitch = -20.0f;
+    camera.ProcessMouseMovement(0.0f, 0.0f);
+
+    if (startTime < 0.0f)
+        return;
+
+    // statistics of the previous frame's update
+    if (frames > 0)
+    {
+        const HeightmapStreamer::FrameStats& stats = streamer.LastFrame;
+        missingFrames += stats.Missing > 0;
+        uploads += stats.Uploaded;
+        loads += stats.Loaded;
+        updateTotal += stats.UpdateMilliseconds;
+        updateMax = std::max(updateMax, stats.UpdateMilliseconds);
+        cpuMax = std::max(cpuMax, streamer.CpuBytes());
+    }
+    frames++;
+    if (t >= 1.0f)
+    {
+        std::cout << "flythrough: " << warmupFrames << " frames loading the start, then "
+                  << frames << " frames in " << time - startTime << " s, "
+                  << missingFrames << " frames drawing some near tiles from the overview, "
+                  << loads << " tiles loaded, " << uploads << " uploaded" << std::endl;
+        std::cout << "streamer update: " << updateTotal / frames << " ms average, " << updateMax << " ms max; memory: "
+                  << cpuMax / (1024 * 1024) << " MB CPU peak, " << streamer.GpuBytes() / (1024 * 1024) << " MB GPU, "
+                  << heightmap.FileBytes() / (1024 * 1024) << " MB mapped file" << std::endl;
+        glfwSetWindowShouldClose(glfwGetCurrentContext(), true);
+    }
+}